@@ -0,0 +1,227 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "CommandCapture.h"
+
+#include <vector>
+
+class CommandQueue;
+
+// Receives the commands of a CommandCapture as it is replayed. Object ids
+// have already been mapped to objects and descriptor handles are passed
+// through as captured.
+class CaptureBackend
+{
+public:
+	virtual ~CaptureBackend() = default;
+
+	virtual void BeginCommandList(D3D12_COMMAND_LIST_TYPE type) = 0;
+	virtual void EndCommandList() = 0;
+	virtual void EndFrame() = 0;
+
+	virtual void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) = 0;
+	virtual void SetComputeRootSignature(ID3D12RootSignature* rootSignature) = 0;
+	virtual void SetPipelineState(ID3D12PipelineState* pipelineState) = 0;
+	virtual void SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps) = 0;
+
+	virtual void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+	virtual void SetComputeRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+	virtual void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void SetComputeRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void SetComputeRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void SetGraphicsRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void SetComputeRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues) = 0;
+	virtual void SetComputeRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues) = 0;
+
+	virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology) = 0;
+	virtual void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+	virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) = 0;
+
+	virtual void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) = 0;
+	virtual void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) = 0;
+
+	virtual void OMSetRenderTargets(
+		UINT numRenderTargetDescriptors,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetDescriptors,
+		BOOL rtsSingleHandleToDescriptorRange,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilDescriptor) = 0;
+	virtual void OMSetBlendFactor(const FLOAT blendFactor[4]) = 0;
+	virtual void OMSetStencilRef(UINT stencilRef) = 0;
+
+	virtual void DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) = 0;
+	virtual void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ) = 0;
+
+	virtual void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) = 0;
+	virtual void CopyBufferRegion(ID3D12Resource* dstBuffer, UINT64 dstOffset, ID3D12Resource* srcBuffer, UINT64 srcOffset, UINT64 numBytes) = 0;
+	virtual void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT dstX, UINT dstY, UINT dstZ, const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* srcBox) = 0;
+	virtual void CopyResource(ID3D12Resource* dstResource, ID3D12Resource* srcResource) = 0;
+
+	virtual void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT colorRGBA[4], UINT numRects, const D3D12_RECT* rects) = 0;
+	virtual void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS clearFlags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) = 0;
+
+	virtual void ExecuteBundle(ID3D12GraphicsCommandList* bundle) = 0;
+};
+
+// Drops every command, so a replay measures only the cost of decoding the
+// capture and the application-side work around it.
+class NullCaptureBackend : public CaptureBackend
+{
+public:
+	void BeginCommandList(D3D12_COMMAND_LIST_TYPE) override {}
+	void EndCommandList() override {}
+	void EndFrame() override {}
+
+	void SetGraphicsRootSignature(ID3D12RootSignature*) override {}
+	void SetComputeRootSignature(ID3D12RootSignature*) override {}
+	void SetPipelineState(ID3D12PipelineState*) override {}
+	void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) override {}
+
+	void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) override {}
+	void SetComputeRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) override {}
+	void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+	void SetComputeRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+	void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+	void SetComputeRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+	void SetGraphicsRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+	void SetComputeRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+	void SetGraphicsRoot32BitConstants(UINT, UINT, const void*, UINT) override {}
+	void SetComputeRoot32BitConstants(UINT, UINT, const void*, UINT) override {}
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) override {}
+	void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) override {}
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) override {}
+
+	void RSSetViewports(UINT, const D3D12_VIEWPORT*) override {}
+	void RSSetScissorRects(UINT, const D3D12_RECT*) override {}
+
+	void OMSetRenderTargets(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE*) override {}
+	void OMSetBlendFactor(const FLOAT[4]) override {}
+	void OMSetStencilRef(UINT) override {}
+
+	void DrawInstanced(UINT, UINT, UINT, UINT) override {}
+	void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) override {}
+	void Dispatch(UINT, UINT, UINT) override {}
+
+	void ResourceBarrier(UINT, const D3D12_RESOURCE_BARRIER*) override {}
+	void CopyBufferRegion(ID3D12Resource*, UINT64, ID3D12Resource*, UINT64, UINT64) override {}
+	void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION*, UINT, UINT, UINT, const D3D12_TEXTURE_COPY_LOCATION*, const D3D12_BOX*) override {}
+	void CopyResource(ID3D12Resource*, ID3D12Resource*) override {}
+
+	void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE, const FLOAT[4], UINT, const D3D12_RECT*) override {}
+	void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_CLEAR_FLAGS, FLOAT, UINT8, UINT, const D3D12_RECT*) override {}
+
+	void ExecuteBundle(ID3D12GraphicsCommandList*) override {}
+};
+
+// Records each captured list into a list from the queue and submits a
+// frame's lists together at EndFrame. Lists of another type than the
+// queue's are skipped.
+class D3D12CaptureBackend : public CaptureBackend
+{
+public:
+	explicit D3D12CaptureBackend(CommandQueue& queue);
+
+	// Fence value of the last submitted frame.
+	UINT64 GetLastFenceValue() const { return m_LastFenceValue; }
+
+	void BeginCommandList(D3D12_COMMAND_LIST_TYPE type) override;
+	void EndCommandList() override;
+	void EndFrame() override;
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) override { if (m_List) m_List->SetGraphicsRootSignature(rootSignature); }
+	void SetComputeRootSignature(ID3D12RootSignature* rootSignature) override { if (m_List) m_List->SetComputeRootSignature(rootSignature); }
+	void SetPipelineState(ID3D12PipelineState* pipelineState) override { if (m_List) m_List->SetPipelineState(pipelineState); }
+	void SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps) override { if (m_List) m_List->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps); }
+
+	void SetGraphicsRootDescriptorTable(UINT index, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override { if (m_List) m_List->SetGraphicsRootDescriptorTable(index, baseDescriptor); }
+	void SetComputeRootDescriptorTable(UINT index, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override { if (m_List) m_List->SetComputeRootDescriptorTable(index, baseDescriptor); }
+	void SetGraphicsRootConstantBufferView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS location) override { if (m_List) m_List->SetGraphicsRootConstantBufferView(index, location); }
+	void SetComputeRootConstantBufferView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS location) override { if (m_List) m_List->SetComputeRootConstantBufferView(index, location); }
+	void SetGraphicsRootShaderResourceView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS location) override { if (m_List) m_List->SetGraphicsRootShaderResourceView(index, location); }
+	void SetComputeRootShaderResourceView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS location) override { if (m_List) m_List->SetComputeRootShaderResourceView(index, location); }
+	void SetGraphicsRootUnorderedAccessView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS location) override { if (m_List) m_List->SetGraphicsRootUnorderedAccessView(index, location); }
+	void SetComputeRootUnorderedAccessView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS location) override { if (m_List) m_List->SetComputeRootUnorderedAccessView(index, location); }
+	void SetGraphicsRoot32BitConstants(UINT index, UINT count, const void* data, UINT offset) override { if (m_List) m_List->SetGraphicsRoot32BitConstants(index, count, data, offset); }
+	void SetComputeRoot32BitConstants(UINT index, UINT count, const void* data, UINT offset) override { if (m_List) m_List->SetComputeRoot32BitConstants(index, count, data, offset); }
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology) override { if (m_List) m_List->IASetPrimitiveTopology(primitiveTopology); }
+	void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override { if (m_List) m_List->IASetVertexBuffers(startSlot, numViews, views); }
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override { if (m_List) m_List->IASetIndexBuffer(view); }
+
+	void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) override { if (m_List) m_List->RSSetViewports(numViewports, viewports); }
+	void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) override { if (m_List) m_List->RSSetScissorRects(numRects, rects); }
+
+	void OMSetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargets, BOOL singleRange, const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencil) override { if (m_List) m_List->OMSetRenderTargets(count, renderTargets, singleRange, depthStencil); }
+	void OMSetBlendFactor(const FLOAT blendFactor[4]) override { if (m_List) m_List->OMSetBlendFactor(blendFactor); }
+	void OMSetStencilRef(UINT stencilRef) override { if (m_List) m_List->OMSetStencilRef(stencilRef); }
+
+	void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance) override { if (m_List) m_List->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance); }
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override { if (m_List) m_List->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance); }
+	void Dispatch(UINT x, UINT y, UINT z) override { if (m_List) m_List->Dispatch(x, y, z); }
+
+	void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override { if (m_List) m_List->ResourceBarrier(numBarriers, barriers); }
+	void CopyBufferRegion(ID3D12Resource* dst, UINT64 dstOffset, ID3D12Resource* src, UINT64 srcOffset, UINT64 numBytes) override { if (m_List) m_List->CopyBufferRegion(dst, dstOffset, src, srcOffset, numBytes); }
+	void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT x, UINT y, UINT z, const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* box) override { if (m_List) m_List->CopyTextureRegion(dst, x, y, z, src, box); }
+	void CopyResource(ID3D12Resource* dst, ID3D12Resource* src) override { if (m_List) m_List->CopyResource(dst, src); }
+
+	void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE view, const FLOAT color[4], UINT numRects, const D3D12_RECT* rects) override { if (m_List) m_List->ClearRenderTargetView(view, color, numRects, rects); }
+	void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE view, D3D12_CLEAR_FLAGS flags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) override { if (m_List) m_List->ClearDepthStencilView(view, flags, depth, stencil, numRects, rects); }
+
+	void ExecuteBundle(ID3D12GraphicsCommandList* bundle) override { if (m_List) m_List->ExecuteBundle(bundle); }
+
+private:
+	CommandQueue& m_Queue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_List;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> m_FrameLists;
+	UINT64 m_LastFenceValue;
+};
+
+// Decodes a capture into a backend. Reuses its scratch arrays between
+// commands, so replaying allocates nothing once warmed up.
+class CaptureReplayer
+{
+public:
+	struct Stats
+	{
+		UINT64 Frames = 0;
+		UINT64 CommandLists = 0;
+		UINT64 Commands = 0;
+		// Unknown commands, payloads that do not match their command, and
+		// commands missing an object D3D12 does not accept null for.
+		UINT64 SkippedCommands = 0;
+	};
+
+	// objects[id] is the object to use for capture object id; ids outside it
+	// or mapped to null replay as null, and commands that need the object
+	// are skipped. Pass capture.GetCapturedObjects() when replaying in the
+	// process that made the capture. Each entry must point to the type the
+	// capture registered for that id.
+	Stats Replay(const CommandCapture& capture, CaptureBackend& backend, const std::vector<void*>& objects);
+	Stats ReplayFrame(const CommandCapture& capture, size_t frame, CaptureBackend& backend, const std::vector<void*>& objects);
+
+	struct BenchmarkResult
+	{
+		double FrameMilliseconds = 0.0;    // Average per captured frame.
+		double CommandNanoseconds = 0.0;   // Average per command.
+	};
+
+	// Replay the whole capture iterationCount times at full speed.
+	static BenchmarkResult RunBenchmark(const CommandCapture& capture, CaptureBackend& backend,
+		const std::vector<void*>& objects, UINT iterationCount = 16);
+
+private:
+	void ReplayCommandList(const CapturedCommandList& list, CaptureBackend& backend, const std::vector<void*>& objects, Stats& stats);
+
+	std::vector<UINT32> m_Constants;
+	std::vector<ID3D12DescriptorHeap*> m_DescriptorHeaps;
+	std::vector<D3D12_VERTEX_BUFFER_VIEW> m_VertexBuffers;
+	std::vector<D3D12_VIEWPORT> m_Viewports;
+	std::vector<D3D12_RECT> m_Rects;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_RenderTargets;
+	std::vector<D3D12_RESOURCE_BARRIER> m_Barriers;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Fixed-capacity Chase-Lev work-stealing deque of pointers.
+//
+// The owning thread pushes and pops at the bottom; any other thread may
+// steal from the top. Memory orderings follow Le, Pop, Cohen and Zappa
+// Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models"
+// (PPoPP 2013). The buffer does not grow: Push returns false when full and
+// the caller is expected to run the item itself.
+template <typename T>
+class ChaseLevDeque
+{
+public:
+	// capacity must be a power of two.
+	explicit ChaseLevDeque(size_t capacity = 4096)
+		: m_Top(0)
+		, m_Bottom(0)
+		, m_Mask(static_cast<int64_t>(capacity) - 1)
+		, m_Buffer(new std::atomic<T*>[capacity])
+	{}
+
+	ChaseLevDeque(const ChaseLevDeque&) = delete;
+	ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+	// Owner only.
+	bool Push(T* item)
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		if (bottom - top > m_Mask)
+		{
+			return false;
+		}
+
+		m_Buffer[bottom & m_Mask].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Owner only. Takes the most recently pushed item.
+	T* Pop()
+	{
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Empty.
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = m_Buffer[bottom & m_Mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last item: race thieves for it.
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = nullptr;
+			}
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread. Takes the oldest item, or returns null if the deque is empty
+	// or another thread won the race for it.
+	T* Steal()
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		T* item = m_Buffer[top & m_Mask].load(std::memory_order_relaxed);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return item;
+	}
+
+	// Approximate when called concurrently with other operations.
+	size_t GetSize() const
+	{
+		int64_t size = m_Bottom.load(std::memory_order_relaxed) - m_Top.load(std::memory_order_relaxed);
+		return size > 0 ? static_cast<size_t>(size) : 0;
+	}
+
+private:
+	// Top and bottom are kept a cache line apart, since thieves hammer one and
+	// the owner the other. Padding rather than alignas, so that deques can be
+	// allocated with plain new.
+	static const size_t CacheLineSize = 64;
+
+	std::atomic<int64_t> m_Top;
+	char m_TopPadding[CacheLineSize - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t> m_Bottom;
+	char m_BottomPadding[CacheLineSize - sizeof(std::atomic<int64_t>)];
+	int64_t m_Mask;
+	std::unique_ptr<std::atomic<T*>[]> m_Buffer;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binary capture of ID3D12GraphicsCommandList calls, for replaying real
+// frames offline as reproducible CPU benchmarks.
+//
+// A capture is a table of the D3D12 objects the commands refer to, a list of
+// recorded command lists in submission order, and the frame boundaries
+// between them. Objects are stored by id, so a capture can be saved and
+// replayed in another process once the replayer maps ids to new objects.
+// Descriptor handles and GPU virtual addresses are stored as raw values.
+//
+// Each command list is a packed stream of commands. A command is an 8 byte
+// header (command, reserved, payload size) followed by its arguments, so a
+// replayer can skip commands it does not know.
+
+enum class CaptureCommand : UINT16
+{
+	SetGraphicsRootSignature,
+	SetComputeRootSignature,
+	SetPipelineState,
+	SetDescriptorHeaps,
+	SetGraphicsRootDescriptorTable,
+	SetComputeRootDescriptorTable,
+	SetGraphicsRootConstantBufferView,
+	SetComputeRootConstantBufferView,
+	SetGraphicsRootShaderResourceView,
+	SetComputeRootShaderResourceView,
+	SetGraphicsRootUnorderedAccessView,
+	SetComputeRootUnorderedAccessView,
+	SetGraphicsRoot32BitConstants,
+	SetComputeRoot32BitConstants,
+	IASetPrimitiveTopology,
+	IASetVertexBuffers,
+	IASetIndexBuffer,
+	RSSetViewports,
+	RSSetScissorRects,
+	OMSetRenderTargets,
+	OMSetBlendFactor,
+	OMSetStencilRef,
+	DrawInstanced,
+	DrawIndexedInstanced,
+	Dispatch,
+	ResourceBarrier,
+	CopyBufferRegion,
+	CopyTextureRegion,
+	CopyResource,
+	ClearRenderTargetView,
+	ClearDepthStencilView,
+	ExecuteBundle,
+	Count
+};
+
+const char* GetCaptureCommandName(CaptureCommand command);
+
+enum class CaptureObjectType : UINT32
+{
+	Resource,
+	PipelineState,
+	RootSignature,
+	DescriptorHeap,
+	CommandList,
+};
+
+struct CaptureCommandHeader
+{
+	UINT16 Command;
+	UINT16 Reserved;
+	UINT32 Size;  // Payload bytes after the header.
+};
+
+struct CapturedCommandList
+{
+	D3D12_COMMAND_LIST_TYPE Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+	UINT32 CommandCount = 0;
+	std::vector<UINT8> Commands;
+};
+
+class CommandCapture
+{
+public:
+	static const UINT32 Version = 1;
+
+	// Id 0 is null. Registering an object again returns its existing id.
+	// Thread-safe.
+	UINT32 RegisterObject(const void* object, CaptureObjectType type);
+
+	// Lists must be added in submission order. Thread-safe.
+	void AddCommandList(CapturedCommandList list);
+
+	// Lists added after the last EndFrame belong to no frame and are not saved.
+	void EndFrame();
+
+	void Clear();
+
+	// Drop the lists and frames but keep the object ids, so recorders that
+	// cache them can carry on. Thread-safe.
+	void ClearCommandLists();
+
+	// Object ids run from 1 to GetObjectCount() inclusive.
+	UINT32 GetObjectCount() const { return static_cast<UINT32>(m_ObjectTypes.size()) - 1; }
+	CaptureObjectType GetObjectType(UINT32 id) const { return m_ObjectTypes[id]; }
+
+	// The objects indexed by id, as captured in this process. Entry 0 is null.
+	// After Load every entry is null until the caller fills in replacements.
+	const std::vector<void*>& GetCapturedObjects() const { return m_Objects; }
+
+	size_t GetFrameCount() const { return m_FrameEnds.size(); }
+	size_t GetFrameBegin(size_t frame) const { return frame == 0 ? 0 : m_FrameEnds[frame - 1]; }
+	size_t GetFrameEnd(size_t frame) const { return m_FrameEnds[frame]; }
+
+	size_t GetCommandListCount() const { return m_Lists.size(); }
+	const CapturedCommandList& GetCommandList(size_t index) const { return m_Lists[index]; }
+
+	UINT64 GetCommandCount() const;
+	UINT64 GetByteSize() const;
+
+	// Throws FileError if the file cannot be written.
+	void Save(const std::wstring& path) const;
+
+	// Returns false, leaving the capture empty, if the file is missing, has a
+	// different version or does not parse.
+	bool Load(const std::wstring& path);
+
+private:
+	mutable std::mutex m_Mutex;
+	std::unordered_map<const void*, UINT32> m_ObjectIds;
+	std::vector<CaptureObjectType> m_ObjectTypes = { CaptureObjectType::Resource };
+	std::vector<void*> m_Objects = { nullptr };
+	std::vector<CapturedCommandList> m_Lists;
+	std::vector<size_t> m_FrameEnds;
+};
+
+// Records into a CommandCapture while forwarding every call to a real command
+// list, or to nothing if the list is null. One per recording thread.
+//
+// Recording appends the arguments to a growing buffer and looks objects up
+// in a cache local to the recorder, so it stays a small fraction of the cost
+// of the D3D12 call it wraps.
+class CapturingCommandList
+{
+public:
+	CapturingCommandList(CommandCapture& capture, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
+		D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+	ID3D12GraphicsCommandList* Get() const { return m_CommandList.Get(); }
+
+	// Hand the commands recorded so far to the capture as one list and start
+	// a new one on commandList. The lists themselves are not closed or reset.
+	void Finish(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList = nullptr);
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature);
+	void SetComputeRootSignature(ID3D12RootSignature* rootSignature);
+	void SetPipelineState(ID3D12PipelineState* pipelineState);
+	void SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps);
+
+	void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+	void SetComputeRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+	void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetComputeRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetComputeRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetGraphicsRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetComputeRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues);
+	void SetComputeRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues);
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology);
+	void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views);
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+
+	void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports);
+	void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects);
+
+	void OMSetRenderTargets(
+		UINT numRenderTargetDescriptors,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetDescriptors,
+		BOOL rtsSingleHandleToDescriptorRange,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilDescriptor);
+	void OMSetBlendFactor(const FLOAT blendFactor[4]);
+	void OMSetStencilRef(UINT stencilRef);
+
+	void DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+	void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ);
+
+	void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers);
+	void CopyBufferRegion(ID3D12Resource* dstBuffer, UINT64 dstOffset, ID3D12Resource* srcBuffer, UINT64 srcOffset, UINT64 numBytes);
+	void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT dstX, UINT dstY, UINT dstZ, const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* srcBox);
+	void CopyResource(ID3D12Resource* dstResource, ID3D12Resource* srcResource);
+
+	void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT colorRGBA[4], UINT numRects, const D3D12_RECT* rects);
+	void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS clearFlags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects);
+
+	void ExecuteBundle(ID3D12GraphicsCommandList* bundle);
+
+private:
+	class Writer;
+
+	Writer BeginCommand(CaptureCommand command, size_t payloadSize);
+	void WriteRootArgument(CaptureCommand command, UINT rootParameterIndex, UINT64 value);
+	UINT32 GetObjectId(const void* object, CaptureObjectType type);
+
+	CommandCapture& m_Capture;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
+	CapturedCommandList m_List;
+	std::unordered_map<const void*, UINT32> m_ObjectIds;
+};
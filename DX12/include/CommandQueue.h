@@ -0,0 +1,93 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "Fence.h"
+#include "FencedPool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A command queue that hands out ready-to-record command lists.
+//
+// Allocators are pooled and tagged with the fence value of the submission
+// that used them. An allocator is reset and handed out again only after the
+// GPU has passed that value, so a new allocator is created only when every
+// pooled one is still in flight. Submitted lists go back to the pool as they
+// are and are reset against a fresh allocator when GetCommandList hands them
+// out again; a list, unlike its allocator, can be reset once it is submitted.
+//
+// GetCommandList and ExecuteCommandLists may be called from any thread.
+// Passing a SimulatedFence lets allocator recycling be driven by hand. The
+// destructor flushes, so complete every value of a simulated fence first.
+class CommandQueue
+{
+public:
+	struct Stats
+	{
+		UINT64 AllocatorsCreated = 0;
+		UINT64 AllocatorsRecycled = 0;
+		UINT64 ListsCreated = 0;
+		UINT64 ListsRecycled = 0;
+		UINT64 Submissions = 0;
+	};
+
+	CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type, std::shared_ptr<Fence> fence = nullptr);
+	~CommandQueue();
+
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	// An open command list with its own allocator.
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> GetCommandList();
+
+	// Close and submit the lists in order with one ExecuteCommandLists call.
+	// Returns the fence value that completes when they have finished.
+	UINT64 ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList);
+	UINT64 ExecuteCommandLists(const std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>>& commandLists);
+
+	// Same for lists the caller has already closed.
+	UINT64 ExecuteClosedCommandLists(const std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>>& commandLists);
+
+	// Make the GPU wait for another queue's fence before running anything
+	// submitted after this call.
+	void Wait(Fence& fence, UINT64 fenceValue);
+
+	UINT64 Signal();
+	bool IsFenceComplete(UINT64 fenceValue) const;
+	void WaitForFenceValue(UINT64 fenceValue);
+	void Flush();
+
+	ID3D12CommandQueue* GetD3D12CommandQueue() const { return m_CommandQueue.Get(); }
+	D3D12_COMMAND_LIST_TYPE GetType() const { return m_Type; }
+	Fence& GetFence() const { return *m_Fence; }
+
+	Stats GetStats() const;
+	size_t GetPooledAllocatorCount() const { return m_Allocators.GetSize(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> AcquireAllocator();
+
+	Microsoft::WRL::ComPtr<ID3D12Device2> m_Device;
+	D3D12_COMMAND_LIST_TYPE m_Type;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CommandQueue;
+	std::shared_ptr<Fence> m_Fence;
+
+	// Submission and signaling happen under one lock so that allocators are
+	// released into the pool in fence order.
+	std::mutex m_SubmitMutex;
+
+	FencedPool<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> m_Allocators;
+
+	std::mutex m_ListMutex;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> m_Lists;
+
+	std::atomic<UINT64> m_AllocatorsCreated;
+	std::atomic<UINT64> m_AllocatorsRecycled;
+	std::atomic<UINT64> m_ListsCreated;
+	std::atomic<UINT64> m_ListsRecycled;
+	std::atomic<UINT64> m_Submissions;
+};
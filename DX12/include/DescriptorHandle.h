@@ -0,0 +1,170 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cassert>
+
+// Descriptor handles that carry their heap type in the type system.
+//
+// The increment size for each heap type is read once from the device at
+// startup, so offsetting a handle is a multiply-add against a cached value
+// and handles from different heap types can't be mixed up.
+
+class DescriptorIncrementTable
+{
+public:
+	// Query the increment size of every heap type. Call once after the device
+	// has been created.
+	static void Initialize(ID3D12Device* device);
+
+	static bool IsInitialized() { return s_Initialized; }
+
+	template <D3D12_DESCRIPTOR_HEAP_TYPE Type>
+	static UINT Get()
+	{
+		static_assert(Type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES, "Invalid descriptor heap type.");
+		assert(s_Initialized && "DescriptorIncrementTable::Initialize must be called before using typed handles.");
+		return s_IncrementSizes[Type];
+	}
+
+	static UINT Get(D3D12_DESCRIPTOR_HEAP_TYPE type)
+	{
+		assert(s_Initialized && type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES);
+		return s_IncrementSizes[type];
+	}
+
+private:
+	static UINT s_IncrementSizes[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+	static bool s_Initialized;
+};
+
+template <D3D12_DESCRIPTOR_HEAP_TYPE Type>
+struct TypedCpuDescriptorHandle : public D3D12_CPU_DESCRIPTOR_HANDLE
+{
+	static const D3D12_DESCRIPTOR_HEAP_TYPE HeapType = Type;
+
+	TypedCpuDescriptorHandle()
+	{
+		ptr = 0;
+	}
+	explicit TypedCpuDescriptorHandle(const D3D12_CPU_DESCRIPTOR_HANDLE& o) :
+		D3D12_CPU_DESCRIPTOR_HANDLE(o)
+	{}
+	TypedCpuDescriptorHandle(const D3D12_CPU_DESCRIPTOR_HANDLE& base, INT offsetInDescriptors)
+	{
+		ptr = SIZE_T(INT64(base.ptr) + INT64(offsetInDescriptors) * INT64(DescriptorIncrementTable::Get<Type>()));
+	}
+
+	// Start of the CPU visible range of a heap. The heap type is checked in debug builds.
+	static TypedCpuDescriptorHandle HeapStart(ID3D12DescriptorHeap* heap)
+	{
+		assert(heap->GetDesc().Type == Type && "Descriptor heap type does not match handle type.");
+		return TypedCpuDescriptorHandle(heap->GetCPUDescriptorHandleForHeapStart());
+	}
+
+	TypedCpuDescriptorHandle& Offset(INT offsetInDescriptors)
+	{
+		ptr = SIZE_T(INT64(ptr) + INT64(offsetInDescriptors) * INT64(DescriptorIncrementTable::Get<Type>()));
+		return *this;
+	}
+
+	TypedCpuDescriptorHandle operator+(INT offsetInDescriptors) const
+	{
+		return TypedCpuDescriptorHandle(*this, offsetInDescriptors);
+	}
+
+	TypedCpuDescriptorHandle& operator+=(INT offsetInDescriptors)
+	{
+		return Offset(offsetInDescriptors);
+	}
+
+	TypedCpuDescriptorHandle& operator++()
+	{
+		return Offset(1);
+	}
+
+	TypedCpuDescriptorHandle operator[](INT offsetInDescriptors) const
+	{
+		return TypedCpuDescriptorHandle(*this, offsetInDescriptors);
+	}
+
+	// Number of descriptors between two handles of the same heap.
+	INT operator-(const TypedCpuDescriptorHandle& other) const
+	{
+		return INT((INT64(ptr) - INT64(other.ptr)) / INT64(DescriptorIncrementTable::Get<Type>()));
+	}
+
+	bool operator==(const TypedCpuDescriptorHandle& other) const { return ptr == other.ptr; }
+	bool operator!=(const TypedCpuDescriptorHandle& other) const { return ptr != other.ptr; }
+	bool IsNull() const { return ptr == 0; }
+};
+
+template <D3D12_DESCRIPTOR_HEAP_TYPE Type>
+struct TypedGpuDescriptorHandle : public D3D12_GPU_DESCRIPTOR_HANDLE
+{
+	static_assert(Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+		"Only CBV_SRV_UAV and SAMPLER heaps can be shader visible.");
+
+	static const D3D12_DESCRIPTOR_HEAP_TYPE HeapType = Type;
+
+	TypedGpuDescriptorHandle()
+	{
+		ptr = 0;
+	}
+	explicit TypedGpuDescriptorHandle(const D3D12_GPU_DESCRIPTOR_HANDLE& o) :
+		D3D12_GPU_DESCRIPTOR_HANDLE(o)
+	{}
+	TypedGpuDescriptorHandle(const D3D12_GPU_DESCRIPTOR_HANDLE& base, INT offsetInDescriptors)
+	{
+		ptr = UINT64(INT64(base.ptr) + INT64(offsetInDescriptors) * INT64(DescriptorIncrementTable::Get<Type>()));
+	}
+
+	static TypedGpuDescriptorHandle HeapStart(ID3D12DescriptorHeap* heap)
+	{
+		assert(heap->GetDesc().Type == Type && "Descriptor heap type does not match handle type.");
+		assert((heap->GetDesc().Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) && "Descriptor heap is not shader visible.");
+		return TypedGpuDescriptorHandle(heap->GetGPUDescriptorHandleForHeapStart());
+	}
+
+	TypedGpuDescriptorHandle& Offset(INT offsetInDescriptors)
+	{
+		ptr = UINT64(INT64(ptr) + INT64(offsetInDescriptors) * INT64(DescriptorIncrementTable::Get<Type>()));
+		return *this;
+	}
+
+	TypedGpuDescriptorHandle operator+(INT offsetInDescriptors) const
+	{
+		return TypedGpuDescriptorHandle(*this, offsetInDescriptors);
+	}
+
+	TypedGpuDescriptorHandle& operator+=(INT offsetInDescriptors)
+	{
+		return Offset(offsetInDescriptors);
+	}
+
+	TypedGpuDescriptorHandle& operator++()
+	{
+		return Offset(1);
+	}
+
+	TypedGpuDescriptorHandle operator[](INT offsetInDescriptors) const
+	{
+		return TypedGpuDescriptorHandle(*this, offsetInDescriptors);
+	}
+
+	INT operator-(const TypedGpuDescriptorHandle& other) const
+	{
+		return INT((INT64(ptr) - INT64(other.ptr)) / INT64(DescriptorIncrementTable::Get<Type>()));
+	}
+
+	bool operator==(const TypedGpuDescriptorHandle& other) const { return ptr == other.ptr; }
+	bool operator!=(const TypedGpuDescriptorHandle& other) const { return ptr != other.ptr; }
+	bool IsNull() const { return ptr == 0; }
+};
+
+using CbvSrvUavCpuHandle = TypedCpuDescriptorHandle<D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV>;
+using SamplerCpuHandle = TypedCpuDescriptorHandle<D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER>;
+using RtvCpuHandle = TypedCpuDescriptorHandle<D3D12_DESCRIPTOR_HEAP_TYPE_RTV>;
+using DsvCpuHandle = TypedCpuDescriptorHandle<D3D12_DESCRIPTOR_HEAP_TYPE_DSV>;
+
+using CbvSrvUavGpuHandle = TypedGpuDescriptorHandle<D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV>;
+using SamplerGpuHandle = TypedGpuDescriptorHandle<D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER>;
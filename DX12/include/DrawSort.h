@@ -0,0 +1,155 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+class JobSystem;
+class ShadowedCommandList;
+
+enum class DrawSortField
+{
+	Layer,
+	Pipeline,
+	Material,
+	Depth,
+	Count
+};
+
+// Layout of a 64-bit draw sort key.
+//
+// Fields are packed from the most significant bit down in the order given,
+// so sorting by key sorts by the first field, then the second and so on.
+// Layer, pipeline and material values are masked to their field width, so
+// they should be small dense indices rather than hashes. Depth is a
+// non-negative float (view depth or distance) quantized by keeping the top
+// bits of its IEEE representation, which orders the same way as the value.
+class DrawSortKeyFormat
+{
+public:
+	struct Field
+	{
+		DrawSortField Which;
+		uint32_t Bits;
+	};
+
+	// Bits must be at most 32 per field and 64 in total. Fields left out are
+	// not part of the key.
+	DrawSortKeyFormat(std::initializer_list<Field> fields, bool depthDescending = false);
+
+	// Layer, then pipeline, material and front-to-back depth: minimizes state
+	// changes and still draws roughly front to back within a material.
+	static DrawSortKeyFormat Opaque();
+
+	// Layer, then back-to-front depth, then pipeline and material: blending
+	// needs the order, state changes come second.
+	static DrawSortKeyFormat Transparent();
+
+	uint64_t Encode(uint32_t layer, uint32_t pipeline, uint32_t material, float depth) const;
+
+	// The field's value as stored in the key. Depth comes back quantized.
+	uint32_t Decode(uint64_t key, DrawSortField field) const;
+
+	uint32_t GetBits(DrawSortField field) const { return m_Bits[static_cast<size_t>(field)]; }
+
+private:
+	uint32_t m_Bits[static_cast<size_t>(DrawSortField::Count)];
+	uint32_t m_Shifts[static_cast<size_t>(DrawSortField::Count)];
+	bool m_DepthDescending;
+};
+
+// Everything needed to record one draw.
+struct DrawPacket
+{
+	ID3D12RootSignature* RootSignature;
+	ID3D12PipelineState* PipelineState;
+	D3D12_GPU_DESCRIPTOR_HANDLE MaterialTable;
+	D3D12_GPU_VIRTUAL_ADDRESS ObjectConstants;
+	D3D12_VERTEX_BUFFER_VIEW VertexBuffer;
+	D3D12_INDEX_BUFFER_VIEW IndexBuffer;
+	UINT IndexCount;
+	UINT InstanceCount;
+	UINT StartIndex;
+	INT BaseVertex;
+};
+
+// What gets sorted: the key and the index of its packet. Packets stay where
+// they are, so sorting moves 16 bytes per draw.
+struct DrawSortItem
+{
+	uint64_t Key;
+	uint64_t Packet;
+};
+
+// Stable LSD radix sort on Key, 8 bits per pass. Passes where every key has
+// the same digit are skipped, so keys that only use their low bits sort in
+// fewer passes. With jobs, each pass is spread across the job system; call
+// from the thread that owns it. scratch is used as the second buffer.
+void RadixSortDrawItems(std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch, JobSystem* jobs = nullptr);
+
+struct DrawStateChanges
+{
+	uint64_t RootSignatures = 0;
+	uint64_t PipelineStates = 0;
+	uint64_t Materials = 0;
+	uint64_t VertexBuffers = 0;
+	uint64_t IndexBuffers = 0;
+
+	uint64_t GetTotal() const { return RootSignatures + PipelineStates + Materials + VertexBuffers + IndexBuffers; }
+};
+
+// Records draw packets in sorted order.
+//
+// Every packet sets its full state through a ShadowedCommandList, which drops
+// whatever did not change since the previous packet, so the fewer neighbours
+// differ the fewer calls reach D3D12. The caller sets descriptor heaps,
+// render targets, viewports and topology beforehand.
+class DrawSubmitter
+{
+public:
+	struct RootParameters
+	{
+		UINT MaterialTable = 0;
+		UINT ObjectConstants = 1;
+	};
+
+	explicit DrawSubmitter(const RootParameters& rootParameters);
+
+	// Record order[begin, end). Ranges can be recorded into separate lists in
+	// parallel, for example from ParallelCommandRecorder.
+	void Submit(ShadowedCommandList& commandList, const std::vector<DrawPacket>& packets,
+		const std::vector<DrawSortItem>& order, size_t begin, size_t end) const;
+
+	// The state changes recording packets in this order would make.
+	static DrawStateChanges CountStateChanges(const std::vector<DrawPacket>& packets, const std::vector<DrawSortItem>& order);
+
+	struct BenchmarkResult
+	{
+		uint32_t ThreadCount = 0;
+		double SortMilliseconds = 0.0;
+		double Speedup = 1.0;               // Relative to one thread.
+	};
+
+	struct Benchmark
+	{
+		size_t PacketCount = 0;
+		double StdSortMilliseconds = 0.0;   // std::stable_sort on the same items, for reference.
+		std::vector<BenchmarkResult> RadixSort;
+		DrawStateChanges Unsorted;
+		DrawStateChanges Sorted;
+	};
+
+	// packetCount synthetic packets spread over a few hundred pipelines and a
+	// few thousand materials, and their items in submission order.
+	static void CreateBenchmarkPackets(size_t packetCount, std::vector<DrawPacket>& packets, std::vector<DrawSortItem>& unsorted);
+
+	// Sort packetCount of those packets with 1, 2, 4, ... up to
+	// maxThreadCount threads, and count state changes before and after.
+	static Benchmark RunBenchmark(size_t packetCount = 1 << 20, uint32_t maxThreadCount = 0, uint32_t iterationCount = 8);
+
+private:
+	RootParameters m_RootParameters;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// A monotonically increasing fence on one command queue.
+//
+// Signal is called after work is submitted and returns the value that will be
+// reached once that work finishes. D3D12Fence wraps an ID3D12Fence.
+// SimulatedFence completes values only when told to, so code that recycles
+// GPU resources by fence value can be exercised without a GPU.
+class Fence
+{
+public:
+	virtual ~Fence() = default;
+
+	// Queue a signal after all work submitted so far. Thread-safe.
+	virtual UINT64 Signal(ID3D12CommandQueue* queue) = 0;
+
+	virtual UINT64 GetCompletedValue() const = 0;
+
+	// Block until value completes or timeout expires. Returns true if it completed.
+	virtual bool Wait(UINT64 value, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) = 0;
+
+	// Make queue wait on the GPU until value completes.
+	virtual void QueueWait(ID3D12CommandQueue* queue, UINT64 value) = 0;
+
+	// The last value returned by Signal.
+	virtual UINT64 GetLastSignaledValue() const = 0;
+
+	bool IsComplete(UINT64 value) const { return GetCompletedValue() >= value; }
+};
+
+class D3D12Fence : public Fence
+{
+public:
+	explicit D3D12Fence(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT64 initialValue = 0);
+	~D3D12Fence() override;
+
+	D3D12Fence(const D3D12Fence&) = delete;
+	D3D12Fence& operator=(const D3D12Fence&) = delete;
+
+	UINT64 Signal(ID3D12CommandQueue* queue) override;
+	UINT64 GetCompletedValue() const override;
+	bool Wait(UINT64 value, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) override;
+	void QueueWait(ID3D12CommandQueue* queue, UINT64 value) override;
+	UINT64 GetLastSignaledValue() const override { return m_LastSignaled; }
+
+	ID3D12Fence* Get() const { return m_Fence.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
+	// Serializes Signal so values reach the queue in increasing order.
+	std::mutex m_SignalMutex;
+	std::atomic<UINT64> m_LastSignaled;
+};
+
+// Values complete only through Complete or CompleteAll, which play the role
+// of the GPU. The queue passed to Signal is ignored and may be null.
+class SimulatedFence : public Fence
+{
+public:
+	explicit SimulatedFence(UINT64 initialValue = 0);
+
+	UINT64 Signal(ID3D12CommandQueue* queue) override;
+	UINT64 GetCompletedValue() const override { return m_Completed; }
+	bool Wait(UINT64 value, std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) override;
+	// There is no GPU timeline to stall, so this blocks the calling thread instead.
+	void QueueWait(ID3D12CommandQueue* queue, UINT64 value) override;
+	UINT64 GetLastSignaledValue() const override { return m_LastSignaled; }
+
+	// Complete all values up to value. Values are clamped to the last signal.
+	void Complete(UINT64 value);
+	void CompleteAll() { Complete(m_LastSignaled); }
+
+private:
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Completion;
+	std::atomic<UINT64> m_LastSignaled;
+	std::atomic<UINT64> m_Completed;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Objects the GPU may still be using, each tagged with the fence value after
+// which it is free again.
+//
+// Release must be called with non-decreasing fence values (which is the case
+// when values come from one queue's fence), so only the oldest entry ever
+// needs to be checked. Thread-safe.
+template <typename T>
+class FencedPool
+{
+public:
+	// Take the oldest object whose fence value has completed.
+	bool TryAcquire(uint64_t completedFenceValue, T& object)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Entries.empty() || m_Entries.front().first > completedFenceValue)
+		{
+			return false;
+		}
+		object = std::move(m_Entries.front().second);
+		m_Entries.pop_front();
+		return true;
+	}
+
+	void Release(T object, uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Entries.emplace_back(fenceValue, std::move(object));
+	}
+
+	size_t GetSize() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Entries.size();
+	}
+
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Entries.clear();
+	}
+
+private:
+	mutable std::mutex m_Mutex;
+	std::deque<std::pair<uint64_t, T>> m_Entries;
+};
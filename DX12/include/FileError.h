@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// A file that could not be read or written. what() names the operation and
+// the file, such as "Cannot write benchmark.json", with the path in UTF-8.
+class FileError : public std::runtime_error
+{
+public:
+	FileError(const char* operation, const std::wstring& path);
+
+	const std::wstring& GetPath() const { return m_Path; }
+
+private:
+	std::wstring m_Path;
+};
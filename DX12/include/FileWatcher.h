@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Makes paths that name the same file compare equal: separators become '/',
+// "." and "dir/.." segments are dropped and, on Windows, letters are
+// lowercased. Lexical only; links are not resolved.
+std::wstring NormalizePath(const std::wstring& path);
+
+// Up to and including the last separator, or empty.
+std::wstring GetPathDirectory(const std::wstring& path);
+
+// Reports the files changed in a set of directories.
+//
+// Implementations must allow Watch and Poll to be called from different
+// threads.
+class FileWatcher
+{
+public:
+	virtual ~FileWatcher() = default;
+
+	// Watch the files directly in directory, a normalized path ending in '/',
+	// or empty for the working directory. Watching a directory twice does
+	// nothing. Returns false if it cannot be watched.
+	virtual bool Watch(const std::wstring& directory) = 0;
+
+	// Append the normalized paths of the files written, created or renamed
+	// into place since the last call. Never blocks. A file saved once may be
+	// reported several times. If events were lost, the directory is reported
+	// instead, ending in '/', meaning any file in it may have changed.
+	virtual void Poll(std::vector<std::wstring>& changed) = 0;
+};
+
+// ReadDirectoryChangesW on Windows and inotify on Linux. On other platforms
+// Watch fails.
+class SystemFileWatcher : public FileWatcher
+{
+public:
+	SystemFileWatcher();
+	~SystemFileWatcher() override;
+
+	SystemFileWatcher(const SystemFileWatcher&) = delete;
+	SystemFileWatcher& operator=(const SystemFileWatcher&) = delete;
+
+	bool Watch(const std::wstring& directory) override;
+	void Poll(std::vector<std::wstring>& changed) override;
+
+private:
+	class Platform;
+
+	std::mutex m_Mutex;
+	std::unique_ptr<Platform> m_Platform;
+};
+
+// Reports the changes it is told about, so code built on a watcher can run
+// headless and deterministically. Changes to files outside the watched
+// directories are dropped, as a real watcher would never see them.
+class SimulatedFileWatcher : public FileWatcher
+{
+public:
+	bool Watch(const std::wstring& directory) override;
+	void Poll(std::vector<std::wstring>& changed) override;
+
+	void NotifyChanged(const std::wstring& path);
+	bool IsWatching(const std::wstring& directory) const;
+
+private:
+	mutable std::mutex m_Mutex;
+	std::unordered_set<std::wstring> m_Directories;
+	std::vector<std::wstring> m_Changed;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "FrameStatistics.h"
+
+#include <chrono>
+#include <cstdint>
+
+// A fixed, repeatable frame loop for comparing builds without a window or a
+// GPU.
+//
+// Each frame re-keys a scene of synthetic draws for a moving camera, sorts
+// them with RadixSortDrawItems on a JobSystem and packs them batch by batch
+// into an upload ring with IndirectDrawPacker, paced by a FramePacer against
+// a SimulatedGpu that takes GpuFrameTime per frame. Frame and CPU times are
+// measured on the frame thread, and GPU times, CPU waits and GPU idle time by
+// the pacer. The frames are also profiled, on the CPU and through a
+// GpuProfiler whose timestamps the SimulatedGpu writes, so Profiler can save
+// a trace of the run with a GPU track.
+class FrameBenchmark
+{
+public:
+	struct Options
+	{
+		UINT FrameCount = 1000;
+		UINT WarmupFrames = 100;                            // Run first and left out of the statistics.
+		UINT FramesInFlight = 2;
+		uint32_t DrawCount = 1 << 16;
+		uint32_t ThreadCount = ~0u;                         // Job workers; ~0u for one per remaining core.
+		std::chrono::microseconds GpuFrameTime{ 4000 };
+	};
+
+	// The options are added to the statistics' info.
+	static FrameStatistics Run(const Options& options);
+};
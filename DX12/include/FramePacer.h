@@ -0,0 +1,198 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "Fence.h"
+#include "LatencyHistogram.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Keeps the CPU at most N frames ahead of the GPU.
+//
+// Each frame in flight owns a slot. BeginFrame picks the next slot and, if
+// the GPU is still using it, blocks on the fence event until the frame that
+// last used it completes. EndFrame records the fence value the frame's work
+// will signal. Per-frame resources (constant buffer rings, allocators,
+// descriptor heaps) are indexed by GetSlot, for example through PerFrame.
+//
+// One frame in flight gives the lowest latency with no CPU/GPU overlap; more
+// frames trade latency for throughput. To tune that, the pacer records how
+// long the CPU was blocked on the GPU in BeginFrame and how long the GPU sat
+// idle waiting for the CPU's next frame. The GPU side is measured by a
+// watcher thread that waits on each frame's fence and timestamps its
+// completion, so it is accurate to the event wake-up time.
+class FramePacer
+{
+public:
+	static const UINT MaxFramesInFlight = 4;
+
+	FramePacer(std::shared_ptr<Fence> fence, UINT framesInFlight = 2);
+	// Waits for the GPU to finish every frame handed to EndFrame.
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// Block until the next slot is free and return it.
+	UINT BeginFrame();
+
+	// fenceValue is what the frame's last submission signals.
+	void EndFrame(UINT64 fenceValue);
+
+	// Block until the GPU has finished every frame.
+	void WaitForIdle();
+
+	// Waits for idle, then restarts slot rotation at 0. framesInFlight is
+	// clamped to [1, MaxFramesInFlight].
+	void SetFramesInFlight(UINT framesInFlight);
+	UINT GetFramesInFlight() const { return m_FramesInFlight; }
+
+	UINT GetSlot() const { return m_Slot; }
+	UINT64 GetFrameCount() const { return m_FrameCount; }
+
+	// Time BeginFrame spent blocked on the GPU, one sample per frame.
+	const LatencyHistogram& GetCpuWait() const { return m_CpuWait; }
+	// Time between the GPU finishing a frame and the CPU submitting the next.
+	const LatencyHistogram& GetGpuIdle() const { return m_GpuIdle; }
+	// Time from BeginFrame until the GPU finished the frame.
+	const LatencyHistogram& GetFrameLatency() const { return m_FrameLatency; }
+
+	struct Stats
+	{
+		UINT64 Frames = 0;
+		UINT64 CpuWaitNanoseconds = 0;
+		UINT64 GpuIdleNanoseconds = 0;
+		// Frames the watcher has seen complete, and their summed latency.
+		UINT64 CompletedFrames = 0;
+		UINT64 LatencyNanoseconds = 0;
+	};
+
+	Stats GetStats() const;
+	void ResetStats();
+
+	struct CompletedFrame
+	{
+		UINT64 FrameNumber = 0;         // Counts EndFrame calls from 0.
+		UINT64 GpuNanoseconds = 0;      // From the later of EndFrame and the previous frame's completion.
+		UINT64 LatencyNanoseconds = 0;  // From BeginFrame.
+		UINT64 CpuWaitNanoseconds = 0;  // Its BeginFrame's sample of GetCpuWait.
+		UINT64 GpuIdleNanoseconds = 0;  // Its sample of GetGpuIdle.
+	};
+
+	// Called on the watcher thread as each frame completes, in order, before
+	// WaitForIdle can return for it. It holds up the watcher, so keep it short.
+	// Set it while no frames are in flight.
+	void SetCompletionCallback(std::function<void(const CompletedFrame&)> callback);
+
+	struct BenchmarkResult
+	{
+		UINT FramesInFlight = 0;
+		double FrameMilliseconds = 0.0;       // Average CPU frame interval.
+		double CpuWaitMilliseconds = 0.0;     // Average per frame.
+		double GpuIdleMilliseconds = 0.0;     // Average per frame.
+		double LatencyMilliseconds = 0.0;     // Average BeginFrame to GPU completion.
+	};
+
+	// Run frameCount frames against a SimulatedGpu for 1 to MaxFramesInFlight
+	// frames in flight. Each frame busies the CPU for cpuFrameTime and the GPU
+	// for gpuFrameTime.
+	static std::vector<BenchmarkResult> RunBenchmark(
+		std::chrono::microseconds cpuFrameTime, std::chrono::microseconds gpuFrameTime, UINT frameCount = 120);
+
+private:
+	struct PendingFrame
+	{
+		UINT64 FenceValue;
+		UINT64 FrameNumber;
+		UINT64 BeganAt;
+		UINT64 SubmittedAt;
+		UINT64 CpuWait;
+	};
+
+	void WatchCompletions();
+
+	std::shared_ptr<Fence> m_Fence;
+	UINT m_FramesInFlight;
+	UINT m_Slot;
+	UINT64 m_FrameCount;
+	UINT64 m_SlotFenceValues[MaxFramesInFlight];
+	UINT64 m_FrameBeganAt;
+	UINT64 m_FrameCpuWait;
+
+	LatencyHistogram m_CpuWait;
+	LatencyHistogram m_GpuIdle;
+	LatencyHistogram m_FrameLatency;
+	std::atomic<UINT64> m_CpuWaitTotal;
+	std::atomic<UINT64> m_GpuIdleTotal;
+	std::atomic<UINT64> m_CompletedFrames;
+	std::atomic<UINT64> m_LatencyTotal;
+
+	// Frames submitted but not yet seen complete by the watcher.
+	std::mutex m_Mutex;
+	std::condition_variable m_PendingChanged;
+	std::deque<PendingFrame> m_Pending;
+	UINT64 m_LastCompletedAt;
+	std::function<void(const CompletedFrame&)> m_CompletionCallback;
+	bool m_Stopping;
+	std::thread m_Watcher;
+};
+
+// One T per frame slot.
+template <typename T>
+class PerFrame
+{
+public:
+	T& Get(const FramePacer& pacer) { return m_Slots[pacer.GetSlot()]; }
+	const T& Get(const FramePacer& pacer) const { return m_Slots[pacer.GetSlot()]; }
+
+	T& operator[](UINT slot) { return m_Slots[slot]; }
+	const T& operator[](UINT slot) const { return m_Slots[slot]; }
+
+private:
+	std::array<T, FramePacer::MaxFramesInFlight> m_Slots;
+};
+
+// Stands in for a GPU that takes a fixed time per frame. Frames run one at a
+// time in submission order and complete on a SimulatedFence, so FramePacer
+// and anything else fence-driven can run headless.
+class SimulatedGpu
+{
+public:
+	// Run on the GPU thread when a frame's time is up, just before its fence
+	// is signaled, with the time the frame started and finished.
+	using FrameWork = std::function<void(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)>;
+
+	explicit SimulatedGpu(std::chrono::microseconds frameTime);
+	// Finishes all submitted frames first.
+	~SimulatedGpu();
+
+	SimulatedGpu(const SimulatedGpu&) = delete;
+	SimulatedGpu& operator=(const SimulatedGpu&) = delete;
+
+	// Queue one frame. Returns the fence value signaled when it finishes.
+	UINT64 Submit(FrameWork work = nullptr);
+
+	std::shared_ptr<SimulatedFence> GetFence() const { return m_Fence; }
+
+private:
+	void Run();
+
+	std::chrono::microseconds m_FrameTime;
+	std::shared_ptr<SimulatedFence> m_Fence;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::deque<FrameWork> m_Work;
+	UINT64 m_Submitted;
+	bool m_Stopping;
+	std::thread m_Thread;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Summary of a FrameTimeHistogram, in milliseconds.
+struct FrameTimeSummary
+{
+	uint64_t Count = 0;
+	double Mean = 0.0;
+	double P50 = 0.0;
+	double P95 = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+	double StdDev = 0.0;
+	// Mean change from one sample to the next. Alternating 10 and 20 ms
+	// frames average 15 ms like steady ones but have 10 ms of jitter, and
+	// that is what shows up as stutter.
+	double Jitter = 0.0;
+};
+
+// Histogram of durations with bounded relative error, in the manner of
+// HdrHistogram.
+//
+// Durations below 2048 ns get a bucket per nanosecond. Above that, each
+// power of two is split into 1024 linear buckets, so a bucket is never wider
+// than about 0.1% of the values in it, however long. Percentiles are exact to
+// that precision at any scale, from sub-microsecond CPU scopes to multi-second
+// hitches, with a fixed 31744 buckets. Durations from about 18 minutes up
+// share the last bucket. The mean, standard deviation, jitter and max are
+// kept exactly on the side.
+//
+// Unlike LatencyHistogram it is not atomic: record from one thread at a time.
+class FrameTimeHistogram
+{
+public:
+	FrameTimeHistogram();
+
+	void Record(uint64_t nanoseconds);
+	void Reset();
+
+	uint64_t GetCount() const { return m_Count; }
+	uint64_t GetMax() const { return m_Max; }
+
+	// Upper bound of the bucket holding the given percentile (0-100), clamped
+	// to the largest value recorded.
+	uint64_t GetPercentile(double percentile) const;
+
+	FrameTimeSummary GetSummary() const;
+
+	static uint32_t GetBucket(uint64_t nanoseconds);
+	static uint64_t GetBucketLowerBound(uint32_t bucket);
+	static uint64_t GetBucketUpperBound(uint32_t bucket);
+
+private:
+	std::vector<uint64_t> m_Buckets;
+	uint64_t m_Count;
+	uint64_t m_Max;
+	uint64_t m_Previous;
+	double m_Sum;
+	double m_SumOfSquares;
+	double m_JitterSum;
+};
+
+// Frame, CPU and GPU times of a run, written as JSON so runs of different
+// builds can be compared:
+//
+//     {
+//       "info": { "frames": 1000, ... },
+//       "frame": { "count": 1000, "mean_ms": 16.6667, "p50_ms": ..., "p95_ms": ...,
+//                  "p99_ms": ..., "max_ms": ..., "stddev_ms": ..., "jitter_ms": ... },
+//       "cpu": { ... },
+//       "gpu": { ... },
+//       "cpu_wait": { ... },
+//       "gpu_idle": { ... }
+//     }
+//
+// Frame time is from one frame's start to the next, CPU time the part of it
+// the CPU spent working rather than waiting, and GPU time the part the GPU
+// spent on it. CPU wait is how long the CPU was blocked on the GPU before
+// the frame, and GPU idle how long the GPU had nothing to do before it, as
+// FramePacer measures them.
+class FrameStatistics
+{
+public:
+	FrameTimeHistogram& GetFrameTimes() { return m_Frame; }
+	FrameTimeHistogram& GetCpuTimes() { return m_Cpu; }
+	FrameTimeHistogram& GetGpuTimes() { return m_Gpu; }
+	FrameTimeHistogram& GetCpuWaits() { return m_CpuWait; }
+	FrameTimeHistogram& GetGpuIdles() { return m_GpuIdle; }
+
+	const FrameTimeHistogram& GetFrameTimes() const { return m_Frame; }
+	const FrameTimeHistogram& GetCpuTimes() const { return m_Cpu; }
+	const FrameTimeHistogram& GetGpuTimes() const { return m_Gpu; }
+	const FrameTimeHistogram& GetCpuWaits() const { return m_CpuWait; }
+	const FrameTimeHistogram& GetGpuIdles() const { return m_GpuIdle; }
+
+	// Describes the run, such as its frame count or settings. Written under
+	// "info" in the order added.
+	void AddInfo(const char* name, double value);
+
+	void Reset();
+
+	void WriteJson(std::ostream& stream) const;
+
+	// Throws FileError if the file cannot be written.
+	void SaveJson(const std::wstring& path) const;
+
+private:
+	FrameTimeHistogram m_Frame;
+	FrameTimeHistogram m_Cpu;
+	FrameTimeHistogram m_Gpu;
+	FrameTimeHistogram m_CpuWait;
+	FrameTimeHistogram m_GpuIdle;
+	std::vector<std::pair<std::string, double>> m_Info;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "Fence.h"
+#include "FramePacer.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class ShadowedCommandList;
+
+// A GPU timestamp and the CPU time it corresponds to, taken together.
+struct GpuClockCalibration
+{
+	UINT64 GpuTicks = 0;
+	std::chrono::steady_clock::time_point CpuTime;
+};
+
+// Where GpuProfiler's timestamps are written, resolved and read back.
+//
+// D3D12GpuTimestampBackend uses a query heap and a readback buffer.
+// SimulatedGpuTimestampBackend stands in for both with host memory and a GPU
+// clock derived from steady_clock, so the readback and calibration logic can
+// run headless, for example against SimulatedGpu.
+class GpuTimestampBackend
+{
+public:
+	virtual ~GpuTimestampBackend() = default;
+
+	virtual UINT GetQueryCount() const = 0;
+
+	// Write the GPU time into query index once the GPU reaches this point.
+	virtual void EndQuery(ID3D12GraphicsCommandList* commandList, UINT index) = 0;
+
+	// Copy queries [first, first + count) to the same place in the readback
+	// buffer once the GPU reaches this point.
+	virtual void Resolve(ID3D12GraphicsCommandList* commandList, UINT first, UINT count) = 0;
+
+	// Read resolved queries. Only valid after the resolve has completed.
+	virtual void Read(UINT first, UINT count, UINT64* ticks) = 0;
+
+	// Ticks per second.
+	virtual UINT64 GetFrequency() const = 0;
+
+	virtual GpuClockCalibration Calibrate() = 0;
+};
+
+class D3D12GpuTimestampBackend : public GpuTimestampBackend
+{
+public:
+	// Copy queues need D3D12_FEATURE_DATA_D3D12_OPTIONS3::CopyQueueTimestampQueriesSupported.
+	D3D12GpuTimestampBackend(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue, UINT queryCount);
+
+	UINT GetQueryCount() const override { return m_QueryCount; }
+	void EndQuery(ID3D12GraphicsCommandList* commandList, UINT index) override;
+	void Resolve(ID3D12GraphicsCommandList* commandList, UINT first, UINT count) override;
+	void Read(UINT first, UINT count, UINT64* ticks) override;
+	UINT64 GetFrequency() const override { return m_Frequency; }
+	GpuClockCalibration Calibrate() override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_Queue;
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_QueryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_Readback;
+	D3D12_QUERY_TYPE m_QueryType;
+	UINT m_QueryCount;
+	UINT64 m_Frequency;
+};
+
+// Timestamps are steady_clock time at the moment EndQuery is called, scaled
+// to frequency and shifted by offsetTicks, as a GPU clock would be. Command
+// lists are ignored and may be null.
+//
+// Deferred, queries and resolves are kept in order until TakeFrame instead,
+// and written when a SimulatedGpu runs the work it returns. The queries are
+// spread evenly from the frame's start to its end, as a GPU working through
+// the frame would reach them. Record them from one thread.
+class SimulatedGpuTimestampBackend : public GpuTimestampBackend
+{
+public:
+	SimulatedGpuTimestampBackend(UINT queryCount, UINT64 frequency = 24000000, UINT64 offsetTicks = 1ull << 40, bool deferred = false);
+
+	UINT GetQueryCount() const override { return static_cast<UINT>(m_Queries.size()); }
+	void EndQuery(ID3D12GraphicsCommandList* commandList, UINT index) override;
+	void Resolve(ID3D12GraphicsCommandList* commandList, UINT first, UINT count) override;
+	void Read(UINT first, UINT count, UINT64* ticks) override;
+	UINT64 GetFrequency() const override { return m_Frequency; }
+	GpuClockCalibration Calibrate() override;
+
+	// The queries and resolves recorded since the last call, as a frame's
+	// work for SimulatedGpu::Submit. Deferred only.
+	SimulatedGpu::FrameWork TakeFrame();
+
+private:
+	struct Command
+	{
+		UINT First;
+		UINT Count;
+		bool Resolve;   // Otherwise a query.
+	};
+
+	UINT64 GetTicks(std::chrono::steady_clock::time_point time) const;
+
+	std::vector<UINT64> m_Queries;
+	std::vector<UINT64> m_Readback;
+	UINT64 m_Frequency;
+	UINT64 m_OffsetTicks;
+	std::chrono::steady_clock::time_point m_Start;
+	bool m_Deferred;
+	std::vector<Command> m_Commands;
+};
+
+struct GpuScopeTiming
+{
+	const char* Name;
+	std::chrono::steady_clock::time_point Begin;
+	std::chrono::steady_clock::time_point End;
+
+	double GetMilliseconds() const { return std::chrono::duration<double, std::milli>(End - Begin).count(); }
+};
+
+// Times scopes on one queue's timeline with timestamp queries.
+//
+// Each frame slot owns a range of queries and the same range of the readback
+// buffer. Scopes take two queries from the current slot; Resolve copies the
+// ones used into the readback buffer at the end of the frame and EndFrame
+// tags the slot with the frame's fence value. The results are read when that
+// value completes, typically a few frames later, so nothing waits on the GPU
+// unless every slot is still in flight.
+//
+// GPU ticks are converted to steady_clock time through a calibration taken
+// about once a second, and every scope is also handed to the Profiler on a
+// track named after the queue, so GPU passes line up with CPU scopes in the
+// exported trace.
+class GpuProfiler
+{
+public:
+	// More slots than frames in flight, so reading back never stalls.
+	static const UINT FrameCount = FramePacer::MaxFramesInFlight + 1;
+	static const UINT InvalidScope = ~0u;
+
+	// The backend needs 2 * maxScopesPerFrame * FrameCount queries. track
+	// names the queue in the trace and must outlive the profiler.
+	GpuProfiler(std::shared_ptr<GpuTimestampBackend> backend, std::shared_ptr<Fence> fence, const char* track, UINT maxScopesPerFrame = 256);
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// Scopes may be recorded on several lists from several threads, as long
+	// as those lists run on this profiler's queue. Returns InvalidScope if
+	// the frame is out of queries; EndScope ignores it.
+	UINT BeginScope(ID3D12GraphicsCommandList* commandList, const char* name);
+	void EndScope(ID3D12GraphicsCommandList* commandList, UINT scope);
+
+	UINT BeginScope(ShadowedCommandList& commandList, const char* name);
+	void EndScope(ShadowedCommandList& commandList, UINT scope);
+
+	// Record the resolve on a list that runs after every list with scopes in
+	// this frame, then submit it and pass the fence value to EndFrame.
+	void Resolve(ID3D12GraphicsCommandList* commandList);
+	void Resolve(ShadowedCommandList& commandList);
+
+	// Move to the next slot and read back every frame that has completed.
+	void EndFrame(UINT64 fenceValue);
+
+	// Wait for every frame handed to EndFrame and read it back.
+	void Flush();
+
+	// Scopes of the most recent frame read back, in the order they began.
+	const std::vector<GpuScopeTiming>& GetLastFrame() const { return m_LastFrame; }
+	UINT64 GetLastFrameNumber() const { return m_LastFrameNumber; }
+
+	// Scopes dropped because a frame ran out of queries.
+	UINT64 GetDroppedScopeCount() const { return m_DroppedScopes.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot
+	{
+		std::vector<const char*> Names;
+		std::vector<std::atomic<bool>> Ended;
+		UINT ScopeCount = 0;
+		UINT64 FenceValue = 0;
+		UINT64 FrameNumber = 0;
+		GpuClockCalibration Calibration;
+		bool Pending = false;
+	};
+
+	UINT GetFirstQuery(UINT slot) const { return slot * m_MaxScopesPerFrame * 2; }
+	void ReadBack(Slot& slot, UINT slotIndex);
+
+	std::shared_ptr<GpuTimestampBackend> m_Backend;
+	std::shared_ptr<Fence> m_Fence;
+	const char* m_Track;
+	UINT m_MaxScopesPerFrame;
+	UINT64 m_Frequency;
+
+	Slot m_Slots[FrameCount];
+	UINT m_Slot;
+	UINT64 m_FrameNumber;
+	std::atomic<UINT> m_NextScope;
+	std::atomic<UINT64> m_DroppedScopes;
+
+	GpuClockCalibration m_Calibration;
+	std::vector<UINT64> m_Ticks;
+	std::vector<GpuScopeTiming> m_LastFrame;
+	UINT64 m_LastFrameNumber;
+};
+
+// Times its own lifetime on the GPU.
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler& profiler, ShadowedCommandList& commandList, const char* name)
+		: m_Profiler(profiler)
+		, m_CommandList(commandList)
+		, m_Scope(profiler.BeginScope(commandList, name))
+	{
+	}
+
+	~GpuProfileScope()
+	{
+		m_Profiler.EndScope(m_CommandList, m_Scope);
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	GpuProfiler& m_Profiler;
+	ShadowedCommandList& m_CommandList;
+	UINT m_Scope;
+};
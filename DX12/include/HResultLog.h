@@ -0,0 +1,46 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h> // For HRESULT
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// The most recent HRESULT failures caught by ThrowIfFailed, kept for crash
+// reports and debugging after the exception has been handled or swallowed
+// (by a job, the submit thread or a compile service that only keeps the
+// first exception).
+//
+// Recording takes no locks: a failure claims the next slot with one atomic
+// increment and publishes it with a sequence number, so threads that fail
+// together do not wait on each other. Readers skip slots that are being
+// written. Once the ring wraps, older failures are overwritten.
+class HResultLog
+{
+public:
+	static const uint32_t Capacity = 256;
+
+	struct Entry
+	{
+		uint64_t Sequence;                          // Failures recorded before this one.
+		HRESULT Result;
+		const char* File;                           // __FILE__, not copied.
+		uint32_t Line;
+		uint32_t ThreadId;
+		std::chrono::steady_clock::time_point Time;
+	};
+
+	// Thread-safe. file must outlive the log; use __FILE__.
+	static void Record(HRESULT result, const char* file, uint32_t line);
+
+	// The failures still in the ring, oldest first. Thread-safe.
+	static std::vector<Entry> GetEntries();
+
+	// Failures recorded since startup, including overwritten ones.
+	static uint64_t GetFailureCount();
+
+	// One line per entry, oldest first.
+	static void Write(std::ostream& stream);
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Not cryptographic, but stable across runs and builds, which
+// is what cache keys on disk need.
+
+const uint64_t HashOffsetBasis = 14695981039346656037ull;
+const uint64_t HashPrime = 1099511628211ull;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HashOffsetBasis)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= HashPrime;
+	}
+	return hash;
+}
+
+// Only for types without padding. Padding bytes are indeterminate and would
+// make equal values hash differently.
+template <typename T>
+inline uint64_t HashValue(const T& value, uint64_t seed = HashOffsetBasis)
+{
+	return HashBytes(&value, sizeof(T), seed);
+}
+
+inline uint64_t HashString(const char* string, uint64_t seed = HashOffsetBasis)
+{
+	uint64_t hash = seed;
+	if (string)
+	{
+		for (; *string; ++string)
+		{
+			hash ^= static_cast<unsigned char>(*string);
+			hash *= HashPrime;
+		}
+	}
+	// Terminate so that "ab" + "c" and "a" + "bc" differ.
+	hash ^= 0xFF;
+	hash *= HashPrime;
+	return hash;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+{
+	return HashValue(value, seed);
+}
+
+// Compile-time counterparts. HashConstant hashes the low size bytes of value
+// in little-endian order, which gives the same result as HashValue on an
+// integer of that size.
+constexpr uint64_t HashConstant(uint64_t value, size_t size, uint64_t seed = HashOffsetBasis)
+{
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= (value >> (i * 8)) & 0xFF;
+		hash *= HashPrime;
+	}
+	return hash;
+}
+
+// IEEE 754 bits of a float, computed without reinterpreting memory so that it
+// can run at compile time. Exact for every value except negative zero, which
+// gives the bits of positive zero: a constant expression cannot read the sign
+// of a zero before C++20's std::bit_cast. Write 0.0f, not -0.0f, in tables
+// whose hash must match HashValue.
+constexpr uint32_t FloatBitsConstant(float value)
+{
+	if (value != value)
+	{
+		return 0x7FC00000u;
+	}
+
+	uint32_t sign = 0;
+	if (value < 0.0f)
+	{
+		sign = 0x80000000u;
+		value = -value;
+	}
+	if (value == 0.0f)
+	{
+		return 0;
+	}
+	if (value > 3.402823466e+38f)
+	{
+		return sign | 0x7F800000u;
+	}
+
+	int exponent = 0;
+	while (value >= 2.0f)
+	{
+		value /= 2.0f;
+		++exponent;
+	}
+	while (value < 1.0f)
+	{
+		value *= 2.0f;
+		--exponent;
+	}
+	if (exponent < -126)
+	{
+		// Denormal: the bits are the value in units of 2^-149, and
+		// exponent + 149 is at most 22, so the product is an exact integer.
+		return sign | static_cast<uint32_t>(value * static_cast<float>(1u << (exponent + 149)));
+	}
+
+	uint32_t mantissa = static_cast<uint32_t>((value - 1.0f) * 8388608.0f);
+	return sign | (static_cast<uint32_t>(exponent + 127) << 23) | mantissa;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct DrawPacket;
+struct DrawSortItem;
+class ShadowedCommandList;
+class UploadRing;
+
+// Builds an ExecuteIndirect command signature and keeps track of where each
+// argument lands in a record, so packers can write records directly:
+//
+//     CommandSignatureBuilder builder;
+//     builder.AddConstant(DrawIdParameter, 0, 1).AddDrawIndexed();
+//     ComPtr<ID3D12CommandSignature> signature = builder.Create(device, rootSignature);
+//
+// Records are the arguments back to back in the order added. The draw or
+// dispatch must come last, and only once.
+class CommandSignatureBuilder
+{
+public:
+	CommandSignatureBuilder& AddConstant(UINT rootParameterIndex, UINT destOffsetIn32BitValues, UINT num32BitValuesToSet);
+	CommandSignatureBuilder& AddConstantBufferView(UINT rootParameterIndex);
+	CommandSignatureBuilder& AddShaderResourceView(UINT rootParameterIndex);
+	CommandSignatureBuilder& AddUnorderedAccessView(UINT rootParameterIndex);
+	CommandSignatureBuilder& AddVertexBufferView(UINT slot);
+	CommandSignatureBuilder& AddIndexBufferView();
+
+	CommandSignatureBuilder& AddDraw();
+	CommandSignatureBuilder& AddDrawIndexed();
+	CommandSignatureBuilder& AddDispatch();
+
+	size_t GetArgumentCount() const { return m_Arguments.size(); }
+	// Byte offset of the index-th argument within a record.
+	UINT GetArgumentOffset(size_t index) const { return m_Offsets[index]; }
+	UINT GetByteStride() const { return m_ByteStride; }
+
+	// Signatures that set root arguments need the root signature they are
+	// used with; the others must be created without one.
+	bool ChangesRootArguments() const;
+
+	// Points into the builder, which must outlive the desc.
+	D3D12_COMMAND_SIGNATURE_DESC GetDesc() const;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandSignature> Create(ID3D12Device* device, ID3D12RootSignature* rootSignature = nullptr) const;
+
+private:
+	CommandSignatureBuilder& Add(const D3D12_INDIRECT_ARGUMENT_DESC& argument, UINT size);
+
+	std::vector<D3D12_INDIRECT_ARGUMENT_DESC> m_Arguments;
+	std::vector<UINT> m_Offsets;
+	UINT m_ByteStride = 0;
+	bool m_HasDrawOrDispatch = false;
+};
+
+// Record layouts the draw packer writes.
+enum class IndirectDrawLayout
+{
+	// D3D12_DRAW_INDEXED_ARGUMENTS only, 20 bytes. StartInstanceLocation
+	// holds the draw id, which reaches the shader through a per-instance
+	// vertex stream of 0, 1, 2, ... (SV_InstanceID does not include it).
+	// Instance k of a draw would read the id k draws further on, so every
+	// packet must have an InstanceCount of 1; use DrawIdAndDrawIndexed for
+	// instanced draws.
+	DrawIndexed,
+	// A 32-bit root constant holding the draw id, then the arguments with
+	// StartInstanceLocation 0, 24 bytes.
+	DrawIdAndDrawIndexed,
+};
+
+UINT GetIndirectDrawStride(IndirectDrawLayout layout);
+
+// A signature for layout. drawIdRootParameter is the 32-bit constant the draw
+// id goes to and is ignored for DrawIndexed.
+CommandSignatureBuilder MakeIndirectDrawSignature(IndirectDrawLayout layout, UINT drawIdRootParameter = 0);
+
+// Write one record per order[0, count) to destination, which must be 16-byte
+// aligned. Index count, instance count, start index and base vertex come from
+// the packet; the i-th record gets draw id firstDrawId + i. With DrawIndexed,
+// every packet must draw a single instance. Uses SSE2 on x86
+// and x64 with streaming stores, which suit write-combined upload memory.
+void PackDrawIndexedArguments(const DrawPacket* packets, const DrawSortItem* order, size_t count,
+	IndirectDrawLayout layout, UINT firstDrawId, void* destination);
+
+// One record at a time, for platforms without SSE2 and to check against.
+void PackDrawIndexedArgumentsScalar(const DrawPacket* packets, const DrawSortItem* order, size_t count,
+	IndirectDrawLayout layout, UINT firstDrawId, void* destination);
+
+// A range of records in an upload ring, ready for ExecuteIndirect.
+struct IndirectDrawBatch
+{
+	ID3D12Resource* ArgumentBuffer = nullptr;
+	UINT64 ArgumentBufferOffset = 0;
+	UINT DrawCount = 0;
+};
+
+// Packs sorted draws into indirect argument buffers, so a run of draws that
+// share their bound state costs one ExecuteIndirect instead of one call per
+// draw.
+class IndirectDrawPacker
+{
+public:
+	IndirectDrawPacker(UploadRing& ring, IndirectDrawLayout layout);
+
+	// The end of the run starting at begin whose packets share root signature,
+	// pipeline, material and vertex and index buffers, so they can go in one
+	// batch. Geometry from shared buffers, addressed by start index and base
+	// vertex, makes runs long.
+	static size_t FindBatchEnd(const std::vector<DrawPacket>& packets, const std::vector<DrawSortItem>& order, size_t begin, size_t end);
+
+	// Pack order[begin, end) into the ring. Draw ids are the positions in
+	// order, so per-draw data can be laid out in the same order.
+	IndirectDrawBatch Pack(const std::vector<DrawPacket>& packets, const std::vector<DrawSortItem>& order, size_t begin, size_t end);
+
+	// The caller binds the state shared by the batch, from its first packet.
+	static void Execute(ShadowedCommandList& commandList, ID3D12CommandSignature* signature, const IndirectDrawBatch& batch);
+
+	IndirectDrawLayout GetLayout() const { return m_Layout; }
+
+	struct BenchmarkResult
+	{
+		IndirectDrawLayout Layout = IndirectDrawLayout::DrawIndexed;
+		double ScalarNanosecondsPerDraw = 0.0;
+		double PackedNanosecondsPerDraw = 0.0;
+		double GigabytesPerSecond = 0.0;    // Written by PackDrawIndexedArguments.
+		bool Matches = false;               // Both paths wrote the same bytes.
+	};
+
+	// Pack drawCount shuffled synthetic draws into a host-backed ring with both
+	// paths, for every layout.
+	static std::vector<BenchmarkResult> RunBenchmark(size_t drawCount = 1 << 16, uint32_t iterationCount = 64);
+
+private:
+	UploadRing& m_Ring;
+	IndirectDrawLayout m_Layout;
+};
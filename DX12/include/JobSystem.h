@@ -0,0 +1,184 @@
+#pragma once
+
+#include "ChaseLevDeque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job scheduler.
+//
+// Each worker owns a Chase-Lev deque. New jobs go to the bottom of the
+// current thread's deque; idle workers steal from the top of other deques.
+//
+// A job runs once all the jobs it depends on have finished, and counts as
+// finished once it and all its children have finished:
+//
+//     Job* cull = jobs.Create([&] { Cull(); });
+//     Job* record = jobs.Create([&] { Record(); });
+//     jobs.AddDependency(record, cull);
+//     jobs.Submit(record);
+//     jobs.Submit(cull);
+//     jobs.Wait(record);
+//     ...
+//     jobs.EndFrame();
+//
+// Jobs are allocated from per-thread arenas that EndFrame recycles, so Job
+// pointers are only valid until then. Apart from the workers, only one
+// thread (the one that created the system) may create, submit or wait.
+class JobSystem;
+
+class Job
+{
+public:
+	Job() = default;
+	Job(const Job&) = delete;
+	Job& operator=(const Job&) = delete;
+
+	bool IsFinished() const { return m_Unfinished.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::function<void()> m_Function;
+
+	// ParallelFor ranges point at the function stored in the root job instead
+	// of wrapping it in a std::function of their own, which would allocate.
+	const std::function<void(size_t, size_t)>* m_Range = nullptr;
+	std::function<void(size_t, size_t)> m_RangeFunction;
+	size_t m_RangeBegin = 0;
+	size_t m_RangeEnd = 0;
+	size_t m_GrainSize = 1;
+
+	Job* m_Parent = nullptr;
+	// 1 for the job itself plus one per unfinished child.
+	std::atomic<int32_t> m_Unfinished{ 0 };
+	// 1 until submitted plus one per unfinished dependency.
+	std::atomic<int32_t> m_Dependencies{ 0 };
+
+	// Jobs waiting on this one. Guarded by m_ContinuationLock.
+	std::atomic_flag m_ContinuationLock = ATOMIC_FLAG_INIT;
+	bool m_Completed = false;
+	std::vector<Job*> m_Continuations;
+};
+
+class JobSystem
+{
+public:
+	struct Options
+	{
+		static const uint32_t AutoThreadCount = ~0u;
+
+		uint32_t ThreadCount = AutoThreadCount;   // Workers besides the owning thread. Auto = one per remaining core.
+		bool PinThreads = false;                  // Pin worker i to logical processor i + 1.
+		size_t QueueCapacity = 4096;              // Per deque, power of two.
+	};
+
+	JobSystem();
+	explicit JobSystem(const Options& options);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Create a job without scheduling it. A child keeps its parent from
+	// finishing until the child has finished too.
+	Job* Create(std::function<void()> function, Job* parent = nullptr);
+
+	// job will not start before dependency has finished. Must be called
+	// before job is submitted. dependency may already be running or done.
+	void AddDependency(Job* job, Job* dependency);
+
+	// Schedule job. It runs as soon as its dependencies have finished.
+	void Submit(Job* job);
+
+	Job* CreateAndSubmit(std::function<void()> function, Job* parent = nullptr)
+	{
+		Job* job = Create(std::move(function), parent);
+		Submit(job);
+		return job;
+	}
+
+	// Run other jobs until job has finished.
+	void Wait(Job* job);
+
+	// Split [begin, end) into ranges of at most grainSize and call function on
+	// each in parallel. The returned job finishes once every range is done.
+	// The ranges are split recursively, so thieves take large halves and the
+	// splitting itself is spread over the workers.
+	Job* ParallelFor(size_t begin, size_t end, size_t grainSize,
+		std::function<void(size_t begin, size_t end)> function, Job* parent = nullptr);
+
+	// Wait for everything and recycle all jobs created this frame.
+	void EndFrame();
+
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+	struct Stats
+	{
+		uint64_t JobsExecuted = 0;
+		uint64_t Steals = 0;
+		uint64_t InlineRuns = 0;     // Jobs run immediately because a deque was full.
+	};
+	Stats GetStats() const;
+
+	struct BenchmarkResult
+	{
+		uint32_t ThreadCount = 0;
+		double FrameMilliseconds = 0.0;
+		double OverheadNanosecondsPerJob = 0.0;   // Above the serial cost of the same work.
+		double Speedup = 1.0;
+	};
+
+	// Run frameCount frames of jobCount jobs that each do workPerJob units of
+	// arithmetic, with 1, 2, 4, ... up to maxThreadCount threads.
+	static std::vector<BenchmarkResult> RunBenchmark(
+		uint32_t jobCount = 16384, uint32_t workPerJob = 256, uint32_t maxThreadCount = 0, uint32_t frameCount = 32);
+
+private:
+	struct Arena
+	{
+		static const size_t BlockSize = 1024;
+		std::vector<std::unique_ptr<Job[]>> Blocks;
+		size_t Used = 0;
+	};
+
+	struct Worker
+	{
+		explicit Worker(size_t capacity) : Queue(capacity) {}
+		ChaseLevDeque<Job> Queue;
+		Arena Jobs;
+		uint32_t RandomState = 0;
+	};
+
+	uint32_t GetCurrentWorkerIndex() const;
+	Job* Allocate();
+	void Schedule(Job* job);
+	void Execute(Job* job);
+	void Finish(Job* job);
+	Job* FindJob(uint32_t workerIndex);
+	void WorkerThread(uint32_t workerIndex);
+	void SplitRange(Job* job);
+
+	// One slot per worker thread, plus the last one for the owning thread.
+	std::vector<std::unique_ptr<Worker>> m_Slots;
+	std::vector<std::thread> m_Workers;
+
+	// Jobs created and not yet finished. EndFrame waits for this to reach zero.
+	std::atomic<int64_t> m_Outstanding;
+	// Jobs sitting in deques. Workers sleep when this reaches zero.
+	std::atomic<int64_t> m_QueuedJobs;
+	std::atomic<uint32_t> m_Sleeping;
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeUp;
+	std::atomic<bool> m_Stopping;
+
+	std::atomic<uint64_t> m_JobsExecuted;
+	std::atomic<uint64_t> m_Steals;
+	std::atomic<uint64_t> m_InlineRuns;
+};
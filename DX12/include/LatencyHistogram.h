@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Histogram of durations in power-of-two nanosecond buckets. Record is a
+// single relaxed atomic increment, so it can be called from any thread on a
+// hot path.
+class LatencyHistogram
+{
+public:
+	// Bucket i holds durations in [2^i, 2^(i+1)) ns; bucket 0 also holds 0.
+	// The last bucket collects everything from about 2 seconds up.
+	static const int BucketCount = 32;
+
+	LatencyHistogram() { Reset(); }
+
+	void Record(uint64_t nanoseconds)
+	{
+		m_Buckets[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t max = m_Max.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !m_Max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void Reset()
+	{
+		for (std::atomic<uint64_t>& bucket : m_Buckets)
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		m_Max.store(0, std::memory_order_relaxed);
+	}
+
+	uint64_t GetCount() const
+	{
+		uint64_t count = 0;
+		for (const std::atomic<uint64_t>& bucket : m_Buckets)
+		{
+			count += bucket.load(std::memory_order_relaxed);
+		}
+		return count;
+	}
+
+	uint64_t GetBucketCount(int bucket) const { return m_Buckets[bucket].load(std::memory_order_relaxed); }
+	uint64_t GetMax() const { return m_Max.load(std::memory_order_relaxed); }
+
+	// Upper bound of the bucket containing the given percentile (0-100).
+	uint64_t GetPercentile(double percentile) const
+	{
+		uint64_t count = GetCount();
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		uint64_t target = static_cast<uint64_t>(count * percentile / 100.0);
+		uint64_t seen = 0;
+		for (int i = 0; i < BucketCount; ++i)
+		{
+			seen += GetBucketCount(i);
+			if (seen > target)
+			{
+				return GetBucketUpperBound(i);
+			}
+		}
+		return GetMax();
+	}
+
+	static uint64_t GetBucketUpperBound(int bucket) { return (uint64_t(2) << bucket) - 1; }
+
+	// One line per non-empty bucket: "[lower, upper] ns  count  bar".
+	void Write(std::ostream& out, const char* title) const
+	{
+		uint64_t count = GetCount();
+		out << title << ": " << count << " samples, p50 <= " << GetPercentile(50.0)
+			<< " ns, p99 <= " << GetPercentile(99.0) << " ns, max " << GetMax() << " ns\n";
+
+		for (int i = 0; i < BucketCount; ++i)
+		{
+			uint64_t bucketCount = GetBucketCount(i);
+			if (bucketCount == 0)
+			{
+				continue;
+			}
+
+			uint64_t lower = i == 0 ? 0 : uint64_t(1) << i;
+			out << "  [" << lower << ", " << GetBucketUpperBound(i) << "] ns  " << bucketCount << "  ";
+			int width = static_cast<int>(40 * bucketCount / count);
+			for (int j = 0; j < width; ++j)
+			{
+				out << '#';
+			}
+			out << '\n';
+		}
+	}
+
+private:
+	static int GetBucket(uint64_t nanoseconds)
+	{
+		int bucket = 0;
+		while (nanoseconds > 1 && bucket < BucketCount - 1)
+		{
+			nanoseconds >>= 1;
+			++bucket;
+		}
+		return bucket;
+	}
+
+	std::atomic<uint64_t> m_Buckets[BucketCount];
+	std::atomic<uint64_t> m_Max;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free multi-producer single-consumer queue.
+//
+// Dmitry Vyukov's intrusive MPSC design: a producer swaps itself in as the
+// new head with a single exchange and then links the previous head to it.
+// Push is wait-free. The consumer may briefly see the queue as empty while a
+// producer is between those two steps; the item shows up on the next TryPop.
+//
+// T must be default constructible, since the node the consumer stops on
+// keeps an empty T.
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue()
+		: m_Head(new Node())
+		, m_Tail(m_Head.load(std::memory_order_relaxed))
+	{}
+
+	~MpscQueue()
+	{
+		T discarded;
+		while (TryPop(discarded))
+		{
+		}
+		delete m_Tail;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// Any thread.
+	void Push(T value)
+	{
+		Node* node = new Node();
+		node->Value = std::move(value);
+		Node* previous = m_Head.exchange(node, std::memory_order_acq_rel);
+		previous->Next.store(node, std::memory_order_release);
+	}
+
+	// Consumer thread only.
+	bool TryPop(T& value)
+	{
+		Node* tail = m_Tail;
+		Node* next = tail->Next.load(std::memory_order_acquire);
+		if (!next)
+		{
+			return false;
+		}
+
+		value = std::move(next->Value);
+		next->Value = T();
+		m_Tail = next;
+		delete tail;
+		return true;
+	}
+
+	// Consumer thread only. May report empty while a push is in progress.
+	bool IsEmpty() const
+	{
+		return m_Tail->Next.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	struct Node
+	{
+		std::atomic<Node*> Next{ nullptr };
+		T Value;
+	};
+
+	// Producers and the consumer on separate cache lines.
+	std::atomic<Node*> m_Head;
+	char m_Padding[64 - sizeof(std::atomic<Node*>)];
+	Node* m_Tail;
+};
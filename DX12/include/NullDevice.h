@@ -0,0 +1,406 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Stand-ins for D3D12 objects that do nothing, so CPU-side code written
+// against the real interfaces (the d3dx12.h helpers, ShadowedCommandList,
+// DrawSubmitter, CommandQueue) can run and be timed without a device or a
+// driver.
+//
+// All are reference counted like any COM object; hold them in a ComPtr.
+// QueryInterface only answers for the interfaces they implement, so code
+// that asks for a newer command list version sees it as unsupported.
+
+// Private data attached with SetPrivateData and SetPrivateDataInterface, as
+// CommandQueue does to tie an allocator to its list. Not thread-safe: an
+// object's private data is only touched by the thread using the object.
+class NullPrivateData
+{
+public:
+	HRESULT Get(REFGUID guid, UINT* dataSize, void* data) const;
+	HRESULT Set(REFGUID guid, UINT dataSize, const void* data);
+	HRESULT SetInterface(REFGUID guid, const IUnknown* object);
+
+private:
+	struct Entry
+	{
+		GUID Guid;
+		std::vector<UINT8> Data;
+		Microsoft::WRL::ComPtr<IUnknown> Interface;
+	};
+
+	Entry* Find(REFGUID guid);
+	const Entry* Find(REFGUID guid) const;
+
+	std::vector<Entry> m_Entries;
+};
+
+// A resource with the given description. Buffers are backed by host memory
+// that Map returns and that stays mapped; textures have no memory and cannot
+// be mapped. The GPU virtual address of a buffer is its host address.
+class NullResource : public ID3D12Resource
+{
+public:
+	static Microsoft::WRL::ComPtr<NullResource> Create(const D3D12_RESOURCE_DESC& desc);
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return DXGI_ERROR_NOT_FOUND; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override;
+
+	// ID3D12Resource
+	HRESULT STDMETHODCALLTYPE Map(UINT subresource, const D3D12_RANGE* readRange, void** data) override;
+	void STDMETHODCALLTYPE Unmap(UINT, const D3D12_RANGE*) override {}
+	D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc() override { return m_Desc; }
+	D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override;
+	HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT, const D3D12_BOX*, const void*, UINT, UINT) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE ReadFromSubresource(void*, UINT, UINT, UINT, const D3D12_BOX*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS*) override { return E_NOTIMPL; }
+
+private:
+	explicit NullResource(const D3D12_RESOURCE_DESC& desc);
+	~NullResource() = default;
+
+	std::atomic<ULONG> m_References;
+	D3D12_RESOURCE_DESC m_Desc;
+	std::vector<UINT8> m_Memory;
+};
+
+// A graphics command list that counts the calls made to it.
+class NullGraphicsCommandList : public ID3D12GraphicsCommandList
+{
+public:
+	static Microsoft::WRL::ComPtr<NullGraphicsCommandList> Create(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+	UINT64 GetCallCount() const { return m_Calls; }
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* dataSize, void* data) override { return m_PrivateData.Get(guid, dataSize, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT dataSize, const void* data) override { return m_PrivateData.Set(guid, dataSize, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* object) override { return m_PrivateData.SetInterface(guid, object); }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override;
+
+	// ID3D12CommandList
+	D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE GetType() override { return m_Type; }
+
+	// ID3D12GraphicsCommandList
+	HRESULT STDMETHODCALLTYPE Close() override { ++m_Calls; return S_OK; }
+	HRESULT STDMETHODCALLTYPE Reset(ID3D12CommandAllocator*, ID3D12PipelineState*) override { ++m_Calls; return S_OK; }
+	void STDMETHODCALLTYPE ClearState(ID3D12PipelineState*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE DrawInstanced(UINT, UINT, UINT, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE Dispatch(UINT, UINT, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE CopyBufferRegion(ID3D12Resource*, UINT64, ID3D12Resource*, UINT64, UINT64) override { ++m_Calls; }
+	void STDMETHODCALLTYPE CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION*, UINT, UINT, UINT, const D3D12_TEXTURE_COPY_LOCATION*, const D3D12_BOX*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE CopyResource(ID3D12Resource*, ID3D12Resource*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE CopyTiles(ID3D12Resource*, const D3D12_TILED_RESOURCE_COORDINATE*, const D3D12_TILE_REGION_SIZE*, ID3D12Resource*, UINT64, D3D12_TILE_COPY_FLAGS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ResolveSubresource(ID3D12Resource*, UINT, ID3D12Resource*, UINT, DXGI_FORMAT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) override { ++m_Calls; }
+	void STDMETHODCALLTYPE RSSetViewports(UINT, const D3D12_VIEWPORT*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE RSSetScissorRects(UINT, const D3D12_RECT*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE OMSetBlendFactor(const FLOAT[4]) override { ++m_Calls; }
+	void STDMETHODCALLTYPE OMSetStencilRef(UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetPipelineState(ID3D12PipelineState*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ResourceBarrier(UINT, const D3D12_RESOURCE_BARRIER*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ExecuteBundle(ID3D12GraphicsCommandList*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRootSignature(ID3D12RootSignature*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRootSignature(ID3D12RootSignature*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRoot32BitConstant(UINT, UINT, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRoot32BitConstant(UINT, UINT, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRoot32BitConstants(UINT, UINT, const void*, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRoot32BitConstants(UINT, UINT, const void*, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetComputeRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetGraphicsRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override { ++m_Calls; }
+	void STDMETHODCALLTYPE IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SOSetTargets(UINT, UINT, const D3D12_STREAM_OUTPUT_BUFFER_VIEW*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE OMSetRenderTargets(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_CLEAR_FLAGS, FLOAT, UINT8, UINT, const D3D12_RECT*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE, const FLOAT[4], UINT, const D3D12_RECT*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(D3D12_GPU_DESCRIPTOR_HANDLE, D3D12_CPU_DESCRIPTOR_HANDLE, ID3D12Resource*, const UINT[4], UINT, const D3D12_RECT*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(D3D12_GPU_DESCRIPTOR_HANDLE, D3D12_CPU_DESCRIPTOR_HANDLE, ID3D12Resource*, const FLOAT[4], UINT, const D3D12_RECT*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE DiscardResource(ID3D12Resource*, const D3D12_DISCARD_REGION*) override { ++m_Calls; }
+	void STDMETHODCALLTYPE BeginQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE EndQuery(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE ResolveQueryData(ID3D12QueryHeap*, D3D12_QUERY_TYPE, UINT, UINT, ID3D12Resource*, UINT64) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetPredication(ID3D12Resource*, UINT64, D3D12_PREDICATION_OP) override { ++m_Calls; }
+	void STDMETHODCALLTYPE SetMarker(UINT, const void*, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE BeginEvent(UINT, const void*, UINT) override { ++m_Calls; }
+	void STDMETHODCALLTYPE EndEvent() override { ++m_Calls; }
+	void STDMETHODCALLTYPE ExecuteIndirect(ID3D12CommandSignature*, UINT, ID3D12Resource*, UINT64, ID3D12Resource*, UINT64) override { ++m_Calls; }
+
+private:
+	explicit NullGraphicsCommandList(D3D12_COMMAND_LIST_TYPE type);
+	~NullGraphicsCommandList() = default;
+
+	std::atomic<ULONG> m_References;
+	D3D12_COMMAND_LIST_TYPE m_Type;
+	UINT64 m_Calls;
+	NullPrivateData m_PrivateData;
+};
+
+// A pipeline state with no pipeline behind it, for code that creates, swaps
+// and releases pipelines without drawing with them.
+class NullPipelineState : public ID3D12PipelineState
+{
+public:
+	static Microsoft::WRL::ComPtr<NullPipelineState> Create();
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return DXGI_ERROR_NOT_FOUND; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override;
+
+	// ID3D12PipelineState
+	HRESULT STDMETHODCALLTYPE GetCachedBlob(ID3DBlob** blob) override;
+
+private:
+	NullPipelineState();
+	~NullPipelineState() = default;
+
+	std::atomic<ULONG> m_References;
+};
+
+// A command allocator with no memory behind it.
+class NullCommandAllocator : public ID3D12CommandAllocator
+{
+public:
+	static Microsoft::WRL::ComPtr<NullCommandAllocator> Create(D3D12_COMMAND_LIST_TYPE type);
+
+	UINT64 GetResetCount() const { return m_Resets; }
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* dataSize, void* data) override { return m_PrivateData.Get(guid, dataSize, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT dataSize, const void* data) override { return m_PrivateData.Set(guid, dataSize, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* object) override { return m_PrivateData.SetInterface(guid, object); }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override;
+
+	// ID3D12CommandAllocator
+	HRESULT STDMETHODCALLTYPE Reset() override { ++m_Resets; return S_OK; }
+
+private:
+	explicit NullCommandAllocator(D3D12_COMMAND_LIST_TYPE type);
+	~NullCommandAllocator() = default;
+
+	std::atomic<ULONG> m_References;
+	D3D12_COMMAND_LIST_TYPE m_Type;
+	UINT64 m_Resets;
+	NullPrivateData m_PrivateData;
+};
+
+// A fence whose value only moves when Signal is called on it, from the CPU
+// or from a NullCommandQueue. Events passed to SetEventOnCompletion are set
+// once the value is reached, so D3D12Fence can wait on it as usual.
+class NullFence : public ID3D12Fence
+{
+public:
+	static Microsoft::WRL::ComPtr<NullFence> Create(UINT64 initialValue = 0);
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return DXGI_ERROR_NOT_FOUND; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override;
+
+	// ID3D12Fence
+	UINT64 STDMETHODCALLTYPE GetCompletedValue() override { return m_Completed; }
+	HRESULT STDMETHODCALLTYPE SetEventOnCompletion(UINT64 value, HANDLE event) override;
+	HRESULT STDMETHODCALLTYPE Signal(UINT64 value) override;
+
+private:
+	explicit NullFence(UINT64 initialValue);
+	~NullFence() = default;
+
+	struct PendingEvent
+	{
+		UINT64 Value;
+		HANDLE Event;
+	};
+
+	std::atomic<ULONG> m_References;
+	std::atomic<UINT64> m_Completed;
+	std::mutex m_Mutex;
+	std::vector<PendingEvent> m_PendingEvents;
+};
+
+// A command queue that finishes everything the moment it is submitted:
+// ExecuteCommandLists only counts the lists, and Signal sets the fence
+// right away. Waits never stall, since every signal has already happened.
+class NullCommandQueue : public ID3D12CommandQueue
+{
+public:
+	static Microsoft::WRL::ComPtr<NullCommandQueue> Create(const D3D12_COMMAND_QUEUE_DESC& desc);
+
+	UINT64 GetExecutedListCount() const { return m_ExecutedLists; }
+	UINT64 GetExecuteCount() const { return m_Executes; }
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return DXGI_ERROR_NOT_FOUND; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override;
+
+	// ID3D12CommandQueue
+	void STDMETHODCALLTYPE UpdateTileMappings(ID3D12Resource*, UINT, const D3D12_TILED_RESOURCE_COORDINATE*, const D3D12_TILE_REGION_SIZE*,
+		ID3D12Heap*, UINT, const D3D12_TILE_RANGE_FLAGS*, const UINT*, const UINT*, D3D12_TILE_MAPPING_FLAGS) override {}
+	void STDMETHODCALLTYPE CopyTileMappings(ID3D12Resource*, const D3D12_TILED_RESOURCE_COORDINATE*, ID3D12Resource*,
+		const D3D12_TILED_RESOURCE_COORDINATE*, const D3D12_TILE_REGION_SIZE*, D3D12_TILE_MAPPING_FLAGS) override {}
+	void STDMETHODCALLTYPE ExecuteCommandLists(UINT numCommandLists, ID3D12CommandList* const* commandLists) override;
+	void STDMETHODCALLTYPE SetMarker(UINT, const void*, UINT) override {}
+	void STDMETHODCALLTYPE BeginEvent(UINT, const void*, UINT) override {}
+	void STDMETHODCALLTYPE EndEvent() override {}
+	HRESULT STDMETHODCALLTYPE Signal(ID3D12Fence* fence, UINT64 value) override;
+	HRESULT STDMETHODCALLTYPE Wait(ID3D12Fence* fence, UINT64 value) override;
+	HRESULT STDMETHODCALLTYPE GetTimestampFrequency(UINT64* frequency) override;
+	HRESULT STDMETHODCALLTYPE GetClockCalibration(UINT64* gpuTimestamp, UINT64* cpuTimestamp) override;
+	D3D12_COMMAND_QUEUE_DESC STDMETHODCALLTYPE GetDesc() override { return m_Desc; }
+
+private:
+	explicit NullCommandQueue(const D3D12_COMMAND_QUEUE_DESC& desc);
+	~NullCommandQueue() = default;
+
+	std::atomic<ULONG> m_References;
+	D3D12_COMMAND_QUEUE_DESC m_Desc;
+	std::atomic<UINT64> m_ExecutedLists;
+	std::atomic<UINT64> m_Executes;
+};
+
+// A device that creates the objects above, so code that owns its queues,
+// allocators, lists and fences (CommandQueue, ParallelCommandRecorder) can
+// run headless. Pipeline states and committed resources come back as
+// NullPipelineState and NullResource; whatever else the renderer does not
+// create through it fails with E_NOTIMPL or does nothing.
+class NullDevice : public ID3D12Device2
+{
+public:
+	static Microsoft::WRL::ComPtr<NullDevice> Create();
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return DXGI_ERROR_NOT_FOUND; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return S_OK; }
+
+	// ID3D12Device
+	UINT STDMETHODCALLTYPE GetNodeCount() override { return 1; }
+	HRESULT STDMETHODCALLTYPE CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC* desc, REFIID riid, void** commandQueue) override;
+	HRESULT STDMETHODCALLTYPE CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type, REFIID riid, void** commandAllocator) override;
+	HRESULT STDMETHODCALLTYPE CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC*, REFIID riid, void** pipelineState) override;
+	HRESULT STDMETHODCALLTYPE CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC*, REFIID riid, void** pipelineState) override;
+	HRESULT STDMETHODCALLTYPE CreateCommandList(UINT, D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator*, ID3D12PipelineState*, REFIID riid, void** commandList) override;
+	HRESULT STDMETHODCALLTYPE CheckFeatureSupport(D3D12_FEATURE, void*, UINT) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC*, REFIID, void** heap) override;
+	UINT STDMETHODCALLTYPE GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE) override { return 32; }
+	HRESULT STDMETHODCALLTYPE CreateRootSignature(UINT, const void*, SIZE_T, REFIID, void** rootSignature) override;
+	void STDMETHODCALLTYPE CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC*, D3D12_CPU_DESCRIPTOR_HANDLE) override {}
+	void STDMETHODCALLTYPE CreateShaderResourceView(ID3D12Resource*, const D3D12_SHADER_RESOURCE_VIEW_DESC*, D3D12_CPU_DESCRIPTOR_HANDLE) override {}
+	void STDMETHODCALLTYPE CreateUnorderedAccessView(ID3D12Resource*, ID3D12Resource*, const D3D12_UNORDERED_ACCESS_VIEW_DESC*, D3D12_CPU_DESCRIPTOR_HANDLE) override {}
+	void STDMETHODCALLTYPE CreateRenderTargetView(ID3D12Resource*, const D3D12_RENDER_TARGET_VIEW_DESC*, D3D12_CPU_DESCRIPTOR_HANDLE) override {}
+	void STDMETHODCALLTYPE CreateDepthStencilView(ID3D12Resource*, const D3D12_DEPTH_STENCIL_VIEW_DESC*, D3D12_CPU_DESCRIPTOR_HANDLE) override {}
+	void STDMETHODCALLTYPE CreateSampler(const D3D12_SAMPLER_DESC*, D3D12_CPU_DESCRIPTOR_HANDLE) override {}
+	void STDMETHODCALLTYPE CopyDescriptors(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, const UINT*, UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, const UINT*, D3D12_DESCRIPTOR_HEAP_TYPE) override {}
+	void STDMETHODCALLTYPE CopyDescriptorsSimple(UINT, D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_DESCRIPTOR_HEAP_TYPE) override {}
+	D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE GetResourceAllocationInfo(UINT, UINT, const D3D12_RESOURCE_DESC*) override { return {}; }
+	D3D12_HEAP_PROPERTIES STDMETHODCALLTYPE GetCustomHeapProperties(UINT, D3D12_HEAP_TYPE) override { return {}; }
+	HRESULT STDMETHODCALLTYPE CreateCommittedResource(const D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS, const D3D12_RESOURCE_DESC* desc,
+		D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID riid, void** resource) override;
+	HRESULT STDMETHODCALLTYPE CreateHeap(const D3D12_HEAP_DESC*, REFIID, void** heap) override;
+	HRESULT STDMETHODCALLTYPE CreatePlacedResource(ID3D12Heap*, UINT64, const D3D12_RESOURCE_DESC*, D3D12_RESOURCE_STATES,
+		const D3D12_CLEAR_VALUE*, REFIID, void** resource) override;
+	HRESULT STDMETHODCALLTYPE CreateReservedResource(const D3D12_RESOURCE_DESC*, D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID, void** resource) override;
+	HRESULT STDMETHODCALLTYPE CreateSharedHandle(ID3D12DeviceChild*, const SECURITY_ATTRIBUTES*, DWORD, LPCWSTR, HANDLE*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE OpenSharedHandle(HANDLE, REFIID, void** object) override;
+	HRESULT STDMETHODCALLTYPE OpenSharedHandleByName(LPCWSTR, DWORD, HANDLE*) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE MakeResident(UINT, ID3D12Pageable* const*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE Evict(UINT, ID3D12Pageable* const*) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE CreateFence(UINT64 initialValue, D3D12_FENCE_FLAGS, REFIID riid, void** fence) override;
+	HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() override { return S_OK; }
+	void STDMETHODCALLTYPE GetCopyableFootprints(const D3D12_RESOURCE_DESC*, UINT, UINT numSubresources, UINT64,
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizes, UINT64* totalBytes) override;
+	HRESULT STDMETHODCALLTYPE CreateQueryHeap(const D3D12_QUERY_HEAP_DESC*, REFIID, void** heap) override;
+	HRESULT STDMETHODCALLTYPE SetStablePowerState(BOOL) override { return S_OK; }
+	HRESULT STDMETHODCALLTYPE CreateCommandSignature(const D3D12_COMMAND_SIGNATURE_DESC*, ID3D12RootSignature*, REFIID, void** commandSignature) override;
+	void STDMETHODCALLTYPE GetResourceTiling(ID3D12Resource*, UINT*, D3D12_PACKED_MIP_INFO*, D3D12_TILE_SHAPE*, UINT*, UINT, D3D12_SUBRESOURCE_TILING*) override {}
+	LUID STDMETHODCALLTYPE GetAdapterLuid() override { return {}; }
+
+	// ID3D12Device1
+	HRESULT STDMETHODCALLTYPE CreatePipelineLibrary(const void*, SIZE_T, REFIID, void** pipelineLibrary) override;
+	HRESULT STDMETHODCALLTYPE SetEventOnMultipleFenceCompletion(ID3D12Fence* const*, const UINT64*, UINT, D3D12_MULTIPLE_FENCE_WAIT_FLAGS, HANDLE) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetResidencyPriority(UINT, ID3D12Pageable* const*, const D3D12_RESIDENCY_PRIORITY*) override { return S_OK; }
+
+	// ID3D12Device2
+	HRESULT STDMETHODCALLTYPE CreatePipelineState(const D3D12_PIPELINE_STATE_STREAM_DESC*, REFIID riid, void** pipelineState) override;
+
+private:
+	NullDevice();
+	~NullDevice() = default;
+
+	std::atomic<ULONG> m_References;
+};
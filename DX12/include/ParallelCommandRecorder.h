@@ -0,0 +1,99 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CommandQueue;
+
+// Records one frame's draws on several threads.
+//
+// The items [0, itemCount) are split into contiguous chunks. Each chunk is
+// recorded into its own command list from the queue's pool, by a worker or
+// by the calling thread. The lists come back in chunk order, so submitting
+// them in one ExecuteCommandLists call keeps draw order deterministic no
+// matter which thread recorded what.
+//
+// State does not carry over between command lists, so setup is called at
+// the start of every list to bind the root signature, render targets,
+// viewports and so on before record is called for the chunk's items.
+class ParallelCommandRecorder
+{
+public:
+	using SetupFunction = std::function<void(ID3D12GraphicsCommandList* commandList)>;
+	using RecordFunction = std::function<void(ID3D12GraphicsCommandList* commandList, size_t begin, size_t end)>;
+
+	// Chunks smaller than this cost more in list overhead than they save.
+	static const size_t MinItemsPerList = 256;
+
+	// threadCount workers are started in addition to the calling thread.
+	explicit ParallelCommandRecorder(CommandQueue& queue, UINT threadCount = 0);
+	~ParallelCommandRecorder();
+
+	ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+	ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+	// Record and return the open lists in item order. itemsPerList of 0 picks
+	// a chunk size that gives each thread a few chunks to balance load.
+	// Exceptions thrown by setup or record are rethrown here.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> Record(
+		size_t itemCount, const SetupFunction& setup, const RecordFunction& record, size_t itemsPerList = 0);
+
+	// Record, then submit with one ExecuteCommandLists call. Returns the fence value.
+	UINT64 RecordAndSubmit(
+		size_t itemCount, const SetupFunction& setup, const RecordFunction& record, size_t itemsPerList = 0);
+
+	UINT GetThreadCount() const { return static_cast<UINT>(m_Workers.size()) + 1; }
+
+	struct ScalingResult
+	{
+		UINT ThreadCount = 0;
+		double RecordMilliseconds = 0.0;   // Average per frame.
+		double Speedup = 1.0;              // Relative to one thread.
+	};
+
+	// Record frameCount frames of itemCount items with 1, 2, 4, ... up to
+	// maxThreadCount threads and report the average CPU time per frame.
+	// Returns no results if frameCount is zero.
+	static std::vector<ScalingResult> RunScalingBenchmark(
+		CommandQueue& queue, size_t itemCount, const SetupFunction& setup, const RecordFunction& record,
+		UINT maxThreadCount = 0, UINT frameCount = 16);
+
+private:
+	struct Batch
+	{
+		const SetupFunction* Setup = nullptr;
+		const RecordFunction* Record = nullptr;
+		size_t ItemCount = 0;
+		size_t ItemsPerList = 0;
+		size_t ChunkCount = 0;
+		std::atomic<size_t> NextChunk{ 0 };
+		std::atomic<size_t> Remaining{ 0 };
+		std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> Lists;
+
+		std::mutex ErrorMutex;
+		std::exception_ptr Error;
+	};
+
+	void WorkerThread();
+	void RecordChunks(Batch& batch);
+
+	CommandQueue& m_Queue;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkDone;
+	Batch* m_Batch;
+	UINT64 m_Generation;
+	UINT m_ActiveWorkers;
+	bool m_Stopping;
+
+	std::vector<std::thread> m_Workers;
+};
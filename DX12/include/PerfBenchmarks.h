@@ -0,0 +1,14 @@
+#pragma once
+
+class PerfSuite;
+
+// The regression suite: the CPU side of the d3dx12.h helpers the renderer
+// leans on (MemcpySubresource, UpdateSubresources, D3DX12ParsePipelineStream,
+// D3DX12SerializeVersionedRootSignature, CD3DX12_STATE_OBJECT_DESC
+// flattening) and of the renderer's own hot paths (capture recording and
+// replay, draw sorting, draw submission, indirect argument packing, job
+// scheduling, profiler scopes, the success path of ThrowIfFailed).
+//
+// Everything runs against NullDevice objects or the null capture backend,
+// so the suite needs no GPU and measures only CPU overhead.
+void AddPerfBenchmarks(PerfSuite& suite);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timing of one benchmark, in nanoseconds per operation.
+struct PerfResult
+{
+	std::string Name;
+	uint32_t SampleCount = 0;
+	uint64_t IterationsPerSample = 0;
+	double Median = 0.0;
+	// Median absolute deviation of the samples from Median: a spread that a
+	// few samples hit by the scheduler barely move.
+	double Deviation = 0.0;
+	double Min = 0.0;
+};
+
+enum class PerfVerdict
+{
+	Unchanged,
+	Improved,
+	Regressed,
+	New,        // Not in the baseline.
+	Missing     // In the baseline but not run.
+};
+
+struct PerfComparison
+{
+	std::string Name;
+	PerfVerdict Verdict = PerfVerdict::Unchanged;
+	double BaselineMedian = 0.0;
+	double CurrentMedian = 0.0;
+	double Change = 0.0;            // Relative: 0.1 is 10% slower.
+	double Significance = 0.0;      // Difference in standard errors of the medians.
+};
+
+// One benchmark's median relative to another's, such as the cost of a
+// wrapper over the calls it wraps.
+struct PerfRatio
+{
+	std::string Name;
+	double Ratio = 0.0;         // Benchmark median over reference median.
+	double Difference = 0.0;    // Nanoseconds per operation added.
+};
+
+// A benchmark's median against a fixed limit, such as the cost per call a
+// design promises. Unlike a baseline, a budget holds on every machine.
+struct PerfBudget
+{
+	std::string Name;
+	double Median = 0.0;
+	double Budget = 0.0;        // Nanoseconds per operation.
+	bool Exceeded = false;
+};
+
+const char* GetPerfVerdictName(PerfVerdict verdict);
+
+// Microbenchmarks that are timed, saved as JSON and compared against a
+// baseline to catch CPU-overhead regressions.
+//
+// Each benchmark repeats an operation. The suite first finds how many
+// iterations fill a sample of SampleMilliseconds, then takes SampleCount
+// samples and keeps the median time per operation and the median absolute
+// deviation. Medians ignore the occasional preempted sample, so on a quiet
+// machine runs agree to a few percent.
+//
+// A benchmark has regressed when its median is both Change slower than the
+// baseline's and Significance standard errors away from it. The relative
+// threshold ignores differences too small to matter; the statistical one
+// ignores differences as large as the noise of a benchmark that is jittery
+// on this machine. Record baselines on the machine that runs the comparison.
+class PerfSuite
+{
+public:
+	// Runs the operation iterations times. Every call must do the same work.
+	using Benchmark = std::function<void(uint64_t iterations)>;
+
+	struct Options
+	{
+		uint32_t SampleCount = 15;
+		double SampleMilliseconds = 20.0;
+		std::string Filter;                 // Only run benchmarks whose name contains this.
+	};
+
+	struct Thresholds
+	{
+		double Change = 0.05;
+		double Significance = 3.0;
+	};
+
+	void Add(const std::string& name, Benchmark benchmark);
+
+	// Report benchmark's median relative to reference's after a run. Both
+	// must do the same number of operations per iteration.
+	void AddRatio(const std::string& name, const std::string& benchmark, const std::string& reference);
+
+	// Fail a run whose median for benchmark is above maxNanoseconds, with or
+	// without a baseline.
+	void AddBudget(const std::string& benchmark, double maxNanoseconds);
+
+	std::vector<PerfResult> Run(const Options& options) const;
+
+	// The ratios whose benchmarks are both in results.
+	std::vector<PerfRatio> GetRatios(const std::vector<PerfResult>& results) const;
+
+	// The budgets whose benchmarks are in results.
+	std::vector<PerfBudget> GetBudgets(const std::vector<PerfResult>& results) const;
+	static bool ExceedsBudget(const std::vector<PerfBudget>& budgets);
+
+	static std::vector<PerfComparison> Compare(const std::vector<PerfResult>& baseline,
+		const std::vector<PerfResult>& current, const Thresholds& thresholds);
+	static bool HasRegression(const std::vector<PerfComparison>& comparisons);
+
+	static void WriteJson(std::ostream& stream, const std::vector<PerfResult>& results);
+
+	// Throws FileError if the file cannot be written.
+	static void SaveJson(const std::wstring& path, const std::vector<PerfResult>& results);
+
+	// Returns false, leaving results empty, if the file is missing or does not
+	// parse.
+	static bool LoadJson(const std::wstring& path, std::vector<PerfResult>& results);
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		Benchmark Function;
+	};
+
+	struct RatioEntry
+	{
+		std::string Name;
+		std::string Benchmark;
+		std::string Reference;
+	};
+
+	std::vector<Entry> m_Benchmarks;
+	struct BudgetEntry
+	{
+		std::string Benchmark;
+		double Nanoseconds;
+	};
+
+	std::vector<RatioEntry> m_Ratios;
+	std::vector<BudgetEntry> m_Budgets;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class PipelineLibraryCache;
+
+// Visible requests are compiled before speculative ones. A speculative request
+// that becomes visible is moved up the queue.
+enum class CompilePriority
+{
+	Speculative = 0,
+	Visible = 1,
+};
+
+struct PipelineCompileJob;
+
+// A queued or finished compilation. Cheap to copy and to poll every frame.
+class PipelineRequest
+{
+public:
+	using Future = std::shared_future<Microsoft::WRL::ComPtr<ID3D12PipelineState>>;
+
+	PipelineRequest() = default;
+
+	bool IsValid() const { return m_Job != nullptr; }
+
+	// The pipeline if compilation has finished successfully, otherwise null.
+	ID3D12PipelineState* TryGet() const;
+
+	// Holds an exception if creation failed.
+	const Future& GetFuture() const;
+
+private:
+	friend class PipelineCompileService;
+
+	explicit PipelineRequest(std::shared_ptr<PipelineCompileJob> job)
+		: m_Job(std::move(job))
+	{}
+
+	std::shared_ptr<PipelineCompileJob> m_Job;
+};
+
+// Compiles pipeline state streams on a pool of worker threads so the render
+// thread never waits on the driver.
+//
+// Until a pipeline is ready the renderer draws with a fallback pipeline, or
+// skips the draw when there is none:
+//
+//     PipelineRequest request = service.Request(stream, CompilePriority::Speculative);
+//     ...
+//     ID3D12PipelineState* pso = service.Acquire(request, CompilePriority::Visible, fallbackPso);
+//     if (pso) { commandList.SetPipelineState(pso); ... }
+//
+// Requests are deduplicated by the stream hash (see PipelineStateHash.h). The
+// stream is copied, but the shaders, input layout and root signature it
+// points to must stay alive until the request completes.
+class PipelineCompileService
+{
+public:
+	struct Stats
+	{
+		UINT64 Requested = 0;
+		UINT64 Compiled = 0;
+		UINT64 Failed = 0;
+		UINT64 Promoted = 0;       // Speculative requests that became visible while queued.
+		UINT64 FallbackDraws = 0;  // Acquire calls answered with the fallback.
+		UINT64 SkippedDraws = 0;   // Acquire calls with no pipeline to return.
+	};
+
+	// Compiles through cache when one is given, so results are persisted too.
+	PipelineCompileService(Microsoft::WRL::ComPtr<ID3D12Device2> device, PipelineLibraryCache* cache = nullptr, UINT threadCount = 0);
+	~PipelineCompileService();
+
+	PipelineCompileService(const PipelineCompileService&) = delete;
+	PipelineCompileService& operator=(const PipelineCompileService&) = delete;
+
+	// Queue a stream for compilation. Requesting a stream that is already queued
+	// returns the existing request and raises its priority if needed.
+	PipelineRequest Request(D3D12_PIPELINE_STATE_STREAM_DESC desc, CompilePriority priority);
+
+	template <typename Stream>
+	PipelineRequest Request(Stream& stream, CompilePriority priority)
+	{
+		D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(Stream), &stream };
+		return Request(desc, priority);
+	}
+
+	// The compiled pipeline if it is ready. Otherwise the request is promoted
+	// to priority if needed and fallback is returned, which may be null to
+	// skip the draw.
+	ID3D12PipelineState* Acquire(const PipelineRequest& request, CompilePriority priority, ID3D12PipelineState* fallback = nullptr);
+
+	// Block until the queue is empty and all workers are idle.
+	void WaitIdle();
+
+	size_t GetPendingCount() const;
+	Stats GetStats() const;
+
+private:
+	// Ordered so the first element is the next job to compile.
+	struct QueueKey
+	{
+		CompilePriority Priority;
+		UINT64 Sequence;
+		UINT64 Hash;
+
+		bool operator<(const QueueKey& other) const
+		{
+			if (Priority != other.Priority)
+			{
+				return Priority > other.Priority;
+			}
+			return Sequence < other.Sequence;
+		}
+	};
+
+	void Promote(PipelineCompileJob& job, CompilePriority priority);
+	void WorkerThread();
+	void Compile(PipelineCompileJob& job);
+
+	Microsoft::WRL::ComPtr<ID3D12Device2> m_Device;
+	PipelineLibraryCache* m_Cache;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_Idle;
+	std::unordered_map<UINT64, std::shared_ptr<PipelineCompileJob>> m_Jobs;
+	std::set<QueueKey> m_Queue;
+	UINT64 m_NextSequence;
+	UINT m_ActiveWorkers;
+	bool m_Stopping;
+
+	std::vector<std::thread> m_Workers;
+
+	std::atomic<UINT64> m_Requested;
+	std::atomic<UINT64> m_Compiled;
+	std::atomic<UINT64> m_Failed;
+	std::atomic<UINT64> m_Promoted;
+	std::atomic<UINT64> m_FallbackDraws;
+	std::atomic<UINT64> m_SkippedDraws;
+};
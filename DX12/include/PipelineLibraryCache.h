@@ -0,0 +1,131 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Persistent cache of pipeline state objects backed by ID3D12PipelineLibrary.
+//
+// Every PSO created through the cache is stored in the library under the hash
+// of its stream (see PipelineStateHash.h). The library is written to disk on
+// shutdown, together with a usage log that records the order pipelines were
+// first needed in. On the next run Prewarm() loads pipelines on background
+// threads in that order, so the ones needed first are ready first.
+//
+// GetOrCreate and Prewarm may be called from any thread.
+
+class PipelineLibraryCache
+{
+public:
+	struct Stats
+	{
+		UINT64 LibraryHits = 0;     // Loaded from the library blob.
+		UINT64 LibraryMisses = 0;   // Compiled by the driver.
+		UINT64 MemoryHits = 0;      // Already created this run.
+		double CreateMilliseconds = 0.0;
+	};
+
+	// Loads <path> and <path>.usage if they exist. A library written by a
+	// different driver or adapter is discarded.
+	PipelineLibraryCache(Microsoft::WRL::ComPtr<ID3D12Device2> device, const std::wstring& path);
+
+	// Waits for prewarming and saves.
+	~PipelineLibraryCache();
+
+	PipelineLibraryCache(const PipelineLibraryCache&) = delete;
+	PipelineLibraryCache& operator=(const PipelineLibraryCache&) = delete;
+
+	// Taken by value so that this overload, not the template, is picked for descs.
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetOrCreate(D3D12_PIPELINE_STATE_STREAM_DESC desc);
+
+	template <typename Stream>
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetOrCreate(Stream& stream)
+	{
+		D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(Stream), &stream };
+		return GetOrCreate(desc);
+	}
+
+	// Create the given pipelines on background threads, ordered by when they
+	// were first used in previous runs. Pipelines never used before go last.
+	// The streams and everything they point to must stay alive until
+	// WaitForPrewarm returns.
+	void Prewarm(const std::vector<D3D12_PIPELINE_STATE_STREAM_DESC>& streams, UINT threadCount = 0);
+	void WaitForPrewarm();
+
+	// Write the library and the usage log. Each file is written to a temporary
+	// file first and then moved over the old one, so a crash mid-write never
+	// leaves a truncated cache behind. Throws FileError if either cannot be
+	// written.
+	void Save();
+
+	// Discard everything stored on disk and in memory.
+	void Clear();
+
+	Stats GetStats() const;
+	bool HasLibrary() const { return m_Library != nullptr; }
+
+	struct BenchmarkResult
+	{
+		UINT PipelineCount = 0;
+		double ColdMilliseconds = 0.0;
+		double WarmMilliseconds = 0.0;
+		UINT64 WarmLibraryHits = 0;
+	};
+
+	// Create all streams with an empty library, save it, then create them again
+	// from a freshly loaded library. path is overwritten.
+	static BenchmarkResult RunBenchmark(
+		Microsoft::WRL::ComPtr<ID3D12Device2> device,
+		const std::wstring& path,
+		const std::vector<D3D12_PIPELINE_STATE_STREAM_DESC>& streams);
+
+private:
+	struct Entry
+	{
+		std::once_flag Created;
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineState;
+		// Requested by the game (not just prewarmed) this run. Guarded by m_EntriesMutex.
+		bool Used = false;
+	};
+
+	void CreateLibrary();
+	void LoadUsageLog();
+	void Create(UINT64 hash, const D3D12_PIPELINE_STATE_STREAM_DESC& desc, Entry& entry);
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetOrCreate(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, bool recordUsage);
+
+	static std::wstring GetPipelineName(UINT64 hash);
+	static void WriteFileAtomic(const std::wstring& path, const void* data, size_t size);
+
+	Microsoft::WRL::ComPtr<ID3D12Device2> m_Device;
+	std::wstring m_Path;
+
+	// The library references this blob for its whole lifetime.
+	std::vector<char> m_LibraryBlob;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary1> m_Library;
+	// StorePipeline and Serialize must not run concurrently.
+	std::mutex m_LibraryMutex;
+
+	mutable std::mutex m_EntriesMutex;
+	std::unordered_map<UINT64, std::shared_ptr<Entry>> m_Entries;
+
+	// First-use rank of each pipeline from previous runs.
+	std::unordered_map<UINT64, UINT> m_PreviousUsage;
+	// First-use order of this run.
+	std::vector<UINT64> m_Usage;
+
+	std::vector<std::thread> m_PrewarmThreads;
+	std::vector<D3D12_PIPELINE_STATE_STREAM_DESC> m_PrewarmQueue;
+	std::atomic<size_t> m_PrewarmNext;
+
+	std::atomic<UINT64> m_LibraryHits;
+	std::atomic<UINT64> m_LibraryMisses;
+	std::atomic<UINT64> m_MemoryHits;
+	std::atomic<UINT64> m_CreateMicroseconds;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <d3d12.h>
+
+// Stable hashes of pipeline state streams.
+//
+// Streams hold pointers to shader bytecode, input layouts and root signatures,
+// so their raw bytes change from run to run. These hashes follow the pointers
+// and hash what they point to instead. Subobjects are hashed where they lie in
+// the stream, so a compact PipelineStream costs only the subobjects it holds,
+// and subobjects equal to their default are skipped, so subobject order and
+// omitted defaults do not affect the result.
+//
+// Root signatures are identified by the hash of their serialized blob, which
+// has to be attached with SetRootSignatureHash when the root signature is
+// created.
+
+void SetRootSignatureHash(ID3D12RootSignature* rootSignature, const void* serializedBlob, SIZE_T blobSize);
+UINT64 GetRootSignatureHash(ID3D12RootSignature* rootSignature);
+
+// Taken by value so that this overload, not the template, is picked for descs.
+UINT64 HashPipelineStateStream(D3D12_PIPELINE_STATE_STREAM_DESC desc);
+
+template <typename Stream>
+inline UINT64 HashPipelineStateStream(Stream& stream)
+{
+	D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(Stream), &stream };
+	return HashPipelineStateStream(desc);
+}
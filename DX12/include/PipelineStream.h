@@ -0,0 +1,209 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <cstddef>
+#include <type_traits>
+
+// Pipeline state stream with a layout fixed at compile time.
+//
+// CD3DX12_PIPELINE_STATE_STREAM1 holds every subobject whether it is used or
+// not. PipelineStream holds only the ones it is given, back to back, so a
+// compute pipeline is two subobjects instead of several hundred bytes:
+//
+//     auto stream = MakePipelineStream(
+//         CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE(rootSignature),
+//         CD3DX12_PIPELINE_STATE_STREAM_CS(CD3DX12_SHADER_BYTECODE(csBlob.Get())));
+//     D3D12_PIPELINE_STATE_STREAM_DESC desc = stream.GetDesc();
+//     device->CreatePipelineState(&desc, IID_PPV_ARGS(&pipelineState));
+//
+// Listing a subobject type twice is a compile error. The stream can be passed
+// anywhere a stream struct is accepted (PipelineLibraryCache::GetOrCreate,
+// HashPipelineStateStream, ...), since its size is exactly the size of its
+// subobjects.
+
+namespace PipelineStreamDetail
+{
+	template <typename Subobject>
+	struct SubobjectTraits;
+
+	template <typename InnerStructType, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE SubobjectType, typename DefaultArg>
+	struct SubobjectTraits<CD3DX12_PIPELINE_STATE_STREAM_SUBOBJECT<InnerStructType, SubobjectType, DefaultArg>>
+	{
+		static const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type = SubobjectType;
+		using Inner = InnerStructType;
+	};
+
+	template <D3D12_PIPELINE_STATE_SUBOBJECT_TYPE... Types>
+	struct TypeList
+	{
+		static constexpr bool Contains(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type)
+		{
+			const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE types[] = { Types... };
+			for (D3D12_PIPELINE_STATE_SUBOBJECT_TYPE t : types)
+			{
+				if (t == type)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static constexpr bool AllDistinct()
+		{
+			const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE types[] = { Types... };
+			const size_t count = sizeof...(Types);
+			for (size_t i = 0; i < count; ++i)
+			{
+				for (size_t j = i + 1; j < count; ++j)
+				{
+					if (types[i] == types[j])
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		static constexpr size_t IndexOf(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type)
+		{
+			const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE types[] = { Types... };
+			for (size_t i = 0; i < sizeof...(Types); ++i)
+			{
+				if (types[i] == type)
+				{
+					return i;
+				}
+			}
+			return sizeof...(Types);
+		}
+	};
+
+	template <size_t... Sizes>
+	struct SizeSum;
+
+	template <>
+	struct SizeSum<>
+	{
+		static const size_t Value = 0;
+	};
+
+	template <size_t First, size_t... Rest>
+	struct SizeSum<First, Rest...>
+	{
+		static const size_t Value = First + SizeSum<Rest...>::Value;
+	};
+
+	// Subobjects are pointer aligned and padded to pointer size, so each one
+	// directly follows the previous one. The single element case ends the
+	// recursion without an empty member, which would add trailing padding.
+	template <typename... Subobjects>
+	struct Storage;
+
+	template <typename Last>
+	struct Storage<Last>
+	{
+		Storage() = default;
+		explicit Storage(const Last& last) : First(last) {}
+
+		template <size_t Index>
+		Last& Get()
+		{
+			static_assert(Index == 0, "Subobject index out of range.");
+			return First;
+		}
+
+		template <size_t Index>
+		const Last& Get() const
+		{
+			static_assert(Index == 0, "Subobject index out of range.");
+			return First;
+		}
+
+		Last First;
+	};
+
+	template <typename Head, typename Next, typename... Tail>
+	struct Storage<Head, Next, Tail...>
+	{
+		using RestStorage = Storage<Next, Tail...>;
+
+		Storage() = default;
+		Storage(const Head& head, const Next& next, const Tail&... tail) : First(head), Rest(next, tail...) {}
+
+		template <size_t Index, typename = typename std::enable_if<Index == 0>::type>
+		Head& Get() { return First; }
+
+		template <size_t Index, typename = typename std::enable_if<Index == 0>::type>
+		const Head& Get() const { return First; }
+
+		template <size_t Index, typename = typename std::enable_if<Index != 0>::type, typename = void>
+		auto& Get() { return Rest.template Get<Index - 1>(); }
+
+		template <size_t Index, typename = typename std::enable_if<Index != 0>::type, typename = void>
+		const auto& Get() const { return Rest.template Get<Index - 1>(); }
+
+		Head First;
+		RestStorage Rest;
+	};
+}
+
+template <typename... Subobjects>
+class PipelineStream
+{
+	using Types = PipelineStreamDetail::TypeList<PipelineStreamDetail::SubobjectTraits<Subobjects>::Type...>;
+
+	static_assert(sizeof...(Subobjects) > 0, "A pipeline stream needs at least one subobject.");
+	static_assert(Types::AllDistinct(), "Each subobject type may appear only once in a pipeline stream.");
+	static_assert(!(Types::Contains(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL) && Types::Contains(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1)),
+		"DEPTH_STENCIL and DEPTH_STENCIL1 describe the same state, use only one.");
+	static_assert(sizeof(PipelineStreamDetail::Storage<Subobjects...>) == PipelineStreamDetail::SizeSum<sizeof(Subobjects)...>::Value,
+		"Pipeline stream subobjects must be tightly packed.");
+
+public:
+	static const UINT SubobjectCount = sizeof...(Subobjects);
+
+	// Subobjects not given explicitly keep their d3dx12 defaults.
+	PipelineStream() = default;
+	explicit PipelineStream(const Subobjects&... subobjects) : m_Storage(subobjects...) {}
+
+	template <D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type>
+	static constexpr bool Has() { return Types::Contains(Type); }
+
+	// Access a subobject by its d3dx12 type, e.g. stream.Get<CD3DX12_PIPELINE_STATE_STREAM_VS>() = vsBytecode.
+	template <typename Subobject>
+	Subobject& Get()
+	{
+		const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = PipelineStreamDetail::SubobjectTraits<Subobject>::Type;
+		static_assert(Types::Contains(type), "The stream does not contain this subobject.");
+		return m_Storage.template Get<Types::IndexOf(type)>();
+	}
+
+	template <typename Subobject>
+	const Subobject& Get() const
+	{
+		const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = PipelineStreamDetail::SubobjectTraits<Subobject>::Type;
+		static_assert(Types::Contains(type), "The stream does not contain this subobject.");
+		return m_Storage.template Get<Types::IndexOf(type)>();
+	}
+
+	D3D12_PIPELINE_STATE_STREAM_DESC GetDesc()
+	{
+		return { sizeof(m_Storage), &m_Storage };
+	}
+
+private:
+	PipelineStreamDetail::Storage<Subobjects...> m_Storage;
+};
+
+template <typename... Subobjects>
+inline PipelineStream<Subobjects...> MakePipelineStream(const Subobjects&... subobjects)
+{
+	return PipelineStream<Subobjects...>(subobjects...);
+}
+
+using ComputePipelineStream = PipelineStream<
+	CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE,
+	CD3DX12_PIPELINE_STATE_STREAM_CS>;
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Scoped CPU timing markers, counters and frame boundaries, exported as a
+// Chrome trace (chrome://tracing, ui.perfetto.dev).
+//
+// Each thread writes into its own ring of events, so recording takes no
+// locks and shares no cache lines with other threads: a scope is two
+// timestamps and two 32-byte writes. Collect drains the rings into the
+// capture, so call it about once a frame (MarkFrame does) or the rings fill
+// up and new events are dropped until it runs. The capture keeps the most
+// recent events, so recording can stay on indefinitely. A thread that exits
+// leaves its ring to the next thread to start, whose events continue on the
+// same timeline, so worker threads can come and go without the profiler
+// growing.
+//
+//     void Renderer::RecordShadows()
+//     {
+//         ProfileScope scope("RecordShadows");
+//         ...
+//     }
+//
+// Names are not copied and must outlive the capture; use string literals.
+class Profiler
+{
+public:
+	// Events each thread can hold between two calls to Collect.
+	static const uint32_t EventsPerThread = 1 << 15;
+	// Events of each thread the capture keeps; older ones are dropped.
+	static const uint32_t CapturedEventsPerThread = 1 << 20;
+	// Events of all threads together the capture keeps; the oldest are
+	// dropped first.
+	static const uint32_t CapturedEvents = 1 << 22;
+
+	// Recording is on by default. Scopes open when it is turned off still end.
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// Returns false if the scope was not recorded, because recording is off or
+	// the thread's ring is full. EndScope must only follow a true BeginScope.
+	static bool BeginScope(const char* name);
+	static void EndScope();
+
+	// A sample of a value over time, drawn as a graph above the threads.
+	static void Counter(const char* name, int64_t value);
+
+	// Mark the end of a frame on every thread's timeline and collect.
+	static void MarkFrame();
+
+	// Shown instead of the thread's number. Copied.
+	static void SetThreadName(const char* name);
+
+	// A scope timed elsewhere, such as on the GPU, shown on a track of that
+	// name above the threads. Takes a lock, so it suits tens of scopes a frame
+	// rather than thousands. Thread-safe.
+	static void AddTrackScope(const char* track, const char* name,
+		std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+	// Move the events recorded so far from every thread into the capture.
+	// Thread-safe, but it does not scale, so call it from one thread.
+	static void Collect();
+
+	// Drop the capture. Events still in the rings are dropped too.
+	static void Clear();
+
+	// Events lost to full rings since the last Clear.
+	static uint64_t GetDroppedEventCount();
+
+	// Collect and write the capture as Chrome trace JSON. Scopes still open
+	// are left out.
+	static void WriteChromeTrace(std::ostream& stream);
+
+	// Throws FileError if the file cannot be written.
+	static void SaveChromeTrace(const std::wstring& path);
+
+	struct Benchmark
+	{
+		double ScopeNanoseconds = 0.0;          // Begin and end of one recorded scope.
+		double DisabledScopeNanoseconds = 0.0;  // The same with recording off.
+		double TimestampNanoseconds = 0.0;      // Reading the clock once.
+		bool TimeStampCounter = false;          // The clock is rdtsc rather than steady_clock.
+	};
+
+	// Time scopeCount empty scopes on the calling thread, collecting between
+	// batches as a frame would. Leaves the capture empty.
+	static Benchmark RunBenchmark(uint32_t scopeCount = 1 << 22);
+};
+
+// Times its own lifetime.
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: m_Recorded(Profiler::BeginScope(name))
+	{
+	}
+
+	~ProfileScope()
+	{
+		if (m_Recorded)
+		{
+			Profiler::EndScope();
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	bool m_Recorded;
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <d3d12.h>
+#include "d3dx12.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Root signature cost analysis and layout optimization.
+//
+// A root signature holds at most 64 DWORDs. Root constants cost one DWORD per
+// 32-bit value, root descriptors cost two and descriptor tables cost one.
+// Hardware keeps the front of the root signature in registers and spills the
+// rest to memory, so the order of parameters matters as well as their size.
+
+enum ShaderStage : UINT
+{
+	ShaderStage_Vertex = 0,
+	ShaderStage_Hull,
+	ShaderStage_Domain,
+	ShaderStage_Geometry,
+	ShaderStage_Pixel,
+	ShaderStage_Count
+};
+
+enum ShaderStageMask : UINT
+{
+	ShaderStageMask_None = 0,
+	ShaderStageMask_Vertex = 1 << ShaderStage_Vertex,
+	ShaderStageMask_Hull = 1 << ShaderStage_Hull,
+	ShaderStageMask_Domain = 1 << ShaderStage_Domain,
+	ShaderStageMask_Geometry = 1 << ShaderStage_Geometry,
+	ShaderStageMask_Pixel = 1 << ShaderStage_Pixel,
+	ShaderStageMask_All = (1 << ShaderStage_Count) - 1
+};
+
+const char* GetShaderStageName(ShaderStage stage);
+
+// Stages that can see a parameter with the given visibility.
+UINT GetVisibleStageMask(D3D12_SHADER_VISIBILITY visibility);
+
+// How the application uses a root parameter. Without usage information every
+// parameter is assumed to be read by every stage and rebound once per frame.
+struct RootParameterUsage
+{
+	// How many times per frame the parameter is rebound.
+	float ChangesPerFrame = 1.0f;
+	// Stages that actually read the parameter.
+	UINT StageMask = ShaderStageMask_All;
+	// For root CBVs, the size of the bound constant buffer. Zero if unknown.
+	// A known size lets the optimizer promote the CBV to root constants.
+	UINT BufferSizeInDwords = 0;
+};
+
+struct RootSignatureCost
+{
+	static const UINT MaxDwords = 64;
+
+	UINT TotalDwords = 0;
+	std::vector<UINT> ParameterDwords;
+
+	// DWORDs of root arguments each stage can see.
+	UINT StageDwords[ShaderStage_Count] = {};
+	// DWORDs each stage can see but never reads.
+	UINT WastedStageDwords[ShaderStage_Count] = {};
+
+	// Stages that read no parameter but are not denied root access.
+	UINT UndeniedUnusedStageMask = 0;
+
+	bool IsOverLimit() const { return TotalDwords > MaxDwords; }
+};
+
+enum class RootParameterAction
+{
+	Kept,
+	Promoted, // Root CBV rewritten as root constants.
+	Demoted,  // Root descriptor folded into a descriptor table.
+};
+
+// Where a parameter of the original root signature ended up.
+struct RootParameterBinding
+{
+	UINT RootParameterIndex = 0;
+	// Descriptor offset inside the table for demoted parameters.
+	UINT OffsetInTable = 0;
+	RootParameterAction Action = RootParameterAction::Kept;
+};
+
+// A root signature description that owns its parameters, ranges and samplers.
+class RootSignatureLayout
+{
+public:
+	RootSignatureLayout() = default;
+	RootSignatureLayout(const RootSignatureLayout&) = delete;
+	RootSignatureLayout& operator=(const RootSignatureLayout&) = delete;
+	RootSignatureLayout(RootSignatureLayout&&) = default;
+	RootSignatureLayout& operator=(RootSignatureLayout&&) = default;
+
+	// Always a version 1.1 description.
+	const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& GetDesc() const { return m_Desc; }
+
+	const std::vector<CD3DX12_ROOT_PARAMETER1>& GetParameters() const { return m_Parameters; }
+
+	// Indexed by the parameter index of the source root signature.
+	const std::vector<RootParameterBinding>& GetBindings() const { return m_Bindings; }
+
+	// False when RootSignatureAnalyzer::Optimize ran out of root descriptors
+	// to demote before reaching Options::DwordBudget. The layout is then
+	// still over budget.
+	bool IsWithinBudget() const { return m_WithinBudget; }
+
+private:
+	friend class RootSignatureAnalyzer;
+	friend class RootSignatureGenerator;
+
+	void Finalize(D3D12_ROOT_SIGNATURE_FLAGS flags);
+
+	std::vector<CD3DX12_ROOT_PARAMETER1> m_Parameters;
+	std::vector<std::vector<CD3DX12_DESCRIPTOR_RANGE1>> m_Ranges;
+	std::vector<D3D12_STATIC_SAMPLER_DESC> m_StaticSamplers;
+	std::vector<RootParameterBinding> m_Bindings;
+	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC m_Desc;
+	bool m_WithinBudget = true;
+};
+
+class RootSignatureAnalyzer
+{
+public:
+	struct Options
+	{
+		// Root CBVs rebound at least this often are promoted to root constants.
+		float PromoteChangesPerFrame = 4.0f;
+		// Largest constant buffer that will be promoted.
+		UINT MaxPromotedDwords = 16;
+		// Root descriptors and tables rebound at most this often are demoted.
+		float DemoteChangesPerFrame = 0.1f;
+		UINT DwordBudget = RootSignatureCost::MaxDwords;
+	};
+
+	// usage is indexed by root parameter and may be empty.
+	static RootSignatureCost Analyze(
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		const std::vector<RootParameterUsage>& usage = {});
+
+	// Propose a cheaper layout for desc. The result is a version 1.1
+	// description ready for D3DX12SerializeVersionedRootSignature. Check
+	// RootSignatureLayout::IsWithinBudget: when the source has too many root
+	// constants and tables, no promotion or demotion brings it under budget.
+	static RootSignatureLayout Optimize(
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		const std::vector<RootParameterUsage>& usage,
+		const Options& options);
+
+	static RootSignatureLayout Optimize(
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		const std::vector<RootParameterUsage>& usage)
+	{
+		return Optimize(desc, usage, Options());
+	}
+
+	static UINT GetParameterDwords(const D3D12_ROOT_PARAMETER1& parameter);
+
+	// Read measured usage as text, one root parameter per line:
+	//
+	//     # parameter  changes per frame  [constant buffer DWORDs]
+	//     0            250                16
+	//     3            0.01
+	//
+	// Parameters not listed keep their entry in usage, which grows to fit.
+	// Returns false with a message in error on a malformed line.
+	static bool ReadUsage(std::istream& in, std::vector<RootParameterUsage>& usage, std::string& error);
+
+	static void WriteReport(
+		std::ostream& out,
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		const RootSignatureCost& cost);
+
+	static void WriteComparison(
+		std::ostream& out,
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		const std::vector<RootParameterUsage>& usage,
+		const RootSignatureLayout& layout);
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "RootSignatureAnalyzer.h"
+#include "ShaderReflection.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Root signature generation from shader reflection.
+//
+// The bindings of every stage of a pipeline are merged by register, and each
+// merged binding gets the cheapest parameter the shader can read it through:
+//
+//   constant buffer of known size, small enough     root constants
+//   constant buffer                                 root CBV
+//   raw or structured buffer, acceleration struct   root SRV or UAV
+//   anything else, and arrays                       descriptor table
+//
+// Root constants are read directly, root descriptors through one pointer and
+// tables through two. If the result is over the DWORD budget, the largest
+// root constants turn back into root CBVs, then root descriptors move into
+// tables, from the back of the root signature.
+//
+// A register read by several stages is bound once, visible to all of them;
+// a parameter read by one stage is visible only to that stage. Tables are
+// shared by the bindings with the same visibility, and stages that read
+// nothing are denied root access. CBVs and SRVs are marked DATA_STATIC unless
+// the options say otherwise: their contents must not change between binding
+// and the end of the command list's execution.
+
+// Where a shader binding ended up.
+struct GeneratedRootBinding
+{
+	std::string Name;                       // As declared by the first stage; empty for DXIL.
+	ShaderBindingClass Class = ShaderBindingClass::ShaderResource;
+	UINT Space = 0;
+	UINT Register = 0;
+	UINT Count = 1;                         // 0 for an unbounded array.
+	UINT StageMask = 0;                     // ShaderStageMask_*, or ShaderStageMask_All for compute.
+
+	// Where to bind it. Static samplers have no root parameter.
+	bool IsStaticSampler = false;
+	UINT RootParameterIndex = 0;
+	UINT OffsetInTable = 0;
+	D3D12_ROOT_PARAMETER_TYPE ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+};
+
+struct GeneratedRootSignature
+{
+	RootSignatureLayout Layout;
+	std::vector<GeneratedRootBinding> Bindings;
+};
+
+class RootSignatureGenerator
+{
+public:
+	struct Options
+	{
+		// Largest constant buffer turned into root constants. Only the part up
+		// to the last variable the shaders read is counted. Needs the layout,
+		// which DXBC shaders have and DXIL shaders do not.
+		UINT MaxRootConstantDwords = 16;
+		bool AllowRootDescriptors = true;
+		// DATA_STATIC for CBVs and SRVs rather than the version 1.1 default,
+		// DATA_STATIC_WHILE_SET_AT_EXECUTE.
+		bool DataStatic = true;
+		UINT DwordBudget = RootSignatureCost::MaxDwords;
+		// Samplers bound at a register and space listed here become static
+		// samplers. Their visibility is narrowed like a parameter's.
+		std::vector<D3D12_STATIC_SAMPLER_DESC> StaticSamplers;
+	};
+
+	// shaders are the stages of one pipeline: any of vertex, hull, domain,
+	// geometry and pixel, or a single compute shader. Returns false with a
+	// message in error if the stages cannot share a root signature or the
+	// bindings do not fit the budget.
+	static bool Generate(
+		const std::vector<const ShaderReflection*>& shaders,
+		const Options& options,
+		GeneratedRootSignature& result,
+		std::string& error);
+
+	static bool Generate(
+		const std::vector<const ShaderReflection*>& shaders,
+		GeneratedRootSignature& result,
+		std::string& error)
+	{
+		return Generate(shaders, Options(), result, error);
+	}
+
+	// The stages that read each root parameter, for RootSignatureAnalyzer.
+	// How often parameters are rebound is unknown and left at the default.
+	static std::vector<RootParameterUsage> GetUsage(const GeneratedRootSignature& result);
+
+	// The cost report of RootSignatureAnalyzer, then where each binding went.
+	static void WriteReport(std::ostream& out, const GeneratedRootSignature& result);
+
+	// Only where each binding went.
+	static void WriteBindings(std::ostream& out, const GeneratedRootSignature& result);
+};
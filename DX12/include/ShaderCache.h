@@ -0,0 +1,141 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "ShaderCompiler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+struct ShaderCacheResult
+{
+	D3D12_SHADER_BYTECODE Bytecode = {};    // Empty if preprocessing or compiling failed.
+	uint64_t Key = 0;
+	bool CacheHit = false;
+	std::vector<std::wstring> Includes;     // The source and every file it included.
+	std::string Errors;                     // Compiler output, including warnings.
+};
+
+// Content-addressed cache of shader bytecode, persisted in a pack file.
+//
+// The key of a shader hashes its preprocessed source, the paths of its
+// include closure, its defines, entry point, profile and flags, and the
+// compiler version. Preprocessing is much cheaper than compiling, so every
+// lookup preprocesses and only misses compile. Editing an include, changing a
+// define or upgrading the compiler changes the key; nothing needs to be
+// invalidated by hand.
+//
+// The pack is memory-mapped at construction, so a hit costs a binary search
+// of its index and returns a pointer into the mapping. Save writes the pack
+// back with this run's compiles added.
+//
+//     ShaderCache cache(std::make_unique<D3DShaderCompiler>(), L"shaders.pack");
+//     std::vector<ShaderCacheResult> shaders = cache.GetOrCompile(descs, jobs);
+//     ...create pipelines...
+//     cache.Save();
+//
+// GetOrCompile may be called from any thread. Bytecode stays valid until the
+// next Save or until the cache is destroyed; D3D12 copies it when creating a
+// pipeline, so create pipelines before saving.
+class ShaderCache
+{
+public:
+	struct Stats
+	{
+		UINT64 Hits = 0;                    // From the pack or compiled earlier this run.
+		UINT64 Misses = 0;                  // Compiled.
+		UINT64 Failures = 0;                // Failed to preprocess or compile.
+		double CompileMilliseconds = 0.0;   // Spent compiling misses.
+		double SavedMilliseconds = 0.0;     // What compiling the hits took when they missed.
+
+		double GetHitRate() const { return Hits + Misses ? double(Hits) / double(Hits + Misses) : 0.0; }
+	};
+
+	// Maps path if it holds a valid pack. A missing or damaged pack starts the
+	// cache empty.
+	ShaderCache(std::unique_ptr<ShaderCompiler> compiler, const std::wstring& path);
+
+	// Saves if anything was compiled this run.
+	~ShaderCache();
+
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	ShaderCacheResult GetOrCompile(const ShaderDesc& desc);
+
+	// Look up every shader and compile the misses in parallel on jobs. Call
+	// from the thread that owns jobs.
+	std::vector<ShaderCacheResult> GetOrCompile(const std::vector<ShaderDesc>& descs, JobSystem& jobs);
+
+	// Write the pack with everything compiled this run, through a temporary
+	// file so a crash never leaves a truncated pack, and map it again.
+	// Invalidates bytecode returned so far. Not thread-safe with GetOrCompile.
+	// Throws FileError if the pack cannot be written.
+	void Save();
+
+	// Delete the pack and forget everything compiled this run.
+	void Clear();
+
+	Stats GetStats() const;
+	ShaderCompiler& GetCompiler() const { return *m_Compiler; }
+
+	struct BenchmarkResult
+	{
+		UINT ShaderCount = 0;
+		double ColdMilliseconds = 0.0;
+		double WarmMilliseconds = 0.0;
+		Stats Warm;
+	};
+
+	// Compile descs with an empty pack, save it, then get them again through a
+	// cache that maps the saved pack. path is overwritten.
+	static BenchmarkResult RunBenchmark(const std::function<std::unique_ptr<ShaderCompiler>()>& createCompiler,
+		const std::wstring& path, const std::vector<ShaderDesc>& descs, JobSystem& jobs);
+
+private:
+	struct PackEntry
+	{
+		uint64_t Key;
+		uint64_t Offset;
+		uint32_t Size;
+		uint32_t CompileMicroseconds;
+	};
+
+	// A shader compiled this run. Compiled once even if several threads miss
+	// it at the same time.
+	struct Entry
+	{
+		std::once_flag Compiled;
+		bool Succeeded = false;
+		std::vector<uint8_t> Bytecode;
+		std::string Errors;
+		uint32_t CompileMicroseconds = 0;
+	};
+
+	class MappedPack;
+
+	uint64_t ComputeKey(const ShaderDesc& desc, const std::string& preprocessed,
+		const std::vector<std::wstring>& includes) const;
+	const PackEntry* FindInPack(uint64_t key) const;
+	void Map();
+
+	std::unique_ptr<ShaderCompiler> m_Compiler;
+	std::wstring m_Path;
+	std::unique_ptr<MappedPack> m_Pack;
+
+	std::mutex m_EntriesMutex;
+	std::unordered_map<uint64_t, std::shared_ptr<Entry>> m_Entries;
+
+	std::atomic<UINT64> m_Hits;
+	std::atomic<UINT64> m_Misses;
+	std::atomic<UINT64> m_Failures;
+	std::atomic<UINT64> m_CompileMicroseconds;
+	std::atomic<UINT64> m_SavedMicroseconds;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+// One shader to compile: a source file, its entry point and everything else
+// that changes the output.
+struct ShaderDesc
+{
+	std::wstring Path;
+	std::string EntryPoint = "main";
+	std::string Profile;                    // "vs_5_1", "ps_6_0", ...
+	std::vector<ShaderDefine> Defines;
+	UINT Flags = 0;                         // D3DCOMPILE_* flags.
+};
+
+// Turns HLSL into bytecode in two steps, so that callers can key a cache on
+// the preprocessed text and skip the expensive second step on a hit.
+//
+// Implementations must allow both methods to run on several threads at once.
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() = default;
+
+	// Identifies the compiler build. Part of every cache key, so a compiler
+	// upgrade misses the cache instead of returning stale bytecode.
+	virtual uint64_t GetVersionHash() const = 0;
+
+	// Expand includes and macros. includes receives every file opened, in the
+	// order they were first opened, including the source itself.
+	virtual bool Preprocess(const ShaderDesc& desc, std::string& output,
+		std::vector<std::wstring>& includes, std::string& errors) = 0;
+
+	// Compile the output of Preprocess for desc.
+	virtual bool Compile(const ShaderDesc& desc, const std::string& preprocessed,
+		std::vector<uint8_t>& bytecode, std::string& errors) = 0;
+};
+
+// D3DPreprocess and D3DCompile from d3dcompiler_47.dll. Includes are
+// resolved relative to the including file, then to the source's directory.
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	uint64_t GetVersionHash() const override;
+	bool Preprocess(const ShaderDesc& desc, std::string& output,
+		std::vector<std::wstring>& includes, std::string& errors) override;
+	bool Compile(const ShaderDesc& desc, const std::string& preprocessed,
+		std::vector<uint8_t>& bytecode, std::string& errors) override;
+};
+
+// Stands in for a compiler so the cache and everything built on it can run
+// headless. Preprocessing follows #include "file" lines relative to the
+// including file and prepends the defines; other directives are left alone.
+// Compiling takes a fixed time and returns a blob derived from the text,
+// leaving out defines the text never mentions, as a real compiler's output
+// does not depend on them. A source containing #error fails to compile.
+class SimulatedShaderCompiler : public ShaderCompiler
+{
+public:
+	explicit SimulatedShaderCompiler(std::chrono::microseconds compileTime);
+
+	uint64_t GetVersionHash() const override;
+	bool Preprocess(const ShaderDesc& desc, std::string& output,
+		std::vector<std::wstring>& includes, std::string& errors) override;
+	bool Compile(const ShaderDesc& desc, const std::string& preprocessed,
+		std::vector<uint8_t>& bytecode, std::string& errors) override;
+
+private:
+	std::chrono::microseconds m_CompileTime;
+};
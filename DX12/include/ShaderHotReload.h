@@ -0,0 +1,167 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "FileWatcher.h"
+#include "ShaderPermutations.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class Fence;
+
+// Rebuilds pipelines when the shader files they were compiled from change.
+//
+// A registered pipeline names the shader permutations it is built from and
+// how to create it. The include closure of every permutation is tracked and
+// its directories watched. When a file changes, a background thread
+// recompiles the permutations that include it, and only those, through their
+// ShaderCache, then recreates the pipelines whose bytecode changed. Update
+// swaps the new pipelines in between frames, a whole batch at once, so a
+// frame never mixes old and new shaders:
+//
+//     ShaderHotReload reload(std::make_unique<SystemFileWatcher>(), fence);
+//     ShaderHotReload::Handle forward = reload.Register({ { &forwardVs, 0 }, { &forwardPs, alphaTest } },
+//         [&] { return CreateForwardPipeline(forwardVs.Get(0), forwardPs.Get(alphaTest)); });
+//     ...
+//     reload.Update();
+//     commandList->SetPipelineState(reload.Get(forward));
+//
+// Saving a file raises several events, so changes are collected until none
+// has arrived for Options::SettleTime. A shader that fails to compile keeps
+// its last good bytecode and pipeline until it is fixed; GetErrors says what
+// is wrong. Pipelines replaced by Update are released once the fence passes
+// the value last signaled before the swap.
+//
+// Recompiles go through ShaderCache::GetOrCompile at any time, so do not
+// call ShaderCache::Save while reloading is enabled. Creation functions run
+// on the reload thread as well as in Register, so they must be thread-safe.
+// Register, Get and Update are for the render thread.
+class ShaderHotReload
+{
+public:
+	using Handle = UINT;
+	using CreatePipeline = std::function<Microsoft::WRL::ComPtr<ID3D12PipelineState>()>;
+
+	struct Shader
+	{
+		ShaderPermutations* Permutations;
+		ShaderPermutations::Key Key;
+
+		bool operator<(const Shader& other) const
+		{
+			return Permutations != other.Permutations ? Permutations < other.Permutations : Key < other.Key;
+		}
+	};
+
+	struct Options
+	{
+		std::chrono::milliseconds SettleTime{ 100 };
+		// How often the watcher is polled.
+		std::chrono::milliseconds PollInterval{ 20 };
+	};
+
+	struct Stats
+	{
+		UINT64 Changes = 0;             // Batches of file changes handled.
+		UINT64 Recompiled = 0;          // Permutations compiled again.
+		UINT64 Unchanged = 0;           // Of those, compiled to the same bytecode.
+		UINT64 Failed = 0;              // Of those, failed to compile.
+		UINT64 PipelinesCreated = 0;    // Recreated on the reload thread.
+		UINT64 PipelineFailures = 0;    // Creation returned null.
+		UINT64 PipelinesSwapped = 0;    // Swapped in by Update.
+	};
+
+	ShaderHotReload(std::unique_ptr<FileWatcher> watcher, std::shared_ptr<Fence> fence, const Options& options);
+	ShaderHotReload(std::unique_ptr<FileWatcher> watcher, std::shared_ptr<Fence> fence)
+		: ShaderHotReload(std::move(watcher), std::move(fence), Options())
+	{}
+	// Stops the reload thread and releases every pipeline, so wait for the
+	// GPU first.
+	~ShaderHotReload();
+
+	ShaderHotReload(const ShaderHotReload&) = delete;
+	ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+	// Compiles the shaders if needed and creates the pipeline. The pipeline
+	// is null if either failed, until a change fixes it.
+	Handle Register(const std::vector<Shader>& shaders, CreatePipeline create);
+
+	// The current pipeline. Stays the same until the next Update.
+	ID3D12PipelineState* Get(Handle handle) const { return m_Pipelines[handle]->Current.Get(); }
+
+	// Swap in the pipelines recreated since the last call and release the
+	// replaced ones the GPU is done with. Call between frames, after the last
+	// frame's work has been signaled on the fence. Returns the number swapped.
+	UINT Update();
+
+	// Block until every change reported to the watcher so far has been
+	// handled, without waiting for the settle time. For tests and tools.
+	void WaitIdle();
+
+	// Compiler output of the tracked shaders whose last compile failed.
+	std::string GetErrors() const;
+
+	Stats GetStats() const;
+
+private:
+	struct Pipeline
+	{
+		// Constant once registered.
+		std::vector<Shader> Shaders;
+		CreatePipeline Create;
+		// Render thread only.
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> Current;
+	};
+
+	struct TrackedShader
+	{
+		std::vector<std::wstring> Files;  // Normalized.
+		std::vector<Handle> Pipelines;
+		bool Failed = false;
+	};
+
+	struct RetiredPipeline
+	{
+		UINT64 FenceValue;
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> Pipeline;
+	};
+
+	// Call with m_Mutex held.
+	void Track(const Shader& shader, TrackedShader& tracked, const std::vector<std::wstring>& includes);
+	void ReloadThread();
+	void Reload(std::vector<std::wstring>& changed);
+
+	std::unique_ptr<FileWatcher> m_Watcher;
+	std::shared_ptr<Fence> m_Fence;
+	Options m_Options;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_WakeUp;
+	std::condition_variable m_Idle;
+	std::vector<std::unique_ptr<Pipeline>> m_Pipelines;
+	std::map<Shader, TrackedShader> m_Shaders;
+	// Every tracked file and the shaders that include it.
+	std::unordered_map<std::wstring, std::vector<Shader>> m_Files;
+	// Recreated pipelines waiting for Update, in batches.
+	std::vector<std::pair<Handle, Microsoft::WRL::ComPtr<ID3D12PipelineState>>> m_Recreated;
+	UINT64 m_FlushRequested;
+	UINT64 m_FlushCompleted;
+	bool m_Stopping;
+	Stats m_Stats;
+
+	// Render thread only.
+	std::deque<RetiredPipeline> m_Retired;
+
+	std::thread m_Thread;
+};
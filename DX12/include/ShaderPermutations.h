@@ -0,0 +1,141 @@
+#pragma once
+
+#include "d3dx12.h"
+#include "ShaderCompiler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+class ShaderCache;
+
+// The variants of one shader, selected by feature switches.
+//
+// Each feature is a bit of a 64-bit key. A permutation defines every
+// feature, to 1 if its bit is set and to 0 otherwise, so the shader tests
+// them with #if rather than #ifdef. Permutations compile through the
+// ShaderCache the first time they are requested, or ahead of time from a
+// manifest of the keys a previous run used:
+//
+//     ShaderPermutations permutations(cache, desc, { "ALPHA_TEST", "SKINNED", "SHADOWS" });
+//     std::vector<ShaderPermutations::Key> keys;
+//     if (permutations.LoadManifest(L"forward_ps.manifest", keys))
+//     {
+//         permutations.Prewarm(keys, jobs);
+//     }
+//     ...
+//     stream.PS = permutations.Get(permutations.MakeKey({ "ALPHA_TEST" }));
+//     ComPtr<ID3D12PipelineState> pso = pipelineCache.GetOrCreate(stream);
+//     ...
+//     permutations.SaveManifest(L"forward_ps.manifest");
+//
+// Features often do not change the output: a switch for a vertex input the
+// pixel shader never reads compiles to the same pixel shader. Identical
+// bytecode is stored once and every key that produced it gets the same
+// pointer, and since pipeline hashes follow the bytecode, the
+// PipelineLibraryCache then creates one pipeline for all of them.
+//
+// Bytecode stays valid for the lifetime of the permutations, independent of
+// ShaderCache::Save, and is not freed when Reload replaces it. Get, Reload,
+// Prewarm and GetStats are thread-safe.
+class ShaderPermutations
+{
+public:
+	using Key = uint64_t;
+	static const uint32_t MaxFeatures = 64;
+
+	ShaderPermutations(ShaderCache& cache, const ShaderDesc& desc, std::vector<std::string> features);
+
+	ShaderPermutations(const ShaderPermutations&) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+	// The bit of a feature. Asserts that it is declared.
+	Key GetFeature(const char* name) const;
+	Key MakeKey(std::initializer_list<const char*> features) const;
+
+	// The desc a permutation compiles with.
+	ShaderDesc GetDesc(Key key) const;
+
+	// Compiles the permutation if it has not been compiled yet. Empty if it
+	// failed to compile; GetErrors says why. The key is added to the manifest.
+	CD3DX12_SHADER_BYTECODE Get(Key key);
+	std::string GetErrors(Key key) const;
+
+	// The files the permutation was compiled from, as reported by the
+	// compiler: the source, then every include. Empty until it is compiled.
+	std::vector<std::wstring> GetIncludes(Key key) const;
+
+	enum class ReloadResult
+	{
+		Unchanged,  // Compiled to the same bytecode as before.
+		Changed,    // Get returns the new bytecode from now on.
+		Failed,     // Get keeps returning the old bytecode; GetErrors says why.
+	};
+
+	// Compile the permutation again after its files changed. The cache key
+	// covers the preprocessed source, so only real edits recompile.
+	ReloadResult Reload(Key key);
+
+	// Compile the permutations not compiled yet in parallel. Call from the
+	// thread that owns jobs. Does not add keys to the manifest.
+	void Prewarm(const std::vector<Key>& keys, JobSystem& jobs);
+
+	// Keys requested through Get this run, in the order first requested.
+	std::vector<Key> GetUsedKeys() const;
+
+	// One permutation per line, as the names of its features, so that adding
+	// or reordering features keeps old manifests valid. Throws FileError if the
+	// file cannot be written.
+	void SaveManifest(const std::wstring& path) const;
+
+	// Lines naming a feature that no longer exists are skipped. Returns false
+	// if the file cannot be read.
+	bool LoadManifest(const std::wstring& path, std::vector<Key>& keys) const;
+
+	struct Stats
+	{
+		UINT64 Permutations = 0;        // Compiled, successfully or not.
+		UINT64 Failures = 0;
+		UINT64 UniqueBytecode = 0;      // Distinct outputs stored.
+		UINT64 DeduplicatedBytes = 0;   // Not stored because an identical output was.
+		UINT64 Reloads = 0;
+	};
+	Stats GetStats() const;
+
+private:
+	struct Permutation
+	{
+		std::once_flag Compiled;
+		std::atomic<const std::vector<uint8_t>*> Bytecode{ nullptr };
+		// Guarded by m_PermutationsMutex.
+		std::string Errors;
+		std::vector<std::wstring> Includes;
+	};
+
+	Permutation& GetPermutation(Key key, bool used);
+	ReloadResult Compile(Key key, Permutation& permutation, bool reload);
+	// Call with m_PermutationsMutex held. hash is of the bytecode. Matching
+	// current, the permutation's own bytecode, saves nothing.
+	const std::vector<uint8_t>* Intern(const D3D12_SHADER_BYTECODE& bytecode, uint64_t hash, const std::vector<uint8_t>* current);
+
+	ShaderCache& m_Cache;
+	ShaderDesc m_Desc;
+	std::vector<std::string> m_Features;
+
+	mutable std::mutex m_PermutationsMutex;
+	std::unordered_map<Key, std::unique_ptr<Permutation>> m_Permutations;
+	std::vector<Key> m_Used;
+	UINT64 m_Compiled;
+	UINT64 m_Failures;
+	UINT64 m_Reloads;
+
+	// Distinct bytecode by content hash. Guarded by m_PermutationsMutex.
+	std::unordered_multimap<uint64_t, std::unique_ptr<std::vector<uint8_t>>> m_Bytecode;
+	UINT64 m_DeduplicatedBytes;
+};
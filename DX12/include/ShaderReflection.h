@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Shader reflection read straight from a compiled shader's container, without
+// d3dcompiler or dxcompiler, so it runs wherever shaders are built.
+//
+// Both containers start with a "DXBC" header and a table of parts. Their
+// contents differ:
+//
+//   DXBC (fxc, shader model 5.1 and earlier)
+//     RDEF            bindings with names, constant buffer layouts
+//     ISGN/OSGN/...   input, output and patch constant signatures
+//     SHDR/SHEX       program; its declarations give the thread group size
+//
+//   DXIL (dxc, shader model 6)
+//     PSV0            bindings without names, thread group size
+//     ISG1/OSG1/PSG1  signatures
+//     DXIL            program header, for the stage and version
+//
+// dxc keeps names and constant buffer layouts in LLVM metadata, which is not
+// parsed here, so a DXIL shader's bindings have empty names and it has no
+// ConstantBuffers. Bindings alone are enough to build a root signature.
+//
+// Enumerations use the values of their d3dcommon.h counterparts, so they
+// can be cast to them on Windows.
+
+// D3D12_SHADER_VERSION_TYPE.
+enum class ShaderProgramType : uint32_t
+{
+	Pixel = 0,
+	Vertex = 1,
+	Geometry = 2,
+	Hull = 3,
+	Domain = 4,
+	Compute = 5,
+	Library = 6,
+	Mesh = 13,
+	Amplification = 14,
+	Unknown = 0xFFFF,
+};
+
+// D3D_SHADER_INPUT_TYPE.
+enum class ShaderInputType : uint32_t
+{
+	ConstantBuffer = 0,
+	TextureBuffer,
+	Texture,
+	Sampler,
+	RWTyped,
+	Structured,
+	RWStructured,
+	ByteAddress,
+	RWByteAddress,
+	AppendStructured,
+	ConsumeStructured,
+	RWStructuredWithCounter,
+	AccelerationStructure,
+	FeedbackTexture,
+};
+
+// The kind of descriptor a binding takes, in the order of
+// D3D12_DESCRIPTOR_RANGE_TYPE.
+enum class ShaderBindingClass : uint32_t
+{
+	ShaderResource = 0,
+	UnorderedAccess,
+	ConstantBuffer,
+	Sampler,
+};
+
+ShaderBindingClass GetShaderBindingClass(ShaderInputType type);
+const char* GetShaderProgramTypeName(ShaderProgramType type);
+const char* GetShaderInputTypeName(ShaderInputType type);
+
+struct ShaderResourceBinding
+{
+	std::string Name;                       // Empty for DXIL.
+	ShaderInputType Type = ShaderInputType::ConstantBuffer;
+	uint32_t Space = 0;
+	uint32_t BindPoint = 0;
+	uint32_t BindCount = 1;                 // 0 for an unbounded array.
+	uint32_t Dimension = 0;                 // D3D_SRV_DIMENSION.
+	uint32_t ReturnType = 0;                // D3D_RESOURCE_RETURN_TYPE. RDEF only.
+	uint32_t NumSamples = 0;                // RDEF only.
+	uint32_t Flags = 0;                     // D3D_SHADER_INPUT_FLAGS. RDEF only.
+};
+
+struct ShaderVariableType
+{
+	uint32_t Class = 0;                     // D3D_SHADER_VARIABLE_CLASS.
+	uint32_t Type = 0;                      // D3D_SHADER_VARIABLE_TYPE.
+	uint32_t Rows = 0;
+	uint32_t Columns = 0;
+	uint32_t Elements = 0;                  // 0 if not an array.
+	std::string Name;                       // "float4x4", a struct's name, ...
+	struct Member;
+	std::vector<Member> Members;
+};
+
+struct ShaderVariableType::Member
+{
+	std::string Name;
+	uint32_t Offset = 0;                    // In bytes, from the start of the struct.
+	ShaderVariableType Type;
+};
+
+struct ShaderVariable
+{
+	std::string Name;
+	uint32_t Offset = 0;                    // In bytes, from the start of the buffer.
+	uint32_t Size = 0;
+	bool Used = false;                      // Read by the program.
+	ShaderVariableType Type;
+};
+
+struct ShaderConstantBuffer
+{
+	std::string Name;
+	uint32_t Type = 0;                      // D3D_CBUFFER_TYPE.
+	uint32_t Size = 0;                      // In bytes, a multiple of 16.
+	std::vector<ShaderVariable> Variables;
+};
+
+struct ShaderSignatureElement
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex = 0;
+	uint32_t Register = 0;
+	uint32_t SystemValue = 0;               // D3D_NAME.
+	uint32_t ComponentType = 0;             // D3D_REGISTER_COMPONENT_TYPE.
+	uint8_t Mask = 0;
+	// Components read by an input; components never written by an output.
+	uint8_t ReadWriteMask = 0;
+	uint32_t Stream = 0;
+	uint32_t MinPrecision = 0;              // D3D_MIN_PRECISION.
+};
+
+struct ShaderReflection
+{
+	ShaderProgramType ProgramType = ShaderProgramType::Unknown;
+	uint32_t MajorVersion = 0;
+	uint32_t MinorVersion = 0;
+	bool IsDxil = false;
+
+	std::vector<ShaderSignatureElement> Inputs;
+	std::vector<ShaderSignatureElement> Outputs;
+	std::vector<ShaderSignatureElement> PatchConstants;
+
+	std::vector<ShaderResourceBinding> Bindings;
+	std::vector<ShaderConstantBuffer> ConstantBuffers;
+
+	// Compute, mesh and amplification shaders. Zero for other stages, and for
+	// DXIL shaders whose PSV0 predates thread group sizes.
+	uint32_t ThreadGroupSize[3] = {};
+
+	// The layout of a constant buffer binding, or null if unknown.
+	const ShaderConstantBuffer* FindConstantBuffer(const ShaderResourceBinding& binding) const;
+};
+
+// Parse a compiled shader. Every read is bounds-checked, so a truncated or
+// corrupt container fails with a message in error instead of crashing. The
+// container's checksum is not verified.
+bool ReflectShader(const void* bytecode, size_t size, ShaderReflection& reflection, std::string& error);
+
+void WriteShaderReflection(std::ostream& out, const ShaderReflection& reflection);
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+#include "d3dx12.h"
+
+#include <atomic>
+
+// A wrapper around ID3D12GraphicsCommandList that keeps a shadow copy of the
+// bound state and only forwards calls that actually change it.
+//
+// State set through Get() bypasses the shadow. Call InvalidateState()
+// afterwards so the next call through the wrapper is forwarded.
+
+enum class ShadowedCall
+{
+	GraphicsRootSignature,
+	ComputeRootSignature,
+	PipelineState,
+	PrimitiveTopology,
+	VertexBuffers,
+	IndexBuffer,
+	Viewports,
+	ScissorRects,
+	RenderTargets,
+	BlendFactor,
+	StencilRef,
+	DescriptorHeaps,
+	GraphicsRootDescriptorTable,
+	ComputeRootDescriptorTable,
+	GraphicsRootView,
+	ComputeRootView,
+	RenderPass,
+	Count
+};
+
+const char* GetShadowedCallName(ShadowedCall call);
+
+struct ShadowedCommandListStats
+{
+	UINT64 Forwarded[static_cast<size_t>(ShadowedCall::Count)] = {};
+	UINT64 Elided[static_cast<size_t>(ShadowedCall::Count)] = {};
+
+	UINT64 GetTotalForwarded() const;
+	UINT64 GetTotalElided() const;
+
+	ShadowedCommandListStats& operator+=(const ShadowedCommandListStats& other);
+};
+
+class ShadowedCommandList
+{
+public:
+	static const UINT MaxRootParameters = 64;
+
+	explicit ShadowedCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList);
+
+	// The underlying command list. Any pending render pass end is flushed
+	// first so calls made directly land in the right place.
+	ID3D12GraphicsCommandList* Get();
+
+	void Reset(ID3D12CommandAllocator* allocator, ID3D12PipelineState* initialState);
+	void Close();
+
+	// Forget all shadowed state so the next call of every kind is forwarded.
+	void InvalidateState();
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature);
+	void SetComputeRootSignature(ID3D12RootSignature* rootSignature);
+	void SetPipelineState(ID3D12PipelineState* pipelineState);
+	void SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps);
+
+	void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+	void SetComputeRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+	void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetComputeRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetComputeRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetGraphicsRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+	void SetComputeRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
+
+	// Root constants are cheap to set and rarely repeated, so they are always forwarded.
+	void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues);
+	void SetComputeRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues);
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology);
+	void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views);
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+
+	void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports);
+	void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects);
+
+	void OMSetRenderTargets(
+		UINT numRenderTargetDescriptors,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetDescriptors,
+		BOOL rtsSingleHandleToDescriptorRange,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilDescriptor);
+	void OMSetBlendFactor(const FLOAT blendFactor[4]);
+	void OMSetStencilRef(UINT stencilRef);
+
+	// EndRenderPass is deferred. If the next call begins an identical pass
+	// that preserves all of its attachments, both calls are dropped.
+	void BeginRenderPass(
+		UINT numRenderTargets,
+		const D3D12_RENDER_PASS_RENDER_TARGET_DESC* renderTargets,
+		const D3D12_RENDER_PASS_DEPTH_STENCIL_DESC* depthStencil,
+		D3D12_RENDER_PASS_FLAGS flags);
+	void EndRenderPass();
+
+	void DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+	void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ);
+
+	// The arguments can set root arguments and vertex and index buffers, so
+	// those are forgotten afterwards.
+	void ExecuteIndirect(
+		ID3D12CommandSignature* commandSignature,
+		UINT maxCommandCount,
+		ID3D12Resource* argumentBuffer,
+		UINT64 argumentBufferOffset,
+		ID3D12Resource* countBuffer,
+		UINT64 countBufferOffset);
+
+	void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers);
+	void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT colorRGBA[4], UINT numRects, const D3D12_RECT* rects);
+	void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS clearFlags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects);
+
+	// State set inside a bundle carries over into this list, so the shadow is reset.
+	void ExecuteBundle(ID3D12GraphicsCommandList* bundle);
+
+	const ShadowedCommandListStats& GetStats() const { return m_Stats; }
+
+	// Totals of every wrapper closed since the last call. Call once per frame.
+	static ShadowedCommandListStats EndFrame();
+
+private:
+	struct RootArguments
+	{
+		ID3D12RootSignature* RootSignature;
+		UINT64 Values[MaxRootParameters];
+		UINT64 ValidMask;
+
+		void Invalidate();
+		bool IsSet(UINT index, UINT64 value) const;
+		void Set(UINT index, UINT64 value);
+	};
+
+	bool Elide(ShadowedCall call, bool unchanged);
+	bool SetRootArgument(RootArguments& arguments, ShadowedCall call, UINT index, UINT64 value);
+	void FlushPendingEndRenderPass();
+
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> m_CommandList4;
+
+	ShadowedCommandListStats m_Stats;
+
+	ID3D12PipelineState* m_PipelineState;
+	D3D12_PRIMITIVE_TOPOLOGY m_PrimitiveTopology;
+	bool m_PrimitiveTopologyValid;
+
+	RootArguments m_Graphics;
+	RootArguments m_Compute;
+
+	ID3D12DescriptorHeap* m_DescriptorHeaps[2];
+	UINT m_NumDescriptorHeaps;
+	bool m_DescriptorHeapsValid;
+
+	D3D12_VERTEX_BUFFER_VIEW m_VertexBuffers[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	UINT m_VertexBufferValidMask;
+	D3D12_INDEX_BUFFER_VIEW m_IndexBuffer;
+	bool m_IndexBufferValid;
+
+	D3D12_VIEWPORT m_Viewports[D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+	UINT m_NumViewports;
+	D3D12_RECT m_ScissorRects[D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+	UINT m_NumScissorRects;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE m_RenderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	UINT m_NumRenderTargets;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_DepthStencil;
+	bool m_RenderTargetsValid;
+
+	FLOAT m_BlendFactor[4];
+	bool m_BlendFactorValid;
+	UINT m_StencilRef;
+	bool m_StencilRefValid;
+
+	// The most recent render pass, kept to detect a redundant end/begin pair.
+	D3D12_RENDER_PASS_RENDER_TARGET_DESC m_RenderPassTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	UINT m_NumRenderPassTargets;
+	D3D12_RENDER_PASS_DEPTH_STENCIL_DESC m_RenderPassDepthStencil;
+	bool m_RenderPassHasDepthStencil;
+	D3D12_RENDER_PASS_FLAGS m_RenderPassFlags;
+	bool m_EndRenderPassPending;
+
+	static std::atomic<UINT64> s_FrameForwarded[static_cast<size_t>(ShadowedCall::Count)];
+	static std::atomic<UINT64> s_FrameElided[static_cast<size_t>(ShadowedCall::Count)];
+};
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "Hash.h"
+
+#include <cstddef>
+
+// constexpr counterparts of the d3dx12 description helpers.
+//
+// CD3DX12_RASTERIZER_DESC, CD3DX12_BLEND_DESC and friends fill their fields
+// in constructor bodies, so a table of them is initialized by code at startup.
+// The functions here return plain D3D12 structs from constant expressions, so
+// fixed pipeline and root signature tables can live in read-only data:
+//
+//     constexpr D3D12_DESCRIPTOR_RANGE1 MaterialRanges[] =
+//     {
+//         StaticDescriptorRange1(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 0),
+//     };
+//     constexpr StaticRootParameter1 ForwardParameters[] =
+//     {
+//         StaticRootParameter1::AsConstants(16, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX),
+//         StaticRootParameter1::AsDescriptorTable(MaterialRanges, D3D12_SHADER_VISIBILITY_PIXEL),
+//     };
+//     constexpr StaticRootSignatureDesc ForwardRootSignature(ForwardParameters);
+//     constexpr UINT64 ForwardRootSignatureHash = HashStaticDesc(ForwardRootSignature);
+//
+//     D3DX12SerializeVersionedRootSignature(&ForwardRootSignature.Get(), ...);
+//
+// Defaults match the CD3DX12_DEFAULT constructors.
+
+constexpr D3D12_RASTERIZER_DESC StaticRasterizerDesc(
+	D3D12_FILL_MODE fillMode = D3D12_FILL_MODE_SOLID,
+	D3D12_CULL_MODE cullMode = D3D12_CULL_MODE_BACK,
+	BOOL frontCounterClockwise = FALSE,
+	INT depthBias = D3D12_DEFAULT_DEPTH_BIAS,
+	FLOAT depthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP,
+	FLOAT slopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS,
+	BOOL depthClipEnable = TRUE,
+	BOOL multisampleEnable = FALSE,
+	BOOL antialiasedLineEnable = FALSE,
+	UINT forcedSampleCount = 0,
+	D3D12_CONSERVATIVE_RASTERIZATION_MODE conservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF)
+{
+	return {
+		fillMode, cullMode, frontCounterClockwise,
+		depthBias, depthBiasClamp, slopeScaledDepthBias,
+		depthClipEnable, multisampleEnable, antialiasedLineEnable,
+		forcedSampleCount, conservativeRaster };
+}
+
+constexpr D3D12_RENDER_TARGET_BLEND_DESC StaticRenderTargetBlendDesc(
+	BOOL blendEnable = FALSE,
+	D3D12_BLEND srcBlend = D3D12_BLEND_ONE,
+	D3D12_BLEND destBlend = D3D12_BLEND_ZERO,
+	D3D12_BLEND_OP blendOp = D3D12_BLEND_OP_ADD,
+	D3D12_BLEND srcBlendAlpha = D3D12_BLEND_ONE,
+	D3D12_BLEND destBlendAlpha = D3D12_BLEND_ZERO,
+	D3D12_BLEND_OP blendOpAlpha = D3D12_BLEND_OP_ADD,
+	UINT8 renderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL)
+{
+	return {
+		blendEnable, FALSE,
+		srcBlend, destBlend, blendOp,
+		srcBlendAlpha, destBlendAlpha, blendOpAlpha,
+		D3D12_LOGIC_OP_NOOP,
+		renderTargetWriteMask };
+}
+
+// Premultiplied alpha: src + dest * (1 - src.a).
+constexpr D3D12_RENDER_TARGET_BLEND_DESC StaticAlphaBlendDesc()
+{
+	return StaticRenderTargetBlendDesc(TRUE,
+		D3D12_BLEND_ONE, D3D12_BLEND_INV_SRC_ALPHA, D3D12_BLEND_OP_ADD,
+		D3D12_BLEND_ONE, D3D12_BLEND_INV_SRC_ALPHA, D3D12_BLEND_OP_ADD);
+}
+
+// Every render target uses the same blend state.
+constexpr D3D12_BLEND_DESC StaticBlendDesc(
+	D3D12_RENDER_TARGET_BLEND_DESC renderTarget = StaticRenderTargetBlendDesc(),
+	BOOL alphaToCoverageEnable = FALSE)
+{
+	static_assert(D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT == 8, "StaticBlendDesc lists every render target.");
+	return {
+		alphaToCoverageEnable, FALSE,
+		{ renderTarget, renderTarget, renderTarget, renderTarget,
+		  renderTarget, renderTarget, renderTarget, renderTarget } };
+}
+
+constexpr D3D12_DEPTH_STENCILOP_DESC StaticStencilOpDesc(
+	D3D12_STENCIL_OP stencilFailOp = D3D12_STENCIL_OP_KEEP,
+	D3D12_STENCIL_OP stencilDepthFailOp = D3D12_STENCIL_OP_KEEP,
+	D3D12_STENCIL_OP stencilPassOp = D3D12_STENCIL_OP_KEEP,
+	D3D12_COMPARISON_FUNC stencilFunc = D3D12_COMPARISON_FUNC_ALWAYS)
+{
+	return { stencilFailOp, stencilDepthFailOp, stencilPassOp, stencilFunc };
+}
+
+constexpr D3D12_DEPTH_STENCIL_DESC StaticDepthStencilDesc(
+	BOOL depthEnable = TRUE,
+	D3D12_DEPTH_WRITE_MASK depthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL,
+	D3D12_COMPARISON_FUNC depthFunc = D3D12_COMPARISON_FUNC_LESS,
+	BOOL stencilEnable = FALSE,
+	UINT8 stencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK,
+	UINT8 stencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK,
+	D3D12_DEPTH_STENCILOP_DESC frontFace = StaticStencilOpDesc(),
+	D3D12_DEPTH_STENCILOP_DESC backFace = StaticStencilOpDesc())
+{
+	return {
+		depthEnable, depthWriteMask, depthFunc,
+		stencilEnable, stencilReadMask, stencilWriteMask,
+		frontFace, backFace };
+}
+
+constexpr D3D12_DEPTH_STENCIL_DESC1 StaticDepthStencilDesc1(
+	D3D12_DEPTH_STENCIL_DESC desc = StaticDepthStencilDesc(),
+	BOOL depthBoundsTestEnable = FALSE)
+{
+	return {
+		desc.DepthEnable, desc.DepthWriteMask, desc.DepthFunc,
+		desc.StencilEnable, desc.StencilReadMask, desc.StencilWriteMask,
+		desc.FrontFace, desc.BackFace,
+		depthBoundsTestEnable };
+}
+
+constexpr D3D12_STATIC_SAMPLER_DESC StaticSamplerDesc(
+	UINT shaderRegister,
+	D3D12_FILTER filter = D3D12_FILTER_ANISOTROPIC,
+	D3D12_TEXTURE_ADDRESS_MODE addressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+	D3D12_TEXTURE_ADDRESS_MODE addressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+	D3D12_TEXTURE_ADDRESS_MODE addressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+	FLOAT mipLODBias = 0,
+	UINT maxAnisotropy = 16,
+	D3D12_COMPARISON_FUNC comparisonFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL,
+	D3D12_STATIC_BORDER_COLOR borderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE,
+	FLOAT minLOD = 0.f,
+	FLOAT maxLOD = D3D12_FLOAT32_MAX,
+	D3D12_SHADER_VISIBILITY shaderVisibility = D3D12_SHADER_VISIBILITY_ALL,
+	UINT registerSpace = 0)
+{
+	return {
+		filter, addressU, addressV, addressW,
+		mipLODBias, maxAnisotropy, comparisonFunc, borderColor,
+		minLOD, maxLOD,
+		shaderRegister, registerSpace, shaderVisibility };
+}
+
+constexpr D3D12_DESCRIPTOR_RANGE1 StaticDescriptorRange1(
+	D3D12_DESCRIPTOR_RANGE_TYPE rangeType,
+	UINT numDescriptors,
+	UINT baseShaderRegister,
+	UINT registerSpace = 0,
+	D3D12_DESCRIPTOR_RANGE_FLAGS flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE,
+	UINT offsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND)
+{
+	return { rangeType, numDescriptors, baseShaderRegister, registerSpace, flags, offsetInDescriptorsFromTableStart };
+}
+
+// Same layout as D3D12_ROOT_PARAMETER1. Aggregate initialization can only set
+// the first member of the union, so this type adds constexpr constructors for
+// the other two.
+struct StaticRootParameter1
+{
+	D3D12_ROOT_PARAMETER_TYPE ParameterType;
+	union
+	{
+		D3D12_ROOT_DESCRIPTOR_TABLE1 DescriptorTable;
+		D3D12_ROOT_CONSTANTS Constants;
+		D3D12_ROOT_DESCRIPTOR1 Descriptor;
+	};
+	D3D12_SHADER_VISIBILITY ShaderVisibility;
+
+	template <size_t NumRanges>
+	static constexpr StaticRootParameter1 AsDescriptorTable(
+		const D3D12_DESCRIPTOR_RANGE1 (&ranges)[NumRanges],
+		D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL)
+	{
+		return StaticRootParameter1(D3D12_ROOT_DESCRIPTOR_TABLE1{ static_cast<UINT>(NumRanges), ranges }, visibility);
+	}
+
+	static constexpr StaticRootParameter1 AsConstants(
+		UINT num32BitValues,
+		UINT shaderRegister,
+		UINT registerSpace = 0,
+		D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL)
+	{
+		return StaticRootParameter1(D3D12_ROOT_CONSTANTS{ shaderRegister, registerSpace, num32BitValues }, visibility);
+	}
+
+	static constexpr StaticRootParameter1 AsConstantBufferView(
+		UINT shaderRegister,
+		UINT registerSpace = 0,
+		D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+		D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL)
+	{
+		return StaticRootParameter1(D3D12_ROOT_PARAMETER_TYPE_CBV, D3D12_ROOT_DESCRIPTOR1{ shaderRegister, registerSpace, flags }, visibility);
+	}
+
+	static constexpr StaticRootParameter1 AsShaderResourceView(
+		UINT shaderRegister,
+		UINT registerSpace = 0,
+		D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+		D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL)
+	{
+		return StaticRootParameter1(D3D12_ROOT_PARAMETER_TYPE_SRV, D3D12_ROOT_DESCRIPTOR1{ shaderRegister, registerSpace, flags }, visibility);
+	}
+
+	static constexpr StaticRootParameter1 AsUnorderedAccessView(
+		UINT shaderRegister,
+		UINT registerSpace = 0,
+		D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+		D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL)
+	{
+		return StaticRootParameter1(D3D12_ROOT_PARAMETER_TYPE_UAV, D3D12_ROOT_DESCRIPTOR1{ shaderRegister, registerSpace, flags }, visibility);
+	}
+
+	const D3D12_ROOT_PARAMETER1& Get() const
+	{
+		return *reinterpret_cast<const D3D12_ROOT_PARAMETER1*>(this);
+	}
+
+private:
+	constexpr StaticRootParameter1(D3D12_ROOT_DESCRIPTOR_TABLE1 table, D3D12_SHADER_VISIBILITY visibility)
+		: ParameterType(D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE), DescriptorTable(table), ShaderVisibility(visibility)
+	{}
+
+	constexpr StaticRootParameter1(D3D12_ROOT_CONSTANTS constants, D3D12_SHADER_VISIBILITY visibility)
+		: ParameterType(D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS), Constants(constants), ShaderVisibility(visibility)
+	{}
+
+	constexpr StaticRootParameter1(D3D12_ROOT_PARAMETER_TYPE type, D3D12_ROOT_DESCRIPTOR1 descriptor, D3D12_SHADER_VISIBILITY visibility)
+		: ParameterType(type), Descriptor(descriptor), ShaderVisibility(visibility)
+	{}
+};
+
+static_assert(sizeof(StaticRootParameter1) == sizeof(D3D12_ROOT_PARAMETER1), "StaticRootParameter1 must match D3D12_ROOT_PARAMETER1.");
+static_assert(offsetof(StaticRootParameter1, DescriptorTable) == offsetof(D3D12_ROOT_PARAMETER1, DescriptorTable), "StaticRootParameter1 must match D3D12_ROOT_PARAMETER1.");
+static_assert(offsetof(StaticRootParameter1, ShaderVisibility) == offsetof(D3D12_ROOT_PARAMETER1, ShaderVisibility), "StaticRootParameter1 must match D3D12_ROOT_PARAMETER1.");
+
+// Same layout as D3D12_ROOT_SIGNATURE_DESC1, pointing at StaticRootParameter1s.
+struct StaticRootSignatureDesc1
+{
+	UINT NumParameters;
+	const StaticRootParameter1* pParameters;
+	UINT NumStaticSamplers;
+	const D3D12_STATIC_SAMPLER_DESC* pStaticSamplers;
+	D3D12_ROOT_SIGNATURE_FLAGS Flags;
+};
+
+// Same layout as a D3D12_VERSIONED_ROOT_SIGNATURE_DESC holding a version 1.1
+// description, which again cannot be aggregate initialized past the union.
+struct StaticRootSignatureDesc
+{
+	D3D_ROOT_SIGNATURE_VERSION Version;
+	StaticRootSignatureDesc1 Desc_1_1;
+
+	constexpr StaticRootSignatureDesc(
+		UINT numParameters,
+		const StaticRootParameter1* parameters,
+		UINT numStaticSamplers = 0,
+		const D3D12_STATIC_SAMPLER_DESC* staticSamplers = nullptr,
+		D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_NONE)
+		: Version(D3D_ROOT_SIGNATURE_VERSION_1_1)
+		, Desc_1_1{ numParameters, parameters, numStaticSamplers, staticSamplers, flags }
+	{}
+
+	template <size_t N>
+	explicit constexpr StaticRootSignatureDesc(
+		const StaticRootParameter1 (&parameters)[N],
+		D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)
+		: StaticRootSignatureDesc(static_cast<UINT>(N), parameters, 0, nullptr, flags)
+	{}
+
+	template <size_t N, size_t M>
+	constexpr StaticRootSignatureDesc(
+		const StaticRootParameter1 (&parameters)[N],
+		const D3D12_STATIC_SAMPLER_DESC (&staticSamplers)[M],
+		D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)
+		: StaticRootSignatureDesc(static_cast<UINT>(N), parameters, static_cast<UINT>(M), staticSamplers, flags)
+	{}
+
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& Get() const
+	{
+		return *reinterpret_cast<const D3D12_VERSIONED_ROOT_SIGNATURE_DESC*>(this);
+	}
+};
+
+static_assert(sizeof(StaticRootSignatureDesc) == sizeof(D3D12_VERSIONED_ROOT_SIGNATURE_DESC), "StaticRootSignatureDesc must match D3D12_VERSIONED_ROOT_SIGNATURE_DESC.");
+static_assert(offsetof(StaticRootSignatureDesc, Desc_1_1.NumParameters) == offsetof(D3D12_VERSIONED_ROOT_SIGNATURE_DESC, Desc_1_1.NumParameters), "StaticRootSignatureDesc must match D3D12_VERSIONED_ROOT_SIGNATURE_DESC.");
+static_assert(offsetof(StaticRootSignatureDesc, Desc_1_1.Flags) == offsetof(D3D12_VERSIONED_ROOT_SIGNATURE_DESC, Desc_1_1.Flags), "StaticRootSignatureDesc must match D3D12_VERSIONED_ROOT_SIGNATURE_DESC.");
+
+// Compile-time hashes. Fields are hashed one by one, so padding does not
+// matter, and the hash of a desc that has no padding equals HashValue of it,
+// as long as no float field is -0.0f (see FloatBitsConstant). Descs with
+// UINT8 fields (blend and depth-stencil) have padding, so their hashes only
+// compare with other HashStaticDesc results.
+
+constexpr uint64_t HashStaticDesc(const D3D12_RASTERIZER_DESC& desc, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(desc.FillMode, sizeof(desc.FillMode), seed);
+	seed = HashConstant(desc.CullMode, sizeof(desc.CullMode), seed);
+	seed = HashConstant(desc.FrontCounterClockwise, sizeof(desc.FrontCounterClockwise), seed);
+	seed = HashConstant(static_cast<uint32_t>(desc.DepthBias), sizeof(desc.DepthBias), seed);
+	seed = HashConstant(FloatBitsConstant(desc.DepthBiasClamp), sizeof(desc.DepthBiasClamp), seed);
+	seed = HashConstant(FloatBitsConstant(desc.SlopeScaledDepthBias), sizeof(desc.SlopeScaledDepthBias), seed);
+	seed = HashConstant(desc.DepthClipEnable, sizeof(desc.DepthClipEnable), seed);
+	seed = HashConstant(desc.MultisampleEnable, sizeof(desc.MultisampleEnable), seed);
+	seed = HashConstant(desc.AntialiasedLineEnable, sizeof(desc.AntialiasedLineEnable), seed);
+	seed = HashConstant(desc.ForcedSampleCount, sizeof(desc.ForcedSampleCount), seed);
+	return HashConstant(desc.ConservativeRaster, sizeof(desc.ConservativeRaster), seed);
+}
+
+constexpr uint64_t HashStaticDesc(const D3D12_BLEND_DESC& desc, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(desc.AlphaToCoverageEnable, sizeof(desc.AlphaToCoverageEnable), seed);
+	seed = HashConstant(desc.IndependentBlendEnable, sizeof(desc.IndependentBlendEnable), seed);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& target : desc.RenderTarget)
+	{
+		seed = HashConstant(target.BlendEnable, sizeof(target.BlendEnable), seed);
+		seed = HashConstant(target.LogicOpEnable, sizeof(target.LogicOpEnable), seed);
+		seed = HashConstant(target.SrcBlend, sizeof(target.SrcBlend), seed);
+		seed = HashConstant(target.DestBlend, sizeof(target.DestBlend), seed);
+		seed = HashConstant(target.BlendOp, sizeof(target.BlendOp), seed);
+		seed = HashConstant(target.SrcBlendAlpha, sizeof(target.SrcBlendAlpha), seed);
+		seed = HashConstant(target.DestBlendAlpha, sizeof(target.DestBlendAlpha), seed);
+		seed = HashConstant(target.BlendOpAlpha, sizeof(target.BlendOpAlpha), seed);
+		seed = HashConstant(target.LogicOp, sizeof(target.LogicOp), seed);
+		seed = HashConstant(target.RenderTargetWriteMask, sizeof(target.RenderTargetWriteMask), seed);
+	}
+	return seed;
+}
+
+constexpr uint64_t HashStaticDesc(const D3D12_DEPTH_STENCILOP_DESC& desc, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(desc.StencilFailOp, sizeof(desc.StencilFailOp), seed);
+	seed = HashConstant(desc.StencilDepthFailOp, sizeof(desc.StencilDepthFailOp), seed);
+	seed = HashConstant(desc.StencilPassOp, sizeof(desc.StencilPassOp), seed);
+	return HashConstant(desc.StencilFunc, sizeof(desc.StencilFunc), seed);
+}
+
+constexpr uint64_t HashStaticDesc(const D3D12_DEPTH_STENCIL_DESC& desc, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(desc.DepthEnable, sizeof(desc.DepthEnable), seed);
+	seed = HashConstant(desc.DepthWriteMask, sizeof(desc.DepthWriteMask), seed);
+	seed = HashConstant(desc.DepthFunc, sizeof(desc.DepthFunc), seed);
+	seed = HashConstant(desc.StencilEnable, sizeof(desc.StencilEnable), seed);
+	seed = HashConstant(desc.StencilReadMask, sizeof(desc.StencilReadMask), seed);
+	seed = HashConstant(desc.StencilWriteMask, sizeof(desc.StencilWriteMask), seed);
+	seed = HashStaticDesc(desc.FrontFace, seed);
+	return HashStaticDesc(desc.BackFace, seed);
+}
+
+constexpr uint64_t HashStaticDesc(const D3D12_STATIC_SAMPLER_DESC& desc, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(desc.Filter, sizeof(desc.Filter), seed);
+	seed = HashConstant(desc.AddressU, sizeof(desc.AddressU), seed);
+	seed = HashConstant(desc.AddressV, sizeof(desc.AddressV), seed);
+	seed = HashConstant(desc.AddressW, sizeof(desc.AddressW), seed);
+	seed = HashConstant(FloatBitsConstant(desc.MipLODBias), sizeof(desc.MipLODBias), seed);
+	seed = HashConstant(desc.MaxAnisotropy, sizeof(desc.MaxAnisotropy), seed);
+	seed = HashConstant(desc.ComparisonFunc, sizeof(desc.ComparisonFunc), seed);
+	seed = HashConstant(desc.BorderColor, sizeof(desc.BorderColor), seed);
+	seed = HashConstant(FloatBitsConstant(desc.MinLOD), sizeof(desc.MinLOD), seed);
+	seed = HashConstant(FloatBitsConstant(desc.MaxLOD), sizeof(desc.MaxLOD), seed);
+	seed = HashConstant(desc.ShaderRegister, sizeof(desc.ShaderRegister), seed);
+	seed = HashConstant(desc.RegisterSpace, sizeof(desc.RegisterSpace), seed);
+	return HashConstant(desc.ShaderVisibility, sizeof(desc.ShaderVisibility), seed);
+}
+
+constexpr uint64_t HashStaticDesc(const D3D12_DESCRIPTOR_RANGE1& range, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(range.RangeType, sizeof(range.RangeType), seed);
+	seed = HashConstant(range.NumDescriptors, sizeof(range.NumDescriptors), seed);
+	seed = HashConstant(range.BaseShaderRegister, sizeof(range.BaseShaderRegister), seed);
+	seed = HashConstant(range.RegisterSpace, sizeof(range.RegisterSpace), seed);
+	seed = HashConstant(range.Flags, sizeof(range.Flags), seed);
+	return HashConstant(range.OffsetInDescriptorsFromTableStart, sizeof(range.OffsetInDescriptorsFromTableStart), seed);
+}
+
+// Only the active union member is read, which constant evaluation requires.
+constexpr uint64_t HashStaticDesc(const StaticRootParameter1& parameter, uint64_t seed = HashOffsetBasis)
+{
+	seed = HashConstant(parameter.ParameterType, sizeof(parameter.ParameterType), seed);
+	switch (parameter.ParameterType)
+	{
+	case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+		seed = HashConstant(parameter.DescriptorTable.NumDescriptorRanges, sizeof(UINT), seed);
+		for (UINT i = 0; i < parameter.DescriptorTable.NumDescriptorRanges; ++i)
+		{
+			seed = HashStaticDesc(parameter.DescriptorTable.pDescriptorRanges[i], seed);
+		}
+		break;
+	case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+		seed = HashConstant(parameter.Constants.ShaderRegister, sizeof(UINT), seed);
+		seed = HashConstant(parameter.Constants.RegisterSpace, sizeof(UINT), seed);
+		seed = HashConstant(parameter.Constants.Num32BitValues, sizeof(UINT), seed);
+		break;
+	default:
+		seed = HashConstant(parameter.Descriptor.ShaderRegister, sizeof(UINT), seed);
+		seed = HashConstant(parameter.Descriptor.RegisterSpace, sizeof(UINT), seed);
+		seed = HashConstant(parameter.Descriptor.Flags, sizeof(parameter.Descriptor.Flags), seed);
+		break;
+	}
+	return HashConstant(parameter.ShaderVisibility, sizeof(parameter.ShaderVisibility), seed);
+}
+
+constexpr uint64_t HashStaticDesc(const StaticRootSignatureDesc& desc, uint64_t seed = HashOffsetBasis)
+{
+	const StaticRootSignatureDesc1& desc1 = desc.Desc_1_1;
+	seed = HashConstant(desc.Version, sizeof(desc.Version), seed);
+	seed = HashConstant(desc1.NumParameters, sizeof(desc1.NumParameters), seed);
+	for (UINT i = 0; i < desc1.NumParameters; ++i)
+	{
+		seed = HashStaticDesc(desc1.pParameters[i], seed);
+	}
+	seed = HashConstant(desc1.NumStaticSamplers, sizeof(desc1.NumStaticSamplers), seed);
+	for (UINT i = 0; i < desc1.NumStaticSamplers; ++i)
+	{
+		seed = HashStaticDesc(desc1.pStaticSamplers[i], seed);
+	}
+	return HashConstant(desc1.Flags, sizeof(desc1.Flags), seed);
+}
+
+// Compares HashStaticDesc of the default static descs with HashValue of the
+// same descs built by d3dx12 at run time. Called once at startup in debug
+// builds.
+bool StaticDescHashesMatchRuntime();
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "LatencyHistogram.h"
+#include "MpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class CommandQueue;
+class Fence;
+
+// Fence values a submission signals, filled in once the submit thread has
+// executed it.
+class SubmitTicket
+{
+public:
+	SubmitTicket() = default;
+
+	bool IsValid() const { return m_State != nullptr; }
+	bool IsSubmitted() const { return m_State && m_State->FenceValue.load(std::memory_order_acquire) != 0; }
+
+	// The queue's fence value. 0 until submitted.
+	UINT64 GetFenceValue() const { return m_State ? m_State->FenceValue.load(std::memory_order_acquire) : 0; }
+
+	// The value signaled on the submission's Signals[index], to wait on or
+	// pass to another submission's Waits. 0 until submitted.
+	UINT64 GetSignaledValue(size_t index) const { return IsSubmitted() ? m_State->SignaledValues[index] : 0; }
+
+private:
+	friend class SubmitThread;
+
+	struct State
+	{
+		std::atomic<UINT64> FenceValue{ 0 };
+		// Written before FenceValue is published.
+		std::vector<UINT64> SignaledValues;
+	};
+
+	std::shared_ptr<State> m_State;
+};
+
+// Owns all submission to one command queue.
+//
+// Producers post closed command lists together with the fences the GPU must
+// wait on first and the extra fences to signal afterwards. Post only pushes
+// onto a lock-free queue and returns; the submit thread issues the Waits,
+// ExecuteCommandLists and Signals in post order. Posts from one thread keep
+// their relative order; posts from different threads are ordered by when
+// they reach the queue.
+//
+// Post latency is recorded in a histogram, as is the time from post until
+// the lists are on the GPU queue.
+class SubmitThread
+{
+public:
+	struct FenceWait
+	{
+		Fence* WaitFence;
+		UINT64 Value;
+	};
+
+	struct Submission
+	{
+		// Closed lists from queue.GetCommandList().
+		std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> CommandLists;
+		std::vector<FenceWait> Waits;
+		// Signaled after the queue's own fence. The ticket reports the value
+		// each one was signaled with.
+		std::vector<Fence*> Signals;
+	};
+
+	explicit SubmitThread(CommandQueue& queue);
+	// Submits everything still queued before returning.
+	~SubmitThread();
+
+	SubmitThread(const SubmitThread&) = delete;
+	SubmitThread& operator=(const SubmitThread&) = delete;
+
+	// Any thread. Returns without waiting for the submission.
+	SubmitTicket Post(Submission submission);
+
+	SubmitTicket Post(std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> commandLists)
+	{
+		Submission submission;
+		submission.CommandLists = std::move(commandLists);
+		return Post(std::move(submission));
+	}
+
+	// Block until the ticket has been submitted, then until the GPU has
+	// finished it. A failure on the submit thread is rethrown here.
+	void WaitForSubmission(const SubmitTicket& ticket);
+	void WaitForCompletion(const SubmitTicket& ticket);
+
+	// Block until everything posted so far has been submitted.
+	void Drain();
+
+	const LatencyHistogram& GetPostLatency() const { return m_PostLatency; }
+	const LatencyHistogram& GetQueueLatency() const { return m_QueueLatency; }
+	void ResetLatency();
+
+	struct BenchmarkResult
+	{
+		uint32_t ProducerCount = 0;
+		uint64_t Posts = 0;
+		double Milliseconds = 0.0;   // From the first post until everything is submitted.
+	};
+
+	// Post postsPerProducer single-list submissions from each of producerCount
+	// threads at once, then drain. The latency histograms are reset first, so
+	// afterwards they hold this run.
+	static BenchmarkResult RunBenchmark(SubmitThread& submitThread, uint32_t producerCount = 4, uint32_t postsPerProducer = 16384);
+
+private:
+	struct Item
+	{
+		Submission Work;
+		std::shared_ptr<SubmitTicket::State> Ticket;
+		UINT64 PostedAt = 0;
+	};
+
+	void Run();
+	void Execute(Item& item);
+
+	CommandQueue& m_Queue;
+	MpscQueue<Item*> m_Items;
+
+	// Producers only take the lock when the submit thread is asleep.
+	std::atomic<bool> m_Sleeping;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_Submitted;
+	std::atomic<UINT64> m_Posted;
+	std::atomic<UINT64> m_Executed;
+	std::atomic<bool> m_Stopping;
+	// First failure on the submit thread, rethrown by the wait functions.
+	std::exception_ptr m_Error;
+
+	LatencyHistogram m_PostLatency;
+	LatencyHistogram m_QueueLatency;
+
+	std::thread m_Thread;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "Fence.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+// A ring of persistently mapped upload memory for data the GPU reads once,
+// such as per-frame constants and indirect argument buffers.
+//
+// Allocations are carved off the head of the ring. Finish tags everything
+// allocated since the previous Finish with a fence value, and that memory is
+// reused once the fence completes. The CPU pointer is write-combined when the
+// ring lives in an upload heap: write it sequentially and never read it back.
+//
+// Without a device the ring is backed by ordinary memory and its GPU
+// addresses are offsets into it, so code that fills the ring can be run and
+// checked without a GPU.
+class UploadRing
+{
+public:
+	struct Allocation
+	{
+		void* CpuAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+		ID3D12Resource* Resource = nullptr;
+		UINT64 Offset = 0;                  // From the start of Resource.
+		UINT64 Size = 0;
+	};
+
+	UploadRing(Microsoft::WRL::ComPtr<ID3D12Device> device, std::shared_ptr<Fence> fence, UINT64 size);
+	UploadRing(std::shared_ptr<Fence> fence, UINT64 size);
+	~UploadRing();
+
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	// Returns false if the space is still in use by the GPU. alignment must be
+	// a power of two. An allocation never wraps around the end of the ring.
+	bool TryAllocate(UINT64 size, UINT64 alignment, Allocation& allocation);
+
+	// Like TryAllocate, but waits on the fence for space. Throws
+	// std::length_error if size is larger than the ring, and
+	// std::runtime_error if the space is held by allocations not yet finished.
+	Allocation Allocate(UINT64 size, UINT64 alignment);
+
+	// Everything allocated since the last Finish is free again once fenceValue
+	// completes. Not thread-safe, like the rest of the ring: use one per
+	// recording thread, or one per frame slot.
+	void Finish(UINT64 fenceValue);
+
+	UINT64 GetSize() const { return m_Size; }
+	// Bytes allocated and not yet known to be free.
+	UINT64 GetUsedSize() const { return m_Head - m_Tail; }
+
+	ID3D12Resource* GetResource() const { return m_Resource.Get(); }
+
+private:
+	struct PendingRange
+	{
+		UINT64 FenceValue;
+		UINT64 End;
+	};
+
+	void Retire();
+
+	std::shared_ptr<Fence> m_Fence;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_Resource;
+	std::vector<UINT8> m_HostMemory;
+	UINT8* m_CpuBase;
+	D3D12_GPU_VIRTUAL_ADDRESS m_GpuBase;
+	UINT64 m_Size;
+
+	// Positions grow without wrapping; the offset in the ring is position % size.
+	UINT64 m_Head;
+	UINT64 m_Tail;
+	UINT64 m_FinishedHead;
+	std::deque<PendingRange> m_Pending;
+};
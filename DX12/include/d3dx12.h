@@ -32,6 +32,30 @@ inline bool operator!=(const D3D12_VIEWPORT& l, const D3D12_VIEWPORT& r)
 	return !(l == r);
 }
 
+//------------------------------------------------------------------------------------------------
+inline bool operator==(const D3D12_VERTEX_BUFFER_VIEW& l, const D3D12_VERTEX_BUFFER_VIEW& r)
+{
+	return l.BufferLocation == r.BufferLocation && l.SizeInBytes == r.SizeInBytes && l.StrideInBytes == r.StrideInBytes;
+}
+
+//------------------------------------------------------------------------------------------------
+inline bool operator!=(const D3D12_VERTEX_BUFFER_VIEW& l, const D3D12_VERTEX_BUFFER_VIEW& r)
+{
+	return !(l == r);
+}
+
+//------------------------------------------------------------------------------------------------
+inline bool operator==(const D3D12_INDEX_BUFFER_VIEW& l, const D3D12_INDEX_BUFFER_VIEW& r)
+{
+	return l.BufferLocation == r.BufferLocation && l.SizeInBytes == r.SizeInBytes && l.Format == r.Format;
+}
+
+//------------------------------------------------------------------------------------------------
+inline bool operator!=(const D3D12_INDEX_BUFFER_VIEW& l, const D3D12_INDEX_BUFFER_VIEW& r)
+{
+	return !(l == r);
+}
+
 //------------------------------------------------------------------------------------------------
 struct CD3DX12_RECT : public D3D12_RECT
 {
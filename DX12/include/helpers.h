@@ -4,12 +4,45 @@
 #include <Windows.h> // For HRESULT
 #include <exception>
 
-// From DXSampleHelper.h 
+// A failed HRESULT and the ThrowIfFailed that caught it.
+class HResultException : public std::exception
+{
+public:
+	HResultException(HRESULT result, const char* file, int line);
+
+	HRESULT GetResult() const { return m_Result; }
+	const char* GetFile() const { return m_File; }
+	int GetLine() const { return m_Line; }
+
+	// "HRESULT 0x887A0005 at CommandQueue.cpp(42)"
+	const char* what() const noexcept override { return m_Message; }
+
+private:
+	HRESULT m_Result;
+	const char* m_File;
+	int m_Line;
+	char m_Message[128];
+};
+
+#if defined(_MSC_VER)
+#define HRESULT_FAILURE_PATH __declspec(noinline)
+#else
+#define HRESULT_FAILURE_PATH __attribute__((noinline, cold))
+#endif
+
+// Records the failure in HResultLog and throws HResultException. Kept out
+// of line so that ThrowIfFailed inlines to a test and a branch that is
+// predicted not taken, with the call and its arguments moved off the hot path.
+[[noreturn]] HRESULT_FAILURE_PATH void ThrowHResult(HRESULT result, const char* file, int line);
+
+// From DXSampleHelper.h
 // Source: https://github.com/Microsoft/DirectX-Graphics-Samples
-inline void ThrowIfFailed(HRESULT hr)
+inline void ThrowIfFailedAt(HRESULT hr, const char* file, int line)
 {
 	if (FAILED(hr))
 	{
-		throw std::exception();
+		ThrowHResult(hr, file, line);
 	}
-}
\ No newline at end of file
+}
+
+#define ThrowIfFailed(hr) ThrowIfFailedAt((hr), __FILE__, __LINE__)
@@ -0,0 +1,594 @@
+#include "../include/CaptureReplay.h"
+#include "../include/CommandQueue.h"
+
+#include <chrono>
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	class PayloadReader
+	{
+	public:
+		PayloadReader(const UINT8* data, size_t size)
+			: m_Cursor(data)
+			, m_End(data + size)
+			, m_Valid(true)
+		{}
+
+		template <typename T>
+		T Read()
+		{
+			T value = {};
+			ReadBytes(&value, sizeof(T));
+			return value;
+		}
+
+		void ReadBytes(void* data, size_t size)
+		{
+			if (!m_Valid || static_cast<size_t>(m_End - m_Cursor) < size)
+			{
+				m_Valid = false;
+				return;
+			}
+			if (size != 0)
+			{
+				memcpy(data, m_Cursor, size);
+				m_Cursor += size;
+			}
+		}
+
+		// Copied out rather than pointed at, since the stream is not aligned.
+		template <typename T>
+		void ReadArray(std::vector<T>& values, UINT32 count)
+		{
+			if (!m_Valid || count > static_cast<size_t>(m_End - m_Cursor) / sizeof(T))
+			{
+				m_Valid = false;
+				values.clear();
+				return;
+			}
+			values.resize(count);
+			ReadBytes(values.data(), count * sizeof(T));
+		}
+
+		// The payload was exactly as long as the command needed.
+		bool IsValid() const { return m_Valid && m_Cursor == m_End; }
+
+	private:
+		const UINT8* m_Cursor;
+		const UINT8* m_End;
+		bool m_Valid;
+	};
+
+	template <typename T>
+	T* Resolve(const std::vector<void*>& objects, UINT32 id)
+	{
+		return id < objects.size() ? static_cast<T*>(objects[id]) : nullptr;
+	}
+
+	// Aliasing barriers may leave either resource null, and a UAV barrier
+	// without one covers every resource.
+	bool HasRequiredResources(const std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+	{
+		for (const D3D12_RESOURCE_BARRIER& barrier : barriers)
+		{
+			if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && !barrier.Transition.pResource)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	D3D12_TEXTURE_COPY_LOCATION ReadCopyLocation(PayloadReader& reader, const std::vector<void*>& objects)
+	{
+		D3D12_TEXTURE_COPY_LOCATION location = {};
+		location.pResource = Resolve<ID3D12Resource>(objects, reader.Read<UINT32>());
+		location.Type = static_cast<D3D12_TEXTURE_COPY_TYPE>(reader.Read<UINT32>());
+		UINT32 subresourceIndex = reader.Read<UINT32>();
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+		footprint.Offset = reader.Read<UINT64>();
+		footprint.Footprint.Format = static_cast<DXGI_FORMAT>(reader.Read<UINT32>());
+		footprint.Footprint.Width = reader.Read<UINT32>();
+		footprint.Footprint.Height = reader.Read<UINT32>();
+		footprint.Footprint.Depth = reader.Read<UINT32>();
+		footprint.Footprint.RowPitch = reader.Read<UINT32>();
+
+		if (location.Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT)
+		{
+			location.PlacedFootprint = footprint;
+		}
+		else
+		{
+			location.SubresourceIndex = subresourceIndex;
+		}
+		return location;
+	}
+}
+
+D3D12CaptureBackend::D3D12CaptureBackend(CommandQueue& queue)
+	: m_Queue(queue)
+	, m_LastFenceValue(0)
+{}
+
+void D3D12CaptureBackend::BeginCommandList(D3D12_COMMAND_LIST_TYPE type)
+{
+	if (type == m_Queue.GetType())
+	{
+		m_List = m_Queue.GetCommandList();
+	}
+}
+
+void D3D12CaptureBackend::EndCommandList()
+{
+	if (m_List)
+	{
+		m_FrameLists.push_back(std::move(m_List));
+		m_List = nullptr;
+	}
+}
+
+void D3D12CaptureBackend::EndFrame()
+{
+	if (!m_FrameLists.empty())
+	{
+		m_LastFenceValue = m_Queue.ExecuteCommandLists(m_FrameLists);
+		m_FrameLists.clear();
+	}
+}
+
+CaptureReplayer::Stats CaptureReplayer::Replay(const CommandCapture& capture, CaptureBackend& backend, const std::vector<void*>& objects)
+{
+	Stats stats;
+	for (size_t frame = 0; frame < capture.GetFrameCount(); ++frame)
+	{
+		Stats frameStats = ReplayFrame(capture, frame, backend, objects);
+		stats.Frames += frameStats.Frames;
+		stats.CommandLists += frameStats.CommandLists;
+		stats.Commands += frameStats.Commands;
+		stats.SkippedCommands += frameStats.SkippedCommands;
+	}
+	return stats;
+}
+
+CaptureReplayer::Stats CaptureReplayer::ReplayFrame(const CommandCapture& capture, size_t frame, CaptureBackend& backend, const std::vector<void*>& objects)
+{
+	Stats stats;
+	for (size_t i = capture.GetFrameBegin(frame); i < capture.GetFrameEnd(frame); ++i)
+	{
+		const CapturedCommandList& list = capture.GetCommandList(i);
+		backend.BeginCommandList(list.Type);
+		ReplayCommandList(list, backend, objects, stats);
+		backend.EndCommandList();
+		++stats.CommandLists;
+	}
+	backend.EndFrame();
+	++stats.Frames;
+	return stats;
+}
+
+void CaptureReplayer::ReplayCommandList(const CapturedCommandList& list, CaptureBackend& backend, const std::vector<void*>& objects, Stats& stats)
+{
+	const UINT8* cursor = list.Commands.data();
+	const UINT8* end = cursor + list.Commands.size();
+
+	while (static_cast<size_t>(end - cursor) >= sizeof(CaptureCommandHeader))
+	{
+		CaptureCommandHeader header;
+		memcpy(&header, cursor, sizeof(header));
+		cursor += sizeof(header);
+		if (static_cast<size_t>(end - cursor) < header.Size)
+		{
+			++stats.SkippedCommands;
+			return;
+		}
+
+		PayloadReader reader(cursor, header.Size);
+		cursor += header.Size;
+		++stats.Commands;
+
+		// Each command is decoded in full and only forwarded if its payload
+		// had exactly the expected size and every object D3D12 requires
+		// resolved to one.
+		bool replayed = false;
+		switch (static_cast<CaptureCommand>(header.Command))
+		{
+		case CaptureCommand::SetGraphicsRootSignature:
+		{
+			ID3D12RootSignature* rootSignature = Resolve<ID3D12RootSignature>(objects, reader.Read<UINT32>());
+			if ((replayed = reader.IsValid()))
+			{
+				backend.SetGraphicsRootSignature(rootSignature);
+			}
+			break;
+		}
+		case CaptureCommand::SetComputeRootSignature:
+		{
+			ID3D12RootSignature* rootSignature = Resolve<ID3D12RootSignature>(objects, reader.Read<UINT32>());
+			if ((replayed = reader.IsValid()))
+			{
+				backend.SetComputeRootSignature(rootSignature);
+			}
+			break;
+		}
+		case CaptureCommand::SetPipelineState:
+		{
+			ID3D12PipelineState* pipelineState = Resolve<ID3D12PipelineState>(objects, reader.Read<UINT32>());
+			if ((replayed = reader.IsValid() && pipelineState))
+			{
+				backend.SetPipelineState(pipelineState);
+			}
+			break;
+		}
+		case CaptureCommand::SetDescriptorHeaps:
+		{
+			UINT32 count = reader.Read<UINT32>();
+			reader.ReadArray(m_Constants, count);
+			m_DescriptorHeaps.resize(m_Constants.size());
+			bool resolved = true;
+			for (size_t i = 0; i < m_Constants.size(); ++i)
+			{
+				m_DescriptorHeaps[i] = Resolve<ID3D12DescriptorHeap>(objects, m_Constants[i]);
+				resolved = resolved && m_DescriptorHeaps[i];
+			}
+			if ((replayed = reader.IsValid() && resolved))
+			{
+				backend.SetDescriptorHeaps(count, m_DescriptorHeaps.data());
+			}
+			break;
+		}
+		case CaptureCommand::SetGraphicsRootDescriptorTable:
+		case CaptureCommand::SetComputeRootDescriptorTable:
+		{
+			UINT32 index = reader.Read<UINT32>();
+			D3D12_GPU_DESCRIPTOR_HANDLE handle;
+			handle.ptr = reader.Read<UINT64>();
+			if ((replayed = reader.IsValid()))
+			{
+				if (static_cast<CaptureCommand>(header.Command) == CaptureCommand::SetGraphicsRootDescriptorTable)
+				{
+					backend.SetGraphicsRootDescriptorTable(index, handle);
+				}
+				else
+				{
+					backend.SetComputeRootDescriptorTable(index, handle);
+				}
+			}
+			break;
+		}
+		case CaptureCommand::SetGraphicsRootConstantBufferView:
+		case CaptureCommand::SetComputeRootConstantBufferView:
+		case CaptureCommand::SetGraphicsRootShaderResourceView:
+		case CaptureCommand::SetComputeRootShaderResourceView:
+		case CaptureCommand::SetGraphicsRootUnorderedAccessView:
+		case CaptureCommand::SetComputeRootUnorderedAccessView:
+		{
+			UINT32 index = reader.Read<UINT32>();
+			D3D12_GPU_VIRTUAL_ADDRESS location = reader.Read<UINT64>();
+			if (!(replayed = reader.IsValid()))
+			{
+				break;
+			}
+
+			switch (static_cast<CaptureCommand>(header.Command))
+			{
+			case CaptureCommand::SetGraphicsRootConstantBufferView: backend.SetGraphicsRootConstantBufferView(index, location); break;
+			case CaptureCommand::SetComputeRootConstantBufferView: backend.SetComputeRootConstantBufferView(index, location); break;
+			case CaptureCommand::SetGraphicsRootShaderResourceView: backend.SetGraphicsRootShaderResourceView(index, location); break;
+			case CaptureCommand::SetComputeRootShaderResourceView: backend.SetComputeRootShaderResourceView(index, location); break;
+			case CaptureCommand::SetGraphicsRootUnorderedAccessView: backend.SetGraphicsRootUnorderedAccessView(index, location); break;
+			default: backend.SetComputeRootUnorderedAccessView(index, location); break;
+			}
+			break;
+		}
+		case CaptureCommand::SetGraphicsRoot32BitConstants:
+		case CaptureCommand::SetComputeRoot32BitConstants:
+		{
+			UINT32 index = reader.Read<UINT32>();
+			UINT32 count = reader.Read<UINT32>();
+			UINT32 offset = reader.Read<UINT32>();
+			reader.ReadArray(m_Constants, count);
+			if ((replayed = reader.IsValid()))
+			{
+				if (static_cast<CaptureCommand>(header.Command) == CaptureCommand::SetGraphicsRoot32BitConstants)
+				{
+					backend.SetGraphicsRoot32BitConstants(index, count, m_Constants.data(), offset);
+				}
+				else
+				{
+					backend.SetComputeRoot32BitConstants(index, count, m_Constants.data(), offset);
+				}
+			}
+			break;
+		}
+		case CaptureCommand::IASetPrimitiveTopology:
+		{
+			D3D12_PRIMITIVE_TOPOLOGY topology = static_cast<D3D12_PRIMITIVE_TOPOLOGY>(reader.Read<UINT32>());
+			if ((replayed = reader.IsValid()))
+			{
+				backend.IASetPrimitiveTopology(topology);
+			}
+			break;
+		}
+		case CaptureCommand::IASetVertexBuffers:
+		{
+			UINT32 startSlot = reader.Read<UINT32>();
+			UINT32 count = reader.Read<UINT32>();
+			UINT32 hasViews = reader.Read<UINT32>();
+			reader.ReadArray(m_VertexBuffers, hasViews ? count : 0);
+			if ((replayed = reader.IsValid()))
+			{
+				backend.IASetVertexBuffers(startSlot, count, hasViews ? m_VertexBuffers.data() : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::IASetIndexBuffer:
+		{
+			UINT32 hasView = reader.Read<UINT32>();
+			D3D12_INDEX_BUFFER_VIEW view = {};
+			if (hasView)
+			{
+				view = reader.Read<D3D12_INDEX_BUFFER_VIEW>();
+			}
+			if ((replayed = reader.IsValid()))
+			{
+				backend.IASetIndexBuffer(hasView ? &view : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::RSSetViewports:
+		{
+			UINT32 count = reader.Read<UINT32>();
+			reader.ReadArray(m_Viewports, count);
+			if ((replayed = reader.IsValid()))
+			{
+				backend.RSSetViewports(count, m_Viewports.data());
+			}
+			break;
+		}
+		case CaptureCommand::RSSetScissorRects:
+		{
+			UINT32 count = reader.Read<UINT32>();
+			reader.ReadArray(m_Rects, count);
+			if ((replayed = reader.IsValid()))
+			{
+				backend.RSSetScissorRects(count, m_Rects.data());
+			}
+			break;
+		}
+		case CaptureCommand::OMSetRenderTargets:
+		{
+			UINT32 count = reader.Read<UINT32>();
+			UINT32 singleRange = reader.Read<UINT32>();
+			UINT32 handleCount = reader.Read<UINT32>();
+			UINT32 hasDepthStencil = reader.Read<UINT32>();
+			reader.ReadArray(m_RenderTargets, handleCount);
+			D3D12_CPU_DESCRIPTOR_HANDLE depthStencil = {};
+			if (hasDepthStencil)
+			{
+				depthStencil.ptr = static_cast<SIZE_T>(reader.Read<UINT64>());
+			}
+			if ((replayed = reader.IsValid()))
+			{
+				backend.OMSetRenderTargets(count, handleCount ? m_RenderTargets.data() : nullptr, singleRange ? TRUE : FALSE,
+					hasDepthStencil ? &depthStencil : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::OMSetBlendFactor:
+		{
+			UINT32 hasFactor = reader.Read<UINT32>();
+			FLOAT factor[4] = {};
+			if (hasFactor)
+			{
+				reader.ReadBytes(factor, sizeof(factor));
+			}
+			if ((replayed = reader.IsValid()))
+			{
+				backend.OMSetBlendFactor(hasFactor ? factor : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::OMSetStencilRef:
+		{
+			UINT32 stencilRef = reader.Read<UINT32>();
+			if ((replayed = reader.IsValid()))
+			{
+				backend.OMSetStencilRef(stencilRef);
+			}
+			break;
+		}
+		case CaptureCommand::DrawInstanced:
+		{
+			UINT32 vertexCount = reader.Read<UINT32>();
+			UINT32 instanceCount = reader.Read<UINT32>();
+			UINT32 startVertex = reader.Read<UINT32>();
+			UINT32 startInstance = reader.Read<UINT32>();
+			if ((replayed = reader.IsValid()))
+			{
+				backend.DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+			}
+			break;
+		}
+		case CaptureCommand::DrawIndexedInstanced:
+		{
+			UINT32 indexCount = reader.Read<UINT32>();
+			UINT32 instanceCount = reader.Read<UINT32>();
+			UINT32 startIndex = reader.Read<UINT32>();
+			INT32 baseVertex = reader.Read<INT32>();
+			UINT32 startInstance = reader.Read<UINT32>();
+			if ((replayed = reader.IsValid()))
+			{
+				backend.DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+			}
+			break;
+		}
+		case CaptureCommand::Dispatch:
+		{
+			UINT32 x = reader.Read<UINT32>();
+			UINT32 y = reader.Read<UINT32>();
+			UINT32 z = reader.Read<UINT32>();
+			if ((replayed = reader.IsValid()))
+			{
+				backend.Dispatch(x, y, z);
+			}
+			break;
+		}
+		case CaptureCommand::ResourceBarrier:
+		{
+			// Bounds the allocation; IsValid checks the exact size afterwards.
+			UINT32 count = reader.Read<UINT32>();
+			m_Barriers.resize(count <= header.Size ? count : 0);
+			for (D3D12_RESOURCE_BARRIER& barrier : m_Barriers)
+			{
+				barrier = {};
+				barrier.Type = static_cast<D3D12_RESOURCE_BARRIER_TYPE>(reader.Read<UINT32>());
+				barrier.Flags = static_cast<D3D12_RESOURCE_BARRIER_FLAGS>(reader.Read<UINT32>());
+				UINT32 resource = reader.Read<UINT32>();
+				UINT32 resourceAfter = reader.Read<UINT32>();
+				UINT32 subresource = reader.Read<UINT32>();
+				UINT32 stateBefore = reader.Read<UINT32>();
+				UINT32 stateAfter = reader.Read<UINT32>();
+
+				switch (barrier.Type)
+				{
+				case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+					barrier.Transition.pResource = Resolve<ID3D12Resource>(objects, resource);
+					barrier.Transition.Subresource = subresource;
+					barrier.Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(stateBefore);
+					barrier.Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(stateAfter);
+					break;
+				case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+					barrier.Aliasing.pResourceBefore = Resolve<ID3D12Resource>(objects, resource);
+					barrier.Aliasing.pResourceAfter = Resolve<ID3D12Resource>(objects, resourceAfter);
+					break;
+				case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+					barrier.UAV.pResource = Resolve<ID3D12Resource>(objects, resource);
+					break;
+				}
+			}
+			if ((replayed = reader.IsValid() && m_Barriers.size() == count && HasRequiredResources(m_Barriers)))
+			{
+				backend.ResourceBarrier(count, m_Barriers.data());
+			}
+			break;
+		}
+		case CaptureCommand::CopyBufferRegion:
+		{
+			ID3D12Resource* dst = Resolve<ID3D12Resource>(objects, reader.Read<UINT32>());
+			UINT64 dstOffset = reader.Read<UINT64>();
+			ID3D12Resource* src = Resolve<ID3D12Resource>(objects, reader.Read<UINT32>());
+			UINT64 srcOffset = reader.Read<UINT64>();
+			UINT64 numBytes = reader.Read<UINT64>();
+			if ((replayed = reader.IsValid() && dst && src))
+			{
+				backend.CopyBufferRegion(dst, dstOffset, src, srcOffset, numBytes);
+			}
+			break;
+		}
+		case CaptureCommand::CopyTextureRegion:
+		{
+			D3D12_TEXTURE_COPY_LOCATION dst = ReadCopyLocation(reader, objects);
+			UINT32 x = reader.Read<UINT32>();
+			UINT32 y = reader.Read<UINT32>();
+			UINT32 z = reader.Read<UINT32>();
+			D3D12_TEXTURE_COPY_LOCATION src = ReadCopyLocation(reader, objects);
+			UINT32 hasBox = reader.Read<UINT32>();
+			D3D12_BOX box = {};
+			if (hasBox)
+			{
+				box = reader.Read<D3D12_BOX>();
+			}
+			if ((replayed = reader.IsValid() && dst.pResource && src.pResource))
+			{
+				backend.CopyTextureRegion(&dst, x, y, z, &src, hasBox ? &box : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::CopyResource:
+		{
+			ID3D12Resource* dst = Resolve<ID3D12Resource>(objects, reader.Read<UINT32>());
+			ID3D12Resource* src = Resolve<ID3D12Resource>(objects, reader.Read<UINT32>());
+			if ((replayed = reader.IsValid() && dst && src))
+			{
+				backend.CopyResource(dst, src);
+			}
+			break;
+		}
+		case CaptureCommand::ClearRenderTargetView:
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE view;
+			view.ptr = static_cast<SIZE_T>(reader.Read<UINT64>());
+			FLOAT color[4];
+			reader.ReadBytes(color, sizeof(color));
+			UINT32 numRects = reader.Read<UINT32>();
+			reader.ReadArray(m_Rects, numRects);
+			if ((replayed = reader.IsValid()))
+			{
+				backend.ClearRenderTargetView(view, color, numRects, numRects ? m_Rects.data() : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::ClearDepthStencilView:
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE view;
+			view.ptr = static_cast<SIZE_T>(reader.Read<UINT64>());
+			D3D12_CLEAR_FLAGS flags = static_cast<D3D12_CLEAR_FLAGS>(reader.Read<UINT32>());
+			FLOAT depth = reader.Read<FLOAT>();
+			UINT8 stencil = static_cast<UINT8>(reader.Read<UINT32>());
+			UINT32 numRects = reader.Read<UINT32>();
+			reader.ReadArray(m_Rects, numRects);
+			if ((replayed = reader.IsValid()))
+			{
+				backend.ClearDepthStencilView(view, flags, depth, stencil, numRects, numRects ? m_Rects.data() : nullptr);
+			}
+			break;
+		}
+		case CaptureCommand::ExecuteBundle:
+		{
+			ID3D12GraphicsCommandList* bundle = Resolve<ID3D12GraphicsCommandList>(objects, reader.Read<UINT32>());
+			if ((replayed = reader.IsValid() && bundle))
+			{
+				backend.ExecuteBundle(bundle);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+
+		if (!replayed)
+		{
+			++stats.SkippedCommands;
+		}
+	}
+}
+
+CaptureReplayer::BenchmarkResult CaptureReplayer::RunBenchmark(const CommandCapture& capture, CaptureBackend& backend,
+	const std::vector<void*>& objects, UINT iterationCount)
+{
+	CaptureReplayer replayer;
+
+	// One untimed pass sizes the scratch arrays.
+	replayer.Replay(capture, backend, objects);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	UINT64 commands = 0;
+	UINT64 frames = 0;
+	for (UINT i = 0; i < iterationCount; ++i)
+	{
+		Stats stats = replayer.Replay(capture, backend, objects);
+		commands += stats.Commands;
+		frames += stats.Frames;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	BenchmarkResult result;
+	result.FrameMilliseconds = frames ? milliseconds / frames : 0.0;
+	result.CommandNanoseconds = commands ? milliseconds * 1e6 / commands : 0.0;
+	return result;
+}
@@ -0,0 +1,867 @@
+#include "../include/CommandCapture.h"
+#include "../include/FileError.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	const UINT32 CaptureMagic = 0x43323144; // "D12C"
+
+	struct CaptureFileHeader
+	{
+		UINT32 Magic;
+		UINT32 Version;
+		UINT32 ObjectCount;
+		UINT32 FrameCount;
+		UINT64 ListCount;
+	};
+
+	struct CaptureListHeader
+	{
+		UINT32 Type;
+		UINT32 CommandCount;
+		UINT64 ByteSize;
+	};
+
+	// Wire sizes of the structures that hold object pointers, which are
+	// written field by field with the pointers replaced by ids.
+	const size_t BarrierSize = 7 * sizeof(UINT32);
+	const size_t CopyLocationSize = 3 * sizeof(UINT32) + sizeof(UINT64) + 5 * sizeof(UINT32);
+
+	bool ReadFile(const std::wstring& path, std::vector<char>& data)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	class FileReader
+	{
+	public:
+		FileReader(const std::vector<char>& data)
+			: m_Cursor(data.data())
+			, m_End(data.data() + data.size())
+		{}
+
+		template <typename T>
+		bool Read(T& value)
+		{
+			return ReadBytes(&value, sizeof(T));
+		}
+
+		bool ReadBytes(void* data, size_t size)
+		{
+			if (static_cast<size_t>(m_End - m_Cursor) < size)
+			{
+				return false;
+			}
+			memcpy(data, m_Cursor, size);
+			m_Cursor += size;
+			return true;
+		}
+
+		size_t GetRemaining() const { return static_cast<size_t>(m_End - m_Cursor); }
+		bool IsAtEnd() const { return m_Cursor == m_End; }
+
+	private:
+		const char* m_Cursor;
+		const char* m_End;
+	};
+
+	// Every command header must lie inside the stream and the count must match.
+	bool ValidateCommands(const CapturedCommandList& list)
+	{
+		const UINT8* cursor = list.Commands.data();
+		const UINT8* end = cursor + list.Commands.size();
+		UINT32 count = 0;
+		while (cursor != end)
+		{
+			CaptureCommandHeader header;
+			if (static_cast<size_t>(end - cursor) < sizeof(header))
+			{
+				return false;
+			}
+			memcpy(&header, cursor, sizeof(header));
+			cursor += sizeof(header);
+			if (static_cast<size_t>(end - cursor) < header.Size)
+			{
+				return false;
+			}
+			cursor += header.Size;
+			++count;
+		}
+		return count == list.CommandCount;
+	}
+}
+
+const char* GetCaptureCommandName(CaptureCommand command)
+{
+	static const char* s_Names[static_cast<size_t>(CaptureCommand::Count)] =
+	{
+		"SetGraphicsRootSignature",
+		"SetComputeRootSignature",
+		"SetPipelineState",
+		"SetDescriptorHeaps",
+		"SetGraphicsRootDescriptorTable",
+		"SetComputeRootDescriptorTable",
+		"SetGraphicsRootConstantBufferView",
+		"SetComputeRootConstantBufferView",
+		"SetGraphicsRootShaderResourceView",
+		"SetComputeRootShaderResourceView",
+		"SetGraphicsRootUnorderedAccessView",
+		"SetComputeRootUnorderedAccessView",
+		"SetGraphicsRoot32BitConstants",
+		"SetComputeRoot32BitConstants",
+		"IASetPrimitiveTopology",
+		"IASetVertexBuffers",
+		"IASetIndexBuffer",
+		"RSSetViewports",
+		"RSSetScissorRects",
+		"OMSetRenderTargets",
+		"OMSetBlendFactor",
+		"OMSetStencilRef",
+		"DrawInstanced",
+		"DrawIndexedInstanced",
+		"Dispatch",
+		"ResourceBarrier",
+		"CopyBufferRegion",
+		"CopyTextureRegion",
+		"CopyResource",
+		"ClearRenderTargetView",
+		"ClearDepthStencilView",
+		"ExecuteBundle",
+	};
+	size_t index = static_cast<size_t>(command);
+	return index < static_cast<size_t>(CaptureCommand::Count) ? s_Names[index] : "Unknown";
+}
+
+UINT32 CommandCapture::RegisterObject(const void* object, CaptureObjectType type)
+{
+	if (!object)
+	{
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto it = m_ObjectIds.find(object);
+	if (it != m_ObjectIds.end())
+	{
+		return it->second;
+	}
+
+	UINT32 id = static_cast<UINT32>(m_Objects.size());
+	m_ObjectIds.emplace(object, id);
+	m_Objects.push_back(const_cast<void*>(object));
+	m_ObjectTypes.push_back(type);
+	return id;
+}
+
+void CommandCapture::AddCommandList(CapturedCommandList list)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Lists.push_back(std::move(list));
+}
+
+void CommandCapture::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_FrameEnds.push_back(m_Lists.size());
+}
+
+void CommandCapture::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_ObjectIds.clear();
+	m_ObjectTypes.assign(1, CaptureObjectType::Resource);
+	m_Objects.assign(1, nullptr);
+	m_Lists.clear();
+	m_FrameEnds.clear();
+}
+
+void CommandCapture::ClearCommandLists()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Lists.clear();
+	m_FrameEnds.clear();
+}
+
+UINT64 CommandCapture::GetCommandCount() const
+{
+	UINT64 count = 0;
+	for (const CapturedCommandList& list : m_Lists)
+	{
+		count += list.CommandCount;
+	}
+	return count;
+}
+
+UINT64 CommandCapture::GetByteSize() const
+{
+	UINT64 size = 0;
+	for (const CapturedCommandList& list : m_Lists)
+	{
+		size += list.Commands.size();
+	}
+	return size;
+}
+
+void CommandCapture::Save(const std::wstring& path) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	size_t listCount = m_FrameEnds.empty() ? 0 : m_FrameEnds.back();
+
+	CaptureFileHeader header;
+	header.Magic = CaptureMagic;
+	header.Version = Version;
+	header.ObjectCount = static_cast<UINT32>(m_ObjectTypes.size()) - 1;
+	header.FrameCount = static_cast<UINT32>(m_FrameEnds.size());
+	header.ListCount = listCount;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_ObjectTypes.data() + 1), header.ObjectCount * sizeof(CaptureObjectType));
+	for (size_t frameEnd : m_FrameEnds)
+	{
+		UINT64 end = frameEnd;
+		file.write(reinterpret_cast<const char*>(&end), sizeof(end));
+	}
+
+	for (size_t i = 0; i < listCount; ++i)
+	{
+		const CapturedCommandList& list = m_Lists[i];
+
+		CaptureListHeader listHeader;
+		listHeader.Type = static_cast<UINT32>(list.Type);
+		listHeader.CommandCount = list.CommandCount;
+		listHeader.ByteSize = list.Commands.size();
+		file.write(reinterpret_cast<const char*>(&listHeader), sizeof(listHeader));
+		file.write(reinterpret_cast<const char*>(list.Commands.data()), list.Commands.size());
+	}
+
+	file.close();
+	if (!file)
+	{
+		throw FileError("Cannot write", path);
+	}
+}
+
+bool CommandCapture::Load(const std::wstring& path)
+{
+	Clear();
+
+	std::vector<char> data;
+	if (!ReadFile(path, data))
+	{
+		return false;
+	}
+
+	std::vector<CaptureObjectType> objectTypes;
+	std::vector<size_t> frameEnds;
+	std::vector<CapturedCommandList> lists;
+
+	auto parse = [&]()
+	{
+		FileReader reader(data);
+
+		CaptureFileHeader header;
+		if (!reader.Read(header) || header.Magic != CaptureMagic || header.Version != Version ||
+			header.ObjectCount > reader.GetRemaining() / sizeof(CaptureObjectType))
+		{
+			return false;
+		}
+
+		objectTypes.resize(header.ObjectCount + 1, CaptureObjectType::Resource);
+		if (!reader.ReadBytes(objectTypes.data() + 1, header.ObjectCount * sizeof(CaptureObjectType)))
+		{
+			return false;
+		}
+
+		UINT64 previousEnd = 0;
+		for (UINT32 i = 0; i < header.FrameCount; ++i)
+		{
+			UINT64 end;
+			if (!reader.Read(end) || end < previousEnd || end > header.ListCount)
+			{
+				return false;
+			}
+			frameEnds.push_back(static_cast<size_t>(end));
+			previousEnd = end;
+		}
+		if (previousEnd != header.ListCount)
+		{
+			return false;
+		}
+
+		for (UINT64 i = 0; i < header.ListCount; ++i)
+		{
+			CaptureListHeader listHeader;
+			// Checked before allocating so a corrupt size cannot exhaust memory.
+			if (!reader.Read(listHeader) || listHeader.ByteSize > reader.GetRemaining())
+			{
+				return false;
+			}
+
+			CapturedCommandList list;
+			list.Type = static_cast<D3D12_COMMAND_LIST_TYPE>(listHeader.Type);
+			list.CommandCount = listHeader.CommandCount;
+			list.Commands.resize(static_cast<size_t>(listHeader.ByteSize));
+			if (!reader.ReadBytes(list.Commands.data(), list.Commands.size()) || !ValidateCommands(list))
+			{
+				return false;
+			}
+			lists.push_back(std::move(list));
+		}
+		return reader.IsAtEnd();
+	};
+
+	if (!parse())
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_ObjectTypes = std::move(objectTypes);
+	m_Objects.assign(m_ObjectTypes.size(), nullptr);
+	m_FrameEnds = std::move(frameEnds);
+	m_Lists = std::move(lists);
+	return true;
+}
+
+class CapturingCommandList::Writer
+{
+public:
+	explicit Writer(UINT8* cursor)
+		: m_Cursor(cursor)
+	{}
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		memcpy(m_Cursor, &value, sizeof(T));
+		m_Cursor += sizeof(T);
+	}
+
+	void WriteBytes(const void* data, size_t size)
+	{
+		if (size != 0)
+		{
+			memcpy(m_Cursor, data, size);
+			m_Cursor += size;
+		}
+	}
+
+private:
+	UINT8* m_Cursor;
+};
+
+CapturingCommandList::CapturingCommandList(CommandCapture& capture, ComPtr<ID3D12GraphicsCommandList> commandList, D3D12_COMMAND_LIST_TYPE type)
+	: m_Capture(capture)
+	, m_CommandList(commandList)
+{
+	m_List.Type = type;
+}
+
+void CapturingCommandList::Finish(ComPtr<ID3D12GraphicsCommandList> commandList)
+{
+	D3D12_COMMAND_LIST_TYPE type = m_List.Type;
+	size_t size = m_List.Commands.size();
+	m_Capture.AddCommandList(std::move(m_List));
+
+	// The next list is usually about as long as this one, so start it at
+	// that size rather than growing it a command at a time again.
+	m_List = CapturedCommandList();
+	m_List.Type = type;
+	m_List.Commands.reserve(size);
+	m_CommandList = commandList;
+}
+
+CapturingCommandList::Writer CapturingCommandList::BeginCommand(CaptureCommand command, size_t payloadSize)
+{
+	size_t offset = m_List.Commands.size();
+	m_List.Commands.resize(offset + sizeof(CaptureCommandHeader) + payloadSize);
+	++m_List.CommandCount;
+
+	Writer writer(m_List.Commands.data() + offset);
+	CaptureCommandHeader header;
+	header.Command = static_cast<UINT16>(command);
+	header.Reserved = 0;
+	header.Size = static_cast<UINT32>(payloadSize);
+	writer.Write(header);
+	return writer;
+}
+
+UINT32 CapturingCommandList::GetObjectId(const void* object, CaptureObjectType type)
+{
+	if (!object)
+	{
+		return 0;
+	}
+
+	auto it = m_ObjectIds.find(object);
+	if (it != m_ObjectIds.end())
+	{
+		return it->second;
+	}
+
+	UINT32 id = m_Capture.RegisterObject(object, type);
+	m_ObjectIds.emplace(object, id);
+	return id;
+}
+
+void CapturingCommandList::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	BeginCommand(CaptureCommand::SetGraphicsRootSignature, sizeof(UINT32)).Write(GetObjectId(rootSignature, CaptureObjectType::RootSignature));
+	if (m_CommandList)
+	{
+		m_CommandList->SetGraphicsRootSignature(rootSignature);
+	}
+}
+
+void CapturingCommandList::SetComputeRootSignature(ID3D12RootSignature* rootSignature)
+{
+	BeginCommand(CaptureCommand::SetComputeRootSignature, sizeof(UINT32)).Write(GetObjectId(rootSignature, CaptureObjectType::RootSignature));
+	if (m_CommandList)
+	{
+		m_CommandList->SetComputeRootSignature(rootSignature);
+	}
+}
+
+void CapturingCommandList::SetPipelineState(ID3D12PipelineState* pipelineState)
+{
+	BeginCommand(CaptureCommand::SetPipelineState, sizeof(UINT32)).Write(GetObjectId(pipelineState, CaptureObjectType::PipelineState));
+	if (m_CommandList)
+	{
+		m_CommandList->SetPipelineState(pipelineState);
+	}
+}
+
+void CapturingCommandList::SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps)
+{
+	Writer writer = BeginCommand(CaptureCommand::SetDescriptorHeaps, (1 + numDescriptorHeaps) * sizeof(UINT32));
+	writer.Write(UINT32(numDescriptorHeaps));
+	for (UINT i = 0; i < numDescriptorHeaps; ++i)
+	{
+		writer.Write(GetObjectId(descriptorHeaps[i], CaptureObjectType::DescriptorHeap));
+	}
+
+	if (m_CommandList)
+	{
+		m_CommandList->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
+	}
+}
+
+void CapturingCommandList::WriteRootArgument(CaptureCommand command, UINT rootParameterIndex, UINT64 value)
+{
+	Writer writer = BeginCommand(command, sizeof(UINT32) + sizeof(UINT64));
+	writer.Write(UINT32(rootParameterIndex));
+	writer.Write(value);
+}
+
+void CapturingCommandList::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	WriteRootArgument(CaptureCommand::SetGraphicsRootDescriptorTable, rootParameterIndex, baseDescriptor.ptr);
+	if (m_CommandList)
+	{
+		m_CommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+	}
+}
+
+void CapturingCommandList::SetComputeRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	WriteRootArgument(CaptureCommand::SetComputeRootDescriptorTable, rootParameterIndex, baseDescriptor.ptr);
+	if (m_CommandList)
+	{
+		m_CommandList->SetComputeRootDescriptorTable(rootParameterIndex, baseDescriptor);
+	}
+}
+
+void CapturingCommandList::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	WriteRootArgument(CaptureCommand::SetGraphicsRootConstantBufferView, rootParameterIndex, bufferLocation);
+	if (m_CommandList)
+	{
+		m_CommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void CapturingCommandList::SetComputeRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	WriteRootArgument(CaptureCommand::SetComputeRootConstantBufferView, rootParameterIndex, bufferLocation);
+	if (m_CommandList)
+	{
+		m_CommandList->SetComputeRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void CapturingCommandList::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	WriteRootArgument(CaptureCommand::SetGraphicsRootShaderResourceView, rootParameterIndex, bufferLocation);
+	if (m_CommandList)
+	{
+		m_CommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void CapturingCommandList::SetComputeRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	WriteRootArgument(CaptureCommand::SetComputeRootShaderResourceView, rootParameterIndex, bufferLocation);
+	if (m_CommandList)
+	{
+		m_CommandList->SetComputeRootShaderResourceView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void CapturingCommandList::SetGraphicsRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	WriteRootArgument(CaptureCommand::SetGraphicsRootUnorderedAccessView, rootParameterIndex, bufferLocation);
+	if (m_CommandList)
+	{
+		m_CommandList->SetGraphicsRootUnorderedAccessView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void CapturingCommandList::SetComputeRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	WriteRootArgument(CaptureCommand::SetComputeRootUnorderedAccessView, rootParameterIndex, bufferLocation);
+	if (m_CommandList)
+	{
+		m_CommandList->SetComputeRootUnorderedAccessView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void CapturingCommandList::SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues)
+{
+	Writer writer = BeginCommand(CaptureCommand::SetGraphicsRoot32BitConstants, (3 + num32BitValuesToSet) * sizeof(UINT32));
+	writer.Write(UINT32(rootParameterIndex));
+	writer.Write(UINT32(num32BitValuesToSet));
+	writer.Write(UINT32(destOffsetIn32BitValues));
+	writer.WriteBytes(srcData, num32BitValuesToSet * sizeof(UINT32));
+
+	if (m_CommandList)
+	{
+		m_CommandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValuesToSet, srcData, destOffsetIn32BitValues);
+	}
+}
+
+void CapturingCommandList::SetComputeRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues)
+{
+	Writer writer = BeginCommand(CaptureCommand::SetComputeRoot32BitConstants, (3 + num32BitValuesToSet) * sizeof(UINT32));
+	writer.Write(UINT32(rootParameterIndex));
+	writer.Write(UINT32(num32BitValuesToSet));
+	writer.Write(UINT32(destOffsetIn32BitValues));
+	writer.WriteBytes(srcData, num32BitValuesToSet * sizeof(UINT32));
+
+	if (m_CommandList)
+	{
+		m_CommandList->SetComputeRoot32BitConstants(rootParameterIndex, num32BitValuesToSet, srcData, destOffsetIn32BitValues);
+	}
+}
+
+void CapturingCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology)
+{
+	BeginCommand(CaptureCommand::IASetPrimitiveTopology, sizeof(UINT32)).Write(UINT32(primitiveTopology));
+	if (m_CommandList)
+	{
+		m_CommandList->IASetPrimitiveTopology(primitiveTopology);
+	}
+}
+
+void CapturingCommandList::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	// Null views unbind the slots.
+	UINT32 hasViews = views ? 1 : 0;
+	Writer writer = BeginCommand(CaptureCommand::IASetVertexBuffers, 3 * sizeof(UINT32) + hasViews * numViews * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+	writer.Write(UINT32(startSlot));
+	writer.Write(UINT32(numViews));
+	writer.Write(hasViews);
+	writer.WriteBytes(views, hasViews * numViews * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+
+	if (m_CommandList)
+	{
+		m_CommandList->IASetVertexBuffers(startSlot, numViews, views);
+	}
+}
+
+void CapturingCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+	UINT32 hasView = view ? 1 : 0;
+	Writer writer = BeginCommand(CaptureCommand::IASetIndexBuffer, sizeof(UINT32) + hasView * sizeof(D3D12_INDEX_BUFFER_VIEW));
+	writer.Write(hasView);
+	writer.WriteBytes(view, hasView * sizeof(D3D12_INDEX_BUFFER_VIEW));
+
+	if (m_CommandList)
+	{
+		m_CommandList->IASetIndexBuffer(view);
+	}
+}
+
+void CapturingCommandList::RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports)
+{
+	Writer writer = BeginCommand(CaptureCommand::RSSetViewports, sizeof(UINT32) + numViewports * sizeof(D3D12_VIEWPORT));
+	writer.Write(UINT32(numViewports));
+	writer.WriteBytes(viewports, numViewports * sizeof(D3D12_VIEWPORT));
+
+	if (m_CommandList)
+	{
+		m_CommandList->RSSetViewports(numViewports, viewports);
+	}
+}
+
+void CapturingCommandList::RSSetScissorRects(UINT numRects, const D3D12_RECT* rects)
+{
+	Writer writer = BeginCommand(CaptureCommand::RSSetScissorRects, sizeof(UINT32) + numRects * sizeof(D3D12_RECT));
+	writer.Write(UINT32(numRects));
+	writer.WriteBytes(rects, numRects * sizeof(D3D12_RECT));
+
+	if (m_CommandList)
+	{
+		m_CommandList->RSSetScissorRects(numRects, rects);
+	}
+}
+
+void CapturingCommandList::OMSetRenderTargets(
+	UINT numRenderTargetDescriptors,
+	const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetDescriptors,
+	BOOL rtsSingleHandleToDescriptorRange,
+	const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilDescriptor)
+{
+	// A single handle to a range stores only the first handle.
+	UINT handleCount = renderTargetDescriptors ? (rtsSingleHandleToDescriptorRange ? (numRenderTargetDescriptors ? 1 : 0) : numRenderTargetDescriptors) : 0;
+	UINT32 hasDepthStencil = depthStencilDescriptor ? 1 : 0;
+
+	Writer writer = BeginCommand(CaptureCommand::OMSetRenderTargets, 4 * sizeof(UINT32) + (handleCount + hasDepthStencil) * sizeof(UINT64));
+	writer.Write(UINT32(numRenderTargetDescriptors));
+	writer.Write(UINT32(rtsSingleHandleToDescriptorRange ? 1 : 0));
+	writer.Write(UINT32(handleCount));
+	writer.Write(hasDepthStencil);
+	for (UINT i = 0; i < handleCount; ++i)
+	{
+		writer.Write(UINT64(renderTargetDescriptors[i].ptr));
+	}
+	if (depthStencilDescriptor)
+	{
+		writer.Write(UINT64(depthStencilDescriptor->ptr));
+	}
+
+	if (m_CommandList)
+	{
+		m_CommandList->OMSetRenderTargets(numRenderTargetDescriptors, renderTargetDescriptors, rtsSingleHandleToDescriptorRange, depthStencilDescriptor);
+	}
+}
+
+void CapturingCommandList::OMSetBlendFactor(const FLOAT blendFactor[4])
+{
+	// Null resets the factor to all ones.
+	UINT32 hasFactor = blendFactor ? 1 : 0;
+	Writer writer = BeginCommand(CaptureCommand::OMSetBlendFactor, sizeof(UINT32) + hasFactor * 4 * sizeof(FLOAT));
+	writer.Write(hasFactor);
+	writer.WriteBytes(blendFactor, hasFactor * 4 * sizeof(FLOAT));
+
+	if (m_CommandList)
+	{
+		m_CommandList->OMSetBlendFactor(blendFactor);
+	}
+}
+
+void CapturingCommandList::OMSetStencilRef(UINT stencilRef)
+{
+	BeginCommand(CaptureCommand::OMSetStencilRef, sizeof(UINT32)).Write(UINT32(stencilRef));
+	if (m_CommandList)
+	{
+		m_CommandList->OMSetStencilRef(stencilRef);
+	}
+}
+
+void CapturingCommandList::DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation)
+{
+	Writer writer = BeginCommand(CaptureCommand::DrawInstanced, 4 * sizeof(UINT32));
+	writer.Write(UINT32(vertexCountPerInstance));
+	writer.Write(UINT32(instanceCount));
+	writer.Write(UINT32(startVertexLocation));
+	writer.Write(UINT32(startInstanceLocation));
+
+	if (m_CommandList)
+	{
+		m_CommandList->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
+	}
+}
+
+void CapturingCommandList::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+	Writer writer = BeginCommand(CaptureCommand::DrawIndexedInstanced, 5 * sizeof(UINT32));
+	writer.Write(UINT32(indexCountPerInstance));
+	writer.Write(UINT32(instanceCount));
+	writer.Write(UINT32(startIndexLocation));
+	writer.Write(INT32(baseVertexLocation));
+	writer.Write(UINT32(startInstanceLocation));
+
+	if (m_CommandList)
+	{
+		m_CommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+	}
+}
+
+void CapturingCommandList::Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ)
+{
+	Writer writer = BeginCommand(CaptureCommand::Dispatch, 3 * sizeof(UINT32));
+	writer.Write(UINT32(threadGroupCountX));
+	writer.Write(UINT32(threadGroupCountY));
+	writer.Write(UINT32(threadGroupCountZ));
+
+	if (m_CommandList)
+	{
+		m_CommandList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+	}
+}
+
+void CapturingCommandList::ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+	Writer writer = BeginCommand(CaptureCommand::ResourceBarrier, sizeof(UINT32) + numBarriers * BarrierSize);
+	writer.Write(UINT32(numBarriers));
+	for (UINT i = 0; i < numBarriers; ++i)
+	{
+		const D3D12_RESOURCE_BARRIER& barrier = barriers[i];
+		UINT32 resource = 0;
+		UINT32 resourceAfter = 0;
+		UINT32 subresource = 0;
+		UINT32 stateBefore = 0;
+		UINT32 stateAfter = 0;
+		switch (barrier.Type)
+		{
+		case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+			resource = GetObjectId(barrier.Transition.pResource, CaptureObjectType::Resource);
+			subresource = barrier.Transition.Subresource;
+			stateBefore = barrier.Transition.StateBefore;
+			stateAfter = barrier.Transition.StateAfter;
+			break;
+		case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+			resource = GetObjectId(barrier.Aliasing.pResourceBefore, CaptureObjectType::Resource);
+			resourceAfter = GetObjectId(barrier.Aliasing.pResourceAfter, CaptureObjectType::Resource);
+			break;
+		case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+			resource = GetObjectId(barrier.UAV.pResource, CaptureObjectType::Resource);
+			break;
+		}
+
+		writer.Write(UINT32(barrier.Type));
+		writer.Write(UINT32(barrier.Flags));
+		writer.Write(resource);
+		writer.Write(resourceAfter);
+		writer.Write(subresource);
+		writer.Write(stateBefore);
+		writer.Write(stateAfter);
+	}
+
+	if (m_CommandList)
+	{
+		m_CommandList->ResourceBarrier(numBarriers, barriers);
+	}
+}
+
+void CapturingCommandList::CopyBufferRegion(ID3D12Resource* dstBuffer, UINT64 dstOffset, ID3D12Resource* srcBuffer, UINT64 srcOffset, UINT64 numBytes)
+{
+	Writer writer = BeginCommand(CaptureCommand::CopyBufferRegion, 2 * sizeof(UINT32) + 3 * sizeof(UINT64));
+	writer.Write(GetObjectId(dstBuffer, CaptureObjectType::Resource));
+	writer.Write(UINT64(dstOffset));
+	writer.Write(GetObjectId(srcBuffer, CaptureObjectType::Resource));
+	writer.Write(UINT64(srcOffset));
+	writer.Write(UINT64(numBytes));
+
+	if (m_CommandList)
+	{
+		m_CommandList->CopyBufferRegion(dstBuffer, dstOffset, srcBuffer, srcOffset, numBytes);
+	}
+}
+
+void CapturingCommandList::CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT dstX, UINT dstY, UINT dstZ, const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* srcBox)
+{
+	UINT32 hasBox = srcBox ? 1 : 0;
+	Writer writer = BeginCommand(CaptureCommand::CopyTextureRegion, 2 * CopyLocationSize + 4 * sizeof(UINT32) + hasBox * sizeof(D3D12_BOX));
+
+	auto writeLocation = [this, &writer](const D3D12_TEXTURE_COPY_LOCATION& location)
+	{
+		bool footprint = location.Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		writer.Write(GetObjectId(location.pResource, CaptureObjectType::Resource));
+		writer.Write(UINT32(location.Type));
+		writer.Write(UINT32(footprint ? 0 : location.SubresourceIndex));
+		writer.Write(UINT64(footprint ? location.PlacedFootprint.Offset : 0));
+		writer.Write(UINT32(footprint ? location.PlacedFootprint.Footprint.Format : 0));
+		writer.Write(UINT32(footprint ? location.PlacedFootprint.Footprint.Width : 0));
+		writer.Write(UINT32(footprint ? location.PlacedFootprint.Footprint.Height : 0));
+		writer.Write(UINT32(footprint ? location.PlacedFootprint.Footprint.Depth : 0));
+		writer.Write(UINT32(footprint ? location.PlacedFootprint.Footprint.RowPitch : 0));
+	};
+
+	writeLocation(*dst);
+	writer.Write(UINT32(dstX));
+	writer.Write(UINT32(dstY));
+	writer.Write(UINT32(dstZ));
+	writeLocation(*src);
+	writer.Write(hasBox);
+	writer.WriteBytes(srcBox, hasBox * sizeof(D3D12_BOX));
+
+	if (m_CommandList)
+	{
+		m_CommandList->CopyTextureRegion(dst, dstX, dstY, dstZ, src, srcBox);
+	}
+}
+
+void CapturingCommandList::CopyResource(ID3D12Resource* dstResource, ID3D12Resource* srcResource)
+{
+	Writer writer = BeginCommand(CaptureCommand::CopyResource, 2 * sizeof(UINT32));
+	writer.Write(GetObjectId(dstResource, CaptureObjectType::Resource));
+	writer.Write(GetObjectId(srcResource, CaptureObjectType::Resource));
+
+	if (m_CommandList)
+	{
+		m_CommandList->CopyResource(dstResource, srcResource);
+	}
+}
+
+void CapturingCommandList::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT colorRGBA[4], UINT numRects, const D3D12_RECT* rects)
+{
+	Writer writer = BeginCommand(CaptureCommand::ClearRenderTargetView, sizeof(UINT64) + 4 * sizeof(FLOAT) + sizeof(UINT32) + numRects * sizeof(D3D12_RECT));
+	writer.Write(UINT64(renderTargetView.ptr));
+	writer.WriteBytes(colorRGBA, 4 * sizeof(FLOAT));
+	writer.Write(UINT32(numRects));
+	writer.WriteBytes(rects, numRects * sizeof(D3D12_RECT));
+
+	if (m_CommandList)
+	{
+		m_CommandList->ClearRenderTargetView(renderTargetView, colorRGBA, numRects, rects);
+	}
+}
+
+void CapturingCommandList::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS clearFlags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects)
+{
+	Writer writer = BeginCommand(CaptureCommand::ClearDepthStencilView, sizeof(UINT64) + 2 * sizeof(UINT32) + sizeof(FLOAT) + sizeof(UINT32) + numRects * sizeof(D3D12_RECT));
+	writer.Write(UINT64(depthStencilView.ptr));
+	writer.Write(UINT32(clearFlags));
+	writer.Write(FLOAT(depth));
+	writer.Write(UINT32(stencil));
+	writer.Write(UINT32(numRects));
+	writer.WriteBytes(rects, numRects * sizeof(D3D12_RECT));
+
+	if (m_CommandList)
+	{
+		m_CommandList->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil, numRects, rects);
+	}
+}
+
+void CapturingCommandList::ExecuteBundle(ID3D12GraphicsCommandList* bundle)
+{
+	BeginCommand(CaptureCommand::ExecuteBundle, sizeof(UINT32)).Write(GetObjectId(bundle, CaptureObjectType::CommandList));
+	if (m_CommandList)
+	{
+		m_CommandList->ExecuteBundle(bundle);
+	}
+}
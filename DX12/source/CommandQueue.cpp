@@ -0,0 +1,170 @@
+#include "../include/CommandQueue.h"
+#include "../include/d3dx12.h"
+#include "../include/helpers.h"
+
+using Microsoft::WRL::ComPtr;
+
+CommandQueue::CommandQueue(ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type, std::shared_ptr<Fence> fence)
+	: m_Device(device)
+	, m_Type(type)
+	, m_Fence(fence)
+	, m_AllocatorsCreated(0)
+	, m_AllocatorsRecycled(0)
+	, m_ListsCreated(0)
+	, m_ListsRecycled(0)
+	, m_Submissions(0)
+{
+	D3D12_COMMAND_QUEUE_DESC desc = {};
+	desc.Type = type;
+	desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+	desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	desc.NodeMask = 0;
+	ThrowIfFailed(m_Device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_CommandQueue)));
+
+	if (!m_Fence)
+	{
+		m_Fence = std::make_shared<D3D12Fence>(m_Device);
+	}
+}
+
+CommandQueue::~CommandQueue()
+{
+	Flush();
+}
+
+ComPtr<ID3D12CommandAllocator> CommandQueue::AcquireAllocator()
+{
+	ComPtr<ID3D12CommandAllocator> allocator;
+	if (m_Allocators.TryAcquire(m_Fence->GetCompletedValue(), allocator))
+	{
+		ThrowIfFailed(allocator->Reset());
+		++m_AllocatorsRecycled;
+		return allocator;
+	}
+
+	ThrowIfFailed(m_Device->CreateCommandAllocator(m_Type, IID_PPV_ARGS(&allocator)));
+	++m_AllocatorsCreated;
+	return allocator;
+}
+
+ComPtr<ID3D12GraphicsCommandList> CommandQueue::GetCommandList()
+{
+	ComPtr<ID3D12CommandAllocator> allocator = AcquireAllocator();
+
+	ComPtr<ID3D12GraphicsCommandList> commandList;
+	{
+		std::lock_guard<std::mutex> lock(m_ListMutex);
+		if (!m_Lists.empty())
+		{
+			commandList = std::move(m_Lists.back());
+			m_Lists.pop_back();
+		}
+	}
+
+	if (commandList)
+	{
+		ThrowIfFailed(commandList->Reset(allocator.Get(), nullptr));
+		++m_ListsRecycled;
+	}
+	else
+	{
+		ThrowIfFailed(m_Device->CreateCommandList(0, m_Type, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+		++m_ListsCreated;
+	}
+
+	// The list keeps a reference to its allocator until it is submitted.
+	ThrowIfFailed(commandList->SetPrivateDataInterface(__uuidof(ID3D12CommandAllocator), allocator.Get()));
+
+	return commandList;
+}
+
+UINT64 CommandQueue::ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList> commandList)
+{
+	return ExecuteCommandLists({ commandList });
+}
+
+UINT64 CommandQueue::ExecuteCommandLists(const std::vector<ComPtr<ID3D12GraphicsCommandList>>& commandLists)
+{
+	for (const ComPtr<ID3D12GraphicsCommandList>& commandList : commandLists)
+	{
+		ThrowIfFailed(commandList->Close());
+	}
+	return ExecuteClosedCommandLists(commandLists);
+}
+
+UINT64 CommandQueue::ExecuteClosedCommandLists(const std::vector<ComPtr<ID3D12GraphicsCommandList>>& commandLists)
+{
+	std::vector<ID3D12GraphicsCommandList*> lists;
+	std::vector<ComPtr<ID3D12CommandAllocator>> allocators;
+	lists.reserve(commandLists.size());
+	allocators.reserve(commandLists.size());
+
+	for (const ComPtr<ID3D12GraphicsCommandList>& commandList : commandLists)
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		UINT dataSize = sizeof(ID3D12CommandAllocator*);
+		ThrowIfFailed(commandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, allocator.GetAddressOf()));
+		ThrowIfFailed(commandList->SetPrivateDataInterface(__uuidof(ID3D12CommandAllocator), nullptr));
+
+		lists.push_back(commandList.Get());
+		allocators.push_back(std::move(allocator));
+	}
+
+	UINT64 fenceValue;
+	{
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		m_CommandQueue->ExecuteCommandLists(static_cast<UINT>(lists.size()), CommandListCast(lists.data()));
+		fenceValue = m_Fence->Signal(m_CommandQueue.Get());
+
+		for (ComPtr<ID3D12CommandAllocator>& allocator : allocators)
+		{
+			m_Allocators.Release(std::move(allocator), fenceValue);
+		}
+	}
+	++m_Submissions;
+
+	{
+		std::lock_guard<std::mutex> lock(m_ListMutex);
+		m_Lists.insert(m_Lists.end(), commandLists.begin(), commandLists.end());
+	}
+
+	return fenceValue;
+}
+
+void CommandQueue::Wait(Fence& fence, UINT64 fenceValue)
+{
+	std::lock_guard<std::mutex> lock(m_SubmitMutex);
+	fence.QueueWait(m_CommandQueue.Get(), fenceValue);
+}
+
+UINT64 CommandQueue::Signal()
+{
+	std::lock_guard<std::mutex> lock(m_SubmitMutex);
+	return m_Fence->Signal(m_CommandQueue.Get());
+}
+
+bool CommandQueue::IsFenceComplete(UINT64 fenceValue) const
+{
+	return m_Fence->IsComplete(fenceValue);
+}
+
+void CommandQueue::WaitForFenceValue(UINT64 fenceValue)
+{
+	m_Fence->Wait(fenceValue);
+}
+
+void CommandQueue::Flush()
+{
+	WaitForFenceValue(Signal());
+}
+
+CommandQueue::Stats CommandQueue::GetStats() const
+{
+	Stats stats;
+	stats.AllocatorsCreated = m_AllocatorsCreated;
+	stats.AllocatorsRecycled = m_AllocatorsRecycled;
+	stats.ListsCreated = m_ListsCreated;
+	stats.ListsRecycled = m_ListsRecycled;
+	stats.Submissions = m_Submissions;
+	return stats;
+}
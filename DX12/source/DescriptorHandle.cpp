@@ -0,0 +1,19 @@
+#include "../include/DescriptorHandle.h"
+
+UINT DescriptorIncrementTable::s_IncrementSizes[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES] = {};
+bool DescriptorIncrementTable::s_Initialized = false;
+
+void DescriptorIncrementTable::Initialize(ID3D12Device* device)
+{
+	for (UINT i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+	{
+		UINT size = device->GetDescriptorHandleIncrementSize(static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(i));
+
+		// Increment sizes are per adapter. All devices we create must agree.
+		assert(!s_Initialized || s_IncrementSizes[i] == size);
+
+		s_IncrementSizes[i] = size;
+	}
+
+	s_Initialized = true;
+}
@@ -0,0 +1,361 @@
+#include "../include/DrawSort.h"
+#include "../include/JobSystem.h"
+#include "../include/ShadowedCommandList.h"
+#include "../include/d3dx12.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+	const size_t RadixBuckets = 256;
+	const size_t RadixPasses = 8;
+
+	// Below this many items per block, spreading a pass over jobs costs more
+	// than it saves.
+	const size_t MinItemsPerBlock = 16384;
+
+	template <typename Function>
+	void ForEachBlock(JobSystem* jobs, size_t blockCount, const Function& function)
+	{
+		if (jobs && blockCount > 1)
+		{
+			jobs->Wait(jobs->ParallelFor(0, blockCount, 1, [&function](size_t begin, size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					function(block);
+				}
+			}));
+			return;
+		}
+
+		for (size_t block = 0; block < blockCount; ++block)
+		{
+			function(block);
+		}
+	}
+}
+
+DrawSortKeyFormat::DrawSortKeyFormat(std::initializer_list<Field> fields, bool depthDescending)
+	: m_Bits()
+	, m_Shifts()
+	, m_DepthDescending(depthDescending)
+{
+	uint32_t shift = 64;
+	for (const Field& field : fields)
+	{
+		assert(field.Bits <= 32 && field.Bits <= shift && "Sort key fields must fit in 64 bits.");
+		shift -= field.Bits;
+		m_Bits[static_cast<size_t>(field.Which)] = field.Bits;
+		m_Shifts[static_cast<size_t>(field.Which)] = shift;
+	}
+}
+
+DrawSortKeyFormat DrawSortKeyFormat::Opaque()
+{
+	return DrawSortKeyFormat({
+		{ DrawSortField::Layer, 4 },
+		{ DrawSortField::Pipeline, 16 },
+		{ DrawSortField::Material, 20 },
+		{ DrawSortField::Depth, 24 } });
+}
+
+DrawSortKeyFormat DrawSortKeyFormat::Transparent()
+{
+	return DrawSortKeyFormat({
+		{ DrawSortField::Layer, 4 },
+		{ DrawSortField::Depth, 24 },
+		{ DrawSortField::Pipeline, 16 },
+		{ DrawSortField::Material, 20 } }, true);
+}
+
+uint64_t DrawSortKeyFormat::Encode(uint32_t layer, uint32_t pipeline, uint32_t material, float depth) const
+{
+	auto pack = [this](DrawSortField field, uint32_t value) -> uint64_t
+	{
+		uint32_t bits = m_Bits[static_cast<size_t>(field)];
+		if (bits == 0)
+		{
+			return 0;
+		}
+		uint64_t mask = (uint64_t(1) << bits) - 1;
+		return (value & mask) << m_Shifts[static_cast<size_t>(field)];
+	};
+
+	// Non-negative floats order the same as their bit patterns. Negative
+	// depths and NaN count as zero, the nearest depth, so they sort first
+	// when depth ascends and last when it descends.
+	uint32_t depthBits = 0;
+	if (depth > 0.0f)
+	{
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+	}
+	uint32_t bits = m_Bits[static_cast<size_t>(DrawSortField::Depth)];
+	uint32_t quantizedDepth = bits != 0 ? depthBits >> (32 - bits) : 0;
+	if (m_DepthDescending)
+	{
+		quantizedDepth = ~quantizedDepth;
+	}
+
+	return pack(DrawSortField::Layer, layer) |
+		pack(DrawSortField::Pipeline, pipeline) |
+		pack(DrawSortField::Material, material) |
+		pack(DrawSortField::Depth, quantizedDepth);
+}
+
+uint32_t DrawSortKeyFormat::Decode(uint64_t key, DrawSortField field) const
+{
+	uint32_t bits = m_Bits[static_cast<size_t>(field)];
+	if (bits == 0)
+	{
+		return 0;
+	}
+	uint64_t mask = (uint64_t(1) << bits) - 1;
+	return static_cast<uint32_t>((key >> m_Shifts[static_cast<size_t>(field)]) & mask);
+}
+
+void RadixSortDrawItems(std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch, JobSystem* jobs)
+{
+	size_t count = items.size();
+	if (count < 2)
+	{
+		return;
+	}
+	scratch.resize(count);
+
+	// A few blocks per thread so that a slow worker does not hold up the pass.
+	size_t threadCount = jobs ? jobs->GetWorkerCount() + 1 : 1;
+	size_t blockCount = (std::min)((std::max)(count / MinItemsPerBlock, size_t(1)), threadCount * 4);
+	size_t blockSize = (count + blockCount - 1) / blockCount;
+	blockCount = (count + blockSize - 1) / blockSize;
+
+	// Bits that differ from the first key anywhere. A pass over a digit where
+	// they are all zero would not move anything.
+	std::vector<uint64_t> blockDifferences(blockCount);
+	uint64_t firstKey = items[0].Key;
+	ForEachBlock(jobs, blockCount, [&](size_t block)
+	{
+		size_t begin = block * blockSize;
+		size_t end = (std::min)(begin + blockSize, count);
+		uint64_t difference = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			difference |= items[i].Key ^ firstKey;
+		}
+		blockDifferences[block] = difference;
+	});
+
+	uint64_t difference = 0;
+	for (uint64_t blockDifference : blockDifferences)
+	{
+		difference |= blockDifference;
+	}
+
+	std::vector<size_t> offsets(blockCount * RadixBuckets);
+	DrawSortItem* source = items.data();
+	DrawSortItem* destination = scratch.data();
+	bool sortedIntoScratch = false;
+
+	for (size_t pass = 0; pass < RadixPasses; ++pass)
+	{
+		uint32_t shift = static_cast<uint32_t>(pass * 8);
+		if (((difference >> shift) & 0xff) == 0)
+		{
+			continue;
+		}
+
+		ForEachBlock(jobs, blockCount, [&](size_t block)
+		{
+			size_t* histogram = &offsets[block * RadixBuckets];
+			std::fill(histogram, histogram + RadixBuckets, size_t(0));
+
+			size_t begin = block * blockSize;
+			size_t end = (std::min)(begin + blockSize, count);
+			for (size_t i = begin; i < end; ++i)
+			{
+				++histogram[(source[i].Key >> shift) & 0xff];
+			}
+		});
+
+		// Bucket by bucket, and block by block within a bucket, so items from
+		// earlier blocks land first. That is what keeps the sort stable.
+		size_t offset = 0;
+		for (size_t digit = 0; digit < RadixBuckets; ++digit)
+		{
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				size_t bucketCount = offsets[block * RadixBuckets + digit];
+				offsets[block * RadixBuckets + digit] = offset;
+				offset += bucketCount;
+			}
+		}
+
+		ForEachBlock(jobs, blockCount, [&](size_t block)
+		{
+			size_t* blockOffsets = &offsets[block * RadixBuckets];
+			size_t begin = block * blockSize;
+			size_t end = (std::min)(begin + blockSize, count);
+			for (size_t i = begin; i < end; ++i)
+			{
+				destination[blockOffsets[(source[i].Key >> shift) & 0xff]++] = source[i];
+			}
+		});
+
+		std::swap(source, destination);
+		sortedIntoScratch = !sortedIntoScratch;
+	}
+
+	if (sortedIntoScratch)
+	{
+		items.swap(scratch);
+	}
+}
+
+DrawSubmitter::DrawSubmitter(const RootParameters& rootParameters)
+	: m_RootParameters(rootParameters)
+{}
+
+void DrawSubmitter::Submit(ShadowedCommandList& commandList, const std::vector<DrawPacket>& packets,
+	const std::vector<DrawSortItem>& order, size_t begin, size_t end) const
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		const DrawPacket& packet = packets[order[i].Packet];
+		commandList.SetGraphicsRootSignature(packet.RootSignature);
+		commandList.SetPipelineState(packet.PipelineState);
+		commandList.SetGraphicsRootDescriptorTable(m_RootParameters.MaterialTable, packet.MaterialTable);
+		commandList.SetGraphicsRootConstantBufferView(m_RootParameters.ObjectConstants, packet.ObjectConstants);
+		commandList.IASetVertexBuffers(0, 1, &packet.VertexBuffer);
+		commandList.IASetIndexBuffer(&packet.IndexBuffer);
+		commandList.DrawIndexedInstanced(packet.IndexCount, packet.InstanceCount, packet.StartIndex, packet.BaseVertex, 0);
+	}
+}
+
+DrawStateChanges DrawSubmitter::CountStateChanges(const std::vector<DrawPacket>& packets, const std::vector<DrawSortItem>& order)
+{
+	DrawStateChanges changes;
+	const DrawPacket* previous = nullptr;
+	for (const DrawSortItem& item : order)
+	{
+		const DrawPacket& packet = packets[item.Packet];
+
+		// Setting a root signature invalidates the root arguments bound under it.
+		bool rootSignatureChanged = !previous || packet.RootSignature != previous->RootSignature;
+		changes.RootSignatures += rootSignatureChanged;
+		changes.PipelineStates += !previous || packet.PipelineState != previous->PipelineState;
+		changes.Materials += rootSignatureChanged || packet.MaterialTable.ptr != previous->MaterialTable.ptr;
+		changes.VertexBuffers += !previous || !(packet.VertexBuffer == previous->VertexBuffer);
+		changes.IndexBuffers += !previous || !(packet.IndexBuffer == previous->IndexBuffer);
+		previous = &packet;
+	}
+	return changes;
+}
+
+void DrawSubmitter::CreateBenchmarkPackets(size_t packetCount, std::vector<DrawPacket>& packets, std::vector<DrawSortItem>& unsorted)
+{
+	const uint32_t PipelineCount = 256;
+	const uint32_t RootSignatureCount = 4;
+	const uint32_t MaterialCount = 4096;
+	const uint32_t MeshCount = 2048;
+
+	// The objects are never dereferenced, only compared, so made-up
+	// addresses stand in for them.
+	std::mt19937 random(1234);
+	packets.resize(packetCount);
+	unsorted.resize(packetCount);
+	DrawSortKeyFormat format = DrawSortKeyFormat::Opaque();
+	for (size_t i = 0; i < packetCount; ++i)
+	{
+		uint32_t material = random() % MaterialCount;
+		uint32_t pipeline = material % PipelineCount;
+		uint32_t mesh = random() % MeshCount;
+		uint32_t layer = random() % 16 == 0 ? 1 : 0;
+		float depth = 1.0f + (random() % 100000) * 0.01f;
+
+		DrawPacket& packet = packets[i];
+		packet.RootSignature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(pipeline % RootSignatureCount + 1) * 64);
+		packet.PipelineState = reinterpret_cast<ID3D12PipelineState*>(uintptr_t(pipeline + 1) * 64);
+		packet.MaterialTable.ptr = UINT64(material) * 32;
+		packet.ObjectConstants = UINT64(i) * 256;
+		packet.VertexBuffer = { UINT64(mesh) << 20, 1 << 20, 32 };
+		packet.IndexBuffer = { (UINT64(mesh) << 20) + (1 << 19), 1 << 19, DXGI_FORMAT_R32_UINT };
+		packet.IndexCount = 36;
+		packet.InstanceCount = 1;
+		packet.StartIndex = 0;
+		packet.BaseVertex = 0;
+
+		unsorted[i].Key = format.Encode(layer, pipeline, material, depth);
+		unsorted[i].Packet = i;
+	}
+}
+
+DrawSubmitter::Benchmark DrawSubmitter::RunBenchmark(size_t packetCount, uint32_t maxThreadCount, uint32_t iterationCount)
+{
+	if (maxThreadCount == 0)
+	{
+		maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<DrawPacket> packets;
+	std::vector<DrawSortItem> unsorted;
+	CreateBenchmarkPackets(packetCount, packets, unsorted);
+
+	Benchmark benchmark;
+	benchmark.PacketCount = packetCount;
+	benchmark.Unsorted = CountStateChanges(packets, unsorted);
+
+	std::vector<DrawSortItem> items;
+	double stdSortMilliseconds = 0.0;
+	for (uint32_t iteration = 0; iteration < iterationCount; ++iteration)
+	{
+		items = unsorted;
+		auto start = std::chrono::high_resolution_clock::now();
+		std::stable_sort(items.begin(), items.end(), [](const DrawSortItem& l, const DrawSortItem& r) { return l.Key < r.Key; });
+		auto end = std::chrono::high_resolution_clock::now();
+		stdSortMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	benchmark.StdSortMilliseconds = stdSortMilliseconds / iterationCount;
+
+	std::vector<DrawSortItem> scratch;
+	for (uint32_t threads = 1; ; threads = (std::min)(threads * 2, maxThreadCount))
+	{
+		JobSystem::Options options;
+		options.ThreadCount = threads - 1;
+		JobSystem jobs(options);
+
+		// Warm the job arenas and size the scratch buffer.
+		items = unsorted;
+		RadixSortDrawItems(items, scratch, &jobs);
+		jobs.EndFrame();
+
+		double totalMilliseconds = 0.0;
+		for (uint32_t iteration = 0; iteration < iterationCount; ++iteration)
+		{
+			items = unsorted;
+			auto start = std::chrono::high_resolution_clock::now();
+			RadixSortDrawItems(items, scratch, &jobs);
+			auto end = std::chrono::high_resolution_clock::now();
+			totalMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+			jobs.EndFrame();
+		}
+
+		BenchmarkResult result;
+		result.ThreadCount = threads;
+		result.SortMilliseconds = totalMilliseconds / iterationCount;
+		result.Speedup = benchmark.RadixSort.empty() ? 1.0 : benchmark.RadixSort.front().SortMilliseconds / result.SortMilliseconds;
+		benchmark.RadixSort.push_back(result);
+
+		if (threads == maxThreadCount)
+		{
+			break;
+		}
+	}
+
+	benchmark.Sorted = CountStateChanges(packets, items);
+	return benchmark;
+}
@@ -0,0 +1,108 @@
+#include "../include/Fence.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	DWORD ToWaitMilliseconds(std::chrono::milliseconds timeout)
+	{
+		if (timeout == std::chrono::milliseconds::max() || timeout.count() >= INFINITE)
+		{
+			return INFINITE;
+		}
+		return static_cast<DWORD>((std::max)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(0)));
+	}
+}
+
+D3D12Fence::D3D12Fence(ComPtr<ID3D12Device> device, UINT64 initialValue)
+	: m_LastSignaled(initialValue)
+{
+	ThrowIfFailed(device->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence)));
+}
+
+D3D12Fence::~D3D12Fence() = default;
+
+UINT64 D3D12Fence::Signal(ID3D12CommandQueue* queue)
+{
+	std::lock_guard<std::mutex> lock(m_SignalMutex);
+	UINT64 value = m_LastSignaled + 1;
+	ThrowIfFailed(queue->Signal(m_Fence.Get(), value));
+	m_LastSignaled = value;
+	return value;
+}
+
+UINT64 D3D12Fence::GetCompletedValue() const
+{
+	return m_Fence->GetCompletedValue();
+}
+
+bool D3D12Fence::Wait(UINT64 value, std::chrono::milliseconds timeout)
+{
+	if (m_Fence->GetCompletedValue() >= value)
+	{
+		return true;
+	}
+
+	// One event per wait so several threads can wait on different values.
+	HANDLE event = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (!event)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(::GetLastError()));
+	}
+
+	HRESULT hr = m_Fence->SetEventOnCompletion(value, event);
+	DWORD result = SUCCEEDED(hr) ? ::WaitForSingleObject(event, ToWaitMilliseconds(timeout)) : WAIT_FAILED;
+	::CloseHandle(event);
+
+	ThrowIfFailed(hr);
+	return result == WAIT_OBJECT_0;
+}
+
+void D3D12Fence::QueueWait(ID3D12CommandQueue* queue, UINT64 value)
+{
+	ThrowIfFailed(queue->Wait(m_Fence.Get(), value));
+}
+
+SimulatedFence::SimulatedFence(UINT64 initialValue)
+	: m_LastSignaled(initialValue)
+	, m_Completed(initialValue)
+{}
+
+UINT64 SimulatedFence::Signal(ID3D12CommandQueue*)
+{
+	return ++m_LastSignaled;
+}
+
+bool SimulatedFence::Wait(UINT64 value, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	auto reached = [this, value] { return m_Completed >= value; };
+	if (timeout == std::chrono::milliseconds::max())
+	{
+		m_Completion.wait(lock, reached);
+		return true;
+	}
+	return m_Completion.wait_for(lock, timeout, reached);
+}
+
+void SimulatedFence::QueueWait(ID3D12CommandQueue*, UINT64 value)
+{
+	Wait(value);
+}
+
+void SimulatedFence::Complete(UINT64 value)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		value = (std::min)(value, m_LastSignaled.load());
+		if (value <= m_Completed)
+		{
+			return;
+		}
+		m_Completed = value;
+	}
+	m_Completion.notify_all();
+}
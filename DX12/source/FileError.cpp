@@ -0,0 +1,33 @@
+#include "../include/FileError.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+namespace
+{
+	std::string ToUtf8(const std::wstring& text)
+	{
+#if defined(_WIN32)
+		int size = WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+		std::string utf8(static_cast<size_t>(size), '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), &utf8[0], size, nullptr, nullptr);
+		return utf8;
+#else
+		// Elsewhere only the low byte of each character is kept.
+		std::string narrow(text.size(), '\0');
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			narrow[i] = static_cast<char>(text[i]);
+		}
+		return narrow;
+#endif
+	}
+}
+
+FileError::FileError(const char* operation, const std::wstring& path)
+	: std::runtime_error(std::string(operation) + " " + ToUtf8(path))
+	, m_Path(path)
+{
+}
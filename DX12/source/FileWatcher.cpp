@@ -0,0 +1,388 @@
+#include "../include/FileWatcher.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <unordered_map>
+
+namespace
+{
+	bool IsSeparator(wchar_t c)
+	{
+		return c == L'/' || c == L'\\';
+	}
+
+#if defined(__linux__)
+	std::wstring Widen(const char* text)
+	{
+		return std::wstring(text, text + strlen(text));
+	}
+
+	std::string Narrow(const std::wstring& text)
+	{
+		std::string narrow(text.size(), '\0');
+		std::transform(text.begin(), text.end(), narrow.begin(), [](wchar_t c) { return static_cast<char>(c); });
+		return narrow;
+	}
+#endif
+}
+
+std::wstring NormalizePath(const std::wstring& path)
+{
+	std::wstring normalized = path;
+	for (wchar_t& c : normalized)
+	{
+		if (c == L'\\')
+		{
+			c = L'/';
+		}
+#if defined(_WIN32)
+		c = static_cast<wchar_t>(std::towlower(c));
+#endif
+	}
+
+	// A drive, leading separators or both ("c:/", "/", "//server/") are kept
+	// as they are, and ".." never climbs above them.
+	size_t rootLength = 0;
+	if (normalized.size() >= 2 && normalized[1] == L':')
+	{
+		rootLength = 2;
+	}
+	while (rootLength < normalized.size() && normalized[rootLength] == L'/')
+	{
+		++rootLength;
+	}
+
+	std::vector<std::wstring> segments;
+	for (size_t begin = rootLength; begin < normalized.size();)
+	{
+		size_t end = (std::min)(normalized.find(L'/', begin), normalized.size());
+		std::wstring segment = normalized.substr(begin, end - begin);
+		if (segment == L"..")
+		{
+			if (!segments.empty() && segments.back() != L"..")
+			{
+				segments.pop_back();
+			}
+			else if (rootLength == 0)
+			{
+				segments.push_back(segment);
+			}
+		}
+		else if (!segment.empty() && segment != L".")
+		{
+			segments.push_back(segment);
+		}
+		begin = end + 1;
+	}
+
+	std::wstring result = normalized.substr(0, rootLength);
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		result += (i ? L"/" : L"") + segments[i];
+	}
+	if (!segments.empty() && !path.empty() && IsSeparator(path.back()))
+	{
+		result += L'/';
+	}
+	return result;
+}
+
+std::wstring GetPathDirectory(const std::wstring& path)
+{
+	auto separator = std::find_if(path.rbegin(), path.rend(), IsSeparator);
+	return std::wstring(path.begin(), separator.base());
+}
+
+#if defined(_WIN32)
+
+class SystemFileWatcher::Platform
+{
+public:
+	bool Watch(const std::wstring& directory)
+	{
+		if (m_Directories.count(directory))
+		{
+			return true;
+		}
+
+		std::unique_ptr<Directory> watched(new Directory(directory));
+		if (watched->Handle == INVALID_HANDLE_VALUE || !watched->Overlapped.hEvent || !watched->Read())
+		{
+			return false;
+		}
+		m_Directories.emplace(directory, std::move(watched));
+		return true;
+	}
+
+	void Poll(std::vector<std::wstring>& changed)
+	{
+		for (auto directory = m_Directories.begin(); directory != m_Directories.end();)
+		{
+			Directory& watched = *directory->second;
+			DWORD size = 0;
+			if (!GetOverlappedResult(watched.Handle, &watched.Overlapped, &size, FALSE))
+			{
+				if (GetLastError() == ERROR_IO_INCOMPLETE)
+				{
+					++directory;
+					continue;
+				}
+				// The directory is gone. Forget it so it can be watched again.
+				changed.push_back(watched.Path);
+				directory = m_Directories.erase(directory);
+				continue;
+			}
+
+			if (size == 0)
+			{
+				// The buffer overflowed and the events were dropped.
+				changed.push_back(watched.Path);
+			}
+			else
+			{
+				const BYTE* entry = reinterpret_cast<const BYTE*>(watched.Buffer.data());
+				for (;;)
+				{
+					const FILE_NOTIFY_INFORMATION& information = *reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+					if (information.Action == FILE_ACTION_ADDED || information.Action == FILE_ACTION_MODIFIED
+						|| information.Action == FILE_ACTION_RENAMED_NEW_NAME)
+					{
+						std::wstring name(information.FileName, information.FileNameLength / sizeof(WCHAR));
+						changed.push_back(NormalizePath(watched.Path + name));
+					}
+					if (information.NextEntryOffset == 0)
+					{
+						break;
+					}
+					entry += information.NextEntryOffset;
+				}
+			}
+
+			if (watched.Read())
+			{
+				++directory;
+			}
+			else
+			{
+				directory = m_Directories.erase(directory);
+			}
+		}
+	}
+
+private:
+	// A directory with a ReadDirectoryChangesW call always outstanding.
+	struct Directory
+	{
+		// Editors that save through a temporary file rename it over the
+		// original, so renames count as writes.
+		static const DWORD Filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_CREATION;
+
+		explicit Directory(const std::wstring& path)
+			: Path(path)
+			, Buffer(16 * 1024)
+			, Overlapped()
+		{
+			Handle = CreateFileW(path.empty() ? L"." : path.c_str(), FILE_LIST_DIRECTORY,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+				FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+			Overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		}
+
+		~Directory()
+		{
+			if (Reading)
+			{
+				DWORD size = 0;
+				CancelIoEx(Handle, &Overlapped);
+				GetOverlappedResult(Handle, &Overlapped, &size, TRUE);
+			}
+			if (Overlapped.hEvent)
+			{
+				CloseHandle(Overlapped.hEvent);
+			}
+			if (Handle != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(Handle);
+			}
+		}
+
+		bool Read()
+		{
+			Reading = ReadDirectoryChangesW(Handle, Buffer.data(), static_cast<DWORD>(Buffer.size() * sizeof(DWORD)),
+				FALSE, Filter, nullptr, &Overlapped, nullptr) != FALSE;
+			return Reading;
+		}
+
+		std::wstring Path;
+		HANDLE Handle;
+		// DWORD-aligned, as ReadDirectoryChangesW requires.
+		std::vector<DWORD> Buffer;
+		OVERLAPPED Overlapped;
+		bool Reading = false;
+	};
+
+	std::unordered_map<std::wstring, std::unique_ptr<Directory>> m_Directories;
+};
+
+#elif defined(__linux__)
+
+class SystemFileWatcher::Platform
+{
+public:
+	Platform()
+		: m_Inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+	{}
+
+	~Platform()
+	{
+		if (m_Inotify >= 0)
+		{
+			close(m_Inotify);
+		}
+	}
+
+	bool Watch(const std::wstring& directory)
+	{
+		if (m_Inotify < 0)
+		{
+			return false;
+		}
+		for (const auto& watched : m_Directories)
+		{
+			if (watched.second == directory)
+			{
+				return true;
+			}
+		}
+
+		// Editors that save through a temporary file rename it over the
+		// original, so moves count as writes.
+		int watch = inotify_add_watch(m_Inotify, directory.empty() ? "." : Narrow(directory).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0)
+		{
+			return false;
+		}
+		m_Directories.emplace(watch, directory);
+		return true;
+	}
+
+	void Poll(std::vector<std::wstring>& changed)
+	{
+		if (m_Inotify < 0)
+		{
+			return;
+		}
+
+		alignas(inotify_event) char buffer[16 * 1024];
+		for (;;)
+		{
+			ssize_t size = read(m_Inotify, buffer, sizeof(buffer));
+			if (size <= 0)
+			{
+				return;
+			}
+			for (ssize_t offset = 0; offset < size;)
+			{
+				const inotify_event& event = *reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + event.len;
+
+				if (event.mask & IN_Q_OVERFLOW)
+				{
+					for (const auto& watched : m_Directories)
+					{
+						changed.push_back(watched.second);
+					}
+					continue;
+				}
+				auto watched = m_Directories.find(event.wd);
+				if (watched == m_Directories.end())
+				{
+					continue;
+				}
+				if (event.mask & IN_IGNORED)
+				{
+					// The directory is gone. Forget it so it can be watched again.
+					changed.push_back(watched->second);
+					m_Directories.erase(watched);
+					continue;
+				}
+				if (event.len)
+				{
+					changed.push_back(NormalizePath(watched->second + Widen(event.name)));
+				}
+			}
+		}
+	}
+
+private:
+	int m_Inotify;
+	std::unordered_map<int, std::wstring> m_Directories;
+};
+
+#else
+
+class SystemFileWatcher::Platform
+{
+public:
+	bool Watch(const std::wstring&) { return false; }
+	void Poll(std::vector<std::wstring>&) {}
+};
+
+#endif
+
+SystemFileWatcher::SystemFileWatcher()
+	: m_Platform(new Platform())
+{}
+
+SystemFileWatcher::~SystemFileWatcher() = default;
+
+bool SystemFileWatcher::Watch(const std::wstring& directory)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Platform->Watch(NormalizePath(directory));
+}
+
+void SystemFileWatcher::Poll(std::vector<std::wstring>& changed)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Platform->Poll(changed);
+}
+
+bool SimulatedFileWatcher::Watch(const std::wstring& directory)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Directories.insert(NormalizePath(directory));
+	return true;
+}
+
+void SimulatedFileWatcher::Poll(std::vector<std::wstring>& changed)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	changed.insert(changed.end(), m_Changed.begin(), m_Changed.end());
+	m_Changed.clear();
+}
+
+void SimulatedFileWatcher::NotifyChanged(const std::wstring& path)
+{
+	std::wstring normalized = NormalizePath(path);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Directories.count(GetPathDirectory(normalized)))
+	{
+		m_Changed.push_back(std::move(normalized));
+	}
+}
+
+bool SimulatedFileWatcher::IsWatching(const std::wstring& directory) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Directories.count(NormalizePath(directory)) != 0;
+}
@@ -0,0 +1,179 @@
+#include "../include/FrameBenchmark.h"
+#include "../include/DrawSort.h"
+#include "../include/FramePacer.h"
+#include "../include/GpuProfiler.h"
+#include "../include/IndirectArguments.h"
+#include "../include/JobSystem.h"
+#include "../include/Profiler.h"
+#include "../include/UploadRing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint32_t PipelineCount = 256;
+	const uint32_t MaterialCount = 4096;
+
+	// Arguments are 16-byte aligned per batch, so this bounds a frame's share
+	// of the ring however the draws split into batches.
+	const UINT64 BatchAlignment = 16;
+
+	uint64_t NowNanoseconds()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	struct Scene
+	{
+		std::vector<DrawPacket> Packets;
+		std::vector<uint32_t> Pipelines;
+		std::vector<uint32_t> Materials;
+		std::vector<float> Positions;
+	};
+
+	// The objects are never dereferenced, only compared, so made-up addresses
+	// stand in for them. Meshes share one vertex and index buffer per root
+	// signature, so draws of a material batch together.
+	Scene CreateScene(uint32_t drawCount)
+	{
+		std::mt19937 random(1234);
+		Scene scene;
+		scene.Packets.resize(drawCount);
+		scene.Pipelines.resize(drawCount);
+		scene.Materials.resize(drawCount);
+		scene.Positions.resize(drawCount);
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			uint32_t material = random() % MaterialCount;
+			uint32_t pipeline = material % PipelineCount;
+			uint64_t rootSignature = pipeline % 4;
+
+			DrawPacket& packet = scene.Packets[i];
+			packet.RootSignature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(rootSignature + 1) * 64);
+			packet.PipelineState = reinterpret_cast<ID3D12PipelineState*>(uintptr_t(pipeline + 1) * 64);
+			packet.MaterialTable.ptr = UINT64(material) * 32;
+			packet.ObjectConstants = UINT64(i) * 256;
+			packet.VertexBuffer = { rootSignature << 28, 1 << 27, 32 };
+			packet.IndexBuffer = { (rootSignature << 28) + (1 << 27), 1 << 27, DXGI_FORMAT_R32_UINT };
+			packet.IndexCount = 3 * (1 + random() % 4096);
+			packet.InstanceCount = 1;
+			packet.StartIndex = random() % (1u << 24);
+			packet.BaseVertex = static_cast<INT>(random() % (1u << 20));
+
+			scene.Pipelines[i] = pipeline;
+			scene.Materials[i] = material;
+			scene.Positions[i] = (random() % 100000) * 0.01f;
+		}
+		return scene;
+	}
+}
+
+FrameStatistics FrameBenchmark::Run(const Options& options)
+{
+	FrameStatistics statistics;
+	statistics.AddInfo("frames", options.FrameCount);
+	statistics.AddInfo("warmup_frames", options.WarmupFrames);
+	statistics.AddInfo("frames_in_flight", options.FramesInFlight);
+	statistics.AddInfo("draws", options.DrawCount);
+	statistics.AddInfo("gpu_frame_ms", std::chrono::duration<double, std::milli>(options.GpuFrameTime).count());
+
+	JobSystem::Options jobOptions;
+	jobOptions.ThreadCount = options.ThreadCount;
+	JobSystem jobs(jobOptions);
+	statistics.AddInfo("job_threads", jobs.GetWorkerCount());
+
+	Scene scene = CreateScene(options.DrawCount);
+	DrawSortKeyFormat format = DrawSortKeyFormat::Opaque();
+	std::vector<DrawSortItem> order(options.DrawCount);
+	std::vector<DrawSortItem> scratch(options.DrawCount);
+
+	SimulatedGpu gpu(options.GpuFrameTime);
+	FramePacer pacer(gpu.GetFence(), options.FramesInFlight);
+
+	IndirectDrawLayout layout = IndirectDrawLayout::DrawIdAndDrawIndexed;
+	UINT64 frameSize = UINT64(options.DrawCount) * (GetIndirectDrawStride(layout) + BatchAlignment);
+	UploadRing ring(gpu.GetFence(), (pacer.GetFramesInFlight() + 1) * frameSize);
+	IndirectDrawPacker packer(ring, layout);
+
+	// The simulated GPU writes each frame's timestamps as it runs the frame,
+	// so the trace gets a GPU track read back and calibrated as on hardware.
+	const UINT GpuScopesPerFrame = 1;
+	auto timestamps = std::make_shared<SimulatedGpuTimestampBackend>(2 * GpuScopesPerFrame * GpuProfiler::FrameCount,
+		24000000, 1ull << 40, true);
+	GpuProfiler gpuProfiler(timestamps, gpu.GetFence(), "GPU", GpuScopesPerFrame);
+
+	// Only the watcher thread records these, so they need no lock.
+	pacer.SetCompletionCallback([&statistics, &options](const FramePacer::CompletedFrame& frame)
+	{
+		if (frame.FrameNumber >= options.WarmupFrames)
+		{
+			statistics.GetGpuTimes().Record(frame.GpuNanoseconds);
+			statistics.GetCpuWaits().Record(frame.CpuWaitNanoseconds);
+			statistics.GetGpuIdles().Record(frame.GpuIdleNanoseconds);
+		}
+	});
+
+	// A frame ends when it is handed to the GPU, as it would at Present, and
+	// its frame time runs from the end of the one before.
+	uint64_t frameCount = uint64_t(options.WarmupFrames) + options.FrameCount;
+	uint64_t previousEnd = NowNanoseconds();
+	for (uint64_t frame = 0; frame < frameCount; ++frame)
+	{
+		pacer.BeginFrame();
+		uint64_t workStart = NowNanoseconds();
+		{
+			ProfileScope frameScope("Frame");
+			UINT gpuScope = gpuProfiler.BeginScope(nullptr, "Frame");
+
+			// The camera sweeps back and forth, so every frame sorts a new depth order.
+			float angle = static_cast<float>(frame) * 0.01f;
+			float cameraX = 500.0f + 400.0f * std::cos(angle);
+			{
+				ProfileScope scope("Build keys");
+				for (uint32_t i = 0; i < options.DrawCount; ++i)
+				{
+					float depth = std::fabs(scene.Positions[i] - cameraX);
+					order[i].Key = format.Encode(0, scene.Pipelines[i], scene.Materials[i], depth);
+					order[i].Packet = i;
+				}
+			}
+			{
+				ProfileScope scope("Sort");
+				RadixSortDrawItems(order, scratch, &jobs);
+			}
+			{
+				ProfileScope scope("Pack");
+				for (size_t begin = 0; begin < order.size();)
+				{
+					size_t end = IndirectDrawPacker::FindBatchEnd(scene.Packets, order, begin, order.size());
+					packer.Pack(scene.Packets, order, begin, end);
+					begin = end;
+				}
+			}
+
+			gpuProfiler.EndScope(nullptr, gpuScope);
+			gpuProfiler.Resolve(nullptr);
+			UINT64 fenceValue = gpu.Submit(timestamps->TakeFrame());
+			ring.Finish(fenceValue);
+			pacer.EndFrame(fenceValue);
+			gpuProfiler.EndFrame(fenceValue);
+		}
+		uint64_t end = NowNanoseconds();
+		if (frame >= options.WarmupFrames)
+		{
+			statistics.GetFrameTimes().Record(end - previousEnd);
+			statistics.GetCpuTimes().Record(end - workStart);
+		}
+		previousEnd = end;
+		Profiler::MarkFrame();
+	}
+
+	pacer.WaitForIdle();
+	pacer.SetCompletionCallback(nullptr);
+	gpuProfiler.Flush();
+	return statistics;
+}
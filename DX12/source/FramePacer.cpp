@@ -0,0 +1,286 @@
+#include "../include/FramePacer.h"
+
+#include <algorithm>
+
+namespace
+{
+	UINT64 NowNanoseconds()
+	{
+		return static_cast<UINT64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// Simulated work has to take the time asked for, and sleep_for can
+	// overshoot by a whole scheduler tick, so this yields in a loop instead.
+	void BusyUntil(std::chrono::steady_clock::time_point deadline)
+	{
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+FramePacer::FramePacer(std::shared_ptr<Fence> fence, UINT framesInFlight)
+	: m_Fence(fence)
+	, m_FramesInFlight((std::min)((std::max)(framesInFlight, 1u), MaxFramesInFlight))
+	, m_Slot(0)
+	, m_FrameCount(0)
+	, m_SlotFenceValues()
+	, m_FrameBeganAt(0)
+	, m_FrameCpuWait(0)
+	, m_CpuWaitTotal(0)
+	, m_GpuIdleTotal(0)
+	, m_CompletedFrames(0)
+	, m_LatencyTotal(0)
+	, m_LastCompletedAt(0)
+	, m_Stopping(false)
+{
+	m_Watcher = std::thread(&FramePacer::WatchCompletions, this);
+}
+
+FramePacer::~FramePacer()
+{
+	WaitForIdle();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_PendingChanged.notify_all();
+	m_Watcher.join();
+}
+
+UINT FramePacer::BeginFrame()
+{
+	UINT64 start = NowNanoseconds();
+
+	UINT64 fenceValue = m_SlotFenceValues[m_Slot];
+	if (!m_Fence->IsComplete(fenceValue))
+	{
+		m_Fence->Wait(fenceValue);
+	}
+
+	UINT64 end = NowNanoseconds();
+	m_CpuWait.Record(end - start);
+	m_CpuWaitTotal += end - start;
+	m_FrameBeganAt = end;
+	m_FrameCpuWait = end - start;
+
+	return m_Slot;
+}
+
+void FramePacer::EndFrame(UINT64 fenceValue)
+{
+	m_SlotFenceValues[m_Slot] = fenceValue;
+	m_Slot = (m_Slot + 1) % m_FramesInFlight;
+
+	PendingFrame frame;
+	frame.FenceValue = fenceValue;
+	frame.FrameNumber = m_FrameCount++;
+	frame.BeganAt = m_FrameBeganAt;
+	frame.CpuWait = m_FrameCpuWait;
+	frame.SubmittedAt = NowNanoseconds();
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Pending.push_back(frame);
+	}
+	m_PendingChanged.notify_all();
+}
+
+void FramePacer::WaitForIdle()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_PendingChanged.wait(lock, [this] { return m_Pending.empty(); });
+}
+
+void FramePacer::SetFramesInFlight(UINT framesInFlight)
+{
+	WaitForIdle();
+
+	m_FramesInFlight = (std::min)((std::max)(framesInFlight, 1u), MaxFramesInFlight);
+	m_Slot = 0;
+	std::fill(std::begin(m_SlotFenceValues), std::end(m_SlotFenceValues), 0);
+
+	// The GPU was idle while draining; that is not the CPU's fault.
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_LastCompletedAt = 0;
+}
+
+FramePacer::Stats FramePacer::GetStats() const
+{
+	Stats stats;
+	stats.Frames = m_CpuWait.GetCount();
+	stats.CpuWaitNanoseconds = m_CpuWaitTotal;
+	stats.GpuIdleNanoseconds = m_GpuIdleTotal;
+	stats.CompletedFrames = m_CompletedFrames;
+	stats.LatencyNanoseconds = m_LatencyTotal;
+	return stats;
+}
+
+void FramePacer::ResetStats()
+{
+	m_CpuWait.Reset();
+	m_GpuIdle.Reset();
+	m_FrameLatency.Reset();
+	m_CpuWaitTotal = 0;
+	m_GpuIdleTotal = 0;
+	m_CompletedFrames = 0;
+	m_LatencyTotal = 0;
+}
+
+void FramePacer::SetCompletionCallback(std::function<void(const CompletedFrame&)> callback)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_CompletionCallback = std::move(callback);
+}
+
+void FramePacer::WatchCompletions()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_PendingChanged.wait(lock, [this] { return m_Stopping || !m_Pending.empty(); });
+		if (m_Pending.empty())
+		{
+			return;
+		}
+
+		PendingFrame frame = m_Pending.front();
+		lock.unlock();
+		m_Fence->Wait(frame.FenceValue);
+		UINT64 completedAt = NowNanoseconds();
+		lock.lock();
+
+		// Frames complete in order, so if this one was submitted after the
+		// previous one finished, the GPU had nothing to do in between.
+		UINT64 idle = 0;
+		if (m_LastCompletedAt != 0 && frame.SubmittedAt > m_LastCompletedAt)
+		{
+			idle = frame.SubmittedAt - m_LastCompletedAt;
+		}
+		UINT64 startedAt = (std::max)(frame.SubmittedAt, m_LastCompletedAt);
+		m_LastCompletedAt = completedAt;
+
+		m_GpuIdle.Record(idle);
+		m_GpuIdleTotal += idle;
+		m_FrameLatency.Record(completedAt - frame.BeganAt);
+		m_LatencyTotal += completedAt - frame.BeganAt;
+		++m_CompletedFrames;
+
+		if (m_CompletionCallback)
+		{
+			CompletedFrame completed;
+			completed.FrameNumber = frame.FrameNumber;
+			completed.GpuNanoseconds = completedAt - (std::min)(startedAt, completedAt);
+			completed.LatencyNanoseconds = completedAt - frame.BeganAt;
+			completed.CpuWaitNanoseconds = frame.CpuWait;
+			completed.GpuIdleNanoseconds = idle;
+			m_CompletionCallback(completed);
+		}
+
+		m_Pending.pop_front();
+		m_PendingChanged.notify_all();
+	}
+}
+
+std::vector<FramePacer::BenchmarkResult> FramePacer::RunBenchmark(
+	std::chrono::microseconds cpuFrameTime, std::chrono::microseconds gpuFrameTime, UINT frameCount)
+{
+	std::vector<BenchmarkResult> results;
+	for (UINT framesInFlight = 1; framesInFlight <= MaxFramesInFlight; ++framesInFlight)
+	{
+		SimulatedGpu gpu(gpuFrameTime);
+		FramePacer pacer(gpu.GetFence(), framesInFlight);
+
+		// The first frames only fill the pipeline.
+		std::chrono::steady_clock::time_point start;
+		for (UINT frame = 0; frame < framesInFlight + frameCount; ++frame)
+		{
+			if (frame == framesInFlight)
+			{
+				pacer.ResetStats();
+				start = std::chrono::steady_clock::now();
+			}
+
+			pacer.BeginFrame();
+			BusyUntil(std::chrono::steady_clock::now() + cpuFrameTime);
+			pacer.EndFrame(gpu.Submit());
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		pacer.WaitForIdle();
+
+		Stats stats = pacer.GetStats();
+		BenchmarkResult result;
+		result.FramesInFlight = framesInFlight;
+		result.FrameMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+		result.CpuWaitMilliseconds = stats.CpuWaitNanoseconds / 1e6 / frameCount;
+		result.GpuIdleMilliseconds = stats.GpuIdleNanoseconds / 1e6 / (std::max)(stats.CompletedFrames, UINT64(1));
+		result.LatencyMilliseconds = stats.LatencyNanoseconds / 1e6 / (std::max)(stats.CompletedFrames, UINT64(1));
+		results.push_back(result);
+	}
+	return results;
+}
+
+SimulatedGpu::SimulatedGpu(std::chrono::microseconds frameTime)
+	: m_FrameTime(frameTime)
+	, m_Fence(std::make_shared<SimulatedFence>())
+	, m_Submitted(0)
+	, m_Stopping(false)
+{
+	m_Thread = std::thread(&SimulatedGpu::Run, this);
+}
+
+SimulatedGpu::~SimulatedGpu()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WorkAvailable.notify_one();
+	m_Thread.join();
+}
+
+UINT64 SimulatedGpu::Submit(FrameWork work)
+{
+	UINT64 fenceValue;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		fenceValue = m_Fence->Signal(nullptr);
+		m_Work.push_back(std::move(work));
+		++m_Submitted;
+	}
+	m_WorkAvailable.notify_one();
+	return fenceValue;
+}
+
+void SimulatedGpu::Run()
+{
+	UINT64 completed = 0;
+	std::chrono::steady_clock::time_point busyUntil = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_WorkAvailable.wait(lock, [this, completed] { return m_Stopping || m_Submitted > completed; });
+		if (m_Submitted == completed)
+		{
+			return;
+		}
+		FrameWork work = std::move(m_Work.front());
+		m_Work.pop_front();
+		lock.unlock();
+
+		// A frame starts when it has been submitted and the previous one is done.
+		std::chrono::steady_clock::time_point begin = (std::max)(busyUntil, std::chrono::steady_clock::now());
+		busyUntil = begin + m_FrameTime;
+		BusyUntil(busyUntil);
+		if (work)
+		{
+			work(begin, busyUntil);
+		}
+		m_Fence->Complete(++completed);
+
+		lock.lock();
+	}
+}
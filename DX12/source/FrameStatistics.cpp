@@ -0,0 +1,225 @@
+#include "../include/FrameStatistics.h"
+#include "../include/FileError.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+	// Values below SubBucketCount have a bucket each. Every power of two above
+	// that is split into HalfSubBucketCount buckets.
+	const uint32_t SubBucketBits = 11;
+	const uint64_t SubBucketCount = uint64_t(1) << SubBucketBits;
+	const uint64_t HalfSubBucketCount = SubBucketCount / 2;
+
+	// Everything from 2^MaxValueBits ns, about 18 minutes, goes in the last bucket.
+	const uint32_t MaxValueBits = 40;
+	const uint32_t BucketCount = static_cast<uint32_t>(SubBucketCount + (MaxValueBits - SubBucketBits) * HalfSubBucketCount);
+
+	uint32_t GetHighestBit(uint64_t value)
+	{
+		uint32_t bit = 0;
+		while (value >>= 1)
+		{
+			++bit;
+		}
+		return bit;
+	}
+
+	double ToMilliseconds(double nanoseconds)
+	{
+		return nanoseconds / 1e6;
+	}
+
+	void WriteSummary(std::ostream& stream, const char* name, const FrameTimeSummary& summary)
+	{
+		stream << "  \"" << name << "\": {\"count\": " << summary.Count
+			<< ", \"mean_ms\": " << summary.Mean
+			<< ", \"p50_ms\": " << summary.P50
+			<< ", \"p95_ms\": " << summary.P95
+			<< ", \"p99_ms\": " << summary.P99
+			<< ", \"max_ms\": " << summary.Max
+			<< ", \"stddev_ms\": " << summary.StdDev
+			<< ", \"jitter_ms\": " << summary.Jitter << "}";
+	}
+}
+
+FrameTimeHistogram::FrameTimeHistogram()
+	: m_Buckets(BucketCount)
+{
+	Reset();
+}
+
+uint32_t FrameTimeHistogram::GetBucket(uint64_t nanoseconds)
+{
+	if (nanoseconds < SubBucketCount)
+	{
+		return static_cast<uint32_t>(nanoseconds);
+	}
+	if (nanoseconds >> MaxValueBits)
+	{
+		return BucketCount - 1;
+	}
+
+	// The top SubBucketBits bits pick the bucket within the power of two.
+	uint32_t shift = GetHighestBit(nanoseconds) - (SubBucketBits - 1);
+	return static_cast<uint32_t>(SubBucketCount + (shift - 1) * HalfSubBucketCount + (nanoseconds >> shift) - HalfSubBucketCount);
+}
+
+uint64_t FrameTimeHistogram::GetBucketLowerBound(uint32_t bucket)
+{
+	if (bucket < SubBucketCount)
+	{
+		return bucket;
+	}
+
+	uint64_t index = bucket - SubBucketCount;
+	uint32_t shift = static_cast<uint32_t>(index / HalfSubBucketCount) + 1;
+	return (index % HalfSubBucketCount + HalfSubBucketCount) << shift;
+}
+
+uint64_t FrameTimeHistogram::GetBucketUpperBound(uint32_t bucket)
+{
+	if (bucket < SubBucketCount)
+	{
+		return bucket;
+	}
+	if (bucket == BucketCount - 1)
+	{
+		return ~uint64_t(0);
+	}
+
+	uint32_t shift = static_cast<uint32_t>((bucket - SubBucketCount) / HalfSubBucketCount) + 1;
+	return GetBucketLowerBound(bucket) + (uint64_t(1) << shift) - 1;
+}
+
+void FrameTimeHistogram::Record(uint64_t nanoseconds)
+{
+	++m_Buckets[GetBucket(nanoseconds)];
+
+	if (m_Count)
+	{
+		m_JitterSum += static_cast<double>(nanoseconds > m_Previous ? nanoseconds - m_Previous : m_Previous - nanoseconds);
+	}
+	++m_Count;
+	m_Max = (std::max)(m_Max, nanoseconds);
+	m_Previous = nanoseconds;
+
+	double value = static_cast<double>(nanoseconds);
+	m_Sum += value;
+	m_SumOfSquares += value * value;
+}
+
+void FrameTimeHistogram::Reset()
+{
+	std::fill(m_Buckets.begin(), m_Buckets.end(), 0);
+	m_Count = 0;
+	m_Max = 0;
+	m_Previous = 0;
+	m_Sum = 0.0;
+	m_SumOfSquares = 0.0;
+	m_JitterSum = 0.0;
+}
+
+uint64_t FrameTimeHistogram::GetPercentile(double percentile) const
+{
+	if (m_Count == 0)
+	{
+		return 0;
+	}
+
+	// The smallest value at least percentile% of the samples are at or below.
+	double rank = std::ceil(m_Count * (std::min)((std::max)(percentile, 0.0), 100.0) / 100.0);
+	uint64_t target = (std::max)(static_cast<uint64_t>(rank), uint64_t(1));
+	uint64_t seen = 0;
+	for (uint32_t bucket = 0; bucket < BucketCount; ++bucket)
+	{
+		seen += m_Buckets[bucket];
+		if (seen >= target)
+		{
+			return (std::min)(GetBucketUpperBound(bucket), m_Max);
+		}
+	}
+	return m_Max;
+}
+
+FrameTimeSummary FrameTimeHistogram::GetSummary() const
+{
+	FrameTimeSummary summary;
+	summary.Count = m_Count;
+	if (m_Count == 0)
+	{
+		return summary;
+	}
+
+	double mean = m_Sum / m_Count;
+	double variance = (std::max)(m_SumOfSquares / m_Count - mean * mean, 0.0);
+
+	summary.Mean = ToMilliseconds(mean);
+	summary.P50 = ToMilliseconds(static_cast<double>(GetPercentile(50.0)));
+	summary.P95 = ToMilliseconds(static_cast<double>(GetPercentile(95.0)));
+	summary.P99 = ToMilliseconds(static_cast<double>(GetPercentile(99.0)));
+	summary.Max = ToMilliseconds(static_cast<double>(m_Max));
+	summary.StdDev = ToMilliseconds(std::sqrt(variance));
+	summary.Jitter = m_Count > 1 ? ToMilliseconds(m_JitterSum / (m_Count - 1)) : 0.0;
+	return summary;
+}
+
+void FrameStatistics::AddInfo(const char* name, double value)
+{
+	m_Info.emplace_back(name, value);
+}
+
+void FrameStatistics::Reset()
+{
+	m_Frame.Reset();
+	m_Cpu.Reset();
+	m_Gpu.Reset();
+	m_CpuWait.Reset();
+	m_GpuIdle.Reset();
+	m_Info.clear();
+}
+
+void FrameStatistics::WriteJson(std::ostream& stream) const
+{
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+
+	// Nanosecond resolution, so builds can be compared to the last digit.
+	stream << std::fixed << std::setprecision(6);
+
+	stream << "{\n  \"info\": {";
+	for (size_t i = 0; i < m_Info.size(); ++i)
+	{
+		stream << (i ? ", " : "") << "\"" << m_Info[i].first << "\": " << m_Info[i].second;
+	}
+	stream << "},\n";
+
+	WriteSummary(stream, "frame", m_Frame.GetSummary());
+	stream << ",\n";
+	WriteSummary(stream, "cpu", m_Cpu.GetSummary());
+	stream << ",\n";
+	WriteSummary(stream, "gpu", m_Gpu.GetSummary());
+	stream << ",\n";
+	WriteSummary(stream, "cpu_wait", m_CpuWait.GetSummary());
+	stream << ",\n";
+	WriteSummary(stream, "gpu_idle", m_GpuIdle.GetSummary());
+	stream << "\n}\n";
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+void FrameStatistics::SaveJson(const std::wstring& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	WriteJson(file);
+
+	file.close();
+	if (!file)
+	{
+		throw FileError("Cannot write", path);
+	}
+}
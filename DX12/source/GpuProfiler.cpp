@@ -0,0 +1,317 @@
+#include "../include/GpuProfiler.h"
+#include "../include/Profiler.h"
+#include "../include/ShadowedCommandList.h"
+#include "../include/d3dx12.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	// GPU and CPU clocks drift apart slowly, so recalibrating about once a
+	// second keeps scopes aligned to well under a microsecond.
+	const std::chrono::seconds CalibrationInterval(1);
+
+	std::chrono::steady_clock::time_point ToCpuTime(const GpuClockCalibration& calibration, UINT64 frequency, UINT64 ticks)
+	{
+		// Scopes usually start before the calibration was taken, so the
+		// difference is signed.
+		double seconds = static_cast<double>(static_cast<INT64>(ticks - calibration.GpuTicks)) / frequency;
+		return calibration.CpuTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+	}
+}
+
+D3D12GpuTimestampBackend::D3D12GpuTimestampBackend(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue, UINT queryCount)
+	: m_Queue(queue)
+	, m_QueryType(D3D12_QUERY_TYPE_TIMESTAMP)
+	, m_QueryCount(queryCount)
+	, m_Frequency(0)
+{
+	D3D12_QUERY_HEAP_DESC heapDesc = {};
+	heapDesc.Type = queue->GetDesc().Type == D3D12_COMMAND_LIST_TYPE_COPY
+		? D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP
+		: D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heapDesc.Count = queryCount;
+	ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&m_QueryHeap)));
+
+	CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK);
+	CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(UINT64(queryCount) * sizeof(UINT64));
+	ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_Readback)));
+
+	ThrowIfFailed(queue->GetTimestampFrequency(&m_Frequency));
+}
+
+void D3D12GpuTimestampBackend::EndQuery(ID3D12GraphicsCommandList* commandList, UINT index)
+{
+	commandList->EndQuery(m_QueryHeap.Get(), m_QueryType, index);
+}
+
+void D3D12GpuTimestampBackend::Resolve(ID3D12GraphicsCommandList* commandList, UINT first, UINT count)
+{
+	commandList->ResolveQueryData(m_QueryHeap.Get(), m_QueryType, first, count, m_Readback.Get(), UINT64(first) * sizeof(UINT64));
+}
+
+void D3D12GpuTimestampBackend::Read(UINT first, UINT count, UINT64* ticks)
+{
+	D3D12_RANGE readRange = { first * sizeof(UINT64), (first + count) * sizeof(UINT64) };
+	void* data = nullptr;
+	ThrowIfFailed(m_Readback->Map(0, &readRange, &data));
+	memcpy(ticks, static_cast<const UINT8*>(data) + readRange.Begin, count * sizeof(UINT64));
+
+	D3D12_RANGE writtenRange = { 0, 0 };
+	m_Readback->Unmap(0, &writtenRange);
+}
+
+GpuClockCalibration D3D12GpuTimestampBackend::Calibrate()
+{
+	UINT64 gpuTicks = 0;
+	UINT64 cpuTicks = 0;
+	ThrowIfFailed(m_Queue->GetClockCalibration(&gpuTicks, &cpuTicks));
+
+	// The CPU side is a QueryPerformanceCounter value. Move it onto
+	// steady_clock by reading both clocks now.
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	::QueryPerformanceCounter(&counter);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	::QueryPerformanceFrequency(&frequency);
+
+	double secondsAgo = static_cast<double>(counter.QuadPart - static_cast<INT64>(cpuTicks)) / frequency.QuadPart;
+
+	GpuClockCalibration calibration;
+	calibration.GpuTicks = gpuTicks;
+	calibration.CpuTime = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(secondsAgo));
+	return calibration;
+}
+
+SimulatedGpuTimestampBackend::SimulatedGpuTimestampBackend(UINT queryCount, UINT64 frequency, UINT64 offsetTicks, bool deferred)
+	: m_Queries(queryCount)
+	, m_Readback(queryCount)
+	, m_Frequency(frequency)
+	, m_OffsetTicks(offsetTicks)
+	, m_Start(std::chrono::steady_clock::now())
+	, m_Deferred(deferred)
+{
+}
+
+void SimulatedGpuTimestampBackend::EndQuery(ID3D12GraphicsCommandList*, UINT index)
+{
+	if (m_Deferred)
+	{
+		m_Commands.push_back({ index, 1, false });
+		return;
+	}
+	m_Queries[index] = GetTicks(std::chrono::steady_clock::now());
+}
+
+void SimulatedGpuTimestampBackend::Resolve(ID3D12GraphicsCommandList*, UINT first, UINT count)
+{
+	if (m_Deferred)
+	{
+		m_Commands.push_back({ first, count, true });
+		return;
+	}
+	std::copy(m_Queries.begin() + first, m_Queries.begin() + first + count, m_Readback.begin() + first);
+}
+
+SimulatedGpu::FrameWork SimulatedGpuTimestampBackend::TakeFrame()
+{
+	assert(m_Deferred && "Only deferred queries are taken.");
+
+	std::vector<Command> commands;
+	commands.swap(m_Commands);
+	return [this, commands](std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+	{
+		INT64 queryCount = std::count_if(commands.begin(), commands.end(), [](const Command& command) { return !command.Resolve; });
+		INT64 query = 0;
+		for (const Command& command : commands)
+		{
+			if (command.Resolve)
+			{
+				std::copy(m_Queries.begin() + command.First, m_Queries.begin() + command.First + command.Count, m_Readback.begin() + command.First);
+				continue;
+			}
+
+			std::chrono::steady_clock::time_point time = queryCount > 1 ? begin + (end - begin) * query / (queryCount - 1) : end;
+			m_Queries[command.First] = GetTicks(time);
+			++query;
+		}
+	};
+}
+
+void SimulatedGpuTimestampBackend::Read(UINT first, UINT count, UINT64* ticks)
+{
+	std::copy(m_Readback.begin() + first, m_Readback.begin() + first + count, ticks);
+}
+
+GpuClockCalibration SimulatedGpuTimestampBackend::Calibrate()
+{
+	GpuClockCalibration calibration;
+	calibration.CpuTime = std::chrono::steady_clock::now();
+	calibration.GpuTicks = GetTicks(calibration.CpuTime);
+	return calibration;
+}
+
+UINT64 SimulatedGpuTimestampBackend::GetTicks(std::chrono::steady_clock::time_point time) const
+{
+	return m_OffsetTicks + static_cast<UINT64>(std::chrono::duration<double>(time - m_Start).count() * m_Frequency);
+}
+
+GpuProfiler::GpuProfiler(std::shared_ptr<GpuTimestampBackend> backend, std::shared_ptr<Fence> fence, const char* track, UINT maxScopesPerFrame)
+	: m_Backend(backend)
+	, m_Fence(fence)
+	, m_Track(track)
+	, m_MaxScopesPerFrame(maxScopesPerFrame)
+	, m_Frequency(backend->GetFrequency())
+	, m_Slot(0)
+	, m_FrameNumber(0)
+	, m_NextScope(0)
+	, m_DroppedScopes(0)
+	, m_Calibration(backend->Calibrate())
+	, m_LastFrameNumber(0)
+{
+	assert(backend->GetQueryCount() >= 2 * maxScopesPerFrame * FrameCount && "Too few queries for maxScopesPerFrame.");
+
+	for (Slot& slot : m_Slots)
+	{
+		slot.Names.resize(maxScopesPerFrame);
+		slot.Ended = std::vector<std::atomic<bool>>(maxScopesPerFrame);
+	}
+	m_Ticks.resize(2 * maxScopesPerFrame);
+}
+
+UINT GpuProfiler::BeginScope(ID3D12GraphicsCommandList* commandList, const char* name)
+{
+	UINT scope = m_NextScope.fetch_add(1, std::memory_order_relaxed);
+	if (scope >= m_MaxScopesPerFrame)
+	{
+		m_DroppedScopes.fetch_add(1, std::memory_order_relaxed);
+		return InvalidScope;
+	}
+
+	Slot& slot = m_Slots[m_Slot];
+	slot.Names[scope] = name;
+	slot.Ended[scope].store(false, std::memory_order_relaxed);
+	m_Backend->EndQuery(commandList, GetFirstQuery(m_Slot) + 2 * scope);
+	return scope;
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList* commandList, UINT scope)
+{
+	if (scope == InvalidScope)
+	{
+		return;
+	}
+
+	m_Backend->EndQuery(commandList, GetFirstQuery(m_Slot) + 2 * scope + 1);
+	m_Slots[m_Slot].Ended[scope].store(true, std::memory_order_relaxed);
+}
+
+UINT GpuProfiler::BeginScope(ShadowedCommandList& commandList, const char* name)
+{
+	return BeginScope(commandList.Get(), name);
+}
+
+void GpuProfiler::EndScope(ShadowedCommandList& commandList, UINT scope)
+{
+	EndScope(commandList.Get(), scope);
+}
+
+void GpuProfiler::Resolve(ID3D12GraphicsCommandList* commandList)
+{
+	Slot& slot = m_Slots[m_Slot];
+	slot.ScopeCount = (std::min)(m_NextScope.load(std::memory_order_relaxed), m_MaxScopesPerFrame);
+	if (slot.ScopeCount)
+	{
+		m_Backend->Resolve(commandList, GetFirstQuery(m_Slot), 2 * slot.ScopeCount);
+	}
+}
+
+void GpuProfiler::Resolve(ShadowedCommandList& commandList)
+{
+	Resolve(commandList.Get());
+}
+
+void GpuProfiler::EndFrame(UINT64 fenceValue)
+{
+	Slot& slot = m_Slots[m_Slot];
+
+	// Scopes begun after Resolve, or in a frame that was never resolved,
+	// have nothing to read back.
+	UINT begun = (std::min)(m_NextScope.exchange(0, std::memory_order_relaxed), m_MaxScopesPerFrame);
+	if (begun > slot.ScopeCount)
+	{
+		m_DroppedScopes.fetch_add(begun - slot.ScopeCount, std::memory_order_relaxed);
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_Calibration.CpuTime > CalibrationInterval)
+	{
+		m_Calibration = m_Backend->Calibrate();
+	}
+
+	slot.FenceValue = fenceValue;
+	slot.FrameNumber = m_FrameNumber++;
+	slot.Calibration = m_Calibration;
+	slot.Pending = slot.ScopeCount > 0;
+	m_Slot = (m_Slot + 1) % FrameCount;
+
+	// Oldest first, starting with the slot about to be reused.
+	for (UINT i = 0; i < FrameCount; ++i)
+	{
+		UINT index = (m_Slot + i) % FrameCount;
+		if (m_Slots[index].Pending && m_Fence->IsComplete(m_Slots[index].FenceValue))
+		{
+			ReadBack(m_Slots[index], index);
+		}
+	}
+
+	Slot& next = m_Slots[m_Slot];
+	if (next.Pending)
+	{
+		m_Fence->Wait(next.FenceValue);
+		ReadBack(next, m_Slot);
+	}
+	next.ScopeCount = 0;
+}
+
+void GpuProfiler::Flush()
+{
+	for (UINT i = 0; i < FrameCount; ++i)
+	{
+		UINT index = (m_Slot + i) % FrameCount;
+		if (m_Slots[index].Pending)
+		{
+			m_Fence->Wait(m_Slots[index].FenceValue);
+			ReadBack(m_Slots[index], index);
+		}
+	}
+}
+
+void GpuProfiler::ReadBack(Slot& slot, UINT slotIndex)
+{
+	m_Backend->Read(GetFirstQuery(slotIndex), 2 * slot.ScopeCount, m_Ticks.data());
+
+	m_LastFrame.clear();
+	for (UINT scope = 0; scope < slot.ScopeCount; ++scope)
+	{
+		if (!slot.Ended[scope].load(std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		GpuScopeTiming timing;
+		timing.Name = slot.Names[scope];
+		timing.Begin = ToCpuTime(slot.Calibration, m_Frequency, m_Ticks[2 * scope]);
+		timing.End = ToCpuTime(slot.Calibration, m_Frequency, m_Ticks[2 * scope + 1]);
+		m_LastFrame.push_back(timing);
+
+		Profiler::AddTrackScope(m_Track, timing.Name, timing.Begin, timing.End);
+	}
+
+	m_LastFrameNumber = slot.FrameNumber;
+	slot.Pending = false;
+}
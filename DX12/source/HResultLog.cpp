@@ -0,0 +1,124 @@
+#include "../include/HResultLog.h"
+#include "../include/helpers.h"
+
+#include <atomic>
+#include <cstdio>
+
+namespace
+{
+	// Fields are atomics so that a reader racing a writer reads stale values
+	// rather than undefined ones; the sequence number tells it to drop them.
+	struct Slot
+	{
+		// 0 while empty, odd while written, 2 * (index + 1) once entry index
+		// is complete.
+		std::atomic<uint64_t> Sequence;
+		std::atomic<int32_t> Result;
+		std::atomic<const char*> File;
+		std::atomic<uint32_t> Line;
+		std::atomic<uint32_t> ThreadId;
+		std::atomic<int64_t> Time;
+	};
+
+	Slot s_Slots[HResultLog::Capacity];
+	std::atomic<uint64_t> s_Next(0);
+
+	static_assert((HResultLog::Capacity & (HResultLog::Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+	const char* GetFileName(const char* path)
+	{
+		const char* name = path;
+		for (const char* c = path; *c; ++c)
+		{
+			if (*c == '\\' || *c == '/')
+			{
+				name = c + 1;
+			}
+		}
+		return name;
+	}
+}
+
+HResultException::HResultException(HRESULT result, const char* file, int line)
+	: m_Result(result)
+	, m_File(file)
+	, m_Line(line)
+{
+	snprintf(m_Message, sizeof(m_Message), "HRESULT 0x%08X at %s(%d)",
+		static_cast<unsigned>(result), GetFileName(file), line);
+}
+
+void ThrowHResult(HRESULT result, const char* file, int line)
+{
+	HResultLog::Record(result, file, static_cast<uint32_t>(line));
+	throw HResultException(result, file, line);
+}
+
+void HResultLog::Record(HRESULT result, const char* file, uint32_t line)
+{
+	uint64_t index = s_Next.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = s_Slots[index & (Capacity - 1)];
+
+	slot.Sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.Result.store(result, std::memory_order_relaxed);
+	slot.File.store(file, std::memory_order_relaxed);
+	slot.Line.store(line, std::memory_order_relaxed);
+	slot.ThreadId.store(::GetCurrentThreadId(), std::memory_order_relaxed);
+	slot.Time.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
+	slot.Sequence.store(2 * (index + 1), std::memory_order_release);
+}
+
+std::vector<HResultLog::Entry> HResultLog::GetEntries()
+{
+	uint64_t next = s_Next.load(std::memory_order_acquire);
+	uint64_t first = next > Capacity ? next - Capacity : 0;
+
+	std::vector<Entry> entries;
+	entries.reserve(static_cast<size_t>(next - first));
+	for (uint64_t index = first; index < next; ++index)
+	{
+		const Slot& slot = s_Slots[index & (Capacity - 1)];
+
+		// Skip entries still being written or already overwritten.
+		uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+		if (sequence != 2 * (index + 1))
+		{
+			continue;
+		}
+
+		Entry entry;
+		entry.Sequence = index;
+		entry.Result = slot.Result.load(std::memory_order_relaxed);
+		entry.File = slot.File.load(std::memory_order_relaxed);
+		entry.Line = slot.Line.load(std::memory_order_relaxed);
+		entry.ThreadId = slot.ThreadId.load(std::memory_order_relaxed);
+		entry.Time = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(slot.Time.load(std::memory_order_relaxed)));
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.Sequence.load(std::memory_order_relaxed) == sequence)
+		{
+			entries.push_back(entry);
+		}
+	}
+	return entries;
+}
+
+uint64_t HResultLog::GetFailureCount()
+{
+	return s_Next.load(std::memory_order_relaxed);
+}
+
+void HResultLog::Write(std::ostream& stream)
+{
+	char line[192];
+	for (const Entry& entry : GetEntries())
+	{
+		snprintf(line, sizeof(line), "#%llu thread %u: HRESULT 0x%08X at %s(%u)\n",
+			static_cast<unsigned long long>(entry.Sequence), entry.ThreadId,
+			static_cast<unsigned>(entry.Result), GetFileName(entry.File), entry.Line);
+		stream << line;
+	}
+}
@@ -0,0 +1,441 @@
+#include "../include/JobSystem.h"
+#include "../include/Profiler.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+
+namespace
+{
+	thread_local const JobSystem* t_System = nullptr;
+	thread_local uint32_t t_WorkerIndex = 0;
+
+	// Spins before a worker with nothing to do goes to sleep.
+	const int IdleSpinCount = 64;
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		// xorshift32
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+}
+
+JobSystem::JobSystem()
+	: JobSystem(Options())
+{}
+
+JobSystem::JobSystem(const Options& options)
+	: m_Outstanding(0)
+	, m_QueuedJobs(0)
+	, m_Sleeping(0)
+	, m_Stopping(false)
+	, m_JobsExecuted(0)
+	, m_Steals(0)
+	, m_InlineRuns(0)
+{
+	uint32_t threadCount = options.ThreadCount;
+	if (threadCount == Options::AutoThreadCount)
+	{
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	for (uint32_t i = 0; i <= threadCount; ++i)
+	{
+		m_Slots.emplace_back(new Worker(options.QueueCapacity));
+		m_Slots.back()->RandomState = 0x9E3779B9u * (i + 1);
+	}
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		m_Workers.emplace_back(&JobSystem::WorkerThread, this, i);
+
+#if defined(_WIN32)
+		if (options.PinThreads)
+		{
+			// Processor 0 is left to the owning thread.
+			DWORD_PTR mask = static_cast<DWORD_PTR>(1) << ((i + 1) % (sizeof(DWORD_PTR) * 8));
+			::SetThreadAffinityMask(m_Workers.back().native_handle(), mask);
+		}
+#endif
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	EndFrame();
+
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Stopping = true;
+	}
+	m_WakeUp.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+uint32_t JobSystem::GetCurrentWorkerIndex() const
+{
+	if (t_System == this)
+	{
+		return t_WorkerIndex;
+	}
+	return static_cast<uint32_t>(m_Slots.size() - 1);
+}
+
+Job* JobSystem::Allocate()
+{
+	Arena& arena = m_Slots[GetCurrentWorkerIndex()]->Jobs;
+	if (arena.Used == arena.Blocks.size() * Arena::BlockSize)
+	{
+		arena.Blocks.emplace_back(new Job[Arena::BlockSize]);
+	}
+
+	Job* job = &arena.Blocks[arena.Used / Arena::BlockSize][arena.Used % Arena::BlockSize];
+	++arena.Used;
+	return job;
+}
+
+Job* JobSystem::Create(std::function<void()> function, Job* parent)
+{
+	Job* job = Allocate();
+	job->m_Function = std::move(function);
+	job->m_Range = nullptr;
+	job->m_Parent = parent;
+	job->m_Unfinished.store(1, std::memory_order_relaxed);
+	job->m_Dependencies.store(1, std::memory_order_relaxed);
+	job->m_ContinuationLock.clear(std::memory_order_relaxed);
+	job->m_Completed = false;
+	job->m_Continuations.clear();
+
+	if (parent)
+	{
+		parent->m_Unfinished.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_Outstanding.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::AddDependency(Job* job, Job* dependency)
+{
+	while (dependency->m_ContinuationLock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+
+	if (!dependency->m_Completed)
+	{
+		job->m_Dependencies.fetch_add(1, std::memory_order_relaxed);
+		dependency->m_Continuations.push_back(job);
+	}
+
+	dependency->m_ContinuationLock.clear(std::memory_order_release);
+}
+
+void JobSystem::Submit(Job* job)
+{
+	if (job->m_Dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Schedule(job);
+	}
+}
+
+void JobSystem::Schedule(Job* job)
+{
+	m_QueuedJobs.fetch_add(1);
+	if (!m_Slots[GetCurrentWorkerIndex()]->Queue.Push(job))
+	{
+		m_QueuedJobs.fetch_sub(1);
+		++m_InlineRuns;
+		Execute(job);
+		return;
+	}
+
+	if (m_Sleeping.load() > 0)
+	{
+		// Notify under the lock so a worker between its check and its wait
+		// does not miss the wake-up.
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_WakeUp.notify_one();
+	}
+}
+
+void JobSystem::Execute(Job* job)
+{
+	if (job->m_Range)
+	{
+		SplitRange(job);
+	}
+	else if (job->m_Function)
+	{
+		job->m_Function();
+		// Release captures now rather than when the arena is recycled.
+		job->m_Function = nullptr;
+	}
+	++m_JobsExecuted;
+	Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+	if (job->m_Unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	std::vector<Job*> continuations;
+	while (job->m_ContinuationLock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+	job->m_Completed = true;
+	continuations.swap(job->m_Continuations);
+	job->m_ContinuationLock.clear(std::memory_order_release);
+
+	// All ranges of a ParallelFor are children of its root, so none can still
+	// be using the function.
+	job->m_RangeFunction = nullptr;
+
+	for (Job* continuation : continuations)
+	{
+		Submit(continuation);
+	}
+
+	if (job->m_Parent)
+	{
+		Finish(job->m_Parent);
+	}
+
+	m_Outstanding.fetch_sub(1, std::memory_order_release);
+}
+
+Job* JobSystem::FindJob(uint32_t workerIndex)
+{
+	Worker& self = *m_Slots[workerIndex];
+	if (Job* job = self.Queue.Pop())
+	{
+		m_QueuedJobs.fetch_sub(1);
+		return job;
+	}
+
+	uint32_t slotCount = static_cast<uint32_t>(m_Slots.size());
+	uint32_t start = NextRandom(self.RandomState) % slotCount;
+	for (uint32_t i = 0; i < slotCount; ++i)
+	{
+		uint32_t victim = (start + i) % slotCount;
+		if (victim == workerIndex)
+		{
+			continue;
+		}
+
+		if (Job* job = m_Slots[victim]->Queue.Steal())
+		{
+			m_QueuedJobs.fetch_sub(1);
+			++m_Steals;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::Wait(Job* job)
+{
+	uint32_t workerIndex = GetCurrentWorkerIndex();
+	while (!job->IsFinished())
+	{
+		if (Job* other = FindJob(workerIndex))
+		{
+			Execute(other);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WorkerThread(uint32_t workerIndex)
+{
+	t_System = this;
+	t_WorkerIndex = workerIndex;
+	Profiler::SetThreadName(("Job worker " + std::to_string(workerIndex)).c_str());
+
+	int idleSpins = 0;
+	while (!m_Stopping.load(std::memory_order_relaxed))
+	{
+		if (Job* job = FindJob(workerIndex))
+		{
+			Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < IdleSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		++m_Sleeping;
+		m_WakeUp.wait(lock, [this] { return m_Stopping || m_QueuedJobs.load() > 0; });
+		--m_Sleeping;
+		idleSpins = 0;
+	}
+
+	t_System = nullptr;
+}
+
+Job* JobSystem::ParallelFor(size_t begin, size_t end, size_t grainSize,
+	std::function<void(size_t begin, size_t end)> function, Job* parent)
+{
+	Job* root = Create(nullptr, parent);
+	root->m_RangeFunction = std::move(function);
+	if (begin < end)
+	{
+		root->m_Range = &root->m_RangeFunction;
+		root->m_RangeBegin = begin;
+		root->m_RangeEnd = end;
+		root->m_GrainSize = (std::max)(grainSize, static_cast<size_t>(1));
+	}
+	Submit(root);
+	return root;
+}
+
+void JobSystem::SplitRange(Job* job)
+{
+	size_t begin = job->m_RangeBegin;
+	size_t end = job->m_RangeEnd;
+
+	// Hand the upper half to a child job, which a thief can take, and keep
+	// splitting the lower half here.
+	while (end - begin > job->m_GrainSize)
+	{
+		size_t middle = begin + (end - begin) / 2;
+
+		Job* child = Create(nullptr, job);
+		child->m_Range = job->m_Range;
+		child->m_RangeBegin = middle;
+		child->m_RangeEnd = end;
+		child->m_GrainSize = job->m_GrainSize;
+		Submit(child);
+
+		end = middle;
+	}
+
+	(*job->m_Range)(begin, end);
+}
+
+void JobSystem::EndFrame()
+{
+	assert(t_System != this && "EndFrame must be called from the owning thread.");
+
+	// Jobs created but never submitted would keep this waiting forever.
+	uint32_t workerIndex = GetCurrentWorkerIndex();
+	while (m_Outstanding.load(std::memory_order_acquire) > 0)
+	{
+		if (Job* job = FindJob(workerIndex))
+		{
+			Execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Workers may still be returning from their last Finish, but no job can
+	// be touched once m_Outstanding is zero.
+	for (std::unique_ptr<Worker>& slot : m_Slots)
+	{
+		slot->Jobs.Used = 0;
+	}
+}
+
+JobSystem::Stats JobSystem::GetStats() const
+{
+	Stats stats;
+	stats.JobsExecuted = m_JobsExecuted;
+	stats.Steals = m_Steals;
+	stats.InlineRuns = m_InlineRuns;
+	return stats;
+}
+
+std::vector<JobSystem::BenchmarkResult> JobSystem::RunBenchmark(
+	uint32_t jobCount, uint32_t workPerJob, uint32_t maxThreadCount, uint32_t frameCount)
+{
+	if (maxThreadCount == 0)
+	{
+		maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<float> results(jobCount);
+	auto work = [&results, workPerJob](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			float x = static_cast<float>(i);
+			for (uint32_t k = 0; k < workPerJob; ++k)
+			{
+				x = x * 0.999f + 0.5f;
+			}
+			results[i] = x;
+		}
+	};
+
+	auto serialStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (size_t i = 0; i < jobCount; ++i)
+		{
+			work(i, i + 1);
+		}
+	}
+	auto serialEnd = std::chrono::high_resolution_clock::now();
+	double serialMilliseconds = std::chrono::duration<double, std::milli>(serialEnd - serialStart).count() / frameCount;
+
+	std::vector<BenchmarkResult> benchmarkResults;
+	for (uint32_t threads = 1; ; threads = (std::min)(threads * 2, maxThreadCount))
+	{
+		Options options;
+		options.ThreadCount = threads - 1;
+		JobSystem jobs(options);
+
+		// Warm the arenas.
+		jobs.Wait(jobs.ParallelFor(0, jobCount, 1, work));
+		jobs.EndFrame();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			jobs.Wait(jobs.ParallelFor(0, jobCount, 1, work));
+			jobs.EndFrame();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		BenchmarkResult result;
+		result.ThreadCount = threads;
+		result.FrameMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+		double overheadMilliseconds = result.FrameMilliseconds * threads - serialMilliseconds;
+		result.OverheadNanosecondsPerJob = (std::max)(0.0, overheadMilliseconds * 1e6 / jobCount);
+		result.Speedup = serialMilliseconds / result.FrameMilliseconds;
+		benchmarkResults.push_back(result);
+
+		if (threads == maxThreadCount)
+		{
+			break;
+		}
+	}
+	return benchmarkResults;
+}
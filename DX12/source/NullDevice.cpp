@@ -0,0 +1,668 @@
+#include "../include/NullDevice.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Hands out the object as riid, failing like a device does when the
+	// object does not implement it.
+	template<typename T>
+	HRESULT QueryCreated(const Microsoft::WRL::ComPtr<T>& created, REFIID riid, void** object)
+	{
+		if (!object)
+		{
+			return E_POINTER;
+		}
+		return created->QueryInterface(riid, object);
+	}
+
+	HRESULT NotImplemented(void** object)
+	{
+		if (object)
+		{
+			*object = nullptr;
+		}
+		return E_NOTIMPL;
+	}
+}
+
+NullPrivateData::Entry* NullPrivateData::Find(REFGUID guid)
+{
+	auto entry = std::find_if(m_Entries.begin(), m_Entries.end(), [&guid](const Entry& e) { return e.Guid == guid; });
+	return entry != m_Entries.end() ? &*entry : nullptr;
+}
+
+const NullPrivateData::Entry* NullPrivateData::Find(REFGUID guid) const
+{
+	return const_cast<NullPrivateData*>(this)->Find(guid);
+}
+
+HRESULT NullPrivateData::Get(REFGUID guid, UINT* dataSize, void* data) const
+{
+	if (!dataSize)
+	{
+		return E_INVALIDARG;
+	}
+
+	const Entry* entry = Find(guid);
+	if (!entry)
+	{
+		*dataSize = 0;
+		return DXGI_ERROR_NOT_FOUND;
+	}
+
+	UINT size = entry->Interface ? UINT(sizeof(IUnknown*)) : static_cast<UINT>(entry->Data.size());
+	if (!data)
+	{
+		*dataSize = size;
+		return S_OK;
+	}
+	if (*dataSize < size)
+	{
+		*dataSize = size;
+		return DXGI_ERROR_MORE_DATA;
+	}
+
+	*dataSize = size;
+	if (entry->Interface)
+	{
+		// The caller owns the reference, as with the real runtime.
+		IUnknown* object = entry->Interface.Get();
+		object->AddRef();
+		memcpy(data, &object, sizeof(object));
+	}
+	else if (size != 0)
+	{
+		memcpy(data, entry->Data.data(), size);
+	}
+	return S_OK;
+}
+
+HRESULT NullPrivateData::Set(REFGUID guid, UINT dataSize, const void* data)
+{
+	Entry* entry = Find(guid);
+	if (!data || dataSize == 0)
+	{
+		if (entry)
+		{
+			m_Entries.erase(m_Entries.begin() + (entry - m_Entries.data()));
+		}
+		return S_OK;
+	}
+
+	if (!entry)
+	{
+		m_Entries.push_back({ guid });
+		entry = &m_Entries.back();
+	}
+	entry->Interface.Reset();
+	entry->Data.assign(static_cast<const UINT8*>(data), static_cast<const UINT8*>(data) + dataSize);
+	return S_OK;
+}
+
+HRESULT NullPrivateData::SetInterface(REFGUID guid, const IUnknown* object)
+{
+	Entry* entry = Find(guid);
+	if (!object)
+	{
+		if (entry)
+		{
+			m_Entries.erase(m_Entries.begin() + (entry - m_Entries.data()));
+		}
+		return S_OK;
+	}
+
+	if (!entry)
+	{
+		m_Entries.push_back({ guid });
+		entry = &m_Entries.back();
+	}
+	entry->Data.clear();
+	entry->Interface = const_cast<IUnknown*>(object);
+	return S_OK;
+}
+
+Microsoft::WRL::ComPtr<NullResource> NullResource::Create(const D3D12_RESOURCE_DESC& desc)
+{
+	Microsoft::WRL::ComPtr<NullResource> resource;
+	resource.Attach(new NullResource(desc));
+	return resource;
+}
+
+NullResource::NullResource(const D3D12_RESOURCE_DESC& desc)
+	: m_References(1)
+	, m_Desc(desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		m_Memory.resize(static_cast<size_t>(desc.Width));
+	}
+}
+
+HRESULT NullResource::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild)
+		|| riid == __uuidof(ID3D12Pageable) || riid == __uuidof(ID3D12Resource))
+	{
+		AddRef();
+		*object = static_cast<ID3D12Resource*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullResource::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullResource::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullResource::GetDevice(REFIID, void** device)
+{
+	*device = nullptr;
+	return E_NOINTERFACE;
+}
+
+HRESULT NullResource::Map(UINT subresource, const D3D12_RANGE*, void** data)
+{
+	if (m_Memory.empty() || subresource != 0)
+	{
+		return E_INVALIDARG;
+	}
+	if (data)
+	{
+		*data = m_Memory.data();
+	}
+	return S_OK;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS NullResource::GetGPUVirtualAddress()
+{
+	return m_Memory.empty() ? 0 : reinterpret_cast<D3D12_GPU_VIRTUAL_ADDRESS>(m_Memory.data());
+}
+
+Microsoft::WRL::ComPtr<NullGraphicsCommandList> NullGraphicsCommandList::Create(D3D12_COMMAND_LIST_TYPE type)
+{
+	Microsoft::WRL::ComPtr<NullGraphicsCommandList> commandList;
+	commandList.Attach(new NullGraphicsCommandList(type));
+	return commandList;
+}
+
+NullGraphicsCommandList::NullGraphicsCommandList(D3D12_COMMAND_LIST_TYPE type)
+	: m_References(1)
+	, m_Type(type)
+	, m_Calls(0)
+{
+}
+
+HRESULT NullGraphicsCommandList::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild)
+		|| riid == __uuidof(ID3D12CommandList) || riid == __uuidof(ID3D12GraphicsCommandList))
+	{
+		AddRef();
+		*object = static_cast<ID3D12GraphicsCommandList*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullGraphicsCommandList::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullGraphicsCommandList::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullGraphicsCommandList::GetDevice(REFIID, void** device)
+{
+	*device = nullptr;
+	return E_NOINTERFACE;
+}
+
+Microsoft::WRL::ComPtr<NullPipelineState> NullPipelineState::Create()
+{
+	Microsoft::WRL::ComPtr<NullPipelineState> pipelineState;
+	pipelineState.Attach(new NullPipelineState());
+	return pipelineState;
+}
+
+NullPipelineState::NullPipelineState()
+	: m_References(1)
+{}
+
+HRESULT NullPipelineState::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild)
+		|| riid == __uuidof(ID3D12Pageable) || riid == __uuidof(ID3D12PipelineState))
+	{
+		AddRef();
+		*object = static_cast<ID3D12PipelineState*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullPipelineState::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullPipelineState::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullPipelineState::GetDevice(REFIID, void** device)
+{
+	*device = nullptr;
+	return E_NOINTERFACE;
+}
+
+HRESULT NullPipelineState::GetCachedBlob(ID3DBlob** blob)
+{
+	*blob = nullptr;
+	return E_NOTIMPL;
+}
+
+Microsoft::WRL::ComPtr<NullCommandAllocator> NullCommandAllocator::Create(D3D12_COMMAND_LIST_TYPE type)
+{
+	Microsoft::WRL::ComPtr<NullCommandAllocator> allocator;
+	allocator.Attach(new NullCommandAllocator(type));
+	return allocator;
+}
+
+NullCommandAllocator::NullCommandAllocator(D3D12_COMMAND_LIST_TYPE type)
+	: m_References(1)
+	, m_Type(type)
+	, m_Resets(0)
+{}
+
+HRESULT NullCommandAllocator::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild)
+		|| riid == __uuidof(ID3D12Pageable) || riid == __uuidof(ID3D12CommandAllocator))
+	{
+		AddRef();
+		*object = static_cast<ID3D12CommandAllocator*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullCommandAllocator::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullCommandAllocator::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullCommandAllocator::GetDevice(REFIID, void** device)
+{
+	*device = nullptr;
+	return E_NOINTERFACE;
+}
+
+Microsoft::WRL::ComPtr<NullFence> NullFence::Create(UINT64 initialValue)
+{
+	Microsoft::WRL::ComPtr<NullFence> fence;
+	fence.Attach(new NullFence(initialValue));
+	return fence;
+}
+
+NullFence::NullFence(UINT64 initialValue)
+	: m_References(1)
+	, m_Completed(initialValue)
+{}
+
+HRESULT NullFence::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild)
+		|| riid == __uuidof(ID3D12Pageable) || riid == __uuidof(ID3D12Fence))
+	{
+		AddRef();
+		*object = static_cast<ID3D12Fence*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullFence::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullFence::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullFence::GetDevice(REFIID, void** device)
+{
+	*device = nullptr;
+	return E_NOINTERFACE;
+}
+
+HRESULT NullFence::SetEventOnCompletion(UINT64 value, HANDLE event)
+{
+	if (!event)
+	{
+		// The runtime would block here; there is nothing to wait for.
+		return E_INVALIDARG;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Completed >= value)
+	{
+		::SetEvent(event);
+	}
+	else
+	{
+		m_PendingEvents.push_back({ value, event });
+	}
+	return S_OK;
+}
+
+HRESULT NullFence::Signal(UINT64 value)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Completed = value;
+	auto reached = std::partition(m_PendingEvents.begin(), m_PendingEvents.end(),
+		[value](const PendingEvent& pending) { return pending.Value > value; });
+	for (auto pending = reached; pending != m_PendingEvents.end(); ++pending)
+	{
+		::SetEvent(pending->Event);
+	}
+	m_PendingEvents.erase(reached, m_PendingEvents.end());
+	return S_OK;
+}
+
+Microsoft::WRL::ComPtr<NullCommandQueue> NullCommandQueue::Create(const D3D12_COMMAND_QUEUE_DESC& desc)
+{
+	Microsoft::WRL::ComPtr<NullCommandQueue> queue;
+	queue.Attach(new NullCommandQueue(desc));
+	return queue;
+}
+
+NullCommandQueue::NullCommandQueue(const D3D12_COMMAND_QUEUE_DESC& desc)
+	: m_References(1)
+	, m_Desc(desc)
+	, m_ExecutedLists(0)
+	, m_Executes(0)
+{}
+
+HRESULT NullCommandQueue::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild)
+		|| riid == __uuidof(ID3D12Pageable) || riid == __uuidof(ID3D12CommandQueue))
+	{
+		AddRef();
+		*object = static_cast<ID3D12CommandQueue*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullCommandQueue::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullCommandQueue::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullCommandQueue::GetDevice(REFIID, void** device)
+{
+	*device = nullptr;
+	return E_NOINTERFACE;
+}
+
+void NullCommandQueue::ExecuteCommandLists(UINT numCommandLists, ID3D12CommandList* const*)
+{
+	m_ExecutedLists += numCommandLists;
+	++m_Executes;
+}
+
+HRESULT NullCommandQueue::Signal(ID3D12Fence* fence, UINT64 value)
+{
+	return fence ? fence->Signal(value) : E_INVALIDARG;
+}
+
+HRESULT NullCommandQueue::Wait(ID3D12Fence* fence, UINT64)
+{
+	return fence ? S_OK : E_INVALIDARG;
+}
+
+HRESULT NullCommandQueue::GetTimestampFrequency(UINT64* frequency)
+{
+	LARGE_INTEGER counterFrequency;
+	::QueryPerformanceFrequency(&counterFrequency);
+	*frequency = static_cast<UINT64>(counterFrequency.QuadPart);
+	return S_OK;
+}
+
+HRESULT NullCommandQueue::GetClockCalibration(UINT64* gpuTimestamp, UINT64* cpuTimestamp)
+{
+	// The GPU clock is the CPU's performance counter.
+	LARGE_INTEGER counter;
+	::QueryPerformanceCounter(&counter);
+	*gpuTimestamp = static_cast<UINT64>(counter.QuadPart);
+	*cpuTimestamp = static_cast<UINT64>(counter.QuadPart);
+	return S_OK;
+}
+
+Microsoft::WRL::ComPtr<NullDevice> NullDevice::Create()
+{
+	Microsoft::WRL::ComPtr<NullDevice> device;
+	device.Attach(new NullDevice());
+	return device;
+}
+
+NullDevice::NullDevice()
+	: m_References(1)
+{}
+
+HRESULT NullDevice::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12Device)
+		|| riid == __uuidof(ID3D12Device1) || riid == __uuidof(ID3D12Device2))
+	{
+		AddRef();
+		*object = static_cast<ID3D12Device2*>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG NullDevice::AddRef()
+{
+	return m_References.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG NullDevice::Release()
+{
+	ULONG references = m_References.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (references == 0)
+	{
+		delete this;
+	}
+	return references;
+}
+
+HRESULT NullDevice::CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC* desc, REFIID riid, void** commandQueue)
+{
+	if (!desc)
+	{
+		return E_INVALIDARG;
+	}
+	return QueryCreated(NullCommandQueue::Create(*desc), riid, commandQueue);
+}
+
+HRESULT NullDevice::CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type, REFIID riid, void** commandAllocator)
+{
+	return QueryCreated(NullCommandAllocator::Create(type), riid, commandAllocator);
+}
+
+HRESULT NullDevice::CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC*, REFIID riid, void** pipelineState)
+{
+	return QueryCreated(NullPipelineState::Create(), riid, pipelineState);
+}
+
+HRESULT NullDevice::CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC*, REFIID riid, void** pipelineState)
+{
+	return QueryCreated(NullPipelineState::Create(), riid, pipelineState);
+}
+
+HRESULT NullDevice::CreateCommandList(UINT, D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator*, ID3D12PipelineState*, REFIID riid, void** commandList)
+{
+	// Created open, like a real list.
+	return QueryCreated(NullGraphicsCommandList::Create(type), riid, commandList);
+}
+
+HRESULT NullDevice::CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC*, REFIID, void** heap)
+{
+	return NotImplemented(heap);
+}
+
+HRESULT NullDevice::CreateRootSignature(UINT, const void*, SIZE_T, REFIID, void** rootSignature)
+{
+	return NotImplemented(rootSignature);
+}
+
+HRESULT NullDevice::CreateCommittedResource(const D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS, const D3D12_RESOURCE_DESC* desc,
+	D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID riid, void** resource)
+{
+	if (!desc)
+	{
+		return E_INVALIDARG;
+	}
+	return QueryCreated(NullResource::Create(*desc), riid, resource);
+}
+
+HRESULT NullDevice::CreateHeap(const D3D12_HEAP_DESC*, REFIID, void** heap)
+{
+	return NotImplemented(heap);
+}
+
+HRESULT NullDevice::CreatePlacedResource(ID3D12Heap*, UINT64, const D3D12_RESOURCE_DESC*, D3D12_RESOURCE_STATES,
+	const D3D12_CLEAR_VALUE*, REFIID, void** resource)
+{
+	return NotImplemented(resource);
+}
+
+HRESULT NullDevice::CreateReservedResource(const D3D12_RESOURCE_DESC*, D3D12_RESOURCE_STATES, const D3D12_CLEAR_VALUE*, REFIID, void** resource)
+{
+	return NotImplemented(resource);
+}
+
+HRESULT NullDevice::OpenSharedHandle(HANDLE, REFIID, void** object)
+{
+	return NotImplemented(object);
+}
+
+HRESULT NullDevice::CreateFence(UINT64 initialValue, D3D12_FENCE_FLAGS, REFIID riid, void** fence)
+{
+	return QueryCreated(NullFence::Create(initialValue), riid, fence);
+}
+
+void NullDevice::GetCopyableFootprints(const D3D12_RESOURCE_DESC*, UINT, UINT numSubresources, UINT64,
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizes, UINT64* totalBytes)
+{
+	// There is no layout to report; callers see empty footprints.
+	for (UINT i = 0; i < numSubresources; ++i)
+	{
+		if (layouts)
+		{
+			layouts[i] = {};
+		}
+		if (numRows)
+		{
+			numRows[i] = 0;
+		}
+		if (rowSizes)
+		{
+			rowSizes[i] = 0;
+		}
+	}
+	if (totalBytes)
+	{
+		*totalBytes = 0;
+	}
+}
+
+HRESULT NullDevice::CreateQueryHeap(const D3D12_QUERY_HEAP_DESC*, REFIID, void** heap)
+{
+	return NotImplemented(heap);
+}
+
+HRESULT NullDevice::CreateCommandSignature(const D3D12_COMMAND_SIGNATURE_DESC*, ID3D12RootSignature*, REFIID, void** commandSignature)
+{
+	return NotImplemented(commandSignature);
+}
+
+HRESULT NullDevice::CreatePipelineLibrary(const void*, SIZE_T, REFIID, void** pipelineLibrary)
+{
+	return NotImplemented(pipelineLibrary);
+}
+
+HRESULT NullDevice::CreatePipelineState(const D3D12_PIPELINE_STATE_STREAM_DESC*, REFIID riid, void** pipelineState)
+{
+	return QueryCreated(NullPipelineState::Create(), riid, pipelineState);
+}
@@ -0,0 +1,226 @@
+#include "../include/ParallelCommandRecorder.h"
+#include "../include/CommandQueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+using Microsoft::WRL::ComPtr;
+
+ParallelCommandRecorder::ParallelCommandRecorder(CommandQueue& queue, UINT threadCount)
+	: m_Queue(queue)
+	, m_Batch(nullptr)
+	, m_Generation(0)
+	, m_ActiveWorkers(0)
+	, m_Stopping(false)
+{
+	if (threadCount == 0)
+	{
+		// The calling thread records too.
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	for (UINT i = 0; i < threadCount; ++i)
+	{
+		m_Workers.emplace_back(&ParallelCommandRecorder::WorkerThread, this);
+	}
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+std::vector<ComPtr<ID3D12GraphicsCommandList>> ParallelCommandRecorder::Record(
+	size_t itemCount, const SetupFunction& setup, const RecordFunction& record, size_t itemsPerList)
+{
+	if (itemCount == 0)
+	{
+		return {};
+	}
+
+	if (itemsPerList == 0)
+	{
+		size_t chunks = GetThreadCount() * 4;
+		itemsPerList = (std::max)(MinItemsPerList, (itemCount + chunks - 1) / chunks);
+	}
+
+	Batch batch;
+	batch.Setup = &setup;
+	batch.Record = &record;
+	batch.ItemCount = itemCount;
+	batch.ItemsPerList = itemsPerList;
+	batch.ChunkCount = (itemCount + itemsPerList - 1) / itemsPerList;
+	batch.Remaining = batch.ChunkCount;
+	batch.Lists.resize(batch.ChunkCount);
+
+	// Not worth waking anyone for a single list.
+	bool parallel = batch.ChunkCount > 1 && !m_Workers.empty();
+	if (parallel)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Batch = &batch;
+			++m_Generation;
+		}
+		m_WorkAvailable.notify_all();
+	}
+
+	RecordChunks(batch);
+
+	if (parallel)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkDone.wait(lock, [this, &batch] { return batch.Remaining == 0 && m_ActiveWorkers == 0; });
+		// Workers that wake up late must not touch the finished batch.
+		m_Batch = nullptr;
+	}
+
+	if (batch.Error)
+	{
+		// Lists that were recorded are dropped unsubmitted. Their allocators
+		// never return to the pool, which is acceptable on an error path.
+		std::rethrow_exception(batch.Error);
+	}
+
+	return std::move(batch.Lists);
+}
+
+UINT64 ParallelCommandRecorder::RecordAndSubmit(
+	size_t itemCount, const SetupFunction& setup, const RecordFunction& record, size_t itemsPerList)
+{
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> lists = Record(itemCount, setup, record, itemsPerList);
+	if (lists.empty())
+	{
+		return m_Queue.Signal();
+	}
+	return m_Queue.ExecuteCommandLists(lists);
+}
+
+void ParallelCommandRecorder::RecordChunks(Batch& batch)
+{
+	for (;;)
+	{
+		size_t chunk = batch.NextChunk++;
+		if (chunk >= batch.ChunkCount)
+		{
+			return;
+		}
+
+		try
+		{
+			size_t begin = chunk * batch.ItemsPerList;
+			size_t end = (std::min)(begin + batch.ItemsPerList, batch.ItemCount);
+
+			ComPtr<ID3D12GraphicsCommandList> commandList = m_Queue.GetCommandList();
+			(*batch.Setup)(commandList.Get());
+			(*batch.Record)(commandList.Get(), begin, end);
+			batch.Lists[chunk] = std::move(commandList);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(batch.ErrorMutex);
+			if (!batch.Error)
+			{
+				batch.Error = std::current_exception();
+			}
+		}
+
+		if (--batch.Remaining == 0)
+		{
+			// Lock so the notification cannot slip in between the caller's
+			// check and its wait.
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_WorkDone.notify_all();
+		}
+	}
+}
+
+void ParallelCommandRecorder::WorkerThread()
+{
+	UINT64 generation = 0;
+	for (;;)
+	{
+		Batch* batch;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkAvailable.wait(lock, [this, generation] { return m_Stopping || m_Generation != generation; });
+			if (m_Stopping)
+			{
+				return;
+			}
+
+			generation = m_Generation;
+			batch = m_Batch;
+			if (!batch)
+			{
+				continue;
+			}
+			++m_ActiveWorkers;
+		}
+
+		RecordChunks(*batch);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			--m_ActiveWorkers;
+		}
+		m_WorkDone.notify_all();
+	}
+}
+
+std::vector<ParallelCommandRecorder::ScalingResult> ParallelCommandRecorder::RunScalingBenchmark(
+	CommandQueue& queue, size_t itemCount, const SetupFunction& setup, const RecordFunction& record,
+	UINT maxThreadCount, UINT frameCount)
+{
+	if (maxThreadCount == 0)
+	{
+		maxThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<ScalingResult> results;
+	if (frameCount == 0)
+	{
+		return results;
+	}
+
+	for (UINT threads = 1; ; threads = (std::min)(threads * 2, maxThreadCount))
+	{
+		ParallelCommandRecorder recorder(queue, threads - 1);
+
+		// One untimed frame fills the allocator and list pools.
+		queue.WaitForFenceValue(recorder.RecordAndSubmit(itemCount, setup, record));
+
+		double totalMilliseconds = 0.0;
+		for (UINT frame = 0; frame < frameCount; ++frame)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<ComPtr<ID3D12GraphicsCommandList>> lists = recorder.Record(itemCount, setup, record);
+			auto end = std::chrono::high_resolution_clock::now();
+			totalMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+
+			// Submission and GPU time are not part of the measurement.
+			queue.WaitForFenceValue(queue.ExecuteCommandLists(lists));
+		}
+
+		ScalingResult result;
+		result.ThreadCount = threads;
+		result.RecordMilliseconds = totalMilliseconds / frameCount;
+		result.Speedup = results.empty() ? 1.0 : results.front().RecordMilliseconds / result.RecordMilliseconds;
+		results.push_back(result);
+
+		if (threads == maxThreadCount)
+		{
+			break;
+		}
+	}
+	return results;
+}
@@ -0,0 +1,583 @@
+#include "../include/PerfBenchmarks.h"
+#include "../include/CaptureReplay.h"
+#include "../include/CommandCapture.h"
+#include "../include/DrawSort.h"
+#include "../include/Fence.h"
+#include "../include/IndirectArguments.h"
+#include "../include/JobSystem.h"
+#include "../include/NullDevice.h"
+#include "../include/PerfSuite.h"
+#include "../include/Profiler.h"
+#include "../include/ShadowedCommandList.h"
+#include "../include/UploadRing.h"
+#include "../include/d3dx12.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// Benchmarks store what they compute here, so it cannot be optimized away.
+	volatile UINT64 s_Sink = 0;
+
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// The draws of a frame: a few hundred pipelines, a few thousand materials
+	// and meshes, as DrawSubmitter::RunBenchmark uses. Objects are made-up
+	// addresses that are only compared.
+	struct DrawScene
+	{
+		std::vector<DrawPacket> Packets;
+		std::vector<DrawSortItem> Unsorted;
+		std::vector<DrawSortItem> Sorted;
+	};
+
+	std::shared_ptr<DrawScene> CreateDrawScene(size_t packetCount)
+	{
+		const uint32_t PipelineCount = 256;
+		const uint32_t MaterialCount = 4096;
+		const uint32_t MeshCount = 2048;
+
+		std::mt19937 random(1234);
+		auto scene = std::make_shared<DrawScene>();
+		scene->Packets.resize(packetCount);
+		scene->Unsorted.resize(packetCount);
+		DrawSortKeyFormat format = DrawSortKeyFormat::Opaque();
+		for (size_t i = 0; i < packetCount; ++i)
+		{
+			uint32_t material = random() % MaterialCount;
+			uint32_t pipeline = material % PipelineCount;
+			uint32_t mesh = random() % MeshCount;
+
+			DrawPacket& packet = scene->Packets[i];
+			packet.RootSignature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(pipeline % 4 + 1) * 64);
+			packet.PipelineState = reinterpret_cast<ID3D12PipelineState*>(uintptr_t(pipeline + 1) * 64);
+			packet.MaterialTable.ptr = UINT64(material) * 32;
+			packet.ObjectConstants = UINT64(i) * 256;
+			packet.VertexBuffer = { UINT64(mesh) << 20, 1 << 20, 32 };
+			packet.IndexBuffer = { (UINT64(mesh) << 20) + (1 << 19), 1 << 19, DXGI_FORMAT_R32_UINT };
+			packet.IndexCount = 3 * (1 + random() % 4096);
+			packet.InstanceCount = 1;
+			packet.StartIndex = 0;
+			packet.BaseVertex = 0;
+
+			scene->Unsorted[i].Key = format.Encode(0, pipeline, material, 1.0f + (random() % 100000) * 0.01f);
+			scene->Unsorted[i].Packet = i;
+		}
+
+		scene->Sorted = scene->Unsorted;
+		std::vector<DrawSortItem> scratch;
+		RadixSortDrawItems(scene->Sorted, scratch);
+		return scene;
+	}
+
+	// Binds each sorted draw's state and draws it, through a command list or
+	// anything with the same methods.
+	template <typename CommandList>
+	void RecordDraws(CommandList& commandList, const DrawScene& scene)
+	{
+		for (const DrawSortItem& item : scene.Sorted)
+		{
+			const DrawPacket& packet = scene.Packets[item.Packet];
+			commandList.SetGraphicsRootSignature(packet.RootSignature);
+			commandList.SetPipelineState(packet.PipelineState);
+			commandList.SetGraphicsRootDescriptorTable(0, packet.MaterialTable);
+			commandList.SetGraphicsRootConstantBufferView(1, packet.ObjectConstants);
+			commandList.IASetVertexBuffers(0, 1, &packet.VertexBuffer);
+			commandList.IASetIndexBuffer(&packet.IndexBuffer);
+			commandList.DrawIndexedInstanced(packet.IndexCount, packet.InstanceCount, packet.StartIndex, packet.BaseVertex, 0);
+		}
+	}
+
+	void AddMemcpySubresource(PerfSuite& suite)
+	{
+		// Rows of 4000 bytes into 256-byte aligned 4096-byte rows, as texture
+		// uploads land in an upload heap.
+		const UINT Width = 1000;
+		const UINT Height = 1000;
+		const SIZE_T RowSize = Width * 4;
+		const SIZE_T RowPitch = static_cast<SIZE_T>(AlignUp(RowSize, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+
+		auto source = std::make_shared<std::vector<UINT8>>(RowSize * Height, UINT8(1));
+		auto destination = std::make_shared<std::vector<UINT8>>(RowPitch * Height);
+		suite.Add("MemcpySubresource/1000x1000 RGBA8", [=](uint64_t iterations)
+		{
+			D3D12_SUBRESOURCE_DATA src = { source->data(), static_cast<LONG_PTR>(RowSize), static_cast<LONG_PTR>(RowSize * Height) };
+			D3D12_MEMCPY_DEST dest = { destination->data(), RowPitch, RowPitch * Height };
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				MemcpySubresource(&dest, &src, RowSize, Height, 1);
+			}
+			s_Sink = (*destination)[RowPitch];
+		});
+	}
+
+	void AddUpdateSubresources(PerfSuite& suite)
+	{
+		// A full mip chain of a 256x256 texture. The footprints are laid out
+		// the way GetCopyableFootprints would, since there is no device to ask.
+		struct State
+		{
+			ComPtr<NullGraphicsCommandList> CommandList;
+			ComPtr<NullResource> Texture;
+			ComPtr<NullResource> Intermediate;
+			std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Layouts;
+			std::vector<UINT> NumRows;
+			std::vector<UINT64> RowSizes;
+			std::vector<D3D12_SUBRESOURCE_DATA> Data;
+			std::vector<std::vector<UINT8>> Mips;
+			UINT64 RequiredSize = 0;
+		};
+
+		const UINT Size = 256;
+		const UINT16 MipCount = 9;
+
+		auto state = std::make_shared<State>();
+		state->CommandList = NullGraphicsCommandList::Create();
+		state->Texture = NullResource::Create(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, Size, Size, 1, MipCount));
+
+		UINT64 offset = 0;
+		for (UINT mip = 0; mip < MipCount; ++mip)
+		{
+			UINT width = (std::max)(Size >> mip, 1u);
+			UINT height = (std::max)(Size >> mip, 1u);
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = {};
+			layout.Offset = AlignUp(offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+			layout.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			layout.Footprint.Width = width;
+			layout.Footprint.Height = height;
+			layout.Footprint.Depth = 1;
+			layout.Footprint.RowPitch = static_cast<UINT>(AlignUp(width * 4, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+			offset = layout.Offset + UINT64(layout.Footprint.RowPitch) * height;
+
+			state->Layouts.push_back(layout);
+			state->NumRows.push_back(height);
+			state->RowSizes.push_back(width * 4);
+			state->Mips.emplace_back(width * 4 * height, UINT8(mip));
+		}
+		for (UINT mip = 0; mip < MipCount; ++mip)
+		{
+			UINT64 rowSize = state->RowSizes[mip];
+			state->Data.push_back({ state->Mips[mip].data(), static_cast<LONG_PTR>(rowSize), static_cast<LONG_PTR>(rowSize * state->NumRows[mip]) });
+		}
+		state->RequiredSize = offset;
+		state->Intermediate = NullResource::Create(CD3DX12_RESOURCE_DESC::Buffer(offset));
+
+		suite.Add("UpdateSubresources/256x256 RGBA8 9 mips", [state](uint64_t iterations)
+		{
+			UINT64 copied = 0;
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				copied += UpdateSubresources(state->CommandList.Get(), state->Texture.Get(), state->Intermediate.Get(),
+					0, static_cast<UINT>(state->Layouts.size()), state->RequiredSize,
+					state->Layouts.data(), state->NumRows.data(), state->RowSizes.data(), state->Data.data());
+			}
+			s_Sink = copied;
+		});
+	}
+
+	void AddParsePipelineStream(PerfSuite& suite)
+	{
+		struct CountingCallbacks : public ID3DX12PipelineParserCallbacks
+		{
+			UINT64 Subobjects = 0;
+
+			void RootSignatureCb(ID3D12RootSignature*) override { ++Subobjects; }
+			void InputLayoutCb(const D3D12_INPUT_LAYOUT_DESC&) override { ++Subobjects; }
+			void VSCb(const D3D12_SHADER_BYTECODE&) override { ++Subobjects; }
+			void PSCb(const D3D12_SHADER_BYTECODE&) override { ++Subobjects; }
+			void BlendStateCb(const D3D12_BLEND_DESC&) override { ++Subobjects; }
+			void DepthStencilState1Cb(const D3D12_DEPTH_STENCIL_DESC1&) override { ++Subobjects; }
+			void RasterizerStateCb(const D3D12_RASTERIZER_DESC&) override { ++Subobjects; }
+			void RTVFormatsCb(const D3D12_RT_FORMAT_ARRAY&) override { ++Subobjects; }
+		};
+
+		static const D3D12_INPUT_ELEMENT_DESC InputElements[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		static const UINT8 Bytecode[64] = {};
+
+		// Every subobject of a full graphics pipeline, as CreatePipelineState
+		// would receive it.
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+		desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(64));
+		desc.VS = { Bytecode, sizeof(Bytecode) };
+		desc.PS = { Bytecode, sizeof(Bytecode) };
+		desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+		desc.SampleMask = UINT_MAX;
+		desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+		desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+		desc.InputLayout = { InputElements, _countof(InputElements) };
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+		desc.SampleDesc.Count = 1;
+
+		auto stream = std::make_shared<CD3DX12_PIPELINE_STATE_STREAM>(desc);
+		suite.Add("D3DX12ParsePipelineStream/graphics", [stream](uint64_t iterations)
+		{
+			D3D12_PIPELINE_STATE_STREAM_DESC streamDesc = { sizeof(*stream), stream.get() };
+			CountingCallbacks callbacks;
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				ThrowIfFailed(D3DX12ParsePipelineStream(streamDesc, &callbacks));
+			}
+			s_Sink = callbacks.Subobjects;
+		});
+	}
+
+	void AddSerializeRootSignature(PerfSuite& suite)
+	{
+		// A typical forward pass layout: per-draw constants, per-pass CBV,
+		// material and bindless tables, and two static samplers.
+		struct State
+		{
+			CD3DX12_DESCRIPTOR_RANGE1 MaterialRanges[2];
+			CD3DX12_DESCRIPTOR_RANGE1 BindlessRange;
+			CD3DX12_ROOT_PARAMETER1 Parameters[4];
+			CD3DX12_STATIC_SAMPLER_DESC Samplers[2];
+			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC Desc;
+		};
+
+		auto state = std::make_shared<State>();
+		state->MaterialRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		state->MaterialRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+		state->BindlessRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+		state->Parameters[0].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+		state->Parameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC);
+		state->Parameters[2].InitAsDescriptorTable(2, state->MaterialRanges, D3D12_SHADER_VISIBILITY_PIXEL);
+		state->Parameters[3].InitAsDescriptorTable(1, &state->BindlessRange, D3D12_SHADER_VISIBILITY_PIXEL);
+		state->Samplers[0].Init(0, D3D12_FILTER_ANISOTROPIC);
+		state->Samplers[1].Init(1, D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+			D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+		state->Desc.Init_1_1(_countof(state->Parameters), state->Parameters, _countof(state->Samplers), state->Samplers,
+			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+		// 1.1 goes straight to the runtime; 1.0 takes the helper's conversion path.
+		for (D3D_ROOT_SIGNATURE_VERSION version : { D3D_ROOT_SIGNATURE_VERSION_1_1, D3D_ROOT_SIGNATURE_VERSION_1_0 })
+		{
+			std::string name = version == D3D_ROOT_SIGNATURE_VERSION_1_1
+				? "D3DX12SerializeVersionedRootSignature/1.1"
+				: "D3DX12SerializeVersionedRootSignature/1.1 as 1.0";
+			suite.Add(name, [state, version](uint64_t iterations)
+			{
+				UINT64 size = 0;
+				for (uint64_t i = 0; i < iterations; ++i)
+				{
+					ComPtr<ID3DBlob> blob;
+					ComPtr<ID3DBlob> error;
+					ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&state->Desc, version, &blob, &error));
+					size += blob->GetBufferSize();
+				}
+				s_Sink = size;
+			});
+		}
+	}
+
+	void AddStateObjectFlattening(PerfSuite& suite)
+	{
+		// A raytracing pipeline with a hit group per material type, each with
+		// a local root signature association, as a scene with many shaders has.
+		const UINT HitGroupCount = 64;
+
+		struct State
+		{
+			std::vector<std::wstring> Names;
+			CD3DX12_STATE_OBJECT_DESC Desc{ D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE };
+		};
+
+		auto state = std::make_shared<State>();
+		for (UINT i = 0; i < HitGroupCount; ++i)
+		{
+			state->Names.push_back(L"ClosestHit" + std::to_wstring(i));
+			state->Names.push_back(L"HitGroup" + std::to_wstring(i));
+		}
+
+		static const UINT8 Library[64] = {};
+		D3D12_SHADER_BYTECODE libraryCode = { Library, sizeof(Library) };
+		auto library = state->Desc.CreateSubobject<CD3DX12_DXIL_LIBRARY_SUBOBJECT>();
+		library->SetDXILLibrary(&libraryCode);
+		library->DefineExport(L"RayGen");
+		library->DefineExport(L"Miss");
+
+		auto localRootSignature = state->Desc.CreateSubobject<CD3DX12_LOCAL_ROOT_SIGNATURE_SUBOBJECT>();
+		localRootSignature->SetRootSignature(reinterpret_cast<ID3D12RootSignature*>(uintptr_t(64)));
+		auto association = state->Desc.CreateSubobject<CD3DX12_SUBOBJECT_TO_EXPORTS_ASSOCIATION_SUBOBJECT>();
+		association->SetSubobjectToAssociate(*localRootSignature);
+
+		for (UINT i = 0; i < HitGroupCount; ++i)
+		{
+			const std::wstring& closestHit = state->Names[2 * i];
+			const std::wstring& hitGroupName = state->Names[2 * i + 1];
+			library->DefineExport(closestHit.c_str());
+
+			auto hitGroup = state->Desc.CreateSubobject<CD3DX12_HIT_GROUP_SUBOBJECT>();
+			hitGroup->SetClosestHitShaderImport(closestHit.c_str());
+			hitGroup->SetHitGroupExport(hitGroupName.c_str());
+			hitGroup->SetHitGroupType(D3D12_HIT_GROUP_TYPE_TRIANGLES);
+			association->AddExport(hitGroupName.c_str());
+		}
+
+		state->Desc.CreateSubobject<CD3DX12_RAYTRACING_SHADER_CONFIG_SUBOBJECT>()->Config(32, 8);
+		state->Desc.CreateSubobject<CD3DX12_GLOBAL_ROOT_SIGNATURE_SUBOBJECT>()->SetRootSignature(reinterpret_cast<ID3D12RootSignature*>(uintptr_t(128)));
+		state->Desc.CreateSubobject<CD3DX12_RAYTRACING_PIPELINE_CONFIG_SUBOBJECT>()->Config(2);
+
+		suite.Add("CD3DX12_STATE_OBJECT_DESC/flatten 64 hit groups", [state](uint64_t iterations)
+		{
+			UINT64 subobjects = 0;
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				const D3D12_STATE_OBJECT_DESC& desc = state->Desc;
+				subobjects += desc.NumSubobjects;
+			}
+			s_Sink = subobjects;
+		});
+	}
+
+	void AddCaptureReplay(PerfSuite& suite)
+	{
+		// One frame of a capture made without a device: bind state, then draw,
+		// changing what the sorted draws change.
+		struct State
+		{
+			CommandCapture Capture;
+			NullCaptureBackend Backend;
+			CaptureReplayer Replayer;
+		};
+
+		auto state = std::make_shared<State>();
+		std::shared_ptr<DrawScene> scene = CreateDrawScene(4096);
+		{
+			CapturingCommandList list(state->Capture, nullptr);
+			RecordDraws(list, *scene);
+			list.Finish();
+			state->Capture.EndFrame();
+		}
+
+		suite.Add("CaptureReplayer/4096 draws null backend", [state](uint64_t iterations)
+		{
+			UINT64 commands = 0;
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				commands += state->Replayer.Replay(state->Capture, state->Backend, state->Capture.GetCapturedObjects()).Commands;
+			}
+			s_Sink = commands;
+		});
+	}
+
+	void AddCaptureRecording(PerfSuite& suite)
+	{
+		// The same frame recorded straight into a null list and through a
+		// CapturingCommandList forwarding to one. A null call costs next to
+		// nothing where a driver call does not, so the ratio overstates the
+		// overhead a capture adds to real recording.
+		struct State
+		{
+			std::shared_ptr<DrawScene> Scene;
+			ComPtr<NullGraphicsCommandList> CommandList = NullGraphicsCommandList::Create();
+			CommandCapture Capture;
+			std::unique_ptr<CapturingCommandList> Recorder;
+		};
+
+		auto state = std::make_shared<State>();
+		state->Scene = CreateDrawScene(4096);
+		state->Recorder = std::make_unique<CapturingCommandList>(state->Capture, state->CommandList);
+
+		suite.Add("CommandList/4096 draws direct", [state](uint64_t iterations)
+		{
+			ID3D12GraphicsCommandList& commandList = *state->CommandList.Get();
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				RecordDraws(commandList, *state->Scene);
+			}
+			s_Sink = state->CommandList->GetCallCount();
+		});
+
+		suite.Add("CommandList/4096 draws captured", [state](uint64_t iterations)
+		{
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				RecordDraws(*state->Recorder, *state->Scene);
+				state->Recorder->Finish(state->CommandList);
+				// Keeps memory flat; a real capture would save the frame instead.
+				state->Capture.ClearCommandLists();
+			}
+			s_Sink = state->CommandList->GetCallCount();
+		});
+
+		suite.AddRatio("Capture recording overhead/4096 draws",
+			"CommandList/4096 draws captured", "CommandList/4096 draws direct");
+	}
+
+	void AddRendererPaths(PerfSuite& suite)
+	{
+		const size_t DrawCount = 1 << 14;
+		std::shared_ptr<DrawScene> scene = CreateDrawScene(DrawCount);
+
+		auto items = std::make_shared<std::vector<DrawSortItem>>();
+		auto scratch = std::make_shared<std::vector<DrawSortItem>>();
+		suite.Add("RadixSortDrawItems/16384 draws", [scene, items, scratch](uint64_t iterations)
+		{
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				*items = scene->Unsorted;
+				RadixSortDrawItems(*items, *scratch);
+			}
+			s_Sink = items->front().Key;
+		});
+
+		auto commandList = std::make_shared<ShadowedCommandList>(NullGraphicsCommandList::Create());
+		suite.Add("DrawSubmitter/16384 draws", [scene, commandList](uint64_t iterations)
+		{
+			DrawSubmitter submitter{ DrawSubmitter::RootParameters() };
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				// Each iteration is a new command list as far as the shadow knows.
+				commandList->InvalidateState();
+				submitter.Submit(*commandList, scene->Packets, scene->Sorted, 0, scene->Sorted.size());
+			}
+			ShadowedCommandList::EndFrame();
+		});
+
+		struct PackState
+		{
+			std::shared_ptr<SimulatedFence> Fence = std::make_shared<SimulatedFence>();
+			UploadRing Ring;
+			IndirectDrawPacker Packer;
+
+			PackState(UINT64 size)
+				: Ring(Fence, size)
+				, Packer(Ring, IndirectDrawLayout::DrawIdAndDrawIndexed)
+			{
+			}
+		};
+
+		UINT64 frameSize = DrawCount * GetIndirectDrawStride(IndirectDrawLayout::DrawIdAndDrawIndexed);
+		auto pack = std::make_shared<PackState>(4 * AlignUp(frameSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT));
+		suite.Add("IndirectDrawPacker/16384 draws", [scene, pack](uint64_t iterations)
+		{
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				IndirectDrawBatch batch = pack->Packer.Pack(scene->Packets, scene->Sorted, 0, scene->Sorted.size());
+				pack->Ring.Finish(pack->Fence->Signal(nullptr));
+				pack->Fence->CompleteAll();
+				s_Sink = batch.DrawCount;
+			}
+		});
+	}
+
+	void AddJobSystem(PerfSuite& suite)
+	{
+		// A frame of fine-grained jobs, one per item, as JobSystem::RunBenchmark
+		// runs them. The workers sleep between samples.
+		const uint32_t JobCount = 16384;
+		const uint32_t WorkPerJob = 256;
+
+		struct State
+		{
+			JobSystem Jobs;
+			std::vector<float> Results = std::vector<float>(JobCount);
+		};
+
+		auto state = std::make_shared<State>();
+		suite.Add("JobSystem/ParallelFor 16384 jobs", [state](uint64_t iterations)
+		{
+			std::vector<float>& results = state->Results;
+			auto work = [&results](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					float x = static_cast<float>(i);
+					for (uint32_t k = 0; k < WorkPerJob; ++k)
+					{
+						x = x * 0.999f + 0.5f;
+					}
+					results[i] = x;
+				}
+			};
+
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				state->Jobs.Wait(state->Jobs.ParallelFor(0, JobCount, 1, work));
+				state->Jobs.EndFrame();
+			}
+			s_Sink = static_cast<UINT64>(results.back());
+		});
+	}
+
+	void AddProfiler(PerfSuite& suite)
+	{
+		// An empty scope, with recording on and off. The ring is cleared every
+		// few thousand scopes, as MarkFrame would, so scopes never hit a full
+		// ring and get dropped. Recording a scope is meant to cost under 30 ns,
+		// so the suite fails when it does not.
+		const uint64_t ScopesPerFrame = 4096;
+
+		auto measure = [](bool enabled)
+		{
+			return [enabled](uint64_t iterations)
+			{
+				bool wasEnabled = Profiler::IsEnabled();
+				Profiler::SetEnabled(enabled);
+				Profiler::Clear();
+				for (uint64_t i = 0; i < iterations; ++i)
+				{
+					ProfileScope scope("Benchmark");
+					if (i % ScopesPerFrame == ScopesPerFrame - 1)
+					{
+						Profiler::Clear();
+					}
+				}
+				Profiler::Clear();
+				Profiler::SetEnabled(wasEnabled);
+			};
+		};
+
+		suite.Add("ProfileScope/enabled", measure(true));
+		suite.Add("ProfileScope/disabled", measure(false));
+		suite.AddBudget("ProfileScope/enabled", 30.0);
+	}
+
+	void AddErrorChecks(PerfSuite& suite)
+	{
+		// The cost every checked D3D12 call pays when it succeeds. Results are
+		// read through volatile so the check cannot be folded away.
+		suite.Add("ThrowIfFailed/S_OK", [](uint64_t iterations)
+		{
+			static volatile HRESULT s_Results[16] = {};
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				ThrowIfFailed(s_Results[i & 15]);
+			}
+		});
+	}
+}
+
+void AddPerfBenchmarks(PerfSuite& suite)
+{
+	AddMemcpySubresource(suite);
+	AddUpdateSubresources(suite);
+	AddParsePipelineStream(suite);
+	AddSerializeRootSignature(suite);
+	AddStateObjectFlattening(suite);
+	AddCaptureReplay(suite);
+	AddCaptureRecording(suite);
+	AddRendererPaths(suite);
+	AddJobSystem(suite);
+	AddProfiler(suite);
+	AddErrorChecks(suite);
+}
@@ -0,0 +1,566 @@
+#include "../include/PerfSuite.h"
+#include "../include/FileError.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+	const uint32_t JsonVersion = 1;
+
+	// Scale factors that turn a median absolute deviation into a standard
+	// deviation, and a standard deviation into the standard error of a median,
+	// for normally distributed samples.
+	const double DeviationToSigma = 1.4826;
+	const double SigmaToMedianError = 1.2533;
+
+	double GetMedian(std::vector<double> values)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+
+		size_t middle = values.size() / 2;
+		std::nth_element(values.begin(), values.begin() + middle, values.end());
+		double median = values[middle];
+		if (values.size() % 2 == 0)
+		{
+			median = (median + *std::max_element(values.begin(), values.begin() + middle)) / 2.0;
+		}
+		return median;
+	}
+
+	double GetMedianError(const PerfResult& result)
+	{
+		if (result.SampleCount == 0)
+		{
+			return 0.0;
+		}
+		return SigmaToMedianError * DeviationToSigma * result.Deviation / std::sqrt(static_cast<double>(result.SampleCount));
+	}
+
+	double TimeNanoseconds(const PerfSuite::Benchmark& benchmark, uint64_t iterations)
+	{
+		auto start = std::chrono::steady_clock::now();
+		benchmark(iterations);
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	void WriteString(std::ostream& stream, const std::string& value)
+	{
+		stream << '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				stream << '\\';
+			}
+			stream << c;
+		}
+		stream << '"';
+	}
+
+	// Reads the subset of JSON that WriteJson produces, skipping members it
+	// does not know, so files from newer builds with extra fields still load.
+	class JsonReader
+	{
+	public:
+		explicit JsonReader(const std::string& text)
+			: m_Text(text)
+			, m_Position(0)
+		{
+		}
+
+		bool ReadResults(std::vector<PerfResult>& results)
+		{
+			bool versionMatches = false;
+			bool parsed = ReadObject([&](const std::string& key)
+			{
+				if (key == "version")
+				{
+					double version = 0.0;
+					versionMatches = ReadNumber(version) && version == JsonVersion;
+					return versionMatches;
+				}
+				if (key == "benchmarks")
+				{
+					return ReadArray([&]()
+					{
+						PerfResult result;
+						if (!ReadResult(result))
+						{
+							return false;
+						}
+						results.push_back(result);
+						return true;
+					});
+				}
+				return SkipValue();
+			});
+
+			SkipWhitespace();
+			return parsed && versionMatches && m_Position == m_Text.size();
+		}
+
+	private:
+		bool ReadResult(PerfResult& result)
+		{
+			return ReadObject([&](const std::string& key)
+			{
+				double value = 0.0;
+				if (key == "name")
+				{
+					return ReadString(result.Name);
+				}
+				if (key == "samples")
+				{
+					bool read = ReadNumber(value);
+					result.SampleCount = static_cast<uint32_t>(value);
+					return read;
+				}
+				if (key == "iterations")
+				{
+					bool read = ReadNumber(value);
+					result.IterationsPerSample = static_cast<uint64_t>(value);
+					return read;
+				}
+				if (key == "median_ns")
+				{
+					return ReadNumber(result.Median);
+				}
+				if (key == "deviation_ns")
+				{
+					return ReadNumber(result.Deviation);
+				}
+				if (key == "min_ns")
+				{
+					return ReadNumber(result.Min);
+				}
+				return SkipValue();
+			});
+		}
+
+		template <typename ReadMember>
+		bool ReadObject(ReadMember readMember)
+		{
+			if (!Consume('{'))
+			{
+				return false;
+			}
+			if (Consume('}'))
+			{
+				return true;
+			}
+			do
+			{
+				std::string key;
+				if (!ReadString(key) || !Consume(':') || !readMember(key))
+				{
+					return false;
+				}
+			} while (Consume(','));
+			return Consume('}');
+		}
+
+		template <typename ReadElement>
+		bool ReadArray(ReadElement readElement)
+		{
+			if (!Consume('['))
+			{
+				return false;
+			}
+			if (Consume(']'))
+			{
+				return true;
+			}
+			do
+			{
+				if (!readElement())
+				{
+					return false;
+				}
+			} while (Consume(','));
+			return Consume(']');
+		}
+
+		bool ReadString(std::string& value)
+		{
+			if (!Consume('"'))
+			{
+				return false;
+			}
+
+			value.clear();
+			while (m_Position < m_Text.size())
+			{
+				char c = m_Text[m_Position++];
+				if (c == '"')
+				{
+					return true;
+				}
+				if (c == '\\')
+				{
+					if (m_Position == m_Text.size())
+					{
+						return false;
+					}
+					c = m_Text[m_Position++];
+					switch (c)
+					{
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case 'r': c = '\r'; break;
+					case 'b': c = '\b'; break;
+					case 'f': c = '\f'; break;
+					case 'u':
+						// Names are ASCII; anything else only has to be skipped.
+						if (m_Text.size() - m_Position < 4)
+						{
+							return false;
+						}
+						m_Position += 4;
+						c = '?';
+						break;
+					default: break;
+					}
+				}
+				value += c;
+			}
+			return false;
+		}
+
+		bool ReadNumber(double& value)
+		{
+			SkipWhitespace();
+			const char* begin = m_Text.c_str() + m_Position;
+			char* end = nullptr;
+			value = std::strtod(begin, &end);
+			if (end == begin)
+			{
+				return false;
+			}
+			m_Position += end - begin;
+			return true;
+		}
+
+		bool SkipValue()
+		{
+			SkipWhitespace();
+			if (m_Position == m_Text.size())
+			{
+				return false;
+			}
+
+			char c = m_Text[m_Position];
+			if (c == '{')
+			{
+				return ReadObject([this](const std::string&) { return SkipValue(); });
+			}
+			if (c == '[')
+			{
+				return ReadArray([this]() { return SkipValue(); });
+			}
+			if (c == '"')
+			{
+				std::string ignored;
+				return ReadString(ignored);
+			}
+			for (const char* literal : { "true", "false", "null" })
+			{
+				size_t length = strlen(literal);
+				if (m_Text.compare(m_Position, length, literal) == 0)
+				{
+					m_Position += length;
+					return true;
+				}
+			}
+			double ignored = 0.0;
+			return ReadNumber(ignored);
+		}
+
+		bool Consume(char c)
+		{
+			SkipWhitespace();
+			if (m_Position < m_Text.size() && m_Text[m_Position] == c)
+			{
+				++m_Position;
+				return true;
+			}
+			return false;
+		}
+
+		void SkipWhitespace()
+		{
+			while (m_Position < m_Text.size() && (m_Text[m_Position] == ' ' || m_Text[m_Position] == '\t'
+				|| m_Text[m_Position] == '\n' || m_Text[m_Position] == '\r'))
+			{
+				++m_Position;
+			}
+		}
+
+		const std::string& m_Text;
+		size_t m_Position;
+	};
+}
+
+const char* GetPerfVerdictName(PerfVerdict verdict)
+{
+	switch (verdict)
+	{
+	case PerfVerdict::Unchanged: return "unchanged";
+	case PerfVerdict::Improved: return "improved";
+	case PerfVerdict::Regressed: return "REGRESSED";
+	case PerfVerdict::New: return "new";
+	case PerfVerdict::Missing: return "missing";
+	}
+	return "unknown";
+}
+
+void PerfSuite::Add(const std::string& name, Benchmark benchmark)
+{
+	m_Benchmarks.push_back({ name, std::move(benchmark) });
+}
+
+void PerfSuite::AddRatio(const std::string& name, const std::string& benchmark, const std::string& reference)
+{
+	m_Ratios.push_back({ name, benchmark, reference });
+}
+
+std::vector<PerfRatio> PerfSuite::GetRatios(const std::vector<PerfResult>& results) const
+{
+	auto find = [&results](const std::string& name)
+	{
+		auto match = std::find_if(results.begin(), results.end(), [&name](const PerfResult& r) { return r.Name == name; });
+		return match != results.end() ? &*match : nullptr;
+	};
+
+	std::vector<PerfRatio> ratios;
+	for (const RatioEntry& entry : m_Ratios)
+	{
+		const PerfResult* benchmark = find(entry.Benchmark);
+		const PerfResult* reference = find(entry.Reference);
+		if (!benchmark || !reference || reference->Median <= 0.0)
+		{
+			continue;
+		}
+
+		PerfRatio ratio;
+		ratio.Name = entry.Name;
+		ratio.Ratio = benchmark->Median / reference->Median;
+		ratio.Difference = benchmark->Median - reference->Median;
+		ratios.push_back(ratio);
+	}
+	return ratios;
+}
+
+void PerfSuite::AddBudget(const std::string& benchmark, double maxNanoseconds)
+{
+	m_Budgets.push_back({ benchmark, maxNanoseconds });
+}
+
+std::vector<PerfBudget> PerfSuite::GetBudgets(const std::vector<PerfResult>& results) const
+{
+	std::vector<PerfBudget> budgets;
+	for (const BudgetEntry& entry : m_Budgets)
+	{
+		auto match = std::find_if(results.begin(), results.end(), [&entry](const PerfResult& r) { return r.Name == entry.Benchmark; });
+		if (match == results.end())
+		{
+			continue;
+		}
+
+		PerfBudget budget;
+		budget.Name = entry.Benchmark;
+		budget.Median = match->Median;
+		budget.Budget = entry.Nanoseconds;
+		budget.Exceeded = match->Median > entry.Nanoseconds;
+		budgets.push_back(budget);
+	}
+	return budgets;
+}
+
+bool PerfSuite::ExceedsBudget(const std::vector<PerfBudget>& budgets)
+{
+	return std::any_of(budgets.begin(), budgets.end(), [](const PerfBudget& budget) { return budget.Exceeded; });
+}
+
+std::vector<PerfResult> PerfSuite::Run(const Options& options) const
+{
+	std::vector<PerfResult> results;
+	for (const Entry& entry : m_Benchmarks)
+	{
+		if (!options.Filter.empty() && entry.Name.find(options.Filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		// Double the iterations until a run is long enough to time reliably,
+		// then scale to the sample length. This also warms caches and lazily
+		// allocated scratch memory.
+		double sampleNanoseconds = options.SampleMilliseconds * 1e6;
+		uint64_t iterations = 1;
+		double elapsed = TimeNanoseconds(entry.Function, iterations);
+		while (elapsed < sampleNanoseconds / 8 && iterations < (uint64_t(1) << 40))
+		{
+			iterations *= 2;
+			elapsed = TimeNanoseconds(entry.Function, iterations);
+		}
+		double perIteration = (std::max)(elapsed / iterations, 1e-3);
+		iterations = (std::max)(static_cast<uint64_t>(sampleNanoseconds / perIteration), uint64_t(1));
+
+		std::vector<double> samples;
+		for (uint32_t i = 0; i < (std::max)(options.SampleCount, 1u); ++i)
+		{
+			samples.push_back(TimeNanoseconds(entry.Function, iterations) / iterations);
+		}
+
+		PerfResult result;
+		result.Name = entry.Name;
+		result.SampleCount = static_cast<uint32_t>(samples.size());
+		result.IterationsPerSample = iterations;
+		result.Median = GetMedian(samples);
+		result.Min = *std::min_element(samples.begin(), samples.end());
+
+		std::vector<double> deviations;
+		for (double sample : samples)
+		{
+			deviations.push_back(std::fabs(sample - result.Median));
+		}
+		result.Deviation = GetMedian(deviations);
+
+		results.push_back(result);
+	}
+	return results;
+}
+
+std::vector<PerfComparison> PerfSuite::Compare(const std::vector<PerfResult>& baseline,
+	const std::vector<PerfResult>& current, const Thresholds& thresholds)
+{
+	std::vector<PerfComparison> comparisons;
+	for (const PerfResult& result : current)
+	{
+		PerfComparison comparison;
+		comparison.Name = result.Name;
+		comparison.CurrentMedian = result.Median;
+
+		auto match = std::find_if(baseline.begin(), baseline.end(), [&](const PerfResult& b) { return b.Name == result.Name; });
+		if (match == baseline.end() || match->Median <= 0.0)
+		{
+			comparison.Verdict = PerfVerdict::New;
+			comparisons.push_back(comparison);
+			continue;
+		}
+
+		comparison.BaselineMedian = match->Median;
+		comparison.Change = result.Median / match->Median - 1.0;
+
+		double difference = result.Median - match->Median;
+		double error = std::sqrt(GetMedianError(*match) * GetMedianError(*match) + GetMedianError(result) * GetMedianError(result));
+		if (error > 0.0)
+		{
+			comparison.Significance = difference / error;
+		}
+		else if (difference != 0.0)
+		{
+			// Both runs had no spread at all, so any difference is real.
+			comparison.Significance = std::copysign(std::numeric_limits<double>::infinity(), difference);
+		}
+
+		if (comparison.Change > thresholds.Change && comparison.Significance > thresholds.Significance)
+		{
+			comparison.Verdict = PerfVerdict::Regressed;
+		}
+		else if (comparison.Change < -thresholds.Change && comparison.Significance < -thresholds.Significance)
+		{
+			comparison.Verdict = PerfVerdict::Improved;
+		}
+		comparisons.push_back(comparison);
+	}
+
+	for (const PerfResult& result : baseline)
+	{
+		auto match = std::find_if(current.begin(), current.end(), [&](const PerfResult& c) { return c.Name == result.Name; });
+		if (match == current.end())
+		{
+			PerfComparison comparison;
+			comparison.Name = result.Name;
+			comparison.Verdict = PerfVerdict::Missing;
+			comparison.BaselineMedian = result.Median;
+			comparisons.push_back(comparison);
+		}
+	}
+	return comparisons;
+}
+
+bool PerfSuite::HasRegression(const std::vector<PerfComparison>& comparisons)
+{
+	return std::any_of(comparisons.begin(), comparisons.end(),
+		[](const PerfComparison& comparison) { return comparison.Verdict == PerfVerdict::Regressed; });
+}
+
+void PerfSuite::WriteJson(std::ostream& stream, const std::vector<PerfResult>& results)
+{
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	stream << std::fixed << std::setprecision(3);
+
+	stream << "{\n  \"version\": " << JsonVersion << ",\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const PerfResult& result = results[i];
+		stream << (i ? ",\n" : "\n") << "    {\"name\": ";
+		WriteString(stream, result.Name);
+		stream << ", \"samples\": " << result.SampleCount
+			<< ", \"iterations\": " << result.IterationsPerSample
+			<< ", \"median_ns\": " << result.Median
+			<< ", \"deviation_ns\": " << result.Deviation
+			<< ", \"min_ns\": " << result.Min << "}";
+	}
+	stream << "\n  ]\n}\n";
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+void PerfSuite::SaveJson(const std::wstring& path, const std::vector<PerfResult>& results)
+{
+	std::ofstream file(path, std::ios::trunc);
+	WriteJson(file, results);
+
+	file.close();
+	if (!file)
+	{
+		throw FileError("Cannot write", path);
+	}
+}
+
+bool PerfSuite::LoadJson(const std::wstring& path, std::vector<PerfResult>& results)
+{
+	results.clear();
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	std::string contents = text.str();
+	JsonReader reader(contents);
+	if (!reader.ReadResults(results))
+	{
+		results.clear();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,238 @@
+#include "../include/PipelineCompileService.h"
+#include "../include/PipelineLibraryCache.h"
+#include "../include/PipelineStateHash.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <cassert>
+
+using Microsoft::WRL::ComPtr;
+
+struct PipelineCompileJob
+{
+	UINT64 Hash = 0;
+	// Copy of the caller's stream. Pointers inside it still refer to caller memory.
+	std::vector<BYTE> Stream;
+
+	// Guarded by the service mutex.
+	CompilePriority Priority = CompilePriority::Speculative;
+	UINT64 Sequence = 0;
+	bool Queued = false;
+
+	std::promise<ComPtr<ID3D12PipelineState>> Promise;
+	PipelineRequest::Future Future;
+
+	// Set once compilation succeeds. PipelineState keeps the object alive.
+	std::atomic<ID3D12PipelineState*> Ready{ nullptr };
+	ComPtr<ID3D12PipelineState> PipelineState;
+};
+
+ID3D12PipelineState* PipelineRequest::TryGet() const
+{
+	return m_Job ? m_Job->Ready.load(std::memory_order_acquire) : nullptr;
+}
+
+const PipelineRequest::Future& PipelineRequest::GetFuture() const
+{
+	assert(m_Job);
+	return m_Job->Future;
+}
+
+PipelineCompileService::PipelineCompileService(ComPtr<ID3D12Device2> device, PipelineLibraryCache* cache, UINT threadCount)
+	: m_Device(device)
+	, m_Cache(cache)
+	, m_NextSequence(0)
+	, m_ActiveWorkers(0)
+	, m_Stopping(false)
+	, m_Requested(0)
+	, m_Compiled(0)
+	, m_Failed(0)
+	, m_Promoted(0)
+	, m_FallbackDraws(0)
+	, m_SkippedDraws(0)
+{
+	if (threadCount == 0)
+	{
+		// Leave a core for the render thread, but keep one worker on a single
+		// core. hardware_concurrency may be 0.
+		threadCount = (std::max)(2u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	for (UINT i = 0; i < threadCount; ++i)
+	{
+		m_Workers.emplace_back(&PipelineCompileService::WorkerThread, this);
+	}
+}
+
+PipelineCompileService::~PipelineCompileService()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+PipelineRequest PipelineCompileService::Request(D3D12_PIPELINE_STATE_STREAM_DESC desc, CompilePriority priority)
+{
+	// Hash outside the lock, it reads all the shader bytecode.
+	UINT64 hash = HashPipelineStateStream(desc);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	auto it = m_Jobs.find(hash);
+	if (it != m_Jobs.end())
+	{
+		std::shared_ptr<PipelineCompileJob> job = it->second;
+		lock.unlock();
+		Promote(*job, priority);
+		return PipelineRequest(job);
+	}
+
+	auto job = std::make_shared<PipelineCompileJob>();
+	job->Hash = hash;
+	job->Stream.assign(
+		static_cast<const BYTE*>(desc.pPipelineStateSubobjectStream),
+		static_cast<const BYTE*>(desc.pPipelineStateSubobjectStream) + desc.SizeInBytes);
+	job->Priority = priority;
+	job->Sequence = m_NextSequence++;
+	job->Queued = true;
+	job->Future = job->Promise.get_future().share();
+
+	m_Jobs.emplace(hash, job);
+	m_Queue.insert({ job->Priority, job->Sequence, hash });
+	++m_Requested;
+
+	lock.unlock();
+	m_WorkAvailable.notify_one();
+
+	return PipelineRequest(job);
+}
+
+ID3D12PipelineState* PipelineCompileService::Acquire(const PipelineRequest& request, CompilePriority priority, ID3D12PipelineState* fallback)
+{
+	if (ID3D12PipelineState* pipelineState = request.TryGet())
+	{
+		return pipelineState;
+	}
+
+	if (request.IsValid())
+	{
+		Promote(*request.m_Job, priority);
+	}
+
+	if (fallback)
+	{
+		++m_FallbackDraws;
+	}
+	else
+	{
+		++m_SkippedDraws;
+	}
+	return fallback;
+}
+
+void PipelineCompileService::Promote(PipelineCompileJob& job, CompilePriority priority)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Jobs already picked up by a worker cannot be sped up any more.
+	if (!job.Queued || priority <= job.Priority)
+	{
+		return;
+	}
+
+	m_Queue.erase({ job.Priority, job.Sequence, job.Hash });
+	job.Priority = priority;
+	m_Queue.insert({ job.Priority, job.Sequence, job.Hash });
+	++m_Promoted;
+}
+
+void PipelineCompileService::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Idle.wait(lock, [this] { return m_Queue.empty() && m_ActiveWorkers == 0; });
+}
+
+size_t PipelineCompileService::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Queue.size() + m_ActiveWorkers;
+}
+
+PipelineCompileService::Stats PipelineCompileService::GetStats() const
+{
+	Stats stats;
+	stats.Requested = m_Requested;
+	stats.Compiled = m_Compiled;
+	stats.Failed = m_Failed;
+	stats.Promoted = m_Promoted;
+	stats.FallbackDraws = m_FallbackDraws;
+	stats.SkippedDraws = m_SkippedDraws;
+	return stats;
+}
+
+void PipelineCompileService::WorkerThread()
+{
+	for (;;)
+	{
+		std::shared_ptr<PipelineCompileJob> job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkAvailable.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+			if (m_Stopping)
+			{
+				return;
+			}
+
+			QueueKey key = *m_Queue.begin();
+			m_Queue.erase(m_Queue.begin());
+
+			job = m_Jobs.at(key.Hash);
+			job->Queued = false;
+			++m_ActiveWorkers;
+		}
+
+		Compile(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			--m_ActiveWorkers;
+		}
+		m_Idle.notify_all();
+	}
+}
+
+void PipelineCompileService::Compile(PipelineCompileJob& job)
+{
+	D3D12_PIPELINE_STATE_STREAM_DESC desc = { job.Stream.size(), job.Stream.data() };
+
+	try
+	{
+		ComPtr<ID3D12PipelineState> pipelineState;
+		if (m_Cache)
+		{
+			pipelineState = m_Cache->GetOrCreate(desc);
+		}
+		else
+		{
+			ThrowIfFailed(m_Device->CreatePipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+		}
+
+		job.PipelineState = pipelineState;
+		job.Ready.store(job.PipelineState.Get(), std::memory_order_release);
+		job.Promise.set_value(pipelineState);
+		++m_Compiled;
+	}
+	catch (...)
+	{
+		// Failed jobs stay in m_Jobs so the same stream is not retried every frame.
+		job.Promise.set_exception(std::current_exception());
+		++m_Failed;
+	}
+}
@@ -0,0 +1,406 @@
+#include "../include/PipelineLibraryCache.h"
+#include "../include/FileError.h"
+#include "../include/PipelineStateHash.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	const UINT32 UsageLogMagic = 0x55534750; // "PGSU"
+	const UINT32 UsageLogVersion = 1;
+
+	struct UsageLogHeader
+	{
+		UINT32 Magic;
+		UINT32 Version;
+		UINT64 Count;
+	};
+
+	bool ReadFile(const std::wstring& path, std::vector<char>& data)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	std::wstring GetUsageLogPath(const std::wstring& path)
+	{
+		return path + L".usage";
+	}
+}
+
+PipelineLibraryCache::PipelineLibraryCache(ComPtr<ID3D12Device2> device, const std::wstring& path)
+	: m_Device(device)
+	, m_Path(path)
+	, m_PrewarmNext(0)
+	, m_LibraryHits(0)
+	, m_LibraryMisses(0)
+	, m_MemoryHits(0)
+	, m_CreateMicroseconds(0)
+{
+	if (!ReadFile(m_Path, m_LibraryBlob))
+	{
+		m_LibraryBlob.clear();
+	}
+
+	CreateLibrary();
+	LoadUsageLog();
+}
+
+PipelineLibraryCache::~PipelineLibraryCache()
+{
+	WaitForPrewarm();
+
+	try
+	{
+		Save();
+	}
+	catch (...)
+	{
+		// Losing the cache costs startup time next run, nothing more.
+	}
+}
+
+void PipelineLibraryCache::CreateLibrary()
+{
+	m_Library.Reset();
+
+	if (!m_LibraryBlob.empty())
+	{
+		HRESULT hr = m_Device->CreatePipelineLibrary(m_LibraryBlob.data(), m_LibraryBlob.size(), IID_PPV_ARGS(&m_Library));
+		if (SUCCEEDED(hr))
+		{
+			return;
+		}
+
+		// D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND or a
+		// corrupt blob. Start over with an empty library.
+		m_LibraryBlob.clear();
+	}
+
+	HRESULT hr = m_Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_Library));
+	if (hr == DXGI_ERROR_UNSUPPORTED)
+	{
+		// Some drivers don't support pipeline libraries. Keep the in-memory cache only.
+		m_Library.Reset();
+		return;
+	}
+	ThrowIfFailed(hr);
+}
+
+void PipelineLibraryCache::LoadUsageLog()
+{
+	std::vector<char> data;
+	if (!ReadFile(GetUsageLogPath(m_Path), data) || data.size() < sizeof(UsageLogHeader))
+	{
+		return;
+	}
+
+	UsageLogHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	// Count comes from disk: divide rather than multiply, so it cannot wrap.
+	size_t hashBytes = data.size() - sizeof(header);
+	if (header.Magic != UsageLogMagic || header.Version != UsageLogVersion ||
+		hashBytes % sizeof(UINT64) != 0 || header.Count != hashBytes / sizeof(UINT64) || header.Count > UINT_MAX)
+	{
+		return;
+	}
+
+	const char* hashes = data.data() + sizeof(header);
+	for (size_t i = 0; i < header.Count; ++i)
+	{
+		UINT64 hash;
+		memcpy(&hash, hashes + i * sizeof(UINT64), sizeof(hash));
+		m_PreviousUsage.emplace(hash, static_cast<UINT>(i));
+	}
+}
+
+ComPtr<ID3D12PipelineState> PipelineLibraryCache::GetOrCreate(D3D12_PIPELINE_STATE_STREAM_DESC desc)
+{
+	return GetOrCreate(desc, true);
+}
+
+ComPtr<ID3D12PipelineState> PipelineLibraryCache::GetOrCreate(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, bool recordUsage)
+{
+	UINT64 hash = HashPipelineStateStream(desc);
+
+	std::shared_ptr<Entry> entry;
+	bool created = false;
+	{
+		std::lock_guard<std::mutex> lock(m_EntriesMutex);
+
+		std::shared_ptr<Entry>& slot = m_Entries[hash];
+		if (!slot)
+		{
+			slot = std::make_shared<Entry>();
+			created = true;
+		}
+		entry = slot;
+
+		if (recordUsage && !entry->Used)
+		{
+			entry->Used = true;
+			m_Usage.push_back(hash);
+		}
+	}
+
+	if (!created)
+	{
+		++m_MemoryHits;
+	}
+
+	// Other threads asking for the same pipeline wait here instead of creating
+	// it a second time.
+	std::call_once(entry->Created, [&]() { Create(hash, desc, *entry); });
+
+	return entry->PipelineState;
+}
+
+void PipelineLibraryCache::Create(UINT64 hash, const D3D12_PIPELINE_STATE_STREAM_DESC& desc, Entry& entry)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::wstring name = GetPipelineName(hash);
+
+	HRESULT hr = E_INVALIDARG;
+	if (m_Library)
+	{
+		// Fails with E_INVALIDARG if the name is unknown or the stored pipeline
+		// doesn't match the description.
+		hr = m_Library->LoadPipeline(name.c_str(), &desc, IID_PPV_ARGS(&entry.PipelineState));
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		++m_LibraryHits;
+	}
+	else
+	{
+		ThrowIfFailed(m_Device->CreatePipelineState(&desc, IID_PPV_ARGS(&entry.PipelineState)));
+		++m_LibraryMisses;
+
+		if (m_Library)
+		{
+			std::lock_guard<std::mutex> lock(m_LibraryMutex);
+			// E_INVALIDARG here means a stale pipeline already uses the name. It
+			// is replaced the next time the library is rebuilt from scratch.
+			m_Library->StorePipeline(name.c_str(), entry.PipelineState.Get());
+		}
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	m_CreateMicroseconds += elapsed.count();
+}
+
+void PipelineLibraryCache::Prewarm(const std::vector<D3D12_PIPELINE_STATE_STREAM_DESC>& streams, UINT threadCount)
+{
+	WaitForPrewarm();
+
+	std::vector<std::pair<UINT, size_t>> order;
+	order.reserve(streams.size());
+	for (size_t i = 0; i < streams.size(); ++i)
+	{
+		auto previous = m_PreviousUsage.find(HashPipelineStateStream(streams[i]));
+		UINT rank = previous != m_PreviousUsage.end() ? previous->second : UINT_MAX;
+		order.emplace_back(rank, i);
+	}
+	std::stable_sort(order.begin(), order.end());
+
+	m_PrewarmQueue.clear();
+	for (const auto& item : order)
+	{
+		m_PrewarmQueue.push_back(streams[item.second]);
+	}
+	m_PrewarmNext = 0;
+
+	if (threadCount == 0)
+	{
+		// hardware_concurrency may be 0. At least one thread, so the
+		// prewarm still runs on a single core.
+		threadCount = (std::max)(2u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	for (UINT i = 0; i < threadCount; ++i)
+	{
+		m_PrewarmThreads.emplace_back([this]()
+		{
+			// Threads take the next pipeline in order, so the earliest needed
+			// pipelines are always being worked on first.
+			for (size_t index = m_PrewarmNext++; index < m_PrewarmQueue.size(); index = m_PrewarmNext++)
+			{
+				try
+				{
+					GetOrCreate(m_PrewarmQueue[index], false);
+				}
+				catch (...)
+				{
+					// The render thread reports the error when it needs the pipeline.
+				}
+			}
+		});
+	}
+}
+
+void PipelineLibraryCache::WaitForPrewarm()
+{
+	for (std::thread& thread : m_PrewarmThreads)
+	{
+		thread.join();
+	}
+	m_PrewarmThreads.clear();
+	m_PrewarmQueue.clear();
+}
+
+void PipelineLibraryCache::Save()
+{
+	if (m_Library)
+	{
+		std::vector<char> blob;
+		{
+			std::lock_guard<std::mutex> lock(m_LibraryMutex);
+			blob.resize(m_Library->GetSerializedSize());
+			ThrowIfFailed(m_Library->Serialize(blob.data(), blob.size()));
+		}
+		WriteFileAtomic(m_Path, blob.data(), blob.size());
+	}
+
+	// This run's order first, then pipelines from earlier runs that weren't
+	// needed this time, so rarely used pipelines aren't forgotten.
+	std::vector<UINT64> usage;
+	{
+		std::lock_guard<std::mutex> lock(m_EntriesMutex);
+		usage = m_Usage;
+
+		std::vector<std::pair<UINT, UINT64>> previous;
+		for (const auto& item : m_PreviousUsage)
+		{
+			auto entry = m_Entries.find(item.first);
+			if (entry == m_Entries.end() || !entry->second->Used)
+			{
+				previous.emplace_back(item.second, item.first);
+			}
+		}
+		std::sort(previous.begin(), previous.end());
+		for (const auto& item : previous)
+		{
+			usage.push_back(item.second);
+		}
+	}
+
+	std::vector<char> log(sizeof(UsageLogHeader) + usage.size() * sizeof(UINT64));
+	UsageLogHeader header = { UsageLogMagic, UsageLogVersion, usage.size() };
+	memcpy(log.data(), &header, sizeof(header));
+	if (!usage.empty())
+	{
+		memcpy(log.data() + sizeof(header), usage.data(), usage.size() * sizeof(UINT64));
+	}
+	WriteFileAtomic(GetUsageLogPath(m_Path), log.data(), log.size());
+}
+
+void PipelineLibraryCache::Clear()
+{
+	WaitForPrewarm();
+
+	{
+		std::lock_guard<std::mutex> lock(m_EntriesMutex);
+		m_Entries.clear();
+		m_Usage.clear();
+		m_PreviousUsage.clear();
+	}
+
+	DeleteFileW(m_Path.c_str());
+	DeleteFileW(GetUsageLogPath(m_Path).c_str());
+
+	std::lock_guard<std::mutex> lock(m_LibraryMutex);
+	m_LibraryBlob.clear();
+	CreateLibrary();
+}
+
+PipelineLibraryCache::Stats PipelineLibraryCache::GetStats() const
+{
+	Stats stats;
+	stats.LibraryHits = m_LibraryHits;
+	stats.LibraryMisses = m_LibraryMisses;
+	stats.MemoryHits = m_MemoryHits;
+	stats.CreateMilliseconds = m_CreateMicroseconds / 1000.0;
+	return stats;
+}
+
+std::wstring PipelineLibraryCache::GetPipelineName(UINT64 hash)
+{
+	wchar_t name[17];
+	swprintf_s(name, L"%016llx", hash);
+	return name;
+}
+
+void PipelineLibraryCache::WriteFileAtomic(const std::wstring& path, const void* data, size_t size)
+{
+	std::wstring temporaryPath = path + L".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(static_cast<const char*>(data), size);
+		file.close();
+		if (!file)
+		{
+			DeleteFileW(temporaryPath.c_str());
+			throw FileError("Cannot write", temporaryPath);
+		}
+	}
+
+	if (!MoveFileExW(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFileW(temporaryPath.c_str());
+		throw FileError("Cannot replace", path);
+	}
+}
+
+PipelineLibraryCache::BenchmarkResult PipelineLibraryCache::RunBenchmark(
+	ComPtr<ID3D12Device2> device,
+	const std::wstring& path,
+	const std::vector<D3D12_PIPELINE_STATE_STREAM_DESC>& streams)
+{
+	using Clock = std::chrono::steady_clock;
+
+	BenchmarkResult result;
+	result.PipelineCount = static_cast<UINT>(streams.size());
+
+	// Note that the driver's own shader cache also warms up during the cold
+	// pass, so the cold number is a lower bound for a true first run.
+	{
+		PipelineLibraryCache cache(device, path);
+		cache.Clear();
+
+		auto start = Clock::now();
+		for (const D3D12_PIPELINE_STATE_STREAM_DESC& stream : streams)
+		{
+			cache.GetOrCreate(stream);
+		}
+		result.ColdMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	{
+		PipelineLibraryCache cache(device, path);
+
+		auto start = Clock::now();
+		for (const D3D12_PIPELINE_STATE_STREAM_DESC& stream : streams)
+		{
+			cache.GetOrCreate(stream);
+		}
+		result.WarmMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		result.WarmLibraryHits = cache.GetStats().LibraryHits;
+	}
+
+	return result;
+}
@@ -0,0 +1,293 @@
+#include "../include/PipelineStateHash.h"
+#include "../include/d3dx12.h"
+#include "../include/Hash.h"
+#include "../include/helpers.h"
+
+namespace
+{
+	// {6C1A3E52-2D8B-4F4E-9B71-3A0C5E9D7F21}
+	const GUID RootSignatureHashGuid = { 0x6c1a3e52, 0x2d8b, 0x4f4e, { 0x9b, 0x71, 0x3a, 0x0c, 0x5e, 0x9d, 0x7f, 0x21 } };
+
+	uint64_t HashShader(const D3D12_SHADER_BYTECODE& shader, uint64_t seed)
+	{
+		seed = HashValue(shader.BytecodeLength, seed);
+		return HashBytes(shader.pShaderBytecode, shader.BytecodeLength, seed);
+	}
+
+	uint64_t HashInputLayout(const D3D12_INPUT_LAYOUT_DESC& inputLayout, uint64_t seed)
+	{
+		seed = HashValue(inputLayout.NumElements, seed);
+		for (UINT i = 0; i < inputLayout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[i];
+			seed = HashString(element.SemanticName, seed);
+			seed = HashValue(element.SemanticIndex, seed);
+			seed = HashValue(element.Format, seed);
+			seed = HashValue(element.InputSlot, seed);
+			seed = HashValue(element.AlignedByteOffset, seed);
+			seed = HashValue(element.InputSlotClass, seed);
+			seed = HashValue(element.InstanceDataStepRate, seed);
+		}
+		return seed;
+	}
+
+	uint64_t HashStreamOutput(const D3D12_STREAM_OUTPUT_DESC& streamOutput, uint64_t seed)
+	{
+		seed = HashValue(streamOutput.NumEntries, seed);
+		for (UINT i = 0; i < streamOutput.NumEntries; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+			seed = HashValue(entry.Stream, seed);
+			seed = HashString(entry.SemanticName, seed);
+			seed = HashValue(entry.SemanticIndex, seed);
+			seed = HashValue(entry.StartComponent, seed);
+			seed = HashValue(entry.ComponentCount, seed);
+			seed = HashValue(entry.OutputSlot, seed);
+		}
+		seed = HashValue(streamOutput.NumStrides, seed);
+		seed = HashBytes(streamOutput.pBufferStrides, streamOutput.NumStrides * sizeof(UINT), seed);
+		return HashValue(streamOutput.RasterizedStream, seed);
+	}
+
+	// D3D12_RENDER_TARGET_BLEND_DESC ends in a UINT8, so it is hashed field by field.
+	uint64_t HashBlend(const D3D12_BLEND_DESC& blend, uint64_t seed)
+	{
+		seed = HashValue(blend.AlphaToCoverageEnable, seed);
+		seed = HashValue(blend.IndependentBlendEnable, seed);
+		for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+		{
+			seed = HashValue(target.BlendEnable, seed);
+			seed = HashValue(target.LogicOpEnable, seed);
+			seed = HashValue(target.SrcBlend, seed);
+			seed = HashValue(target.DestBlend, seed);
+			seed = HashValue(target.BlendOp, seed);
+			seed = HashValue(target.SrcBlendAlpha, seed);
+			seed = HashValue(target.DestBlendAlpha, seed);
+			seed = HashValue(target.BlendOpAlpha, seed);
+			seed = HashValue(target.LogicOp, seed);
+			seed = HashValue(target.RenderTargetWriteMask, seed);
+		}
+		return seed;
+	}
+
+	uint64_t HashDepthStencil(const D3D12_DEPTH_STENCIL_DESC1& depthStencil, uint64_t seed)
+	{
+		seed = HashValue(depthStencil.DepthEnable, seed);
+		seed = HashValue(depthStencil.DepthWriteMask, seed);
+		seed = HashValue(depthStencil.DepthFunc, seed);
+		seed = HashValue(depthStencil.StencilEnable, seed);
+		seed = HashValue(depthStencil.StencilReadMask, seed);
+		seed = HashValue(depthStencil.StencilWriteMask, seed);
+		seed = HashValue(depthStencil.FrontFace, seed);
+		seed = HashValue(depthStencil.BackFace, seed);
+		return HashValue(depthStencil.DepthBoundsTestEnable, seed);
+	}
+
+	uint64_t HashViewInstancing(const D3D12_VIEW_INSTANCING_DESC& viewInstancing, uint64_t seed)
+	{
+		seed = HashValue(viewInstancing.ViewInstanceCount, seed);
+		seed = HashBytes(viewInstancing.pViewInstanceLocations,
+			viewInstancing.ViewInstanceCount * sizeof(D3D12_VIEW_INSTANCE_LOCATION), seed);
+		return HashValue(viewInstancing.Flags, seed);
+	}
+
+	// Per-subobject hashes, indexed by base subobject type so that
+	// DEPTH_STENCIL and DEPTH_STENCIL1 share a slot.
+	struct SubobjectHashes
+	{
+		uint64_t Slots[D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID] = {};
+		bool Seen[D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID] = {};
+		DXGI_FORMAT DSVFormat = DXGI_FORMAT_UNKNOWN;
+	};
+
+	template <typename Subobject>
+	const Subobject& ReadSubobject(const BYTE* subobject, SIZE_T& size)
+	{
+		size = sizeof(Subobject);
+		return *reinterpret_cast<const Subobject*>(subobject);
+	}
+
+	uint64_t HashDepthStencilSubobject(const D3D12_DEPTH_STENCIL_DESC1& depthStencil)
+	{
+		return HashDepthStencil(depthStencil, HashValue(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL));
+	}
+
+	// Walks the stream in place, the way D3DX12ParsePipelineStream does, but
+	// hashes each subobject where it lies instead of copying it into a full
+	// CD3DX12_PIPELINE_STATE_STREAM1. A compact PipelineStream only pays for
+	// the subobjects it holds.
+	void HashSubobjects(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, SubobjectHashes& hashes)
+	{
+		if (desc.SizeInBytes == 0 || !desc.pPipelineStateSubobjectStream)
+		{
+			ThrowIfFailed(E_INVALIDARG);
+		}
+
+		const BYTE* stream = static_cast<const BYTE*>(desc.pPipelineStateSubobjectStream);
+		for (SIZE_T offset = 0, size = 0; offset < desc.SizeInBytes; offset += size)
+		{
+			const BYTE* subobject = stream + offset;
+			D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = *reinterpret_cast<const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE*>(subobject);
+			if (type < 0 || type >= D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID)
+			{
+				ThrowIfFailed(E_INVALIDARG);
+			}
+
+			D3D12_PIPELINE_STATE_SUBOBJECT_TYPE slot = D3DX12GetBaseSubobjectType(type);
+			if (hashes.Seen[slot])
+			{
+				ThrowIfFailed(E_INVALIDARG);
+			}
+			hashes.Seen[slot] = true;
+
+			uint64_t hash = HashValue(slot);
+			switch (type)
+			{
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE:
+				hash = HashValue(GetRootSignatureHash(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS:
+				hash = HashShader(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_VS>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS:
+				hash = HashShader(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_PS>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS:
+				hash = HashShader(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_DS>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS:
+				hash = HashShader(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_HS>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS:
+				hash = HashShader(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_GS>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS:
+				hash = HashShader(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_CS>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT:
+				hash = HashStreamOutput(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_STREAM_OUTPUT>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND:
+				hash = HashBlend(static_cast<const CD3DX12_BLEND_DESC&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_BLEND_DESC>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK:
+				hash = HashValue(static_cast<UINT>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_SAMPLE_MASK>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER:
+				hash = HashValue(static_cast<const D3D12_RASTERIZER_DESC&>(static_cast<const CD3DX12_RASTERIZER_DESC&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_RASTERIZER>(subobject, size))), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL:
+				hash = HashDepthStencilSubobject(CD3DX12_DEPTH_STENCIL_DESC1(static_cast<const CD3DX12_DEPTH_STENCIL_DESC&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL>(subobject, size))));
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1:
+				hash = HashDepthStencilSubobject(static_cast<const CD3DX12_DEPTH_STENCIL_DESC1&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL1>(subobject, size)));
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT:
+				hash = HashInputLayout(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT>(subobject, size), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE:
+				hash = HashValue(static_cast<D3D12_INDEX_BUFFER_STRIP_CUT_VALUE>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_IB_STRIP_CUT_VALUE>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY:
+				hash = HashValue(static_cast<D3D12_PRIMITIVE_TOPOLOGY_TYPE>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS:
+				hash = HashValue(static_cast<const D3D12_RT_FORMAT_ARRAY&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT:
+				hashes.DSVFormat = ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT>(subobject, size);
+				hash = HashValue(hashes.DSVFormat, hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC:
+				hash = HashValue(static_cast<const DXGI_SAMPLE_DESC&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_SAMPLE_DESC>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK:
+				hash = HashValue(static_cast<UINT>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_NODE_MASK>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO:
+				// The cached blob is an input to creation, not part of the pipeline's identity.
+				ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_CACHED_PSO>(subobject, size);
+				continue;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS:
+				hash = HashValue(static_cast<D3D12_PIPELINE_STATE_FLAGS>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_FLAGS>(subobject, size)), hash);
+				break;
+			case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING:
+				hash = HashViewInstancing(static_cast<const CD3DX12_VIEW_INSTANCING_DESC&>(ReadSubobject<CD3DX12_PIPELINE_STATE_STREAM_VIEW_INSTANCING>(subobject, size)), hash);
+				break;
+			default:
+				ThrowIfFailed(E_INVALIDARG);
+			}
+			hashes.Slots[slot] = hash;
+		}
+	}
+
+	// Slot hashes of the stream D3DX12ParsePipelineStream starts from, which
+	// is what an absent subobject stands for.
+	const SubobjectHashes& GetDefaultSubobjectHashes()
+	{
+		static const SubobjectHashes s_Defaults = []
+		{
+			CD3DX12_PIPELINE_STATE_STREAM_PARSE_HELPER parser;
+			D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(parser.PipelineStream), &parser.PipelineStream };
+			SubobjectHashes hashes;
+			HashSubobjects(desc, hashes);
+			return hashes;
+		}();
+		return s_Defaults;
+	}
+
+	uint64_t GetDepthEnabledSubobjectHash()
+	{
+		static const uint64_t s_Hash = HashDepthStencilSubobject(CD3DX12_DEPTH_STENCIL_DESC1(D3D12_DEFAULT));
+		return s_Hash;
+	}
+}
+
+void SetRootSignatureHash(ID3D12RootSignature* rootSignature, const void* serializedBlob, SIZE_T blobSize)
+{
+	UINT64 hash = HashBytes(serializedBlob, blobSize);
+	ThrowIfFailed(rootSignature->SetPrivateData(RootSignatureHashGuid, sizeof(hash), &hash));
+}
+
+UINT64 GetRootSignatureHash(ID3D12RootSignature* rootSignature)
+{
+	if (!rootSignature)
+	{
+		return 0;
+	}
+
+	UINT64 hash = 0;
+	UINT size = sizeof(hash);
+	// Fails if SetRootSignatureHash was never called for this root signature.
+	ThrowIfFailed(rootSignature->GetPrivateData(RootSignatureHashGuid, &size, &hash));
+	return hash;
+}
+
+UINT64 HashPipelineStateStream(D3D12_PIPELINE_STATE_STREAM_DESC desc)
+{
+	SubobjectHashes hashes;
+	HashSubobjects(desc, hashes);
+
+	// Subobjects equal to their default are left out, so that omitting one
+	// and spelling out its default give the same hash. As in
+	// CD3DX12_PIPELINE_STATE_STREAM_PARSE_HELPER, the default depth-stencil
+	// state has depth enabled only when a depth-stencil format is set.
+	const SubobjectHashes& defaults = GetDefaultSubobjectHashes();
+	uint64_t hash = HashOffsetBasis;
+	for (size_t slot = 0; slot < D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID; ++slot)
+	{
+		uint64_t defaultHash = defaults.Slots[slot];
+		if (slot == D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL && hashes.DSVFormat != DXGI_FORMAT_UNKNOWN)
+		{
+			defaultHash = GetDepthEnabledSubobjectHash();
+		}
+
+		uint64_t slotHash = hashes.Seen[slot] ? hashes.Slots[slot] : defaultHash;
+		if (slotHash != defaultHash)
+		{
+			hash = HashValue(slot, hash);
+			hash = HashCombine(hash, slotHash);
+		}
+	}
+	return hash;
+}
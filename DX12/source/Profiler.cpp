@@ -0,0 +1,677 @@
+#include "../include/Profiler.h"
+#include "../include/FileError.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC 1
+#endif
+
+namespace
+{
+	enum class EventType : uint32_t
+	{
+		Begin,
+		End,
+		Counter,
+		Frame,
+	};
+
+	struct Event
+	{
+		uint64_t Ticks;
+		const char* Name;
+		int64_t Value;
+		EventType Type;
+	};
+
+	// The time stamp counter is invariant on every x64 CPU D3D12 runs on and
+	// usually costs a fraction of steady_clock, which is QueryPerformanceCounter
+	// on Windows. Some virtual machines make reading it slow, so ChooseClock
+	// times both and steady_clock is used when it is the cheaper one. Ticks
+	// are converted to time at export, against steady_clock.
+	bool s_UseTsc = false;
+
+	uint64_t ReadSteadyClock()
+	{
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	}
+
+	uint64_t ReadTicks()
+	{
+#if PROFILER_RDTSC
+		if (s_UseTsc)
+		{
+			return __rdtsc();
+		}
+#endif
+		return ReadSteadyClock();
+	}
+
+	// Runs once, before the first tick is read.
+	bool ChooseClock()
+	{
+#if PROFILER_RDTSC
+		const uint32_t readCount = 4096;
+		uint64_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < readCount; ++i)
+		{
+			sink += __rdtsc();
+		}
+		auto middle = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < readCount; ++i)
+		{
+			sink += ReadSteadyClock();
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		// The sum keeps the loops from being optimized away.
+		s_UseTsc = middle - start <= end - middle || sink == 0;
+#endif
+		return s_UseTsc;
+	}
+
+	// Single producer, single consumer ring owned by one thread. The owner
+	// pushes, Collect pops under the registry mutex.
+	class ThreadBuffer
+	{
+	public:
+		ThreadBuffer()
+			: m_Events(Profiler::EventsPerThread)
+			, m_Write(0)
+			, m_CachedRead(0)
+			, m_OpenScopes(0)
+			, m_Dropped(0)
+			, m_Read(0)
+		{
+		}
+
+		// Space for the end of every open scope is kept free, so a recorded
+		// scope can always end.
+		bool Begin(const char* name)
+		{
+			if (!Push({ ReadTicks(), name, 0, EventType::Begin }, m_OpenScopes + 1))
+			{
+				return false;
+			}
+			++m_OpenScopes;
+			return true;
+		}
+
+		void End()
+		{
+			assert(m_OpenScopes > 0 && "EndScope without a recorded BeginScope.");
+			--m_OpenScopes;
+			bool pushed = Push({ ReadTicks(), nullptr, 0, EventType::End }, 0);
+			assert(pushed && "The end of a scope always has space.");
+			(void)pushed;
+		}
+
+		bool Mark(EventType type, const char* name, int64_t value)
+		{
+			return Push({ ReadTicks(), name, value, type }, m_OpenScopes);
+		}
+
+		template <typename Function>
+		void Drain(const Function& function)
+		{
+			uint64_t read = m_Read.load(std::memory_order_relaxed);
+			uint64_t write = m_Write.load(std::memory_order_acquire);
+			for (; read != write; ++read)
+			{
+				function(m_Events[read & (Profiler::EventsPerThread - 1)]);
+			}
+			m_Read.store(write, std::memory_order_release);
+		}
+
+		// For a new owner, once the last one has exited. Scopes it left open
+		// never end.
+		void Reuse() { m_OpenScopes = 0; }
+
+		uint64_t GetDropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+		void ResetDropped() { m_Dropped.store(0, std::memory_order_relaxed); }
+
+	private:
+		bool Push(const Event& event, uint32_t reserved)
+		{
+			uint64_t write = m_Write.load(std::memory_order_relaxed);
+			if (write + 1 + reserved - m_CachedRead > Profiler::EventsPerThread)
+			{
+				m_CachedRead = m_Read.load(std::memory_order_acquire);
+				if (write + 1 + reserved - m_CachedRead > Profiler::EventsPerThread)
+				{
+					m_Dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+			}
+			m_Events[write & (Profiler::EventsPerThread - 1)] = event;
+			m_Write.store(write + 1, std::memory_order_release);
+			return true;
+		}
+
+		std::vector<Event> m_Events;
+
+		// Written by the owning thread.
+		alignas(64) std::atomic<uint64_t> m_Write;
+		uint64_t m_CachedRead;
+		uint32_t m_OpenScopes;
+		std::atomic<uint64_t> m_Dropped;
+
+		// Written by Collect.
+		alignas(64) std::atomic<uint64_t> m_Read;
+	};
+
+	static_assert((Profiler::EventsPerThread & (Profiler::EventsPerThread - 1)) == 0, "EventsPerThread must be a power of two.");
+
+	enum class ThreadState
+	{
+		Running,
+		Exited,    // Its ring may still hold events.
+		Reusable,  // Collected since it exited.
+	};
+
+	struct ThreadRecord
+	{
+		uint32_t Id;
+		std::string Name;
+		ThreadBuffer Buffer;
+		std::deque<Event> Events;
+		ThreadState State = ThreadState::Running;
+	};
+
+	struct TrackScope
+	{
+		const char* Name;
+		std::chrono::steady_clock::time_point Begin;
+		std::chrono::steady_clock::time_point End;
+	};
+
+	struct Track
+	{
+		uint32_t Id;
+		std::string Name;
+		std::deque<TrackScope> Scopes;
+	};
+
+	// Track ids start above any thread's, so the two never clash.
+	const uint32_t FirstTrackId = 1 << 16;
+
+	// Records are kept after their thread exits, so its events can still be
+	// exported, and handed to the next thread that starts recording. There
+	// are never more than the most threads ever recording at once.
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadRecord>> Threads;
+		std::vector<std::unique_ptr<Track>> Tracks;
+
+		// Picked before anything reads a tick; every thread records with it.
+		bool UseTsc = ChooseClock();
+
+		// Ticks and time at startup, to convert ticks at export.
+		uint64_t StartTicks = ReadTicks();
+		std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	// Start the clock at startup rather than at the first event, so scopes
+	// timed before then, such as GPU scopes read back later, are not negative.
+	const Registry& s_Registry = GetRegistry();
+
+	std::atomic<bool> s_Enabled(true);
+	std::atomic<uint64_t> s_FrameNumber(0);
+	thread_local ThreadRecord* t_Thread = nullptr;
+
+	// Kept apart from t_Thread, which would otherwise need a check that the
+	// guard is constructed on every access.
+	struct ThreadGuard
+	{
+		ThreadRecord* Record = nullptr;
+
+		~ThreadGuard()
+		{
+			if (Record)
+			{
+				std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+				Record->State = ThreadState::Exited;
+			}
+			t_Thread = nullptr;
+		}
+	};
+
+	thread_local ThreadGuard t_Guard;
+
+	ThreadRecord& RegisterThread()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		auto reusable = std::find_if(registry.Threads.begin(), registry.Threads.end(),
+			[](const std::unique_ptr<ThreadRecord>& thread) { return thread->State == ThreadState::Reusable; });
+		if (reusable != registry.Threads.end())
+		{
+			t_Thread = reusable->get();
+			t_Thread->Buffer.Reuse();
+			t_Thread->State = ThreadState::Running;
+		}
+		else
+		{
+			registry.Threads.push_back(std::make_unique<ThreadRecord>());
+			t_Thread = registry.Threads.back().get();
+			t_Thread->Id = static_cast<uint32_t>(registry.Threads.size());
+		}
+		t_Thread->Name = "Thread " + std::to_string(t_Thread->Id);
+		t_Guard.Record = t_Thread;
+		return *t_Thread;
+	}
+
+	// Drain a thread's ring. Once a thread has exited, nothing else is
+	// written to its ring, so one drain after that empties it for good.
+	template <typename Function>
+	void DrainThread(ThreadRecord& thread, const Function& function)
+	{
+		thread.Buffer.Drain(function);
+		if (thread.State == ThreadState::Exited)
+		{
+			thread.State = ThreadState::Reusable;
+		}
+	}
+
+	// Drop the oldest events of all threads until at most CapturedEvents are
+	// left. Each thread's events are in order, so the oldest is always at the
+	// front of one of them.
+	void TrimCapture(Registry& registry)
+	{
+		size_t total = 0;
+		for (const std::unique_ptr<ThreadRecord>& thread : registry.Threads)
+		{
+			total += thread->Events.size();
+		}
+		if (total <= Profiler::CapturedEvents)
+		{
+			return;
+		}
+
+		auto newer = [](const std::deque<Event>* a, const std::deque<Event>* b) { return a->front().Ticks > b->front().Ticks; };
+		std::vector<std::deque<Event>*> heap;
+		for (const std::unique_ptr<ThreadRecord>& thread : registry.Threads)
+		{
+			if (!thread->Events.empty())
+			{
+				heap.push_back(&thread->Events);
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), newer);
+
+		size_t excess = total - Profiler::CapturedEvents;
+		while (excess > 0)
+		{
+			std::pop_heap(heap.begin(), heap.end(), newer);
+			std::deque<Event>& oldest = *heap.back();
+			// Drop a run at a time, up to where another thread's events begin.
+			uint64_t next = heap.size() > 1 ? heap.front()->front().Ticks : UINT64_MAX;
+			do
+			{
+				oldest.pop_front();
+				--excess;
+			}
+			while (excess > 0 && !oldest.empty() && oldest.front().Ticks <= next);
+
+			if (oldest.empty())
+			{
+				heap.pop_back();
+			}
+			else
+			{
+				std::push_heap(heap.begin(), heap.end(), newer);
+			}
+		}
+	}
+
+	// Registration is kept out of line so the common case inlines.
+	ThreadRecord& GetThreadRecord()
+	{
+		return t_Thread ? *t_Thread : RegisterThread();
+	}
+
+	// Measured against steady_clock over the life of the process so far, so
+	// the longer the capture the more exact.
+	double GetMicrosecondsPerTick(const Registry& registry)
+	{
+		std::chrono::steady_clock::time_point minimum = registry.StartTime + std::chrono::milliseconds(10);
+		while (std::chrono::steady_clock::now() < minimum)
+		{
+		}
+
+		uint64_t ticks = ReadTicks();
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double microseconds = std::chrono::duration<double, std::micro>(now - registry.StartTime).count();
+		return microseconds / static_cast<double>(ticks - registry.StartTicks);
+	}
+
+	void WriteJsonString(std::ostream& stream, const char* text)
+	{
+		stream << '"';
+		for (const char* c = text; *c; ++c)
+		{
+			switch (*c)
+			{
+			case '"': stream << "\\\""; break;
+			case '\\': stream << "\\\\"; break;
+			case '\n': stream << "\\n"; break;
+			case '\t': stream << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(*c) < 0x20)
+				{
+					stream << '?';
+				}
+				else
+				{
+					stream << *c;
+				}
+			}
+		}
+		stream << '"';
+	}
+
+	template <typename Function>
+	double MeasureNanoseconds(uint32_t count, const Function& function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			function();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / count;
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return s_Enabled.load(std::memory_order_relaxed);
+}
+
+bool Profiler::BeginScope(const char* name)
+{
+	if (!s_Enabled.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+	return GetThreadRecord().Buffer.Begin(name);
+}
+
+void Profiler::EndScope()
+{
+	GetThreadRecord().Buffer.End();
+}
+
+void Profiler::Counter(const char* name, int64_t value)
+{
+	if (s_Enabled.load(std::memory_order_relaxed))
+	{
+		GetThreadRecord().Buffer.Mark(EventType::Counter, name, value);
+	}
+}
+
+void Profiler::MarkFrame()
+{
+	uint64_t frame = s_FrameNumber.fetch_add(1, std::memory_order_relaxed);
+	if (s_Enabled.load(std::memory_order_relaxed))
+	{
+		GetThreadRecord().Buffer.Mark(EventType::Frame, "Frame", static_cast<int64_t>(frame));
+	}
+	Collect();
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadRecord& thread = GetThreadRecord();
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	thread.Name = name;
+}
+
+void Profiler::AddTrackScope(const char* track, const char* name,
+	std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+	if (!s_Enabled.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	auto found = std::find_if(registry.Tracks.begin(), registry.Tracks.end(),
+		[track](const std::unique_ptr<Track>& existing) { return existing->Name == track; });
+	if (found == registry.Tracks.end())
+	{
+		registry.Tracks.push_back(std::make_unique<Track>());
+		registry.Tracks.back()->Id = FirstTrackId + static_cast<uint32_t>(registry.Tracks.size()) - 1;
+		registry.Tracks.back()->Name = track;
+		found = registry.Tracks.end() - 1;
+	}
+
+	std::deque<TrackScope>& scopes = (*found)->Scopes;
+	scopes.push_back({ name, begin, end });
+	if (scopes.size() > CapturedEventsPerThread)
+	{
+		scopes.pop_front();
+	}
+}
+
+void Profiler::Collect()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	for (const std::unique_ptr<ThreadRecord>& thread : registry.Threads)
+	{
+		std::deque<Event>& events = thread->Events;
+		DrainThread(*thread, [&events](const Event& event) { events.push_back(event); });
+		while (events.size() > CapturedEventsPerThread)
+		{
+			events.pop_front();
+		}
+	}
+	TrimCapture(registry);
+}
+
+void Profiler::Clear()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	for (const std::unique_ptr<ThreadRecord>& thread : registry.Threads)
+	{
+		DrainThread(*thread, [](const Event&) {});
+		thread->Buffer.ResetDropped();
+		thread->Events.clear();
+	}
+	for (const std::unique_ptr<Track>& track : registry.Tracks)
+	{
+		track->Scopes.clear();
+	}
+}
+
+uint64_t Profiler::GetDroppedEventCount()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	uint64_t dropped = 0;
+	for (const std::unique_ptr<ThreadRecord>& thread : registry.Threads)
+	{
+		dropped += thread->Buffer.GetDropped();
+	}
+	return dropped;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& stream)
+{
+	Collect();
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	double microsecondsPerTick = GetMicrosecondsPerTick(registry);
+	auto toMicroseconds = [&](uint64_t ticks)
+	{
+		return static_cast<double>(ticks - registry.StartTicks) * microsecondsPerTick;
+	};
+
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	stream.setf(std::ios::fixed, std::ios::floatfield);
+	stream.precision(3);
+
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"DX12\"}}";
+
+	struct OpenScope
+	{
+		const char* Name;
+		uint64_t Ticks;
+	};
+	std::vector<OpenScope> open;
+
+	for (const std::unique_ptr<ThreadRecord>& thread : registry.Threads)
+	{
+		uint32_t tid = thread->Id;
+		stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+		WriteJsonString(stream, thread->Name.c_str());
+		stream << "}}";
+
+		open.clear();
+		for (const Event& event : thread->Events)
+		{
+			switch (event.Type)
+			{
+			case EventType::Begin:
+				open.push_back({ event.Name, event.Ticks });
+				break;
+
+			case EventType::End:
+				// The begin may have been dropped by Clear or trimmed off.
+				if (!open.empty())
+				{
+					double begin = toMicroseconds(open.back().Ticks);
+					stream << ",\n{\"name\":";
+					WriteJsonString(stream, open.back().Name);
+					stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+						<< ",\"ts\":" << begin << ",\"dur\":" << toMicroseconds(event.Ticks) - begin << "}";
+					open.pop_back();
+				}
+				break;
+
+			case EventType::Counter:
+				stream << ",\n{\"name\":";
+				WriteJsonString(stream, event.Name);
+				stream << ",\"ph\":\"C\",\"pid\":1,\"tid\":" << tid
+					<< ",\"ts\":" << toMicroseconds(event.Ticks) << ",\"args\":{\"value\":" << event.Value << "}}";
+				break;
+
+			case EventType::Frame:
+				stream << ",\n{\"name\":";
+				WriteJsonString(stream, event.Name);
+				stream << ",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":" << tid
+					<< ",\"ts\":" << toMicroseconds(event.Ticks) << ",\"args\":{\"frame\":" << event.Value << "}}";
+				break;
+			}
+		}
+	}
+
+	for (const std::unique_ptr<Track>& track : registry.Tracks)
+	{
+		uint32_t tid = track->Id;
+		stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+		WriteJsonString(stream, track->Name.c_str());
+		stream << "}}";
+		stream << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"sort_index\":-1}}";
+
+		for (const TrackScope& scope : track->Scopes)
+		{
+			double begin = std::chrono::duration<double, std::micro>(scope.Begin - registry.StartTime).count();
+			double end = std::chrono::duration<double, std::micro>(scope.End - registry.StartTime).count();
+			stream << ",\n{\"name\":";
+			WriteJsonString(stream, scope.Name);
+			stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+				<< ",\"ts\":" << begin << ",\"dur\":" << end - begin << "}";
+		}
+	}
+
+	stream << "\n]}\n";
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+void Profiler::SaveChromeTrace(const std::wstring& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	WriteChromeTrace(file);
+
+	file.close();
+	if (!file)
+	{
+		throw FileError("Cannot write", path);
+	}
+}
+
+Profiler::Benchmark Profiler::RunBenchmark(uint32_t scopeCount)
+{
+	// Batches fit in a ring with room to spare, like a frame's worth of scopes.
+	const uint32_t batchSize = EventsPerThread / 4;
+
+	bool enabled = IsEnabled();
+	Clear();
+
+	Benchmark result;
+	result.TimeStampCounter = GetRegistry().UseTsc;
+	uint64_t sink = 0;
+	result.TimestampNanoseconds = MeasureNanoseconds(scopeCount, [&sink]() { sink += ReadTicks(); });
+
+	auto measureScopes = [&]()
+	{
+		double total = 0.0;
+		for (uint32_t done = 0; done < scopeCount; done += batchSize)
+		{
+			uint32_t count = (std::min)(batchSize, scopeCount - done);
+			total += MeasureNanoseconds(count, []() { ProfileScope scope("Benchmark"); }) * count;
+			Clear();
+		}
+		return total / scopeCount;
+	};
+
+	SetEnabled(true);
+	result.ScopeNanoseconds = measureScopes();
+	SetEnabled(false);
+	result.DisabledScopeNanoseconds = measureScopes();
+	SetEnabled(enabled);
+
+	// Keeps the timestamp loop from being optimized away.
+	if (sink == 0)
+	{
+		result.TimestampNanoseconds = 0.0;
+	}
+	return result;
+}
@@ -0,0 +1,602 @@
+#include "../include/RootSignatureAnalyzer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	const D3D12_ROOT_SIGNATURE_FLAGS s_DenyFlags[ShaderStage_Count] =
+	{
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS,
+	};
+
+	// A root parameter being rewritten by the optimizer.
+	struct Entry
+	{
+		CD3DX12_ROOT_PARAMETER1 Parameter;
+		std::vector<CD3DX12_DESCRIPTOR_RANGE1> Ranges;
+		// Source parameters that ended up in this entry. Demoted tables hold
+		// one source per range, everything else exactly one.
+		std::vector<UINT> Sources;
+		float ChangesPerFrame = 1.0f;
+		UINT StageMask = ShaderStageMask_All;
+		UINT BufferSizeInDwords = 0;
+		RootParameterAction Action = RootParameterAction::Kept;
+		// The root CBV a promoted entry was made from.
+		D3D12_ROOT_PARAMETER1 PromotedFrom = {};
+	};
+
+	UINT CountBits(UINT mask)
+	{
+		UINT count = 0;
+		for (; mask; mask &= mask - 1)
+		{
+			++count;
+		}
+		return count;
+	}
+
+	UINT GetDeniedStageMask(D3D12_ROOT_SIGNATURE_FLAGS flags)
+	{
+		UINT mask = 0;
+		for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+		{
+			if (flags & s_DenyFlags[stage])
+			{
+				mask |= 1 << stage;
+			}
+		}
+		return mask;
+	}
+
+	D3D12_SHADER_VISIBILITY GetNarrowestVisibility(D3D12_SHADER_VISIBILITY current, UINT stageMask)
+	{
+		if (current == D3D12_SHADER_VISIBILITY_ALL && CountBits(stageMask) == 1)
+		{
+			for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+			{
+				if (stageMask == (1u << stage))
+				{
+					return static_cast<D3D12_SHADER_VISIBILITY>(D3D12_SHADER_VISIBILITY_VERTEX + stage);
+				}
+			}
+		}
+		return current;
+	}
+
+	const RootParameterUsage& GetUsage(const std::vector<RootParameterUsage>& usage, UINT index)
+	{
+		static const RootParameterUsage s_DefaultUsage;
+		return index < usage.size() ? usage[index] : s_DefaultUsage;
+	}
+
+	// Copy a root signature of either version into version 1.1 entries. Version
+	// 1.0 semantics are kept by marking descriptors and data volatile.
+	std::vector<Entry> MakeEntries(
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		const std::vector<RootParameterUsage>& usage,
+		std::vector<D3D12_STATIC_SAMPLER_DESC>& staticSamplers,
+		D3D12_ROOT_SIGNATURE_FLAGS& flags)
+	{
+		std::vector<Entry> entries;
+
+		if (desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_0)
+		{
+			const D3D12_ROOT_SIGNATURE_DESC& desc_1_0 = desc.Desc_1_0;
+			entries.resize(desc_1_0.NumParameters);
+
+			for (UINT i = 0; i < desc_1_0.NumParameters; ++i)
+			{
+				const D3D12_ROOT_PARAMETER& source = desc_1_0.pParameters[i];
+				Entry& entry = entries[i];
+				entry.Parameter.ParameterType = source.ParameterType;
+				entry.Parameter.ShaderVisibility = source.ShaderVisibility;
+
+				switch (source.ParameterType)
+				{
+				case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+					for (UINT r = 0; r < source.DescriptorTable.NumDescriptorRanges; ++r)
+					{
+						const D3D12_DESCRIPTOR_RANGE& range = source.DescriptorTable.pDescriptorRanges[r];
+						D3D12_DESCRIPTOR_RANGE_FLAGS rangeFlags = range.RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER
+							? D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE
+							: D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+						entry.Ranges.emplace_back(range.RangeType, range.NumDescriptors, range.BaseShaderRegister,
+							range.RegisterSpace, rangeFlags, range.OffsetInDescriptorsFromTableStart);
+					}
+					break;
+				case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+					entry.Parameter.Constants = source.Constants;
+					break;
+				default:
+					CD3DX12_ROOT_DESCRIPTOR1::Init(entry.Parameter.Descriptor, source.Descriptor.ShaderRegister,
+						source.Descriptor.RegisterSpace, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE);
+					break;
+				}
+			}
+
+			staticSamplers.assign(desc_1_0.pStaticSamplers, desc_1_0.pStaticSamplers + desc_1_0.NumStaticSamplers);
+			flags = desc_1_0.Flags;
+		}
+		else
+		{
+			const D3D12_ROOT_SIGNATURE_DESC1& desc_1_1 = desc.Desc_1_1;
+			entries.resize(desc_1_1.NumParameters);
+
+			for (UINT i = 0; i < desc_1_1.NumParameters; ++i)
+			{
+				const D3D12_ROOT_PARAMETER1& source = desc_1_1.pParameters[i];
+				Entry& entry = entries[i];
+				entry.Parameter = CD3DX12_ROOT_PARAMETER1(source);
+
+				if (source.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+				{
+					const D3D12_DESCRIPTOR_RANGE1* ranges = source.DescriptorTable.pDescriptorRanges;
+					for (UINT r = 0; r < source.DescriptorTable.NumDescriptorRanges; ++r)
+					{
+						entry.Ranges.emplace_back(ranges[r]);
+					}
+				}
+			}
+
+			staticSamplers.assign(desc_1_1.pStaticSamplers, desc_1_1.pStaticSamplers + desc_1_1.NumStaticSamplers);
+			flags = desc_1_1.Flags;
+		}
+
+		for (UINT i = 0; i < entries.size(); ++i)
+		{
+			const RootParameterUsage& parameterUsage = GetUsage(usage, i);
+			Entry& entry = entries[i];
+			entry.Sources.push_back(i);
+			entry.ChangesPerFrame = parameterUsage.ChangesPerFrame;
+			entry.StageMask = parameterUsage.StageMask & GetVisibleStageMask(entry.Parameter.ShaderVisibility);
+			entry.BufferSizeInDwords = parameterUsage.BufferSizeInDwords;
+		}
+
+		return entries;
+	}
+
+	UINT GetTotalDwords(const std::vector<Entry>& entries)
+	{
+		UINT total = 0;
+		for (const Entry& entry : entries)
+		{
+			total += RootSignatureAnalyzer::GetParameterDwords(entry.Parameter);
+		}
+		return total;
+	}
+
+	bool IsRootDescriptor(const Entry& entry)
+	{
+		return entry.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV ||
+			entry.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_SRV ||
+			entry.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_UAV;
+	}
+
+	void Promote(Entry& entry)
+	{
+		assert(entry.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV);
+		entry.PromotedFrom = entry.Parameter;
+		D3D12_ROOT_DESCRIPTOR1 descriptor = entry.Parameter.Descriptor;
+		CD3DX12_ROOT_PARAMETER1::InitAsConstants(entry.Parameter, entry.BufferSizeInDwords,
+			descriptor.ShaderRegister, descriptor.RegisterSpace, entry.Parameter.ShaderVisibility);
+		entry.Action = RootParameterAction::Promoted;
+	}
+
+	void Unpromote(Entry& entry)
+	{
+		assert(entry.Action == RootParameterAction::Promoted);
+		entry.Parameter = CD3DX12_ROOT_PARAMETER1(entry.PromotedFrom);
+		entry.Action = RootParameterAction::Kept;
+	}
+
+	// Fold the root descriptor at index into a descriptor table shared by all
+	// demoted descriptors with the same visibility.
+	void Demote(std::vector<Entry>& entries, size_t index)
+	{
+		Entry source = std::move(entries[index]);
+		entries.erase(entries.begin() + index);
+
+		auto table = std::find_if(entries.begin(), entries.end(), [&source](const Entry& entry)
+		{
+			return entry.Action == RootParameterAction::Demoted &&
+				entry.Parameter.ShaderVisibility == source.Parameter.ShaderVisibility;
+		});
+
+		if (table == entries.end())
+		{
+			Entry newTable;
+			newTable.Parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			newTable.Parameter.ShaderVisibility = source.Parameter.ShaderVisibility;
+			newTable.ChangesPerFrame = 0.0f;
+			newTable.StageMask = 0;
+			newTable.Action = RootParameterAction::Demoted;
+			entries.push_back(std::move(newTable));
+			table = entries.end() - 1;
+		}
+
+		D3D12_DESCRIPTOR_RANGE_TYPE rangeType =
+			source.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV ? D3D12_DESCRIPTOR_RANGE_TYPE_CBV :
+			source.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_SRV ? D3D12_DESCRIPTOR_RANGE_TYPE_SRV :
+			D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+
+		// The data flags of root descriptors and descriptor ranges share values.
+		D3D12_DESCRIPTOR_RANGE_FLAGS rangeFlags = static_cast<D3D12_DESCRIPTOR_RANGE_FLAGS>(source.Parameter.Descriptor.Flags);
+
+		table->Ranges.emplace_back(rangeType, 1, source.Parameter.Descriptor.ShaderRegister,
+			source.Parameter.Descriptor.RegisterSpace, rangeFlags);
+		table->Sources.push_back(source.Sources.front());
+		table->ChangesPerFrame = (std::max)(table->ChangesPerFrame, source.ChangesPerFrame);
+		table->StageMask |= source.StageMask;
+	}
+
+	void AccumulateCost(RootSignatureCost& cost, UINT dwords, UINT visibleMask, UINT usedMask)
+	{
+		cost.TotalDwords += dwords;
+		cost.ParameterDwords.push_back(dwords);
+
+		for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+		{
+			UINT stageBit = 1 << stage;
+			if (visibleMask & stageBit)
+			{
+				cost.StageDwords[stage] += dwords;
+				if (!(usedMask & stageBit))
+				{
+					cost.WastedStageDwords[stage] += dwords;
+				}
+			}
+		}
+	}
+
+	const char* GetParameterTypeName(D3D12_ROOT_PARAMETER_TYPE type)
+	{
+		switch (type)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE: return "table";
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS: return "constants";
+		case D3D12_ROOT_PARAMETER_TYPE_CBV: return "cbv";
+		case D3D12_ROOT_PARAMETER_TYPE_SRV: return "srv";
+		case D3D12_ROOT_PARAMETER_TYPE_UAV: return "uav";
+		default: return "unknown";
+		}
+	}
+
+	const char* GetActionName(RootParameterAction action)
+	{
+		switch (action)
+		{
+		case RootParameterAction::Promoted: return "promoted to root constants";
+		case RootParameterAction::Demoted: return "demoted into descriptor table";
+		default: return "kept";
+		}
+	}
+}
+
+const char* GetShaderStageName(ShaderStage stage)
+{
+	static const char* s_Names[ShaderStage_Count] = { "vertex", "hull", "domain", "geometry", "pixel" };
+	return stage < ShaderStage_Count ? s_Names[stage] : "unknown";
+}
+
+UINT GetVisibleStageMask(D3D12_SHADER_VISIBILITY visibility)
+{
+	if (visibility == D3D12_SHADER_VISIBILITY_ALL)
+	{
+		return ShaderStageMask_All;
+	}
+	return 1u << (visibility - D3D12_SHADER_VISIBILITY_VERTEX);
+}
+
+void RootSignatureLayout::Finalize(D3D12_ROOT_SIGNATURE_FLAGS flags)
+{
+	assert(m_Parameters.size() == m_Ranges.size());
+
+	// Vectors are not resized after this point, so the pointers stay valid even
+	// when the layout is moved.
+	for (size_t i = 0; i < m_Parameters.size(); ++i)
+	{
+		if (m_Parameters[i].ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+		{
+			CD3DX12_ROOT_DESCRIPTOR_TABLE1::Init(m_Parameters[i].DescriptorTable,
+				static_cast<UINT>(m_Ranges[i].size()), m_Ranges[i].data());
+		}
+	}
+
+	m_Desc.Init_1_1(static_cast<UINT>(m_Parameters.size()), m_Parameters.data(),
+		static_cast<UINT>(m_StaticSamplers.size()), m_StaticSamplers.data(), flags);
+}
+
+UINT RootSignatureAnalyzer::GetParameterDwords(const D3D12_ROOT_PARAMETER1& parameter)
+{
+	switch (parameter.ParameterType)
+	{
+	case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+		return 1;
+	case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+		return parameter.Constants.Num32BitValues;
+	default:
+		// Root descriptors are 64-bit GPU virtual addresses.
+		return 2;
+	}
+}
+
+RootSignatureCost RootSignatureAnalyzer::Analyze(
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+	const std::vector<RootParameterUsage>& usage)
+{
+	std::vector<D3D12_STATIC_SAMPLER_DESC> staticSamplers;
+	D3D12_ROOT_SIGNATURE_FLAGS flags;
+	std::vector<Entry> entries = MakeEntries(desc, usage, staticSamplers, flags);
+
+	UINT deniedMask = GetDeniedStageMask(flags);
+	UINT usedMask = 0;
+
+	RootSignatureCost cost;
+	for (const Entry& entry : entries)
+	{
+		UINT visibleMask = GetVisibleStageMask(entry.Parameter.ShaderVisibility) & ~deniedMask;
+		AccumulateCost(cost, GetParameterDwords(entry.Parameter), visibleMask, entry.StageMask);
+		usedMask |= entry.StageMask;
+	}
+
+	cost.UndeniedUnusedStageMask = ShaderStageMask_All & ~usedMask & ~deniedMask;
+
+	return cost;
+}
+
+RootSignatureLayout RootSignatureAnalyzer::Optimize(
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+	const std::vector<RootParameterUsage>& usage,
+	const Options& options)
+{
+	RootSignatureLayout layout;
+	D3D12_ROOT_SIGNATURE_FLAGS flags;
+	std::vector<Entry> entries = MakeEntries(desc, usage, layout.m_StaticSamplers, flags);
+
+	// Narrow the visibility of parameters that only one stage reads.
+	UINT usedMask = 0;
+	for (Entry& entry : entries)
+	{
+		entry.Parameter.ShaderVisibility = GetNarrowestVisibility(entry.Parameter.ShaderVisibility, entry.StageMask);
+		usedMask |= entry.StageMask;
+	}
+
+	// Promote small, frequently changed root CBVs to root constants.
+	for (Entry& entry : entries)
+	{
+		if (entry.Parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV &&
+			entry.ChangesPerFrame >= options.PromoteChangesPerFrame &&
+			entry.BufferSizeInDwords > 0 &&
+			entry.BufferSizeInDwords <= options.MaxPromotedDwords)
+		{
+			Promote(entry);
+		}
+	}
+
+	// Fold rarely changed root descriptors into descriptor tables.
+	for (size_t i = 0; i < entries.size();)
+	{
+		if (IsRootDescriptor(entries[i]) && entries[i].ChangesPerFrame <= options.DemoteChangesPerFrame)
+		{
+			Demote(entries, i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// Stay within budget: give back the least valuable promotions first, then
+	// demote the least frequently changed root descriptors.
+	while (GetTotalDwords(entries) > options.DwordBudget)
+	{
+		Entry* promoted = nullptr;
+		for (Entry& entry : entries)
+		{
+			if (entry.Action == RootParameterAction::Promoted &&
+				(!promoted || entry.ChangesPerFrame < promoted->ChangesPerFrame))
+			{
+				promoted = &entry;
+			}
+		}
+
+		if (promoted)
+		{
+			Unpromote(*promoted);
+			continue;
+		}
+
+		size_t demote = entries.size();
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (IsRootDescriptor(entries[i]) &&
+				(demote == entries.size() || entries[i].ChangesPerFrame < entries[demote].ChangesPerFrame))
+			{
+				demote = i;
+			}
+		}
+
+		if (demote == entries.size())
+		{
+			// Only tables and root constants that were already in the source
+			// are left. Nothing more can be done automatically.
+			layout.m_WithinBudget = false;
+			break;
+		}
+
+		Demote(entries, demote);
+	}
+
+	// The front of the root signature is the part most likely to stay in
+	// registers, so order parameters by how often they change. Rarely changed
+	// tables sink to the back.
+	std::stable_sort(entries.begin(), entries.end(), [&options](const Entry& a, const Entry& b)
+	{
+		bool aRare = a.ChangesPerFrame <= options.DemoteChangesPerFrame;
+		bool bRare = b.ChangesPerFrame <= options.DemoteChangesPerFrame;
+		if (aRare != bRare)
+		{
+			return bRare;
+		}
+		return a.ChangesPerFrame > b.ChangesPerFrame;
+	});
+
+	// Deny root access to stages no parameter is read by.
+	if (!usage.empty())
+	{
+		for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+		{
+			if (!(usedMask & (1u << stage)))
+			{
+				flags |= s_DenyFlags[stage];
+			}
+		}
+	}
+
+	UINT sourceCount = desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_0 ? desc.Desc_1_0.NumParameters : desc.Desc_1_1.NumParameters;
+	layout.m_Bindings.resize(sourceCount);
+
+	for (UINT i = 0; i < entries.size(); ++i)
+	{
+		Entry& entry = entries[i];
+		for (UINT s = 0; s < entry.Sources.size(); ++s)
+		{
+			RootParameterBinding& binding = layout.m_Bindings[entry.Sources[s]];
+			binding.RootParameterIndex = i;
+			binding.OffsetInTable = entry.Action == RootParameterAction::Demoted ? s : 0;
+			binding.Action = entry.Action;
+		}
+
+		layout.m_Parameters.push_back(entry.Parameter);
+		layout.m_Ranges.push_back(std::move(entry.Ranges));
+	}
+
+	layout.Finalize(flags);
+
+	return layout;
+}
+
+bool RootSignatureAnalyzer::ReadUsage(std::istream& in, std::vector<RootParameterUsage>& usage, std::string& error)
+{
+	std::string line;
+	for (UINT lineNumber = 1; std::getline(in, line); ++lineNumber)
+	{
+		std::istringstream fields(line);
+		std::string first;
+		if (!(fields >> first) || first[0] == '#')
+		{
+			continue;
+		}
+
+		// Parameter indices are far below the 64 DWORD limit.
+		std::istringstream indexField(first);
+		UINT index = 0;
+		float changesPerFrame = 0.0f;
+		UINT bufferSizeInDwords = 0;
+		bool valid = (indexField >> index) && indexField.eof() && index < RootSignatureCost::MaxDwords
+			&& (fields >> changesPerFrame) && changesPerFrame >= 0.0f;
+		if (valid && !(fields >> bufferSizeInDwords))
+		{
+			valid = fields.eof();
+			bufferSizeInDwords = 0;
+		}
+		std::string rest;
+		if (!valid || fields >> rest)
+		{
+			error = "Usage line " + std::to_string(lineNumber) + ": expected <parameter> <changes per frame> [<constant buffer DWORDs>].";
+			return false;
+		}
+
+		if (usage.size() <= index)
+		{
+			usage.resize(index + 1);
+		}
+		usage[index].ChangesPerFrame = changesPerFrame;
+		usage[index].BufferSizeInDwords = bufferSizeInDwords;
+	}
+	return true;
+}
+
+void RootSignatureAnalyzer::WriteReport(
+	std::ostream& out,
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+	const RootSignatureCost& cost)
+{
+	out << "Root signature cost: " << cost.TotalDwords << " / " << RootSignatureCost::MaxDwords << " DWORDs";
+	if (cost.IsOverLimit())
+	{
+		out << " (OVER LIMIT)";
+	}
+	out << "\n";
+
+	for (UINT i = 0; i < cost.ParameterDwords.size(); ++i)
+	{
+		D3D12_ROOT_PARAMETER_TYPE type = desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_0
+			? desc.Desc_1_0.pParameters[i].ParameterType
+			: desc.Desc_1_1.pParameters[i].ParameterType;
+
+		out << "  [" << std::setw(2) << i << "] " << std::left << std::setw(10) << GetParameterTypeName(type)
+			<< std::right << std::setw(3) << cost.ParameterDwords[i] << " DWORDs\n";
+	}
+
+	out << "Per-stage visibility:\n";
+	for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+	{
+		out << "  " << std::left << std::setw(9) << GetShaderStageName(static_cast<ShaderStage>(stage)) << std::right
+			<< std::setw(3) << cost.StageDwords[stage] << " DWORDs visible, "
+			<< std::setw(3) << cost.WastedStageDwords[stage] << " unused";
+		if (cost.UndeniedUnusedStageMask & (1u << stage))
+		{
+			out << " (root access could be denied)";
+		}
+		out << "\n";
+	}
+}
+
+void RootSignatureAnalyzer::WriteComparison(
+	std::ostream& out,
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+	const std::vector<RootParameterUsage>& usage,
+	const RootSignatureLayout& layout)
+{
+	RootSignatureCost before = Analyze(desc, usage);
+	WriteReport(out, desc, before);
+
+	// Usage of the optimized layout, gathered back from the source parameters.
+	std::vector<RootParameterUsage> optimizedUsage(layout.GetParameters().size());
+	for (RootParameterUsage& parameterUsage : optimizedUsage)
+	{
+		parameterUsage.ChangesPerFrame = 0.0f;
+		parameterUsage.StageMask = 0;
+	}
+	for (UINT i = 0; i < layout.GetBindings().size(); ++i)
+	{
+		const RootParameterUsage& source = GetUsage(usage, i);
+		RootParameterUsage& target = optimizedUsage[layout.GetBindings()[i].RootParameterIndex];
+		target.ChangesPerFrame = (std::max)(target.ChangesPerFrame, source.ChangesPerFrame);
+		target.StageMask |= source.StageMask;
+	}
+
+	out << "\nProposed layout:\n";
+	RootSignatureCost after = Analyze(layout.GetDesc(), optimizedUsage);
+	WriteReport(out, layout.GetDesc(), after);
+
+	out << "\nParameter mapping:\n";
+	for (UINT i = 0; i < layout.GetBindings().size(); ++i)
+	{
+		const RootParameterBinding& binding = layout.GetBindings()[i];
+		out << "  [" << std::setw(2) << i << "] -> [" << std::setw(2) << binding.RootParameterIndex << "]";
+		if (binding.Action == RootParameterAction::Demoted)
+		{
+			out << "+" << binding.OffsetInTable;
+		}
+		out << " " << GetActionName(binding.Action) << "\n";
+	}
+}
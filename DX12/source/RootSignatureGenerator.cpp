@@ -0,0 +1,523 @@
+#include "../include/RootSignatureGenerator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <iomanip>
+#include <map>
+#include <tuple>
+
+namespace
+{
+	const D3D12_ROOT_SIGNATURE_FLAGS s_DenyFlags[ShaderStage_Count] =
+	{
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS,
+	};
+
+	// D3D_NAME_UNDEFINED: a vertex input fed by the input assembler rather
+	// than generated, like SV_VertexID.
+	const UINT SystemValueUndefined = 0;
+
+	// A register range read by one or more stages.
+	struct MergedBinding
+	{
+		GeneratedRootBinding Binding;
+		// One past the last register. 64 bits so an unbounded array fits.
+		uint64_t End = 0;
+		bool RootDescriptorAllowed = false;
+		// Root constants need the layout from every stage that reads it.
+		bool ConstantsKnown = false;
+		UINT ConstantDwords = 0;
+		D3D12_SHADER_VISIBILITY Visibility = D3D12_SHADER_VISIBILITY_ALL;
+	};
+
+	// Tables are per visibility and heap, and every unbounded array gets a
+	// table of its own: descriptors after it would be part of the array.
+	// Keyed so that tables sort by visibility, CBV/SRV/UAV before samplers,
+	// with the unbounded ones last.
+	typedef std::tuple<size_t, UINT, bool> TableKey;
+	typedef std::map<TableKey, std::vector<size_t>> TableMap;
+
+	bool GetShaderStage(ShaderProgramType type, ShaderStage& stage)
+	{
+		switch (type)
+		{
+		case ShaderProgramType::Vertex: stage = ShaderStage_Vertex; return true;
+		case ShaderProgramType::Hull: stage = ShaderStage_Hull; return true;
+		case ShaderProgramType::Domain: stage = ShaderStage_Domain; return true;
+		case ShaderProgramType::Geometry: stage = ShaderStage_Geometry; return true;
+		case ShaderProgramType::Pixel: stage = ShaderStage_Pixel; return true;
+		default: return false;
+		}
+	}
+
+	// Root SRVs and UAVs are buffer addresses without a format or counter.
+	bool AllowsRootDescriptor(ShaderInputType type)
+	{
+		switch (type)
+		{
+		case ShaderInputType::ConstantBuffer:
+		case ShaderInputType::Structured:
+		case ShaderInputType::ByteAddress:
+		case ShaderInputType::AccelerationStructure:
+		case ShaderInputType::RWStructured:
+		case ShaderInputType::RWByteAddress:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Up to the end of the last variable read. Root constants past it would
+	// be set every draw and never read.
+	UINT GetUsedConstantDwords(const ShaderConstantBuffer& buffer)
+	{
+		UINT end = 0;
+		for (const ShaderVariable& variable : buffer.Variables)
+		{
+			if (variable.Used)
+			{
+				end = (std::max)(end, variable.Offset + variable.Size);
+			}
+		}
+		return (end + 3) / 4;
+	}
+
+	D3D12_SHADER_VISIBILITY GetVisibility(UINT stageMask)
+	{
+		for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+		{
+			if (stageMask == (1u << stage))
+			{
+				return static_cast<D3D12_SHADER_VISIBILITY>(D3D12_SHADER_VISIBILITY_VERTEX + stage);
+			}
+		}
+		return D3D12_SHADER_VISIBILITY_ALL;
+	}
+
+	bool IsRootDescriptor(D3D12_ROOT_PARAMETER_TYPE type)
+	{
+		return type == D3D12_ROOT_PARAMETER_TYPE_CBV || type == D3D12_ROOT_PARAMETER_TYPE_SRV || type == D3D12_ROOT_PARAMETER_TYPE_UAV;
+	}
+
+	// Root parameters come first, constants before CBVs, SRVs and UAVs, then
+	// the tables.
+	int GetParameterRank(D3D12_ROOT_PARAMETER_TYPE type)
+	{
+		switch (type)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS: return 0;
+		case D3D12_ROOT_PARAMETER_TYPE_CBV: return 1;
+		case D3D12_ROOT_PARAMETER_TYPE_SRV: return 2;
+		case D3D12_ROOT_PARAMETER_TYPE_UAV: return 3;
+		default: return 4;
+		}
+	}
+
+	D3D12_ROOT_PARAMETER_TYPE GetCheapestParameterType(const MergedBinding& merged, const RootSignatureGenerator::Options& options)
+	{
+		const GeneratedRootBinding& binding = merged.Binding;
+		if (binding.Count != 1 || !merged.RootDescriptorAllowed)
+		{
+			return D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		}
+		if (binding.Class == ShaderBindingClass::ConstantBuffer && merged.ConstantsKnown &&
+			merged.ConstantDwords > 0 && merged.ConstantDwords <= options.MaxRootConstantDwords)
+		{
+			return D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		}
+		if (!options.AllowRootDescriptors)
+		{
+			return D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		}
+		switch (binding.Class)
+		{
+		case ShaderBindingClass::ConstantBuffer: return D3D12_ROOT_PARAMETER_TYPE_CBV;
+		case ShaderBindingClass::ShaderResource: return D3D12_ROOT_PARAMETER_TYPE_SRV;
+		default: return D3D12_ROOT_PARAMETER_TYPE_UAV;
+		}
+	}
+
+	TableMap GetTables(const std::vector<MergedBinding>& merged)
+	{
+		TableMap tables;
+		for (size_t i = 0; i < merged.size(); ++i)
+		{
+			const GeneratedRootBinding& binding = merged[i].Binding;
+			if (binding.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE && !binding.IsStaticSampler)
+			{
+				TableKey key(binding.Count == 0 ? i + 1 : 0, merged[i].Visibility, binding.Class == ShaderBindingClass::Sampler);
+				tables[key].push_back(i);
+			}
+		}
+		return tables;
+	}
+
+	UINT GetTotalDwords(const std::vector<MergedBinding>& merged)
+	{
+		UINT total = static_cast<UINT>(GetTables(merged).size());
+		for (const MergedBinding& binding : merged)
+		{
+			if (binding.Binding.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+			{
+				total += binding.ConstantDwords;
+			}
+			else if (IsRootDescriptor(binding.Binding.ParameterType))
+			{
+				total += 2;
+			}
+		}
+		return total;
+	}
+
+	// Merge overlapping register ranges of the same class and space. The
+	// result is sorted by class, space and register.
+	std::vector<MergedBinding> MergeBindings(std::vector<MergedBinding> bindings)
+	{
+		std::sort(bindings.begin(), bindings.end(), [](const MergedBinding& a, const MergedBinding& b)
+		{
+			return std::make_tuple(a.Binding.Class, a.Binding.Space, a.Binding.Register) <
+				std::make_tuple(b.Binding.Class, b.Binding.Space, b.Binding.Register);
+		});
+
+		std::vector<MergedBinding> merged;
+		for (MergedBinding& binding : bindings)
+		{
+			if (merged.empty() || merged.back().Binding.Class != binding.Binding.Class ||
+				merged.back().Binding.Space != binding.Binding.Space || binding.Binding.Register >= merged.back().End)
+			{
+				merged.push_back(std::move(binding));
+				continue;
+			}
+
+			MergedBinding& target = merged.back();
+			target.End = (std::max)(target.End, binding.End);
+			target.Binding.Count = target.End == UINT64_MAX ? 0 : static_cast<UINT>(target.End - target.Binding.Register);
+			target.Binding.StageMask |= binding.Binding.StageMask;
+			target.RootDescriptorAllowed = target.RootDescriptorAllowed && binding.RootDescriptorAllowed;
+			target.ConstantsKnown = target.ConstantsKnown && binding.ConstantsKnown;
+			target.ConstantDwords = (std::max)(target.ConstantDwords, binding.ConstantDwords);
+			if (target.Binding.Name.empty())
+			{
+				target.Binding.Name = binding.Binding.Name;
+			}
+		}
+		return merged;
+	}
+
+	const char* GetParameterTypeName(D3D12_ROOT_PARAMETER_TYPE type)
+	{
+		switch (type)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE: return "table";
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS: return "constants";
+		case D3D12_ROOT_PARAMETER_TYPE_CBV: return "cbv";
+		case D3D12_ROOT_PARAMETER_TYPE_SRV: return "srv";
+		case D3D12_ROOT_PARAMETER_TYPE_UAV: return "uav";
+		default: return "unknown";
+		}
+	}
+}
+
+bool RootSignatureGenerator::Generate(
+	const std::vector<const ShaderReflection*>& shaders,
+	const Options& options,
+	GeneratedRootSignature& result,
+	std::string& error)
+{
+	result = GeneratedRootSignature();
+	error.clear();
+
+	if (shaders.empty())
+	{
+		error = "no shaders";
+		return false;
+	}
+	bool compute = std::any_of(shaders.begin(), shaders.end(), [](const ShaderReflection* shader)
+	{
+		return shader && shader->ProgramType == ShaderProgramType::Compute;
+	});
+	if (compute && shaders.size() > 1)
+	{
+		error = "a compute shader cannot share a root signature with other stages";
+		return false;
+	}
+
+	bool needsInputLayout = false;
+	UINT stageMask = 0;
+	std::vector<MergedBinding> bindings;
+	for (const ShaderReflection* shader : shaders)
+	{
+		assert(shader && "Pass the reflection of every stage.");
+		// Compute has no visibility to narrow, so it counts as every stage.
+		ShaderStage stage = ShaderStage_Count;
+		UINT shaderStageMask = ShaderStageMask_All;
+		if (!compute)
+		{
+			if (!GetShaderStage(shader->ProgramType, stage))
+			{
+				error = std::string(GetShaderProgramTypeName(shader->ProgramType)) + " shaders are not supported";
+				return false;
+			}
+			shaderStageMask = 1u << stage;
+			if (stageMask & shaderStageMask)
+			{
+				error = std::string("more than one ") + GetShaderProgramTypeName(shader->ProgramType) + " shader";
+				return false;
+			}
+			stageMask |= shaderStageMask;
+		}
+
+		if (stage == ShaderStage_Vertex)
+		{
+			needsInputLayout = std::any_of(shader->Inputs.begin(), shader->Inputs.end(), [](const ShaderSignatureElement& input)
+			{
+				return input.SystemValue == SystemValueUndefined;
+			});
+		}
+
+		for (const ShaderResourceBinding& source : shader->Bindings)
+		{
+			MergedBinding binding;
+			binding.Binding.Name = source.Name;
+			binding.Binding.Class = GetShaderBindingClass(source.Type);
+			binding.Binding.Space = source.Space;
+			binding.Binding.Register = source.BindPoint;
+			binding.Binding.Count = source.BindCount;
+			binding.Binding.StageMask = shaderStageMask;
+			binding.End = source.BindCount == 0 ? UINT64_MAX : uint64_t(source.BindPoint) + source.BindCount;
+			binding.RootDescriptorAllowed = AllowsRootDescriptor(source.Type);
+			if (const ShaderConstantBuffer* buffer = source.Type == ShaderInputType::ConstantBuffer ? shader->FindConstantBuffer(source) : nullptr)
+			{
+				binding.ConstantsKnown = true;
+				binding.ConstantDwords = GetUsedConstantDwords(*buffer);
+			}
+			bindings.push_back(std::move(binding));
+		}
+	}
+	std::vector<MergedBinding> merged = MergeBindings(std::move(bindings));
+	RootSignatureLayout& layout = result.Layout;
+	UINT readStageMask = 0;
+	for (MergedBinding& binding : merged)
+	{
+		binding.Visibility = GetVisibility(binding.Binding.StageMask);
+		binding.Binding.ParameterType = GetCheapestParameterType(binding, options);
+		readStageMask |= binding.Binding.StageMask;
+
+		if (binding.Binding.Class == ShaderBindingClass::Sampler && binding.Binding.Count == 1)
+		{
+			for (const D3D12_STATIC_SAMPLER_DESC& sampler : options.StaticSamplers)
+			{
+				if (sampler.ShaderRegister == binding.Binding.Register && sampler.RegisterSpace == binding.Binding.Space)
+				{
+					binding.Binding.IsStaticSampler = true;
+					layout.m_StaticSamplers.push_back(sampler);
+					layout.m_StaticSamplers.back().ShaderVisibility = binding.Visibility;
+					break;
+				}
+			}
+		}
+	}
+
+	// Over budget: give back the largest root constants first, then move root
+	// descriptors into tables from the back of the root signature.
+	while (GetTotalDwords(merged) > options.DwordBudget)
+	{
+		MergedBinding* constants = nullptr;
+		MergedBinding* descriptor = nullptr;
+		for (MergedBinding& binding : merged)
+		{
+			D3D12_ROOT_PARAMETER_TYPE type = binding.Binding.ParameterType;
+			if (type == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS && (!constants || binding.ConstantDwords > constants->ConstantDwords))
+			{
+				constants = &binding;
+			}
+			if (IsRootDescriptor(type) && (!descriptor || GetParameterRank(type) >= GetParameterRank(descriptor->Binding.ParameterType)))
+			{
+				descriptor = &binding;
+			}
+		}
+
+		if (constants)
+		{
+			constants->Binding.ParameterType = options.AllowRootDescriptors
+				? D3D12_ROOT_PARAMETER_TYPE_CBV
+				: D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		}
+		else if (descriptor)
+		{
+			descriptor->Binding.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		}
+		else
+		{
+			error = "the bindings need " + std::to_string(GetTotalDwords(merged)) + " DWORDs even in tables; the budget is " +
+				std::to_string(options.DwordBudget);
+			return false;
+		}
+	}
+
+	D3D12_ROOT_DESCRIPTOR_FLAGS descriptorDataFlags = options.DataStatic
+		? D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC
+		: D3D12_ROOT_DESCRIPTOR_FLAG_NONE;
+
+	std::vector<size_t> rootOrder;
+	for (size_t i = 0; i < merged.size(); ++i)
+	{
+		if (merged[i].Binding.ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+		{
+			rootOrder.push_back(i);
+		}
+	}
+	std::stable_sort(rootOrder.begin(), rootOrder.end(), [&merged](size_t a, size_t b)
+	{
+		return GetParameterRank(merged[a].Binding.ParameterType) < GetParameterRank(merged[b].Binding.ParameterType);
+	});
+
+	for (size_t index : rootOrder)
+	{
+		GeneratedRootBinding& binding = merged[index].Binding;
+		D3D12_SHADER_VISIBILITY visibility = merged[index].Visibility;
+		CD3DX12_ROOT_PARAMETER1 parameter;
+		switch (binding.ParameterType)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			parameter.InitAsConstants(merged[index].ConstantDwords, binding.Register, binding.Space, visibility);
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_CBV:
+			parameter.InitAsConstantBufferView(binding.Register, binding.Space, descriptorDataFlags, visibility);
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_SRV:
+			parameter.InitAsShaderResourceView(binding.Register, binding.Space, descriptorDataFlags, visibility);
+			break;
+		default:
+			// UAVs are written by the shader itself, so their data stays volatile.
+			parameter.InitAsUnorderedAccessView(binding.Register, binding.Space, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, visibility);
+			break;
+		}
+		binding.RootParameterIndex = static_cast<UINT>(layout.m_Parameters.size());
+		layout.m_Parameters.push_back(parameter);
+		layout.m_Ranges.emplace_back();
+	}
+
+	for (const TableMap::value_type& table : GetTables(merged))
+	{
+		CD3DX12_ROOT_PARAMETER1 parameter;
+		parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		parameter.ShaderVisibility = static_cast<D3D12_SHADER_VISIBILITY>(std::get<1>(table.first));
+
+		std::vector<CD3DX12_DESCRIPTOR_RANGE1> ranges;
+		UINT offset = 0;
+		for (size_t index : table.second)
+		{
+			GeneratedRootBinding& binding = merged[index].Binding;
+			D3D12_DESCRIPTOR_RANGE_FLAGS flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+			if (binding.Count == 0)
+			{
+				// Bindless arrays are rarely filled completely.
+				flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
+			}
+			else if (options.DataStatic &&
+				(binding.Class == ShaderBindingClass::ConstantBuffer || binding.Class == ShaderBindingClass::ShaderResource))
+			{
+				flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
+			}
+
+			// The classes are in D3D12_DESCRIPTOR_RANGE_TYPE order.
+			ranges.emplace_back(static_cast<D3D12_DESCRIPTOR_RANGE_TYPE>(binding.Class),
+				binding.Count == 0 ? UINT_MAX : binding.Count, binding.Register, binding.Space, flags, offset);
+			binding.RootParameterIndex = static_cast<UINT>(layout.m_Parameters.size());
+			binding.OffsetInTable = offset;
+			offset += binding.Count;
+		}
+		layout.m_Parameters.push_back(parameter);
+		layout.m_Ranges.push_back(std::move(ranges));
+	}
+
+	D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+	if (!compute)
+	{
+		if (needsInputLayout)
+		{
+			flags |= D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+		}
+		for (UINT stage = 0; stage < ShaderStage_Count; ++stage)
+		{
+			if (!(readStageMask & (1u << stage)))
+			{
+				flags |= s_DenyFlags[stage];
+			}
+		}
+	}
+	layout.Finalize(flags);
+
+	for (MergedBinding& binding : merged)
+	{
+		result.Bindings.push_back(std::move(binding.Binding));
+	}
+	return true;
+}
+
+std::vector<RootParameterUsage> RootSignatureGenerator::GetUsage(const GeneratedRootSignature& result)
+{
+	std::vector<RootParameterUsage> usage(result.Layout.GetParameters().size());
+	for (RootParameterUsage& parameterUsage : usage)
+	{
+		parameterUsage.StageMask = 0;
+	}
+	for (const GeneratedRootBinding& binding : result.Bindings)
+	{
+		if (!binding.IsStaticSampler)
+		{
+			usage[binding.RootParameterIndex].StageMask |= binding.StageMask;
+		}
+	}
+	return usage;
+}
+
+void RootSignatureGenerator::WriteReport(std::ostream& out, const GeneratedRootSignature& result)
+{
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc = result.Layout.GetDesc();
+	RootSignatureAnalyzer::WriteReport(out, desc, RootSignatureAnalyzer::Analyze(desc, GetUsage(result)));
+	WriteBindings(out, result);
+}
+
+void RootSignatureGenerator::WriteBindings(std::ostream& out, const GeneratedRootSignature& result)
+{
+	out << "Bindings:\n";
+	for (const GeneratedRootBinding& binding : result.Bindings)
+	{
+		static const char s_Letters[] = { 't', 'u', 'b', 's' };
+		std::string slot = s_Letters[static_cast<size_t>(binding.Class)] + std::to_string(binding.Register);
+		if (binding.Count == 0)
+		{
+			slot += "[]";
+		}
+		else if (binding.Count > 1)
+		{
+			slot += "[" + std::to_string(binding.Count) + "]";
+		}
+		out << "  " << std::left << std::setw(8) << slot << " space" << std::setw(3) << binding.Space << std::right;
+		if (binding.IsStaticSampler)
+		{
+			out << " static sampler";
+		}
+		else
+		{
+			out << " -> [" << std::setw(2) << binding.RootParameterIndex << "]";
+			if (binding.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+			{
+				out << "+" << binding.OffsetInTable;
+			}
+			out << " " << GetParameterTypeName(binding.ParameterType);
+		}
+		if (!binding.Name.empty())
+		{
+			out << " " << binding.Name;
+		}
+		out << "\n";
+	}
+}
@@ -0,0 +1,426 @@
+#include "../include/ShaderCache.h"
+#include "../include/FileError.h"
+#include "../include/Hash.h"
+#include "../include/JobSystem.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const UINT32 PackMagic = 0x4B504853; // "SHPK"
+	const UINT32 PackVersion = 1;
+
+	struct PackHeader
+	{
+		UINT32 Magic;
+		UINT32 Version;
+		UINT64 EntryCount;
+		UINT64 IndexOffset;
+	};
+
+	// Bytecode and the index start on 8-byte boundaries, so the index can be
+	// read in place.
+	const UINT64 PackAlignment = 8;
+
+	UINT64 AlignPack(UINT64 offset)
+	{
+		return (offset + PackAlignment - 1) & ~(PackAlignment - 1);
+	}
+
+	UINT64 ToMicroseconds(std::chrono::steady_clock::duration duration)
+	{
+		return static_cast<UINT64>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+	}
+}
+
+// A read-only view of a pack file. Keeps the file open, so it cannot be
+// replaced while mapped.
+class ShaderCache::MappedPack
+{
+public:
+	// Null if the file is missing or is not a valid pack.
+	static std::unique_ptr<MappedPack> Open(const std::wstring& path)
+	{
+		std::unique_ptr<MappedPack> pack(new MappedPack());
+		pack->m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (pack->m_File == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(pack->m_File, &size) || static_cast<UINT64>(size.QuadPart) < sizeof(PackHeader))
+		{
+			return nullptr;
+		}
+		pack->m_Size = static_cast<UINT64>(size.QuadPart);
+
+		pack->m_Mapping = CreateFileMappingW(pack->m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!pack->m_Mapping)
+		{
+			return nullptr;
+		}
+		pack->m_View = static_cast<const UINT8*>(MapViewOfFile(pack->m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!pack->m_View || !pack->Validate())
+		{
+			return nullptr;
+		}
+		return pack;
+	}
+
+	~MappedPack()
+	{
+		if (m_View)
+		{
+			UnmapViewOfFile(m_View);
+		}
+		if (m_Mapping)
+		{
+			CloseHandle(m_Mapping);
+		}
+		if (m_File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_File);
+		}
+	}
+
+	const UINT8* GetData() const { return m_View; }
+
+	const PackEntry* GetEntries() const
+	{
+		return reinterpret_cast<const PackEntry*>(m_View + GetHeader().IndexOffset);
+	}
+
+	size_t GetEntryCount() const { return static_cast<size_t>(GetHeader().EntryCount); }
+
+private:
+	MappedPack()
+		: m_File(INVALID_HANDLE_VALUE)
+		, m_Mapping(nullptr)
+		, m_View(nullptr)
+		, m_Size(0)
+	{
+	}
+
+	const PackHeader& GetHeader() const { return *reinterpret_cast<const PackHeader*>(m_View); }
+
+	// Everything FindInPack and GetOrCompile rely on: entries in bounds and
+	// sorted by key.
+	bool Validate() const
+	{
+		const PackHeader& header = GetHeader();
+		if (header.Magic != PackMagic || header.Version != PackVersion ||
+			header.IndexOffset % PackAlignment != 0 || header.IndexOffset > m_Size ||
+			header.EntryCount > (m_Size - header.IndexOffset) / sizeof(PackEntry))
+		{
+			return false;
+		}
+
+		const PackEntry* entries = GetEntries();
+		for (UINT64 i = 0; i < header.EntryCount; ++i)
+		{
+			const PackEntry& entry = entries[i];
+			if (entry.Offset < sizeof(PackHeader) || entry.Offset > header.IndexOffset ||
+				entry.Size > header.IndexOffset - entry.Offset ||
+				(i > 0 && entries[i - 1].Key >= entry.Key))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	HANDLE m_File;
+	HANDLE m_Mapping;
+	const UINT8* m_View;
+	UINT64 m_Size;
+};
+
+ShaderCache::ShaderCache(std::unique_ptr<ShaderCompiler> compiler, const std::wstring& path)
+	: m_Compiler(std::move(compiler))
+	, m_Path(path)
+	, m_Hits(0)
+	, m_Misses(0)
+	, m_Failures(0)
+	, m_CompileMicroseconds(0)
+	, m_SavedMicroseconds(0)
+{
+	Map();
+}
+
+ShaderCache::~ShaderCache()
+{
+	try
+	{
+		if (!m_Entries.empty())
+		{
+			Save();
+		}
+	}
+	catch (...)
+	{
+		// Losing the cache costs compile time next run, nothing more.
+	}
+}
+
+void ShaderCache::Map()
+{
+	m_Pack = MappedPack::Open(m_Path);
+}
+
+uint64_t ShaderCache::ComputeKey(const ShaderDesc& desc, const std::string& preprocessed,
+	const std::vector<std::wstring>& includes) const
+{
+	uint64_t hash = HashValue(m_Compiler->GetVersionHash());
+	hash = HashBytes(preprocessed.data(), preprocessed.size(), hash);
+	for (const std::wstring& include : includes)
+	{
+		hash = HashBytes(include.data(), include.size() * sizeof(wchar_t), hash);
+		hash = HashValue(include.size(), hash);
+	}
+	hash = HashValue(includes.size(), hash);
+	for (const ShaderDefine& define : desc.Defines)
+	{
+		hash = HashString(define.Name.c_str(), hash);
+		hash = HashString(define.Value.c_str(), hash);
+	}
+	hash = HashValue(desc.Defines.size(), hash);
+	hash = HashString(desc.EntryPoint.c_str(), hash);
+	hash = HashString(desc.Profile.c_str(), hash);
+	return HashValue(desc.Flags, hash);
+}
+
+const ShaderCache::PackEntry* ShaderCache::FindInPack(uint64_t key) const
+{
+	if (!m_Pack)
+	{
+		return nullptr;
+	}
+	const PackEntry* begin = m_Pack->GetEntries();
+	const PackEntry* end = begin + m_Pack->GetEntryCount();
+	const PackEntry* entry = std::lower_bound(begin, end, key,
+		[](const PackEntry& entry, uint64_t key) { return entry.Key < key; });
+	return entry != end && entry->Key == key ? entry : nullptr;
+}
+
+ShaderCacheResult ShaderCache::GetOrCompile(const ShaderDesc& desc)
+{
+	using Clock = std::chrono::steady_clock;
+
+	ShaderCacheResult result;
+	std::string preprocessed;
+	if (!m_Compiler->Preprocess(desc, preprocessed, result.Includes, result.Errors))
+	{
+		m_Failures.fetch_add(1, std::memory_order_relaxed);
+		return result;
+	}
+	result.Key = ComputeKey(desc, preprocessed, result.Includes);
+
+	if (const PackEntry* packed = FindInPack(result.Key))
+	{
+		result.Bytecode = { m_Pack->GetData() + packed->Offset, packed->Size };
+		result.CacheHit = true;
+		m_Hits.fetch_add(1, std::memory_order_relaxed);
+		m_SavedMicroseconds.fetch_add(packed->CompileMicroseconds, std::memory_order_relaxed);
+		return result;
+	}
+
+	std::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock(m_EntriesMutex);
+		std::shared_ptr<Entry>& slot = m_Entries[result.Key];
+		if (!slot)
+		{
+			slot = std::make_shared<Entry>();
+		}
+		entry = slot;
+	}
+
+	bool compiled = false;
+	std::call_once(entry->Compiled, [&]
+	{
+		auto start = Clock::now();
+		entry->Succeeded = m_Compiler->Compile(desc, preprocessed, entry->Bytecode, entry->Errors);
+		UINT64 microseconds = ToMicroseconds(Clock::now() - start);
+		entry->CompileMicroseconds = static_cast<uint32_t>((std::min)(microseconds, UINT64(UINT32_MAX)));
+		m_CompileMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+		compiled = true;
+	});
+
+	result.Errors = entry->Errors;
+	if (!entry->Succeeded)
+	{
+		m_Failures.fetch_add(1, std::memory_order_relaxed);
+		return result;
+	}
+
+	result.Bytecode = { entry->Bytecode.data(), entry->Bytecode.size() };
+	if (compiled)
+	{
+		m_Misses.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		result.CacheHit = true;
+		m_Hits.fetch_add(1, std::memory_order_relaxed);
+		m_SavedMicroseconds.fetch_add(entry->CompileMicroseconds, std::memory_order_relaxed);
+	}
+	return result;
+}
+
+std::vector<ShaderCacheResult> ShaderCache::GetOrCompile(const std::vector<ShaderDesc>& descs, JobSystem& jobs)
+{
+	std::vector<ShaderCacheResult> results(descs.size());
+	// One shader per range: compiles take milliseconds, so splitting costs
+	// nothing next to them and keeps a slow shader from holding up others.
+	Job* job = jobs.ParallelFor(0, descs.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			results[i] = GetOrCompile(descs[i]);
+		}
+	});
+	jobs.Wait(job);
+	return results;
+}
+
+void ShaderCache::Save()
+{
+	struct Blob
+	{
+		uint64_t Key;
+		const uint8_t* Data;
+		uint32_t Size;
+		uint32_t CompileMicroseconds;
+	};
+
+	// Everything in the pack plus this run's successful compiles.
+	std::vector<Blob> blobs;
+	if (m_Pack)
+	{
+		const PackEntry* entries = m_Pack->GetEntries();
+		for (size_t i = 0; i < m_Pack->GetEntryCount(); ++i)
+		{
+			blobs.push_back({ entries[i].Key, m_Pack->GetData() + entries[i].Offset, entries[i].Size, entries[i].CompileMicroseconds });
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_EntriesMutex);
+		for (const auto& item : m_Entries)
+		{
+			const Entry& entry = *item.second;
+			if (entry.Succeeded && !FindInPack(item.first))
+			{
+				blobs.push_back({ item.first, entry.Bytecode.data(), static_cast<uint32_t>(entry.Bytecode.size()), entry.CompileMicroseconds });
+			}
+		}
+	}
+	std::sort(blobs.begin(), blobs.end(), [](const Blob& l, const Blob& r) { return l.Key < r.Key; });
+
+	std::vector<PackEntry> index;
+	index.reserve(blobs.size());
+	UINT64 offset = sizeof(PackHeader);
+	for (const Blob& blob : blobs)
+	{
+		offset = AlignPack(offset);
+		index.push_back({ blob.Key, offset, blob.Size, blob.CompileMicroseconds });
+		offset += blob.Size;
+	}
+	PackHeader header = { PackMagic, PackVersion, index.size(), AlignPack(offset) };
+
+	// Write next to the pack while it is still mapped, since the blobs point
+	// into it, then swap the files.
+	std::wstring temporaryPath = m_Path + L".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		const char Padding[PackAlignment] = {};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		UINT64 written = sizeof(header);
+		for (size_t i = 0; i < blobs.size(); ++i)
+		{
+			file.write(Padding, static_cast<std::streamsize>(index[i].Offset - written));
+			file.write(reinterpret_cast<const char*>(blobs[i].Data), blobs[i].Size);
+			written = index[i].Offset + blobs[i].Size;
+		}
+		file.write(Padding, static_cast<std::streamsize>(header.IndexOffset - written));
+		if (!index.empty())
+		{
+			file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(PackEntry));
+		}
+		file.close();
+		if (!file)
+		{
+			DeleteFileW(temporaryPath.c_str());
+			throw FileError("Cannot write", temporaryPath);
+		}
+	}
+
+	// A mapped file cannot be replaced.
+	m_Pack.reset();
+	if (!MoveFileExW(temporaryPath.c_str(), m_Path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFileW(temporaryPath.c_str());
+		Map();
+		throw FileError("Cannot replace", m_Path);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_EntriesMutex);
+		m_Entries.clear();
+	}
+	Map();
+}
+
+void ShaderCache::Clear()
+{
+	m_Pack.reset();
+	DeleteFileW(m_Path.c_str());
+
+	std::lock_guard<std::mutex> lock(m_EntriesMutex);
+	m_Entries.clear();
+}
+
+ShaderCache::Stats ShaderCache::GetStats() const
+{
+	Stats stats;
+	stats.Hits = m_Hits.load(std::memory_order_relaxed);
+	stats.Misses = m_Misses.load(std::memory_order_relaxed);
+	stats.Failures = m_Failures.load(std::memory_order_relaxed);
+	stats.CompileMilliseconds = m_CompileMicroseconds.load(std::memory_order_relaxed) / 1000.0;
+	stats.SavedMilliseconds = m_SavedMicroseconds.load(std::memory_order_relaxed) / 1000.0;
+	return stats;
+}
+
+ShaderCache::BenchmarkResult ShaderCache::RunBenchmark(const std::function<std::unique_ptr<ShaderCompiler>()>& createCompiler,
+	const std::wstring& path, const std::vector<ShaderDesc>& descs, JobSystem& jobs)
+{
+	using Clock = std::chrono::steady_clock;
+
+	BenchmarkResult result;
+	result.ShaderCount = static_cast<UINT>(descs.size());
+
+	{
+		ShaderCache cache(createCompiler(), path);
+		cache.Clear();
+
+		auto start = Clock::now();
+		cache.GetOrCompile(descs, jobs);
+		result.ColdMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		cache.Save();
+	}
+
+	{
+		ShaderCache cache(createCompiler(), path);
+
+		auto start = Clock::now();
+		cache.GetOrCompile(descs, jobs);
+		result.WarmMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		result.Warm = cache.GetStats();
+	}
+
+	return result;
+}
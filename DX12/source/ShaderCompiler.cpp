@@ -0,0 +1,307 @@
+#include "../include/ShaderCompiler.h"
+#include "../include/Hash.h"
+#include "../include/helpers.h"
+
+#include <d3dcompiler.h>
+#include <wrl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	bool ReadFile(const std::wstring& path, std::string& data)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	// Up to and including the last separator, or empty.
+	std::wstring GetDirectory(const std::wstring& path)
+	{
+		size_t separator = path.find_last_of(L"\\/");
+		return separator == std::wstring::npos ? std::wstring() : path.substr(0, separator + 1);
+	}
+
+	std::wstring Widen(const char* text)
+	{
+		return std::wstring(text, text + strlen(text));
+	}
+
+	std::string Narrow(const std::wstring& text)
+	{
+		std::string narrow(text.size(), '\0');
+		std::transform(text.begin(), text.end(), narrow.begin(), [](wchar_t c) { return static_cast<char>(c); });
+		return narrow;
+	}
+
+	void AddInclude(std::vector<std::wstring>& includes, const std::wstring& path)
+	{
+		if (std::find(includes.begin(), includes.end(), path) == includes.end())
+		{
+			includes.push_back(path);
+		}
+	}
+
+	// Resolves includes for D3DPreprocess relative to the including file, and
+	// records every file opened. Files stay loaded until the handler goes away.
+	class IncludeHandler : public ID3DInclude
+	{
+	public:
+		IncludeHandler(const std::wstring& sourcePath, std::vector<std::wstring>& includes)
+			: m_SourceDirectory(GetDirectory(sourcePath))
+			, m_Includes(includes)
+		{
+		}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+		{
+			std::wstring parentDirectory = m_SourceDirectory;
+			auto parent = m_Directories.find(parentData);
+			if (parent != m_Directories.end())
+			{
+				parentDirectory = parent->second;
+			}
+
+			for (const std::wstring& directory : { parentDirectory, m_SourceDirectory })
+			{
+				std::wstring path = directory + Widen(fileName);
+				auto file = std::make_unique<std::string>();
+				if (ReadFile(path, *file))
+				{
+					*data = file->data();
+					*bytes = static_cast<UINT>(file->size());
+					m_Directories[file->data()] = GetDirectory(path);
+					m_Files.push_back(std::move(file));
+					AddInclude(m_Includes, path);
+					return S_OK;
+				}
+			}
+			return E_FAIL;
+		}
+
+		HRESULT __stdcall Close(LPCVOID) override
+		{
+			return S_OK;
+		}
+
+	private:
+		std::wstring m_SourceDirectory;
+		std::vector<std::wstring>& m_Includes;
+		std::vector<std::unique_ptr<std::string>> m_Files;
+		std::unordered_map<LPCVOID, std::wstring> m_Directories;
+	};
+
+	std::string GetBlobText(ID3DBlob* blob)
+	{
+		if (!blob)
+		{
+			return std::string();
+		}
+		const char* text = static_cast<const char*>(blob->GetBufferPointer());
+		std::string result(text, text + blob->GetBufferSize());
+		// Blobs of text usually include the terminator.
+		while (!result.empty() && result.back() == '\0')
+		{
+			result.pop_back();
+		}
+		return result;
+	}
+
+	bool SimulatedPreprocess(const std::wstring& path, std::string& output,
+		std::vector<std::wstring>& includes, std::string& errors, int depth)
+	{
+		// Deep enough for any real include chain, shallow enough to stop a cycle.
+		const int MaxIncludeDepth = 32;
+
+		std::string source;
+		if (depth > MaxIncludeDepth || !ReadFile(path, source))
+		{
+			errors += Narrow(path) + ": cannot open include file\n";
+			return false;
+		}
+		AddInclude(includes, path);
+
+		size_t lineBegin = 0;
+		while (lineBegin < source.size())
+		{
+			size_t lineEnd = source.find('\n', lineBegin);
+			lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+
+			size_t directive = source.find_first_not_of(" \t", lineBegin);
+			const char Include[] = "#include \"";
+			if (directive < lineEnd && source.compare(directive, sizeof(Include) - 1, Include) == 0)
+			{
+				size_t nameBegin = directive + sizeof(Include) - 1;
+				size_t nameEnd = source.find('"', nameBegin);
+				if (nameEnd >= lineEnd)
+				{
+					errors += Narrow(path) + ": malformed #include\n";
+					return false;
+				}
+				std::wstring name(source.begin() + nameBegin, source.begin() + nameEnd);
+				if (!SimulatedPreprocess(GetDirectory(path) + name, output, includes, errors, depth + 1))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				output.append(source, lineBegin, lineEnd - lineBegin);
+			}
+			lineBegin = lineEnd;
+		}
+		if (!output.empty() && output.back() != '\n')
+		{
+			output += '\n';
+		}
+		return true;
+	}
+}
+
+uint64_t D3DShaderCompiler::GetVersionHash() const
+{
+	return HashValue(static_cast<uint64_t>(D3D_COMPILER_VERSION), HashString("d3dcompiler"));
+}
+
+bool D3DShaderCompiler::Preprocess(const ShaderDesc& desc, std::string& output,
+	std::vector<std::wstring>& includes, std::string& errors)
+{
+	std::string source;
+	if (!ReadFile(desc.Path, source))
+	{
+		errors = Narrow(desc.Path) + ": cannot open source file\n";
+		return false;
+	}
+	includes.clear();
+	AddInclude(includes, desc.Path);
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : desc.Defines)
+	{
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	}
+	macros.push_back({ nullptr, nullptr });
+
+	IncludeHandler includeHandler(desc.Path, includes);
+	std::string sourceName = Narrow(desc.Path);
+	ComPtr<ID3DBlob> code;
+	ComPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DPreprocess(source.data(), source.size(), sourceName.c_str(), macros.data(),
+		&includeHandler, &code, &errorBlob);
+	errors = GetBlobText(errorBlob.Get());
+	if (FAILED(hr))
+	{
+		return false;
+	}
+	output = GetBlobText(code.Get());
+	return true;
+}
+
+bool D3DShaderCompiler::Compile(const ShaderDesc& desc, const std::string& preprocessed,
+	std::vector<uint8_t>& bytecode, std::string& errors)
+{
+	// Defines and includes were expanded by Preprocess.
+	std::string sourceName = Narrow(desc.Path);
+	ComPtr<ID3DBlob> code;
+	ComPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DCompile(preprocessed.data(), preprocessed.size(), sourceName.c_str(), nullptr, nullptr,
+		desc.EntryPoint.c_str(), desc.Profile.c_str(), desc.Flags, 0, &code, &errorBlob);
+	errors = GetBlobText(errorBlob.Get());
+	if (FAILED(hr))
+	{
+		return false;
+	}
+	const uint8_t* data = static_cast<const uint8_t*>(code->GetBufferPointer());
+	bytecode.assign(data, data + code->GetBufferSize());
+	return true;
+}
+
+SimulatedShaderCompiler::SimulatedShaderCompiler(std::chrono::microseconds compileTime)
+	: m_CompileTime(compileTime)
+{
+}
+
+uint64_t SimulatedShaderCompiler::GetVersionHash() const
+{
+	return HashString("SimulatedShaderCompiler 1");
+}
+
+bool SimulatedShaderCompiler::Preprocess(const ShaderDesc& desc, std::string& output,
+	std::vector<std::wstring>& includes, std::string& errors)
+{
+	output.clear();
+	includes.clear();
+	errors.clear();
+	for (const ShaderDefine& define : desc.Defines)
+	{
+		output += "#define " + define.Name + " " + define.Value + "\n";
+	}
+	return SimulatedPreprocess(desc.Path, output, includes, errors, 0);
+}
+
+bool SimulatedShaderCompiler::Compile(const ShaderDesc& desc, const std::string& preprocessed,
+	std::vector<uint8_t>& bytecode, std::string& errors)
+{
+	// Busy rather than asleep, like a real compile.
+	auto deadline = std::chrono::steady_clock::now() + m_CompileTime;
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+	}
+
+	errors.clear();
+	if (preprocessed.find("#error") != std::string::npos)
+	{
+		errors = Narrow(desc.Path) + ": error: #error directive\n";
+		return false;
+	}
+
+	// Drop the defines the source never mentions, as a real compiler's output
+	// would not depend on them.
+	std::string text;
+	size_t lineBegin = 0;
+	while (lineBegin < preprocessed.size())
+	{
+		size_t lineEnd = preprocessed.find('\n', lineBegin);
+		lineEnd = lineEnd == std::string::npos ? preprocessed.size() : lineEnd + 1;
+
+		const char Define[] = "#define ";
+		bool used = true;
+		if (preprocessed.compare(lineBegin, sizeof(Define) - 1, Define) == 0)
+		{
+			size_t nameBegin = lineBegin + sizeof(Define) - 1;
+			size_t nameEnd = preprocessed.find_first_of(" \t\r\n", nameBegin);
+			std::string name = preprocessed.substr(nameBegin, nameEnd - nameBegin);
+			used = preprocessed.find(name) < lineBegin || preprocessed.find(name, lineEnd) != std::string::npos;
+		}
+		if (used)
+		{
+			text.append(preprocessed, lineBegin, lineEnd - lineBegin);
+		}
+		lineBegin = lineEnd;
+	}
+
+	// A container tag, a hash of everything the output depends on, then the
+	// text, so equal inputs give equal bytecode.
+	uint64_t hash = HashString(text.c_str());
+	hash = HashString(desc.EntryPoint.c_str(), hash);
+	hash = HashString(desc.Profile.c_str(), hash);
+	hash = HashValue(desc.Flags, hash);
+
+	const char Tag[4] = { 'D', 'X', 'B', 'C' };
+	bytecode.assign(Tag, Tag + sizeof(Tag));
+	bytecode.insert(bytecode.end(), reinterpret_cast<const uint8_t*>(&hash), reinterpret_cast<const uint8_t*>(&hash + 1));
+	bytecode.insert(bytecode.end(), text.begin(), text.end());
+	return true;
+}
@@ -0,0 +1,321 @@
+#include "../include/ShaderHotReload.h"
+#include "../include/Fence.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	bool SameShader(const ShaderHotReload::Shader& a, const ShaderHotReload::Shader& b)
+	{
+		return a.Permutations == b.Permutations && a.Key == b.Key;
+	}
+
+	void AppendShaders(std::vector<ShaderHotReload::Shader>& shaders, const std::vector<ShaderHotReload::Shader>& dependents)
+	{
+		shaders.insert(shaders.end(), dependents.begin(), dependents.end());
+	}
+
+	// A pipeline cannot be created while one of its shaders has never compiled.
+	bool HasBytecode(const std::vector<ShaderHotReload::Shader>& shaders)
+	{
+		for (const ShaderHotReload::Shader& shader : shaders)
+		{
+			if (shader.Permutations->Get(shader.Key).BytecodeLength == 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+ShaderHotReload::ShaderHotReload(std::unique_ptr<FileWatcher> watcher, std::shared_ptr<Fence> fence, const Options& options)
+	: m_Watcher(std::move(watcher))
+	, m_Fence(std::move(fence))
+	, m_Options(options)
+	, m_FlushRequested(0)
+	, m_FlushCompleted(0)
+	, m_Stopping(false)
+{
+	m_Thread = std::thread([this] { ReloadThread(); });
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WakeUp.notify_all();
+	m_Thread.join();
+}
+
+ShaderHotReload::Handle ShaderHotReload::Register(const std::vector<Shader>& shaders, CreatePipeline create)
+{
+	std::unique_ptr<Pipeline> pipeline(new Pipeline());
+	pipeline->Shaders = shaders;
+	pipeline->Create = std::move(create);
+	if (HasBytecode(shaders))
+	{
+		pipeline->Current = pipeline->Create();
+	}
+
+	std::vector<std::vector<std::wstring>> includes;
+	std::vector<bool> failed;
+	for (const Shader& shader : shaders)
+	{
+		failed.push_back(shader.Permutations->Get(shader.Key).BytecodeLength == 0);
+		includes.push_back(shader.Permutations->GetIncludes(shader.Key));
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Handle handle = static_cast<Handle>(m_Pipelines.size());
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		TrackedShader& tracked = m_Shaders[shaders[i]];
+		tracked.Failed = failed[i];
+		tracked.Pipelines.push_back(handle);
+		Track(shaders[i], tracked, includes[i]);
+	}
+	m_Pipelines.push_back(std::move(pipeline));
+	return handle;
+}
+
+void ShaderHotReload::Track(const Shader& shader, TrackedShader& tracked, const std::vector<std::wstring>& includes)
+{
+	for (const std::wstring& file : tracked.Files)
+	{
+		std::vector<Shader>& dependents = m_Files[file];
+		dependents.erase(std::remove_if(dependents.begin(), dependents.end(),
+			[&](const Shader& dependent) { return SameShader(dependent, shader); }), dependents.end());
+	}
+
+	tracked.Files.clear();
+	for (const std::wstring& include : includes)
+	{
+		std::wstring file = NormalizePath(include);
+		std::vector<Shader>& dependents = m_Files[file];
+		if (dependents.empty())
+		{
+			// Watching a directory again does nothing, so new files need no
+			// bookkeeping of their own.
+			m_Watcher->Watch(GetPathDirectory(file));
+		}
+		dependents.push_back(shader);
+		tracked.Files.push_back(std::move(file));
+	}
+}
+
+UINT ShaderHotReload::Update()
+{
+	std::vector<std::pair<Handle, ComPtr<ID3D12PipelineState>>> recreated;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		recreated.swap(m_Recreated);
+		m_Stats.PipelinesSwapped += recreated.size();
+	}
+
+	// Frames recorded so far may still use the pipelines being replaced.
+	UINT64 lastSignaled = m_Fence->GetLastSignaledValue();
+	for (auto& pipeline : recreated)
+	{
+		ComPtr<ID3D12PipelineState>& current = m_Pipelines[pipeline.first]->Current;
+		if (current)
+		{
+			m_Retired.push_back({ lastSignaled, std::move(current) });
+		}
+		current = std::move(pipeline.second);
+	}
+
+	UINT64 completed = m_Fence->GetCompletedValue();
+	while (!m_Retired.empty() && m_Retired.front().FenceValue <= completed)
+	{
+		m_Retired.pop_front();
+	}
+	return static_cast<UINT>(recreated.size());
+}
+
+void ShaderHotReload::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	UINT64 flush = ++m_FlushRequested;
+	m_WakeUp.notify_all();
+	m_Idle.wait(lock, [&] { return m_FlushCompleted >= flush; });
+}
+
+std::string ShaderHotReload::GetErrors() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::string errors;
+	for (const auto& shader : m_Shaders)
+	{
+		if (shader.second.Failed)
+		{
+			errors += shader.first.Permutations->GetErrors(shader.first.Key);
+		}
+	}
+	return errors;
+}
+
+ShaderHotReload::Stats ShaderHotReload::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Stats;
+}
+
+void ShaderHotReload::ReloadThread()
+{
+	std::vector<std::wstring> changed;
+	std::chrono::steady_clock::time_point lastChange;
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (!m_Stopping)
+	{
+		// Whatever was reported before the flush was requested is in the
+		// watcher by now, so one poll sees it.
+		UINT64 flush = m_FlushRequested;
+		bool flushing = flush != m_FlushCompleted;
+		lock.unlock();
+
+		size_t known = changed.size();
+		m_Watcher->Poll(changed);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (changed.size() != known)
+		{
+			lastChange = now;
+		}
+		if (!changed.empty() && (flushing || now - lastChange >= m_Options.SettleTime))
+		{
+			Reload(changed);
+			changed.clear();
+		}
+
+		lock.lock();
+		if (flushing)
+		{
+			m_FlushCompleted = flush;
+			m_Idle.notify_all();
+		}
+		m_WakeUp.wait_for(lock, m_Options.PollInterval, [&] { return m_Stopping || m_FlushRequested != m_FlushCompleted; });
+	}
+}
+
+void ShaderHotReload::Reload(std::vector<std::wstring>& changed)
+{
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+	Stats stats;
+	stats.Changes = 1;
+
+	std::vector<Shader> shaders;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (const std::wstring& path : changed)
+		{
+			if (path.empty() || path.back() == L'/')
+			{
+				// Events were lost: anything in the directory may have changed.
+				for (const auto& file : m_Files)
+				{
+					if (file.first.compare(0, path.size(), path) == 0)
+					{
+						AppendShaders(shaders, file.second);
+					}
+				}
+			}
+			else
+			{
+				auto file = m_Files.find(path);
+				if (file != m_Files.end())
+				{
+					AppendShaders(shaders, file->second);
+				}
+			}
+		}
+	}
+	std::sort(shaders.begin(), shaders.end());
+	shaders.erase(std::unique(shaders.begin(), shaders.end(), SameShader), shaders.end());
+
+	std::vector<Shader> rebuilt;
+	for (const Shader& shader : shaders)
+	{
+		ShaderPermutations::ReloadResult result = shader.Permutations->Reload(shader.Key);
+		std::vector<std::wstring> includes = shader.Permutations->GetIncludes(shader.Key);
+
+		++stats.Recompiled;
+		if (result == ShaderPermutations::ReloadResult::Unchanged)
+		{
+			++stats.Unchanged;
+		}
+		else if (result == ShaderPermutations::ReloadResult::Failed)
+		{
+			++stats.Failed;
+		}
+		else
+		{
+			rebuilt.push_back(shader);
+		}
+
+		// An edit may have added or removed includes.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		TrackedShader& tracked = m_Shaders[shader];
+		tracked.Failed = result == ShaderPermutations::ReloadResult::Failed;
+		Track(shader, tracked, includes);
+	}
+
+	std::vector<std::pair<Handle, const Pipeline*>> pipelines;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (const Shader& shader : rebuilt)
+		{
+			for (Handle handle : m_Shaders[shader].Pipelines)
+			{
+				pipelines.emplace_back(handle, m_Pipelines[handle].get());
+			}
+		}
+	}
+	std::sort(pipelines.begin(), pipelines.end());
+	pipelines.erase(std::unique(pipelines.begin(), pipelines.end()), pipelines.end());
+
+	// Published together, so Update never swaps in half of an edit.
+	std::vector<std::pair<Handle, ComPtr<ID3D12PipelineState>>> recreated;
+	for (const auto& pipeline : pipelines)
+	{
+		ComPtr<ID3D12PipelineState> created;
+		if (HasBytecode(pipeline.second->Shaders))
+		{
+			try
+			{
+				created = pipeline.second->Create();
+			}
+			catch (...)
+			{
+				// Counted below; the old pipeline stays in use.
+			}
+		}
+		if (created)
+		{
+			recreated.emplace_back(pipeline.first, std::move(created));
+			++stats.PipelinesCreated;
+		}
+		else
+		{
+			++stats.PipelineFailures;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& pipeline : recreated)
+	{
+		m_Recreated.push_back(std::move(pipeline));
+	}
+	m_Stats.Changes += stats.Changes;
+	m_Stats.Recompiled += stats.Recompiled;
+	m_Stats.Unchanged += stats.Unchanged;
+	m_Stats.Failed += stats.Failed;
+	m_Stats.PipelinesCreated += stats.PipelinesCreated;
+	m_Stats.PipelineFailures += stats.PipelineFailures;
+}
@@ -0,0 +1,286 @@
+#include "../include/ShaderPermutations.h"
+#include "../include/FileError.h"
+#include "../include/Hash.h"
+#include "../include/JobSystem.h"
+#include "../include/ShaderCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Written for a permutation with no features set.
+	const char* const NoFeatures = "-";
+}
+
+ShaderPermutations::ShaderPermutations(ShaderCache& cache, const ShaderDesc& desc, std::vector<std::string> features)
+	: m_Cache(cache)
+	, m_Desc(desc)
+	, m_Features(std::move(features))
+	, m_Compiled(0)
+	, m_Failures(0)
+	, m_Reloads(0)
+	, m_DeduplicatedBytes(0)
+{
+	assert(m_Features.size() <= MaxFeatures && "A key has one bit per feature.");
+}
+
+ShaderPermutations::Key ShaderPermutations::GetFeature(const char* name) const
+{
+	for (size_t i = 0; i < m_Features.size(); ++i)
+	{
+		if (m_Features[i] == name)
+		{
+			return Key(1) << i;
+		}
+	}
+	assert(false && "Feature not declared.");
+	return 0;
+}
+
+ShaderPermutations::Key ShaderPermutations::MakeKey(std::initializer_list<const char*> features) const
+{
+	Key key = 0;
+	for (const char* feature : features)
+	{
+		key |= GetFeature(feature);
+	}
+	return key;
+}
+
+ShaderDesc ShaderPermutations::GetDesc(Key key) const
+{
+	ShaderDesc desc = m_Desc;
+	for (size_t i = 0; i < m_Features.size(); ++i)
+	{
+		desc.Defines.push_back({ m_Features[i], (key >> i) & 1 ? "1" : "0" });
+	}
+	return desc;
+}
+
+ShaderPermutations::Permutation& ShaderPermutations::GetPermutation(Key key, bool used)
+{
+	assert((m_Features.size() == MaxFeatures || key >> m_Features.size() == 0) && "Key has bits of undeclared features.");
+
+	std::lock_guard<std::mutex> lock(m_PermutationsMutex);
+	std::unique_ptr<Permutation>& permutation = m_Permutations[key];
+	if (!permutation)
+	{
+		permutation = std::make_unique<Permutation>();
+	}
+	if (used && std::find(m_Used.begin(), m_Used.end(), key) == m_Used.end())
+	{
+		m_Used.push_back(key);
+	}
+	return *permutation;
+}
+
+CD3DX12_SHADER_BYTECODE ShaderPermutations::Get(Key key)
+{
+	Permutation& permutation = GetPermutation(key, true);
+	std::call_once(permutation.Compiled, [&] { Compile(key, permutation, false); });
+	const std::vector<uint8_t>* bytecode = permutation.Bytecode.load(std::memory_order_acquire);
+	if (!bytecode)
+	{
+		return CD3DX12_SHADER_BYTECODE(nullptr, 0);
+	}
+	return CD3DX12_SHADER_BYTECODE(bytecode->data(), bytecode->size());
+}
+
+std::string ShaderPermutations::GetErrors(Key key) const
+{
+	std::lock_guard<std::mutex> lock(m_PermutationsMutex);
+	auto permutation = m_Permutations.find(key);
+	return permutation != m_Permutations.end() ? permutation->second->Errors : std::string();
+}
+
+std::vector<std::wstring> ShaderPermutations::GetIncludes(Key key) const
+{
+	std::lock_guard<std::mutex> lock(m_PermutationsMutex);
+	auto permutation = m_Permutations.find(key);
+	return permutation != m_Permutations.end() ? permutation->second->Includes : std::vector<std::wstring>();
+}
+
+ShaderPermutations::ReloadResult ShaderPermutations::Reload(Key key)
+{
+	Permutation& permutation = GetPermutation(key, false);
+	bool compiled = false;
+	std::call_once(permutation.Compiled, [&]
+	{
+		Compile(key, permutation, false);
+		compiled = true;
+	});
+	if (compiled)
+	{
+		return permutation.Bytecode.load(std::memory_order_acquire) ? ReloadResult::Changed : ReloadResult::Failed;
+	}
+	return Compile(key, permutation, true);
+}
+
+ShaderPermutations::ReloadResult ShaderPermutations::Compile(Key key, Permutation& permutation, bool reload)
+{
+	ShaderCacheResult result = m_Cache.GetOrCompile(GetDesc(key));
+	uint64_t hash = HashBytes(result.Bytecode.pShaderBytecode, result.Bytecode.BytecodeLength);
+
+	std::lock_guard<std::mutex> lock(m_PermutationsMutex);
+	if (reload)
+	{
+		++m_Reloads;
+	}
+	else
+	{
+		++m_Compiled;
+	}
+	permutation.Errors = std::move(result.Errors);
+	if (result.Bytecode.BytecodeLength == 0)
+	{
+		// Preprocessing stops at the first include it cannot open, so keep the
+		// files known from before: fixing any of them should reload again.
+		for (std::wstring& include : result.Includes)
+		{
+			if (std::find(permutation.Includes.begin(), permutation.Includes.end(), include) == permutation.Includes.end())
+			{
+				permutation.Includes.push_back(std::move(include));
+			}
+		}
+		if (!reload)
+		{
+			++m_Failures;
+		}
+		return ReloadResult::Failed;
+	}
+	permutation.Includes = std::move(result.Includes);
+
+	// Copied out of the cache, whose bytecode only lives until it saves.
+	const std::vector<uint8_t>* current = permutation.Bytecode.load(std::memory_order_relaxed);
+	const std::vector<uint8_t>* bytecode = Intern(result.Bytecode, hash, current);
+	if (bytecode == current)
+	{
+		return ReloadResult::Unchanged;
+	}
+	permutation.Bytecode.store(bytecode, std::memory_order_release);
+	return ReloadResult::Changed;
+}
+
+const std::vector<uint8_t>* ShaderPermutations::Intern(const D3D12_SHADER_BYTECODE& bytecode, uint64_t hash, const std::vector<uint8_t>* current)
+{
+	const uint8_t* data = static_cast<const uint8_t*>(bytecode.pShaderBytecode);
+
+	auto range = m_Bytecode.equal_range(hash);
+	for (auto existing = range.first; existing != range.second; ++existing)
+	{
+		const std::vector<uint8_t>& stored = *existing->second;
+		if (stored.size() == bytecode.BytecodeLength && memcmp(stored.data(), data, stored.size()) == 0)
+		{
+			if (&stored != current)
+			{
+				m_DeduplicatedBytes += stored.size();
+			}
+			return &stored;
+		}
+	}
+
+	auto stored = std::make_unique<std::vector<uint8_t>>(data, data + bytecode.BytecodeLength);
+	const std::vector<uint8_t>* result = stored.get();
+	m_Bytecode.emplace(hash, std::move(stored));
+	return result;
+}
+
+void ShaderPermutations::Prewarm(const std::vector<Key>& keys, JobSystem& jobs)
+{
+	Job* job = jobs.ParallelFor(0, keys.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			Permutation& permutation = GetPermutation(keys[i], false);
+			std::call_once(permutation.Compiled, [&] { Compile(keys[i], permutation, false); });
+		}
+	});
+	jobs.Wait(job);
+}
+
+std::vector<ShaderPermutations::Key> ShaderPermutations::GetUsedKeys() const
+{
+	std::lock_guard<std::mutex> lock(m_PermutationsMutex);
+	return m_Used;
+}
+
+void ShaderPermutations::SaveManifest(const std::wstring& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	for (Key key : GetUsedKeys())
+	{
+		if (key == 0)
+		{
+			file << NoFeatures;
+		}
+		for (size_t i = 0, written = 0; i < m_Features.size(); ++i)
+		{
+			if ((key >> i) & 1)
+			{
+				file << (written++ ? " " : "") << m_Features[i];
+			}
+		}
+		file << '\n';
+	}
+	file.close();
+	if (!file)
+	{
+		throw FileError("Cannot write", path);
+	}
+}
+
+bool ShaderPermutations::LoadManifest(const std::wstring& path, std::vector<Key>& keys) const
+{
+	keys.clear();
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream names(line);
+		std::string name;
+		Key key = 0;
+		bool known = true;
+		bool empty = true;
+		while (names >> name)
+		{
+			empty = false;
+			if (name == NoFeatures)
+			{
+				continue;
+			}
+			auto feature = std::find(m_Features.begin(), m_Features.end(), name);
+			if (feature == m_Features.end())
+			{
+				known = false;
+				break;
+			}
+			key |= Key(1) << (feature - m_Features.begin());
+		}
+		if (known && !empty)
+		{
+			keys.push_back(key);
+		}
+	}
+	return !file.bad();
+}
+
+ShaderPermutations::Stats ShaderPermutations::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_PermutationsMutex);
+	Stats stats;
+	stats.Permutations = m_Compiled;
+	stats.Failures = m_Failures;
+	stats.UniqueBytecode = m_Bytecode.size();
+	stats.DeduplicatedBytes = m_DeduplicatedBytes;
+	stats.Reloads = m_Reloads;
+	return stats;
+}
@@ -0,0 +1,839 @@
+#include "../include/ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <iomanip>
+
+namespace
+{
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+	}
+
+	const uint32_t ContainerMagic = MakeFourCC('D', 'X', 'B', 'C');
+	const uint32_t ContainerHeaderSize = 32;
+
+	const uint32_t PartRdef = MakeFourCC('R', 'D', 'E', 'F');
+	const uint32_t PartIsgn = MakeFourCC('I', 'S', 'G', 'N');
+	const uint32_t PartIsg1 = MakeFourCC('I', 'S', 'G', '1');
+	const uint32_t PartOsgn = MakeFourCC('O', 'S', 'G', 'N');
+	const uint32_t PartOsg5 = MakeFourCC('O', 'S', 'G', '5');
+	const uint32_t PartOsg1 = MakeFourCC('O', 'S', 'G', '1');
+	const uint32_t PartPcsg = MakeFourCC('P', 'C', 'S', 'G');
+	const uint32_t PartPsg1 = MakeFourCC('P', 'S', 'G', '1');
+	const uint32_t PartShdr = MakeFourCC('S', 'H', 'D', 'R');
+	const uint32_t PartShex = MakeFourCC('S', 'H', 'E', 'X');
+	const uint32_t PartDxil = MakeFourCC('D', 'X', 'I', 'L');
+	const uint32_t PartPsv0 = MakeFourCC('P', 'S', 'V', '0');
+
+	// Token stream opcodes (d3d11TokenizedProgramFormat.hpp).
+	const uint32_t OpcodeCustomData = 53;
+	const uint32_t OpcodeDclThreadGroup = 155;
+
+	// D3D_SVF_USED.
+	const uint32_t VariableUsedFlag = 2;
+
+	// Structs nest far less than this; a deeper chain is a cycle in a corrupt
+	// type table.
+	const uint32_t MaxTypeDepth = 32;
+
+	// Types are shared between variables and members, so a small corrupt
+	// table can describe a tree that doubles with every level. Real shaders
+	// stay far below this many types and members per RDEF part.
+	const uint32_t MaxTypeNodes = 1 << 16;
+
+	// PSVRuntimeInfo2 is the first version with NumThreadsX/Y/Z, at the end.
+	const uint32_t PsvRuntimeInfo2Size = 48;
+	const uint32_t PsvNumThreadsOffset = 36;
+	const uint32_t PsvBindInfo0Size = 16;
+	const uint32_t PsvBindInfo1Size = 24;
+
+	// DXIL::ResourceKind values that change the input type or dimension.
+	const uint32_t PsvKindTBuffer = 15;
+	const uint32_t PsvKindAccelerationStructure = 16;
+	const uint32_t PsvKindFeedbackTexture2D = 17;
+	const uint32_t PsvKindFeedbackTexture2DArray = 18;
+
+	// D3D_SRV_DIMENSION of each DXIL::ResourceKind up to FeedbackTexture2DArray.
+	const uint32_t s_KindDimensions[] = { 0, 2, 4, 6, 8, 9, 3, 5, 7, 10, 1, 1, 1, 0, 0, 1, 0, 4, 5 };
+
+	// Bounds-checked reads from one part. Offsets inside a part are relative
+	// to the start of its data. Containers are little-endian, as are all the
+	// platforms this builds for.
+	class PartReader
+	{
+	public:
+		PartReader(const uint8_t* data, uint32_t size)
+			: m_Data(data)
+			, m_Size(size)
+		{
+		}
+
+		uint32_t GetSize() const { return m_Size; }
+
+		template<typename T>
+		bool Read(uint32_t offset, T& value) const
+		{
+			if (offset > m_Size || sizeof(T) > m_Size - offset)
+			{
+				return false;
+			}
+			memcpy(&value, m_Data + offset, sizeof(T));
+			return true;
+		}
+
+		bool ReadString(uint32_t offset, std::string& value) const
+		{
+			if (offset >= m_Size)
+			{
+				return false;
+			}
+			const char* begin = reinterpret_cast<const char*>(m_Data + offset);
+			const void* end = memchr(begin, '\0', m_Size - offset);
+			if (!end)
+			{
+				return false;
+			}
+			value.assign(begin, static_cast<const char*>(end));
+			return true;
+		}
+
+		// Whether count entries of stride bytes fit at offset. Checked before
+		// looping over a count read from the part, so a corrupt count fails
+		// at once instead of after billions of failed reads.
+		bool HasArray(uint32_t offset, uint32_t count, uint32_t stride) const
+		{
+			return offset <= m_Size && (stride == 0 || count <= (m_Size - offset) / stride);
+		}
+
+		PartReader GetSubrange(uint32_t offset, uint32_t size) const
+		{
+			return PartReader(m_Data + offset, size);
+		}
+
+	private:
+		const uint8_t* m_Data;
+		uint32_t m_Size;
+	};
+
+	struct Part
+	{
+		uint32_t FourCC;
+		PartReader Reader;
+	};
+
+	const PartReader* FindPart(const std::vector<Part>& parts, uint32_t fourCC)
+	{
+		for (const Part& part : parts)
+		{
+			if (part.FourCC == fourCC)
+			{
+				return &part.Reader;
+			}
+		}
+		return nullptr;
+	}
+
+	const PartReader* FindPart(const std::vector<Part>& parts, std::initializer_list<uint32_t> fourCCs, uint32_t& found)
+	{
+		for (uint32_t fourCC : fourCCs)
+		{
+			if (const PartReader* part = FindPart(parts, fourCC))
+			{
+				found = fourCC;
+				return part;
+			}
+		}
+		return nullptr;
+	}
+
+	bool Fail(std::string& error, const char* part, const char* message)
+	{
+		error = std::string(part) + ": " + message;
+		return false;
+	}
+
+	ShaderProgramType GetProgramType(uint32_t type)
+	{
+		switch (type)
+		{
+		case 0: return ShaderProgramType::Pixel;
+		case 1: return ShaderProgramType::Vertex;
+		case 2: return ShaderProgramType::Geometry;
+		case 3: return ShaderProgramType::Hull;
+		case 4: return ShaderProgramType::Domain;
+		case 5: return ShaderProgramType::Compute;
+		case 6: return ShaderProgramType::Library;
+		case 13: return ShaderProgramType::Mesh;
+		case 14: return ShaderProgramType::Amplification;
+		default: return ShaderProgramType::Unknown;
+		}
+	}
+
+	bool HasThreadGroup(ShaderProgramType type)
+	{
+		return type == ShaderProgramType::Compute || type == ShaderProgramType::Mesh || type == ShaderProgramType::Amplification;
+	}
+
+	// The version token gives the stage and version, and a compute shader
+	// declares its thread group size with the other declarations up front.
+	bool ParseProgram(const PartReader& part, ShaderReflection& reflection, std::string& error)
+	{
+		uint32_t version = 0;
+		uint32_t lengthInDwords = 0;
+		if (!part.Read(0, version) || !part.Read(4, lengthInDwords))
+		{
+			return Fail(error, "SHEX", "truncated header");
+		}
+		reflection.MinorVersion = version & 0xF;
+		reflection.MajorVersion = (version >> 4) & 0xF;
+		reflection.ProgramType = GetProgramType(version >> 16);
+		if (!HasThreadGroup(reflection.ProgramType))
+		{
+			return true;
+		}
+
+		lengthInDwords = (std::min)(lengthInDwords, part.GetSize() / 4);
+		for (uint32_t dword = 2; dword < lengthInDwords;)
+		{
+			uint32_t token = 0;
+			part.Read(dword * 4, token);
+			uint32_t opcode = token & 0x7FF;
+			uint32_t length = (token >> 24) & 0x7F;
+			if (opcode == OpcodeCustomData && !part.Read(dword * 4 + 4, length))
+			{
+				return Fail(error, "SHEX", "truncated custom data");
+			}
+			if (length == 0)
+			{
+				return Fail(error, "SHEX", "zero-length instruction");
+			}
+			if (opcode == OpcodeDclThreadGroup)
+			{
+				if (!part.Read(dword * 4 + 4, reflection.ThreadGroupSize))
+				{
+					return Fail(error, "SHEX", "truncated dcl_thread_group");
+				}
+				return true;
+			}
+			dword += (std::min)(length, lengthInDwords - dword);
+		}
+		return Fail(error, "SHEX", "compute shader without dcl_thread_group");
+	}
+
+	// DxilProgramHeader: the version in the same layout as a DXBC version
+	// token, then the size and the bitcode header, which are not needed here.
+	bool ParseDxilHeader(const PartReader& part, ShaderReflection& reflection, std::string& error)
+	{
+		uint32_t version = 0;
+		if (!part.Read(0, version))
+		{
+			return Fail(error, "DXIL", "truncated header");
+		}
+		reflection.MinorVersion = version & 0xF;
+		reflection.MajorVersion = (version >> 4) & 0xF;
+		reflection.ProgramType = GetProgramType(version >> 16);
+		reflection.IsDxil = true;
+		return true;
+	}
+
+	// ISGN, OSGN and PCSG elements are six DWORDs. OSG5 puts the stream in
+	// front; ISG1, OSG1 and PSG1 do too and add the minimum precision at the
+	// end.
+	bool ParseSignature(const PartReader& part, uint32_t fourCC, const char* name,
+		std::vector<ShaderSignatureElement>& elements, std::string& error)
+	{
+		bool hasStream = fourCC == PartOsg5 || fourCC == PartIsg1 || fourCC == PartOsg1 || fourCC == PartPsg1;
+		bool hasMinPrecision = fourCC == PartIsg1 || fourCC == PartOsg1 || fourCC == PartPsg1;
+		uint32_t stride = 24 + (hasStream ? 4 : 0) + (hasMinPrecision ? 4 : 0);
+
+		uint32_t count = 0;
+		if (!part.Read(0, count) || !part.HasArray(8, count, stride))
+		{
+			return Fail(error, name, "truncated element table");
+		}
+
+		elements.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			ShaderSignatureElement& element = elements[i];
+			uint32_t offset = 8 + i * stride;
+			if (hasStream)
+			{
+				part.Read(offset, element.Stream);
+				offset += 4;
+			}
+			uint32_t nameOffset = 0;
+			uint32_t masks = 0;
+			part.Read(offset, nameOffset);
+			part.Read(offset + 4, element.SemanticIndex);
+			part.Read(offset + 8, element.SystemValue);
+			part.Read(offset + 12, element.ComponentType);
+			part.Read(offset + 16, element.Register);
+			part.Read(offset + 20, masks);
+			element.Mask = masks & 0xFF;
+			element.ReadWriteMask = (masks >> 8) & 0xFF;
+			if (hasMinPrecision)
+			{
+				part.Read(offset + 24, element.MinPrecision);
+			}
+			if (!part.ReadString(nameOffset, element.SemanticName))
+			{
+				return Fail(error, name, "semantic name out of bounds");
+			}
+		}
+		return true;
+	}
+
+	class RdefParser
+	{
+	public:
+		RdefParser(const PartReader& part, std::string& error)
+			: m_Part(part)
+			, m_Error(error)
+			, m_MajorVersion(0)
+			, m_TypeBudget(MaxTypeNodes)
+		{
+		}
+
+		// Header: constant buffer count and offset, binding count and offset,
+		// target version, flags, creator. Shader model 5 appends a table of
+		// structure sizes, which are implied by the version.
+		bool Parse(ShaderReflection& reflection)
+		{
+			uint32_t header[5] = {};
+			if (!m_Part.Read(0, header))
+			{
+				return Fail(m_Error, "RDEF", "truncated header");
+			}
+			uint32_t target = header[4] & 0xFFFF;
+			m_MajorVersion = target >> 8;
+
+			// 5.1 added the register space and an id to every binding.
+			uint32_t bindingStride = target >= 0x501 ? 40 : 32;
+			if (!m_Part.HasArray(header[3], header[2], bindingStride))
+			{
+				return Fail(m_Error, "RDEF", "truncated binding table");
+			}
+			reflection.Bindings.resize(header[2]);
+			for (uint32_t i = 0; i < header[2]; ++i)
+			{
+				if (!ParseBinding(header[3] + i * bindingStride, target >= 0x501, reflection.Bindings[i]))
+				{
+					return false;
+				}
+			}
+
+			if (!m_Part.HasArray(header[1], header[0], 24))
+			{
+				return Fail(m_Error, "RDEF", "truncated constant buffer table");
+			}
+			reflection.ConstantBuffers.resize(header[0]);
+			for (uint32_t i = 0; i < header[0]; ++i)
+			{
+				if (!ParseConstantBuffer(header[1] + i * 24, reflection.ConstantBuffers[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		bool ParseBinding(uint32_t offset, bool hasSpace, ShaderResourceBinding& binding)
+		{
+			uint32_t fields[8] = {};
+			m_Part.Read(offset, fields);
+			if (fields[1] > static_cast<uint32_t>(ShaderInputType::FeedbackTexture))
+			{
+				return Fail(m_Error, "RDEF", "unknown binding type");
+			}
+			binding.Type = static_cast<ShaderInputType>(fields[1]);
+			binding.ReturnType = fields[2];
+			binding.Dimension = fields[3];
+			binding.NumSamples = fields[4];
+			binding.BindPoint = fields[5];
+			binding.BindCount = fields[6];
+			binding.Flags = fields[7];
+			if (hasSpace)
+			{
+				m_Part.Read(offset + 32, binding.Space);
+			}
+			return ReadName(fields[0], binding.Name);
+		}
+
+		// Name, variable count and offset, size, flags, type.
+		bool ParseConstantBuffer(uint32_t offset, ShaderConstantBuffer& buffer)
+		{
+			uint32_t fields[6] = {};
+			m_Part.Read(offset, fields);
+			buffer.Size = fields[3];
+			buffer.Type = fields[5];
+
+			// Shader model 5 appends texture and sampler ranges for classes.
+			uint32_t variableStride = m_MajorVersion >= 5 ? 40 : 24;
+			if (!m_Part.HasArray(fields[2], fields[1], variableStride))
+			{
+				return Fail(m_Error, "RDEF", "truncated variable table");
+			}
+			buffer.Variables.resize(fields[1]);
+			for (uint32_t i = 0; i < fields[1]; ++i)
+			{
+				if (!ParseVariable(fields[2] + i * variableStride, buffer.Variables[i]))
+				{
+					return false;
+				}
+			}
+			return ReadName(fields[0], buffer.Name);
+		}
+
+		// Name, offset, size, flags, type, default value.
+		bool ParseVariable(uint32_t offset, ShaderVariable& variable)
+		{
+			uint32_t fields[5] = {};
+			m_Part.Read(offset, fields);
+			variable.Offset = fields[1];
+			variable.Size = fields[2];
+			variable.Used = (fields[3] & VariableUsedFlag) != 0;
+			return ReadName(fields[0], variable.Name) && ParseType(fields[4], 0, variable.Type);
+		}
+
+		// Class and type, rows and columns, elements and member count as pairs
+		// of 16-bit values, then the member offset. Shader model 5 adds four
+		// unknown DWORDs and the type's name.
+		bool ParseType(uint32_t offset, uint32_t depth, ShaderVariableType& type)
+		{
+			uint32_t fields[9] = {};
+			uint32_t size = m_MajorVersion >= 5 ? 36 : 16;
+			if (depth > MaxTypeDepth || !m_Part.HasArray(offset, 1, size))
+			{
+				return Fail(m_Error, "RDEF", "type out of bounds");
+			}
+			if (m_TypeBudget == 0)
+			{
+				return Fail(m_Error, "RDEF", "type table too large");
+			}
+			--m_TypeBudget;
+			for (uint32_t i = 0; i < size / 4; ++i)
+			{
+				m_Part.Read(offset + i * 4, fields[i]);
+			}
+			type.Class = fields[0] & 0xFFFF;
+			type.Type = fields[0] >> 16;
+			type.Rows = fields[1] & 0xFFFF;
+			type.Columns = fields[1] >> 16;
+			type.Elements = fields[2] & 0xFFFF;
+			if (m_MajorVersion >= 5 && fields[8] != 0 && !ReadName(fields[8], type.Name))
+			{
+				return false;
+			}
+
+			// Members are name, type and offset.
+			uint32_t memberCount = fields[2] >> 16;
+			if (!m_Part.HasArray(fields[3], memberCount, 12))
+			{
+				return Fail(m_Error, "RDEF", "truncated member table");
+			}
+			if (memberCount > m_TypeBudget)
+			{
+				return Fail(m_Error, "RDEF", "type table too large");
+			}
+			type.Members.resize(memberCount);
+			for (uint32_t i = 0; i < memberCount; ++i)
+			{
+				uint32_t member[3] = {};
+				m_Part.Read(fields[3] + i * 12, member);
+				type.Members[i].Offset = member[2];
+				if (!ReadName(member[0], type.Members[i].Name) || !ParseType(member[1], depth + 1, type.Members[i].Type))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool ReadName(uint32_t offset, std::string& name)
+		{
+			return m_Part.ReadString(offset, name) || Fail(m_Error, "RDEF", "name out of bounds");
+		}
+
+		const PartReader& m_Part;
+		std::string& m_Error;
+		uint32_t m_MajorVersion;
+		// Types and members left to parse in this part.
+		uint32_t m_TypeBudget;
+	};
+
+	ShaderInputType GetPsvInputType(uint32_t type, uint32_t kind, bool& known)
+	{
+		known = true;
+		switch (type)
+		{
+		case 1: return ShaderInputType::Sampler;
+		case 2: return ShaderInputType::ConstantBuffer;
+		case 3: return kind == PsvKindTBuffer ? ShaderInputType::TextureBuffer : ShaderInputType::Texture;
+		case 4: return kind == PsvKindAccelerationStructure ? ShaderInputType::AccelerationStructure : ShaderInputType::ByteAddress;
+		case 5: return ShaderInputType::Structured;
+		case 6:
+			return kind == PsvKindFeedbackTexture2D || kind == PsvKindFeedbackTexture2DArray
+				? ShaderInputType::FeedbackTexture
+				: ShaderInputType::RWTyped;
+		case 7: return ShaderInputType::RWByteAddress;
+		case 8: return ShaderInputType::RWStructured;
+		case 9: return ShaderInputType::RWStructuredWithCounter;
+		default:
+			known = false;
+			return ShaderInputType::ConstantBuffer;
+		}
+	}
+
+	// The runtime info, whose size gives its version, then the bindings,
+	// each a type, space and inclusive register range, plus the resource
+	// kind from version 1. Signatures and view ID tables follow, but the
+	// signature parts have the same elements with more detail.
+	bool ParsePsv(const PartReader& part, bool readBindings, ShaderReflection& reflection, std::string& error)
+	{
+		uint32_t runtimeInfoSize = 0;
+		if (!part.Read(0, runtimeInfoSize) || !part.HasArray(4, 1, runtimeInfoSize))
+		{
+			return Fail(error, "PSV0", "truncated runtime info");
+		}
+		if (runtimeInfoSize >= PsvRuntimeInfo2Size && HasThreadGroup(reflection.ProgramType))
+		{
+			part.Read(4 + PsvNumThreadsOffset, reflection.ThreadGroupSize);
+		}
+		if (!readBindings)
+		{
+			return true;
+		}
+
+		uint32_t offset = 4 + runtimeInfoSize;
+		uint32_t count = 0;
+		uint32_t stride = 0;
+		if (!part.Read(offset, count))
+		{
+			return Fail(error, "PSV0", "truncated binding count");
+		}
+		if (count == 0)
+		{
+			return true;
+		}
+		if (!part.Read(offset + 4, stride) || stride < PsvBindInfo0Size || !part.HasArray(offset + 8, count, stride))
+		{
+			return Fail(error, "PSV0", "truncated binding table");
+		}
+
+		reflection.Bindings.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t fields[5] = {};
+			part.Read(offset + 8 + i * stride, fields[0]);
+			part.Read(offset + 12 + i * stride, fields[1]);
+			part.Read(offset + 16 + i * stride, fields[2]);
+			part.Read(offset + 20 + i * stride, fields[3]);
+			if (stride >= PsvBindInfo1Size)
+			{
+				part.Read(offset + 24 + i * stride, fields[4]);
+			}
+
+			ShaderResourceBinding& binding = reflection.Bindings[i];
+			bool known = false;
+			binding.Type = GetPsvInputType(fields[0], fields[4], known);
+			if (!known)
+			{
+				return Fail(error, "PSV0", "unknown binding type");
+			}
+			if (fields[3] != UINT32_MAX && fields[3] < fields[2])
+			{
+				return Fail(error, "PSV0", "binding range ends before it starts");
+			}
+			binding.Space = fields[1];
+			binding.BindPoint = fields[2];
+			binding.BindCount = fields[3] == UINT32_MAX ? 0 : fields[3] - fields[2] + 1;
+			binding.Dimension = fields[4] < sizeof(s_KindDimensions) / sizeof(s_KindDimensions[0]) ? s_KindDimensions[fields[4]] : 0;
+		}
+		return true;
+	}
+
+	char GetRegisterLetter(ShaderInputType type)
+	{
+		switch (GetShaderBindingClass(type))
+		{
+		case ShaderBindingClass::ShaderResource: return 't';
+		case ShaderBindingClass::UnorderedAccess: return 'u';
+		case ShaderBindingClass::ConstantBuffer: return 'b';
+		default: return 's';
+		}
+	}
+
+	void WriteSignature(std::ostream& out, const char* title, const std::vector<ShaderSignatureElement>& elements)
+	{
+		if (elements.empty())
+		{
+			return;
+		}
+		out << title << ":\n";
+		for (const ShaderSignatureElement& element : elements)
+		{
+			std::string mask;
+			for (uint32_t component = 0; component < 4; ++component)
+			{
+				mask += element.Mask & (1 << component) ? "xyzw"[component] : '_';
+			}
+			out << "  " << std::left << std::setw(20) << element.SemanticName + std::to_string(element.SemanticIndex)
+				<< std::right << " v" << std::left << std::setw(3) << element.Register << std::right << " " << mask;
+			if (element.Stream != 0)
+			{
+				out << " stream " << element.Stream;
+			}
+			out << "\n";
+		}
+	}
+
+	void WriteType(std::ostream& out, const ShaderVariableType& type, uint32_t baseOffset, int indent)
+	{
+		for (const ShaderVariableType::Member& member : type.Members)
+		{
+			out << std::string(indent, ' ') << "+" << std::left << std::setw(5) << baseOffset + member.Offset << std::right
+				<< member.Type.Name << " " << member.Name;
+			if (member.Type.Elements)
+			{
+				out << "[" << member.Type.Elements << "]";
+			}
+			out << "\n";
+			WriteType(out, member.Type, baseOffset + member.Offset, indent + 2);
+		}
+	}
+}
+
+ShaderBindingClass GetShaderBindingClass(ShaderInputType type)
+{
+	switch (type)
+	{
+	case ShaderInputType::ConstantBuffer:
+		return ShaderBindingClass::ConstantBuffer;
+	case ShaderInputType::Sampler:
+		return ShaderBindingClass::Sampler;
+	case ShaderInputType::TextureBuffer:
+	case ShaderInputType::Texture:
+	case ShaderInputType::Structured:
+	case ShaderInputType::ByteAddress:
+	case ShaderInputType::AccelerationStructure:
+		return ShaderBindingClass::ShaderResource;
+	default:
+		return ShaderBindingClass::UnorderedAccess;
+	}
+}
+
+const char* GetShaderProgramTypeName(ShaderProgramType type)
+{
+	switch (type)
+	{
+	case ShaderProgramType::Pixel: return "Pixel";
+	case ShaderProgramType::Vertex: return "Vertex";
+	case ShaderProgramType::Geometry: return "Geometry";
+	case ShaderProgramType::Hull: return "Hull";
+	case ShaderProgramType::Domain: return "Domain";
+	case ShaderProgramType::Compute: return "Compute";
+	case ShaderProgramType::Library: return "Library";
+	case ShaderProgramType::Mesh: return "Mesh";
+	case ShaderProgramType::Amplification: return "Amplification";
+	default: return "Unknown";
+	}
+}
+
+const char* GetShaderInputTypeName(ShaderInputType type)
+{
+	static const char* s_Names[] =
+	{
+		"cbuffer",
+		"tbuffer",
+		"Texture",
+		"SamplerState",
+		"RWTexture",
+		"StructuredBuffer",
+		"RWStructuredBuffer",
+		"ByteAddressBuffer",
+		"RWByteAddressBuffer",
+		"AppendStructuredBuffer",
+		"ConsumeStructuredBuffer",
+		"RWStructuredBuffer+counter",
+		"RaytracingAccelerationStructure",
+		"FeedbackTexture",
+	};
+	size_t index = static_cast<size_t>(type);
+	return index < sizeof(s_Names) / sizeof(s_Names[0]) ? s_Names[index] : "Unknown";
+}
+
+const ShaderConstantBuffer* ShaderReflection::FindConstantBuffer(const ShaderResourceBinding& binding) const
+{
+	if (binding.Name.empty() ||
+		(binding.Type != ShaderInputType::ConstantBuffer && binding.Type != ShaderInputType::TextureBuffer))
+	{
+		return nullptr;
+	}
+	for (const ShaderConstantBuffer& buffer : ConstantBuffers)
+	{
+		if (buffer.Name == binding.Name)
+		{
+			return &buffer;
+		}
+	}
+	return nullptr;
+}
+
+bool ReflectShader(const void* bytecode, size_t size, ShaderReflection& reflection, std::string& error)
+{
+	reflection = ShaderReflection();
+	error.clear();
+
+	// Header: magic, digest, version, total size, part count, then the part
+	// offsets. Each part is a FourCC and a size in front of its data.
+	PartReader container(static_cast<const uint8_t*>(bytecode), static_cast<uint32_t>((std::min)(size, size_t(UINT32_MAX))));
+	uint32_t magic = 0;
+	uint32_t totalSize = 0;
+	uint32_t partCount = 0;
+	if (!bytecode || !container.Read(0, magic) || magic != ContainerMagic)
+	{
+		return Fail(error, "Container", "not a DXBC container");
+	}
+	if (!container.Read(24, totalSize) || !container.Read(28, partCount) ||
+		totalSize < ContainerHeaderSize || totalSize > container.GetSize())
+	{
+		return Fail(error, "Container", "truncated");
+	}
+	container = container.GetSubrange(0, totalSize);
+	if (!container.HasArray(ContainerHeaderSize, partCount, 4))
+	{
+		return Fail(error, "Container", "truncated part table");
+	}
+
+	std::vector<Part> parts;
+	parts.reserve(partCount);
+	for (uint32_t i = 0; i < partCount; ++i)
+	{
+		uint32_t offset = 0;
+		uint32_t fourCC = 0;
+		uint32_t partSize = 0;
+		container.Read(ContainerHeaderSize + i * 4, offset);
+		if (!container.Read(offset, fourCC) || !container.Read(offset + 4, partSize) ||
+			!container.HasArray(offset + 8, partSize, 1))
+		{
+			return Fail(error, "Container", "part out of bounds");
+		}
+		parts.push_back({ fourCC, container.GetSubrange(offset + 8, partSize) });
+	}
+
+	uint32_t fourCC = 0;
+	if (const PartReader* program = FindPart(parts, { PartShex, PartShdr }, fourCC))
+	{
+		if (!ParseProgram(*program, reflection, error))
+		{
+			return false;
+		}
+	}
+	else if (const PartReader* dxil = FindPart(parts, PartDxil))
+	{
+		if (!ParseDxilHeader(*dxil, reflection, error))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		return Fail(error, "Container", "no SHDR, SHEX or DXIL part");
+	}
+
+	const PartReader* rdef = FindPart(parts, PartRdef);
+	if (rdef && !RdefParser(*rdef, error).Parse(reflection))
+	{
+		return false;
+	}
+	if (const PartReader* psv = FindPart(parts, PartPsv0))
+	{
+		if (!ParsePsv(*psv, !rdef, reflection, error))
+		{
+			return false;
+		}
+	}
+
+	if (const PartReader* inputs = FindPart(parts, { PartIsg1, PartIsgn }, fourCC))
+	{
+		if (!ParseSignature(*inputs, fourCC, "ISGN", reflection.Inputs, error))
+		{
+			return false;
+		}
+	}
+	if (const PartReader* outputs = FindPart(parts, { PartOsg1, PartOsg5, PartOsgn }, fourCC))
+	{
+		if (!ParseSignature(*outputs, fourCC, "OSGN", reflection.Outputs, error))
+		{
+			return false;
+		}
+	}
+	if (const PartReader* patchConstants = FindPart(parts, { PartPsg1, PartPcsg }, fourCC))
+	{
+		if (!ParseSignature(*patchConstants, fourCC, "PCSG", reflection.PatchConstants, error))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void WriteShaderReflection(std::ostream& out, const ShaderReflection& reflection)
+{
+	out << GetShaderProgramTypeName(reflection.ProgramType) << " shader " << reflection.MajorVersion << "."
+		<< reflection.MinorVersion << (reflection.IsDxil ? " (DXIL)" : " (DXBC)") << "\n";
+	if (HasThreadGroup(reflection.ProgramType))
+	{
+		out << "Thread group: " << reflection.ThreadGroupSize[0] << " x " << reflection.ThreadGroupSize[1]
+			<< " x " << reflection.ThreadGroupSize[2] << "\n";
+	}
+
+	WriteSignature(out, "Inputs", reflection.Inputs);
+	WriteSignature(out, "Outputs", reflection.Outputs);
+	WriteSignature(out, "Patch constants", reflection.PatchConstants);
+
+	if (!reflection.Bindings.empty())
+	{
+		out << "Bindings:\n";
+	}
+	for (const ShaderResourceBinding& binding : reflection.Bindings)
+	{
+		std::string slot = GetRegisterLetter(binding.Type) + std::to_string(binding.BindPoint);
+		out << "  " << std::left << std::setw(32) << GetShaderInputTypeName(binding.Type) << std::setw(6) << slot
+			<< " space" << std::setw(3) << binding.Space << std::right;
+		if (binding.BindCount == 0)
+		{
+			out << " unbounded";
+		}
+		else if (binding.BindCount > 1)
+		{
+			out << " x" << binding.BindCount;
+		}
+		if (!binding.Name.empty())
+		{
+			out << " " << binding.Name;
+		}
+		out << "\n";
+	}
+
+	for (const ShaderConstantBuffer& buffer : reflection.ConstantBuffers)
+	{
+		out << "cbuffer " << buffer.Name << ", " << buffer.Size << " bytes:\n";
+		for (const ShaderVariable& variable : buffer.Variables)
+		{
+			out << "  +" << std::left << std::setw(5) << variable.Offset << std::right << variable.Type.Name << " "
+				<< variable.Name;
+			if (variable.Type.Elements)
+			{
+				out << "[" << variable.Type.Elements << "]";
+			}
+			out << (variable.Used ? "\n" : " (unused)\n");
+			WriteType(out, variable.Type, variable.Offset, 4);
+		}
+	}
+}
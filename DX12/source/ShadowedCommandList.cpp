@@ -0,0 +1,636 @@
+#include "../include/ShadowedCommandList.h"
+#include "../include/DescriptorHandle.h"
+#include "../include/helpers.h"
+
+#include <cassert>
+#include <cstring>
+
+std::atomic<UINT64> ShadowedCommandList::s_FrameForwarded[static_cast<size_t>(ShadowedCall::Count)] = {};
+std::atomic<UINT64> ShadowedCommandList::s_FrameElided[static_cast<size_t>(ShadowedCall::Count)] = {};
+
+namespace
+{
+	bool operator==(const D3D12_RECT& l, const D3D12_RECT& r)
+	{
+		return l.left == r.left && l.top == r.top && l.right == r.right && l.bottom == r.bottom;
+	}
+
+	template <typename T>
+	bool ArraysEqual(const T* l, const T* r, UINT count)
+	{
+		for (UINT i = 0; i < count; ++i)
+		{
+			if (!(l[i] == r[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool PreservesEverything(const D3D12_RENDER_PASS_RENDER_TARGET_DESC& desc)
+	{
+		return desc.BeginningAccess.Type == D3D12_RENDER_PASS_BEGINNING_ACCESS_TYPE_PRESERVE &&
+			desc.EndingAccess.Type == D3D12_RENDER_PASS_ENDING_ACCESS_TYPE_PRESERVE;
+	}
+
+	bool PreservesEverything(const D3D12_RENDER_PASS_DEPTH_STENCIL_DESC& desc)
+	{
+		auto preserved = [](D3D12_RENDER_PASS_BEGINNING_ACCESS_TYPE begin, D3D12_RENDER_PASS_ENDING_ACCESS_TYPE end)
+		{
+			return (begin == D3D12_RENDER_PASS_BEGINNING_ACCESS_TYPE_PRESERVE && end == D3D12_RENDER_PASS_ENDING_ACCESS_TYPE_PRESERVE) ||
+				(begin == D3D12_RENDER_PASS_BEGINNING_ACCESS_TYPE_NO_ACCESS && end == D3D12_RENDER_PASS_ENDING_ACCESS_TYPE_NO_ACCESS);
+		};
+		return preserved(desc.DepthBeginningAccess.Type, desc.DepthEndingAccess.Type) &&
+			preserved(desc.StencilBeginningAccess.Type, desc.StencilEndingAccess.Type);
+	}
+}
+
+const char* GetShadowedCallName(ShadowedCall call)
+{
+	static const char* s_Names[static_cast<size_t>(ShadowedCall::Count)] =
+	{
+		"SetGraphicsRootSignature",
+		"SetComputeRootSignature",
+		"SetPipelineState",
+		"IASetPrimitiveTopology",
+		"IASetVertexBuffers",
+		"IASetIndexBuffer",
+		"RSSetViewports",
+		"RSSetScissorRects",
+		"OMSetRenderTargets",
+		"OMSetBlendFactor",
+		"OMSetStencilRef",
+		"SetDescriptorHeaps",
+		"SetGraphicsRootDescriptorTable",
+		"SetComputeRootDescriptorTable",
+		"SetGraphicsRootView",
+		"SetComputeRootView",
+		"RenderPass",
+	};
+	return call < ShadowedCall::Count ? s_Names[static_cast<size_t>(call)] : "Unknown";
+}
+
+UINT64 ShadowedCommandListStats::GetTotalForwarded() const
+{
+	UINT64 total = 0;
+	for (UINT64 count : Forwarded)
+	{
+		total += count;
+	}
+	return total;
+}
+
+UINT64 ShadowedCommandListStats::GetTotalElided() const
+{
+	UINT64 total = 0;
+	for (UINT64 count : Elided)
+	{
+		total += count;
+	}
+	return total;
+}
+
+ShadowedCommandListStats& ShadowedCommandListStats::operator+=(const ShadowedCommandListStats& other)
+{
+	for (size_t i = 0; i < static_cast<size_t>(ShadowedCall::Count); ++i)
+	{
+		Forwarded[i] += other.Forwarded[i];
+		Elided[i] += other.Elided[i];
+	}
+	return *this;
+}
+
+void ShadowedCommandList::RootArguments::Invalidate()
+{
+	ValidMask = 0;
+}
+
+bool ShadowedCommandList::RootArguments::IsSet(UINT index, UINT64 value) const
+{
+	return (ValidMask & (1ull << index)) && Values[index] == value;
+}
+
+void ShadowedCommandList::RootArguments::Set(UINT index, UINT64 value)
+{
+	Values[index] = value;
+	ValidMask |= 1ull << index;
+}
+
+ShadowedCommandList::ShadowedCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList)
+	: m_CommandList(commandList)
+	, m_EndRenderPassPending(false)
+{
+	// Render passes need ID3D12GraphicsCommandList4, which older runtimes lack.
+	m_CommandList.As(&m_CommandList4);
+
+	InvalidateState();
+}
+
+ID3D12GraphicsCommandList* ShadowedCommandList::Get()
+{
+	FlushPendingEndRenderPass();
+	return m_CommandList.Get();
+}
+
+void ShadowedCommandList::Reset(ID3D12CommandAllocator* allocator, ID3D12PipelineState* initialState)
+{
+	assert(!m_EndRenderPassPending && "Command list was reset without being closed.");
+
+	ThrowIfFailed(m_CommandList->Reset(allocator, initialState));
+
+	InvalidateState();
+	m_PipelineState = initialState;
+	m_Stats = ShadowedCommandListStats();
+}
+
+void ShadowedCommandList::Close()
+{
+	FlushPendingEndRenderPass();
+
+	ThrowIfFailed(m_CommandList->Close());
+
+	for (size_t i = 0; i < static_cast<size_t>(ShadowedCall::Count); ++i)
+	{
+		s_FrameForwarded[i].fetch_add(m_Stats.Forwarded[i], std::memory_order_relaxed);
+		s_FrameElided[i].fetch_add(m_Stats.Elided[i], std::memory_order_relaxed);
+	}
+}
+
+void ShadowedCommandList::InvalidateState()
+{
+	m_PipelineState = nullptr;
+	m_PrimitiveTopologyValid = false;
+
+	m_Graphics.RootSignature = nullptr;
+	m_Graphics.Invalidate();
+	m_Compute.RootSignature = nullptr;
+	m_Compute.Invalidate();
+
+	m_NumDescriptorHeaps = 0;
+	m_DescriptorHeapsValid = false;
+
+	m_VertexBufferValidMask = 0;
+	m_IndexBufferValid = false;
+
+	m_NumViewports = 0;
+	m_NumScissorRects = 0;
+
+	m_RenderTargetsValid = false;
+	m_BlendFactorValid = false;
+	m_StencilRefValid = false;
+
+	m_NumRenderPassTargets = 0;
+	m_RenderPassHasDepthStencil = false;
+}
+
+ShadowedCommandListStats ShadowedCommandList::EndFrame()
+{
+	ShadowedCommandListStats stats;
+	for (size_t i = 0; i < static_cast<size_t>(ShadowedCall::Count); ++i)
+	{
+		stats.Forwarded[i] = s_FrameForwarded[i].exchange(0, std::memory_order_relaxed);
+		stats.Elided[i] = s_FrameElided[i].exchange(0, std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+bool ShadowedCommandList::Elide(ShadowedCall call, bool unchanged)
+{
+	size_t index = static_cast<size_t>(call);
+	if (unchanged)
+	{
+		++m_Stats.Elided[index];
+		return true;
+	}
+
+	FlushPendingEndRenderPass();
+	++m_Stats.Forwarded[index];
+	return false;
+}
+
+bool ShadowedCommandList::SetRootArgument(RootArguments& arguments, ShadowedCall call, UINT index, UINT64 value)
+{
+	assert(index < MaxRootParameters);
+
+	if (Elide(call, arguments.IsSet(index, value)))
+	{
+		return false;
+	}
+
+	arguments.Set(index, value);
+	return true;
+}
+
+void ShadowedCommandList::FlushPendingEndRenderPass()
+{
+	if (m_EndRenderPassPending)
+	{
+		m_EndRenderPassPending = false;
+		m_CommandList4->EndRenderPass();
+		++m_Stats.Forwarded[static_cast<size_t>(ShadowedCall::RenderPass)];
+	}
+}
+
+void ShadowedCommandList::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	if (Elide(ShadowedCall::GraphicsRootSignature, m_Graphics.RootSignature == rootSignature))
+	{
+		return;
+	}
+
+	// Changing the root signature leaves all root arguments undefined.
+	m_Graphics.RootSignature = rootSignature;
+	m_Graphics.Invalidate();
+	m_CommandList->SetGraphicsRootSignature(rootSignature);
+}
+
+void ShadowedCommandList::SetComputeRootSignature(ID3D12RootSignature* rootSignature)
+{
+	if (Elide(ShadowedCall::ComputeRootSignature, m_Compute.RootSignature == rootSignature))
+	{
+		return;
+	}
+
+	m_Compute.RootSignature = rootSignature;
+	m_Compute.Invalidate();
+	m_CommandList->SetComputeRootSignature(rootSignature);
+}
+
+void ShadowedCommandList::SetPipelineState(ID3D12PipelineState* pipelineState)
+{
+	if (Elide(ShadowedCall::PipelineState, m_PipelineState == pipelineState))
+	{
+		return;
+	}
+
+	m_PipelineState = pipelineState;
+	m_CommandList->SetPipelineState(pipelineState);
+}
+
+void ShadowedCommandList::SetDescriptorHeaps(UINT numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps)
+{
+	assert(numDescriptorHeaps <= _countof(m_DescriptorHeaps));
+
+	bool unchanged = m_DescriptorHeapsValid && m_NumDescriptorHeaps == numDescriptorHeaps &&
+		ArraysEqual(m_DescriptorHeaps, descriptorHeaps, numDescriptorHeaps);
+	if (Elide(ShadowedCall::DescriptorHeaps, unchanged))
+	{
+		return;
+	}
+
+	std::memcpy(m_DescriptorHeaps, descriptorHeaps, numDescriptorHeaps * sizeof(ID3D12DescriptorHeap*));
+	m_NumDescriptorHeaps = numDescriptorHeaps;
+	m_DescriptorHeapsValid = true;
+
+	// Tables set against the old heaps must be set again.
+	m_Graphics.Invalidate();
+	m_Compute.Invalidate();
+
+	m_CommandList->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
+}
+
+void ShadowedCommandList::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	if (SetRootArgument(m_Graphics, ShadowedCall::GraphicsRootDescriptorTable, rootParameterIndex, baseDescriptor.ptr))
+	{
+		m_CommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+	}
+}
+
+void ShadowedCommandList::SetComputeRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	if (SetRootArgument(m_Compute, ShadowedCall::ComputeRootDescriptorTable, rootParameterIndex, baseDescriptor.ptr))
+	{
+		m_CommandList->SetComputeRootDescriptorTable(rootParameterIndex, baseDescriptor);
+	}
+}
+
+void ShadowedCommandList::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	if (SetRootArgument(m_Graphics, ShadowedCall::GraphicsRootView, rootParameterIndex, bufferLocation))
+	{
+		m_CommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void ShadowedCommandList::SetComputeRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	if (SetRootArgument(m_Compute, ShadowedCall::ComputeRootView, rootParameterIndex, bufferLocation))
+	{
+		m_CommandList->SetComputeRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void ShadowedCommandList::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	if (SetRootArgument(m_Graphics, ShadowedCall::GraphicsRootView, rootParameterIndex, bufferLocation))
+	{
+		m_CommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void ShadowedCommandList::SetComputeRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	if (SetRootArgument(m_Compute, ShadowedCall::ComputeRootView, rootParameterIndex, bufferLocation))
+	{
+		m_CommandList->SetComputeRootShaderResourceView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void ShadowedCommandList::SetGraphicsRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	if (SetRootArgument(m_Graphics, ShadowedCall::GraphicsRootView, rootParameterIndex, bufferLocation))
+	{
+		m_CommandList->SetGraphicsRootUnorderedAccessView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void ShadowedCommandList::SetComputeRootUnorderedAccessView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	if (SetRootArgument(m_Compute, ShadowedCall::ComputeRootView, rootParameterIndex, bufferLocation))
+	{
+		m_CommandList->SetComputeRootUnorderedAccessView(rootParameterIndex, bufferLocation);
+	}
+}
+
+void ShadowedCommandList::SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValuesToSet, srcData, destOffsetIn32BitValues);
+}
+
+void ShadowedCommandList::SetComputeRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValuesToSet, const void* srcData, UINT destOffsetIn32BitValues)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->SetComputeRoot32BitConstants(rootParameterIndex, num32BitValuesToSet, srcData, destOffsetIn32BitValues);
+}
+
+void ShadowedCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology)
+{
+	if (Elide(ShadowedCall::PrimitiveTopology, m_PrimitiveTopologyValid && m_PrimitiveTopology == primitiveTopology))
+	{
+		return;
+	}
+
+	m_PrimitiveTopology = primitiveTopology;
+	m_PrimitiveTopologyValid = true;
+	m_CommandList->IASetPrimitiveTopology(primitiveTopology);
+}
+
+void ShadowedCommandList::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	assert(startSlot + numViews <= D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+
+	UINT slotMask = (numViews >= 32 ? ~0u : ((1u << numViews) - 1)) << startSlot;
+	bool unchanged = views && (m_VertexBufferValidMask & slotMask) == slotMask &&
+		ArraysEqual(m_VertexBuffers + startSlot, views, numViews);
+	if (Elide(ShadowedCall::VertexBuffers, unchanged))
+	{
+		return;
+	}
+
+	if (views)
+	{
+		std::memcpy(m_VertexBuffers + startSlot, views, numViews * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+		m_VertexBufferValidMask |= slotMask;
+	}
+	else
+	{
+		// A null array unbinds the slots.
+		m_VertexBufferValidMask &= ~slotMask;
+	}
+
+	m_CommandList->IASetVertexBuffers(startSlot, numViews, views);
+}
+
+void ShadowedCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+	bool unchanged = view && m_IndexBufferValid && m_IndexBuffer == *view;
+	if (Elide(ShadowedCall::IndexBuffer, unchanged))
+	{
+		return;
+	}
+
+	m_IndexBufferValid = view != nullptr;
+	if (view)
+	{
+		m_IndexBuffer = *view;
+	}
+
+	m_CommandList->IASetIndexBuffer(view);
+}
+
+void ShadowedCommandList::RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports)
+{
+	assert(numViewports <= _countof(m_Viewports));
+
+	// Uses the D3D12_VIEWPORT comparison from d3dx12.h.
+	bool unchanged = m_NumViewports == numViewports && ArraysEqual(m_Viewports, viewports, numViewports);
+	if (Elide(ShadowedCall::Viewports, unchanged))
+	{
+		return;
+	}
+
+	std::memcpy(m_Viewports, viewports, numViewports * sizeof(D3D12_VIEWPORT));
+	m_NumViewports = numViewports;
+	m_CommandList->RSSetViewports(numViewports, viewports);
+}
+
+void ShadowedCommandList::RSSetScissorRects(UINT numRects, const D3D12_RECT* rects)
+{
+	assert(numRects <= _countof(m_ScissorRects));
+
+	bool unchanged = m_NumScissorRects == numRects && ArraysEqual(m_ScissorRects, rects, numRects);
+	if (Elide(ShadowedCall::ScissorRects, unchanged))
+	{
+		return;
+	}
+
+	std::memcpy(m_ScissorRects, rects, numRects * sizeof(D3D12_RECT));
+	m_NumScissorRects = numRects;
+	m_CommandList->RSSetScissorRects(numRects, rects);
+}
+
+void ShadowedCommandList::OMSetRenderTargets(
+	UINT numRenderTargetDescriptors,
+	const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetDescriptors,
+	BOOL rtsSingleHandleToDescriptorRange,
+	const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencilDescriptor)
+{
+	assert(numRenderTargetDescriptors <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+
+	// Expand a descriptor range into individual handles so both forms compare equal.
+	D3D12_CPU_DESCRIPTOR_HANDLE renderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	for (UINT i = 0; i < numRenderTargetDescriptors; ++i)
+	{
+		renderTargets[i] = rtsSingleHandleToDescriptorRange
+			? RtvCpuHandle(renderTargetDescriptors[0], i)
+			: renderTargetDescriptors[i];
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE depthStencil = depthStencilDescriptor ? *depthStencilDescriptor : D3D12_CPU_DESCRIPTOR_HANDLE{ 0 };
+
+	bool unchanged = m_RenderTargetsValid && m_NumRenderTargets == numRenderTargetDescriptors &&
+		m_DepthStencil.ptr == depthStencil.ptr;
+	for (UINT i = 0; unchanged && i < numRenderTargetDescriptors; ++i)
+	{
+		unchanged = m_RenderTargets[i].ptr == renderTargets[i].ptr;
+	}
+
+	if (Elide(ShadowedCall::RenderTargets, unchanged))
+	{
+		return;
+	}
+
+	std::memcpy(m_RenderTargets, renderTargets, numRenderTargetDescriptors * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+	m_NumRenderTargets = numRenderTargetDescriptors;
+	m_DepthStencil = depthStencil;
+	m_RenderTargetsValid = true;
+
+	m_CommandList->OMSetRenderTargets(numRenderTargetDescriptors, renderTargetDescriptors, rtsSingleHandleToDescriptorRange, depthStencilDescriptor);
+}
+
+void ShadowedCommandList::OMSetBlendFactor(const FLOAT blendFactor[4])
+{
+	static const FLOAT s_DefaultBlendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const FLOAT* factor = blendFactor ? blendFactor : s_DefaultBlendFactor;
+
+	bool unchanged = m_BlendFactorValid && ArraysEqual(m_BlendFactor, factor, 4);
+	if (Elide(ShadowedCall::BlendFactor, unchanged))
+	{
+		return;
+	}
+
+	std::memcpy(m_BlendFactor, factor, sizeof(m_BlendFactor));
+	m_BlendFactorValid = true;
+	m_CommandList->OMSetBlendFactor(blendFactor);
+}
+
+void ShadowedCommandList::OMSetStencilRef(UINT stencilRef)
+{
+	if (Elide(ShadowedCall::StencilRef, m_StencilRefValid && m_StencilRef == stencilRef))
+	{
+		return;
+	}
+
+	m_StencilRef = stencilRef;
+	m_StencilRefValid = true;
+	m_CommandList->OMSetStencilRef(stencilRef);
+}
+
+void ShadowedCommandList::BeginRenderPass(
+	UINT numRenderTargets,
+	const D3D12_RENDER_PASS_RENDER_TARGET_DESC* renderTargets,
+	const D3D12_RENDER_PASS_DEPTH_STENCIL_DESC* depthStencil,
+	D3D12_RENDER_PASS_FLAGS flags)
+{
+	assert(m_CommandList4 && "Render passes require ID3D12GraphicsCommandList4.");
+	assert(numRenderTargets <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+
+	if (m_EndRenderPassPending)
+	{
+		// Uses the render pass comparisons from d3dx12.h.
+		bool identical = m_RenderPassFlags == flags &&
+			m_NumRenderPassTargets == numRenderTargets &&
+			ArraysEqual(m_RenderPassTargets, renderTargets, numRenderTargets) &&
+			m_RenderPassHasDepthStencil == (depthStencil != nullptr) &&
+			(!depthStencil || m_RenderPassDepthStencil == *depthStencil);
+
+		bool preserved = true;
+		for (UINT i = 0; preserved && i < numRenderTargets; ++i)
+		{
+			preserved = PreservesEverything(renderTargets[i]);
+		}
+		preserved = preserved && (!depthStencil || PreservesEverything(*depthStencil));
+
+		if (identical && preserved)
+		{
+			// Continue the previous pass. Both the end and the begin are dropped.
+			m_EndRenderPassPending = false;
+			m_Stats.Elided[static_cast<size_t>(ShadowedCall::RenderPass)] += 2;
+			return;
+		}
+	}
+
+	FlushPendingEndRenderPass();
+
+	std::memcpy(m_RenderPassTargets, renderTargets, numRenderTargets * sizeof(D3D12_RENDER_PASS_RENDER_TARGET_DESC));
+	m_NumRenderPassTargets = numRenderTargets;
+	m_RenderPassHasDepthStencil = depthStencil != nullptr;
+	if (depthStencil)
+	{
+		m_RenderPassDepthStencil = *depthStencil;
+	}
+	m_RenderPassFlags = flags;
+
+	++m_Stats.Forwarded[static_cast<size_t>(ShadowedCall::RenderPass)];
+	m_CommandList4->BeginRenderPass(numRenderTargets, renderTargets, depthStencil, flags);
+}
+
+void ShadowedCommandList::EndRenderPass()
+{
+	assert(!m_EndRenderPassPending && "EndRenderPass called twice.");
+	m_EndRenderPassPending = true;
+}
+
+void ShadowedCommandList::DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
+}
+
+void ShadowedCommandList::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void ShadowedCommandList::Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+}
+
+void ShadowedCommandList::ExecuteIndirect(
+	ID3D12CommandSignature* commandSignature,
+	UINT maxCommandCount,
+	ID3D12Resource* argumentBuffer,
+	UINT64 argumentBufferOffset,
+	ID3D12Resource* countBuffer,
+	UINT64 countBufferOffset)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentBufferOffset, countBuffer, countBufferOffset);
+
+	// Root signatures stay bound, only the arguments may have changed.
+	m_Graphics.Invalidate();
+	m_Compute.Invalidate();
+	m_VertexBufferValidMask = 0;
+	m_IndexBufferValid = false;
+}
+
+void ShadowedCommandList::ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->ResourceBarrier(numBarriers, barriers);
+}
+
+void ShadowedCommandList::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView, const FLOAT colorRGBA[4], UINT numRects, const D3D12_RECT* rects)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->ClearRenderTargetView(renderTargetView, colorRGBA, numRects, rects);
+}
+
+void ShadowedCommandList::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView, D3D12_CLEAR_FLAGS clearFlags, FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil, numRects, rects);
+}
+
+void ShadowedCommandList::ExecuteBundle(ID3D12GraphicsCommandList* bundle)
+{
+	FlushPendingEndRenderPass();
+	m_CommandList->ExecuteBundle(bundle);
+	InvalidateState();
+}
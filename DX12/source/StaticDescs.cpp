@@ -0,0 +1,80 @@
+#include "../include/StaticDescs.h"
+
+#include "../include/d3dx12.h"
+
+namespace
+{
+	// FloatBitsConstant against known IEEE 754 encodings, including the
+	// smallest and largest denormals.
+	static_assert(FloatBitsConstant(0.0f) == 0x00000000u, "FloatBitsConstant(0) is wrong.");
+	static_assert(FloatBitsConstant(1.0f) == 0x3F800000u, "FloatBitsConstant(1) is wrong.");
+	static_assert(FloatBitsConstant(-2.5f) == 0xC0200000u, "FloatBitsConstant(-2.5) is wrong.");
+	static_assert(FloatBitsConstant(0.1f) == 0x3DCCCCCDu, "FloatBitsConstant(0.1) is wrong.");
+	static_assert(FloatBitsConstant(D3D12_FLOAT32_MAX) == 0x7F7FFFFFu, "FloatBitsConstant(FLT_MAX) is wrong.");
+	static_assert(FloatBitsConstant(1.175494351e-38f) == 0x00800000u, "FloatBitsConstant(FLT_MIN) is wrong.");
+	static_assert(FloatBitsConstant(1.401298464e-45f) == 0x00000001u, "FloatBitsConstant(smallest denormal) is wrong.");
+	static_assert(FloatBitsConstant(-1.175494211e-38f) == 0x807FFFFFu, "FloatBitsConstant(largest denormal) is wrong.");
+
+	// Tables built from the static helpers. Hashing them here makes every
+	// HashStaticDesc overload a constant expression at least once.
+	constexpr D3D12_RASTERIZER_DESC s_DefaultRasterizer = StaticRasterizerDesc();
+	constexpr D3D12_RASTERIZER_DESC s_ShadowRasterizer = StaticRasterizerDesc(
+		D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_FRONT, FALSE, -1000, 1.401298464e-45f, -1.5f);
+	constexpr D3D12_STATIC_SAMPLER_DESC s_DefaultSampler = StaticSamplerDesc(0);
+	constexpr D3D12_STATIC_SAMPLER_DESC s_PointClampSampler = StaticSamplerDesc(
+		1, D3D12_FILTER_MIN_MAG_MIP_POINT,
+		D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+		-0.25f, 1, D3D12_COMPARISON_FUNC_ALWAYS, D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK, 0.0f, 4.0f);
+	constexpr D3D12_DESCRIPTOR_RANGE1 s_MaterialRanges[] =
+	{
+		StaticDescriptorRange1(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC),
+		StaticDescriptorRange1(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 1),
+	};
+	constexpr StaticRootParameter1 s_ForwardParameters[] =
+	{
+		StaticRootParameter1::AsConstants(16, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX),
+		StaticRootParameter1::AsConstantBufferView(1),
+		StaticRootParameter1::AsDescriptorTable(s_MaterialRanges, D3D12_SHADER_VISIBILITY_PIXEL),
+	};
+	constexpr D3D12_STATIC_SAMPLER_DESC s_ForwardSamplers[] = { s_DefaultSampler, s_PointClampSampler };
+	constexpr StaticRootSignatureDesc s_ForwardRootSignature(s_ForwardParameters, s_ForwardSamplers);
+
+	constexpr uint64_t s_BlendHash = HashStaticDesc(StaticBlendDesc());
+	constexpr uint64_t s_DepthStencilHash = HashStaticDesc(StaticDepthStencilDesc());
+	constexpr uint64_t s_ForwardRootSignatureHash = HashStaticDesc(s_ForwardRootSignature);
+
+	static_assert(s_BlendHash != s_DepthStencilHash, "Static desc hashes must be constant expressions.");
+	static_assert(s_ForwardRootSignatureHash != HashStaticDesc(StaticRootSignatureDesc(s_ForwardParameters)), "Static samplers must change the root signature hash.");
+
+	// The defaults must be the CD3DX12_DEFAULT values.
+	static_assert(s_DefaultRasterizer.CullMode == D3D12_CULL_MODE_BACK && s_DefaultRasterizer.DepthClipEnable, "StaticRasterizerDesc defaults must match CD3DX12_DEFAULT.");
+	static_assert(StaticBlendDesc().RenderTarget[7].RenderTargetWriteMask == D3D12_COLOR_WRITE_ENABLE_ALL, "StaticBlendDesc must fill every render target.");
+	static_assert(StaticDepthStencilDesc().DepthFunc == D3D12_COMPARISON_FUNC_LESS && StaticDepthStencilDesc().StencilReadMask == D3D12_DEFAULT_STENCIL_READ_MASK, "StaticDepthStencilDesc defaults must match CD3DX12_DEFAULT.");
+}
+
+bool StaticDescHashesMatchRuntime()
+{
+	// Only descs without padding compare with HashValue; see StaticDescs.h.
+	constexpr uint64_t defaultRasterizerHash = HashStaticDesc(s_DefaultRasterizer);
+	constexpr uint64_t shadowRasterizerHash = HashStaticDesc(s_ShadowRasterizer);
+	constexpr uint64_t defaultSamplerHash = HashStaticDesc(s_DefaultSampler);
+	constexpr uint64_t pointClampSamplerHash = HashStaticDesc(s_PointClampSampler);
+	constexpr uint64_t materialRangeHash = HashStaticDesc(s_MaterialRanges[0]);
+
+	const CD3DX12_RASTERIZER_DESC defaultRasterizer(D3D12_DEFAULT);
+	const CD3DX12_RASTERIZER_DESC shadowRasterizer(
+		D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_FRONT, FALSE, -1000, 1.401298464e-45f, -1.5f,
+		TRUE, FALSE, FALSE, 0, D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF);
+	const CD3DX12_STATIC_SAMPLER_DESC defaultSampler(0);
+	const CD3DX12_STATIC_SAMPLER_DESC pointClampSampler(
+		1, D3D12_FILTER_MIN_MAG_MIP_POINT,
+		D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+		-0.25f, 1, D3D12_COMPARISON_FUNC_ALWAYS, D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK, 0.0f, 4.0f);
+	const CD3DX12_DESCRIPTOR_RANGE1 materialRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+
+	return defaultRasterizerHash == HashValue<D3D12_RASTERIZER_DESC>(defaultRasterizer)
+		&& shadowRasterizerHash == HashValue<D3D12_RASTERIZER_DESC>(shadowRasterizer)
+		&& defaultSamplerHash == HashValue<D3D12_STATIC_SAMPLER_DESC>(defaultSampler)
+		&& pointClampSamplerHash == HashValue<D3D12_STATIC_SAMPLER_DESC>(pointClampSampler)
+		&& materialRangeHash == HashValue<D3D12_DESCRIPTOR_RANGE1>(materialRange);
+}
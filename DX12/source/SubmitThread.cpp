@@ -0,0 +1,238 @@
+#include "../include/SubmitThread.h"
+#include "../include/CommandQueue.h"
+#include "../include/Fence.h"
+#include "../include/Profiler.h"
+#include "../include/helpers.h"
+
+#include <chrono>
+#include <exception>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	UINT64 NowNanoseconds()
+	{
+		return static_cast<UINT64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+SubmitThread::SubmitThread(CommandQueue& queue)
+	: m_Queue(queue)
+	, m_Sleeping(false)
+	, m_Posted(0)
+	, m_Executed(0)
+	, m_Stopping(false)
+{
+	m_Thread = std::thread(&SubmitThread::Run, this);
+}
+
+SubmitThread::~SubmitThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WorkAvailable.notify_one();
+	m_Thread.join();
+}
+
+SubmitTicket SubmitThread::Post(Submission submission)
+{
+	UINT64 start = NowNanoseconds();
+
+	Item* item = new Item();
+	item->Work = std::move(submission);
+	item->Ticket = std::make_shared<SubmitTicket::State>();
+	item->Ticket->SignaledValues.resize(item->Work.Signals.size());
+	item->PostedAt = start;
+
+	SubmitTicket ticket;
+	ticket.m_State = item->Ticket;
+
+	m_Items.Push(item);
+	m_Posted.fetch_add(1);
+
+	// Pairs with the submit thread setting m_Sleeping before it checks
+	// m_Posted, so either it sees this post or this sees it sleeping.
+	if (m_Sleeping.load())
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_WorkAvailable.notify_one();
+	}
+
+	m_PostLatency.Record(NowNanoseconds() - start);
+	return ticket;
+}
+
+void SubmitThread::Run()
+{
+	Profiler::SetThreadName("Submit thread");
+
+	for (;;)
+	{
+		Item* item;
+		while (m_Items.TryPop(item))
+		{
+			Execute(*item);
+			delete item;
+			m_Executed.fetch_add(1);
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Submitted.notify_all();
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_Stopping && m_Executed.load() == m_Posted.load())
+		{
+			return;
+		}
+
+		m_Sleeping.store(true);
+		// Post links its node, increments m_Posted and then reads m_Sleeping;
+		// this thread sets m_Sleeping and then reads m_Posted. All four are
+		// sequentially consistent, so one side sees the other: either the
+		// check below counts the post and does not sleep, or the producer
+		// sees m_Sleeping and notifies under m_Mutex, which this thread holds
+		// until wait has blocked. If another producer's node is still
+		// unlinked, TryPop stops short while m_Posted is ahead, and the loop
+		// goes round again instead of sleeping.
+		m_WorkAvailable.wait(lock, [this] { return m_Stopping || m_Executed.load() != m_Posted.load(); });
+		m_Sleeping.store(false);
+	}
+}
+
+void SubmitThread::Execute(Item& item)
+{
+	Submission& work = item.Work;
+
+	try
+	{
+		for (const FenceWait& wait : work.Waits)
+		{
+			m_Queue.Wait(*wait.WaitFence, wait.Value);
+		}
+
+		UINT64 fenceValue = work.CommandLists.empty()
+			? m_Queue.Signal()
+			: m_Queue.ExecuteClosedCommandLists(work.CommandLists);
+
+		for (size_t i = 0; i < work.Signals.size(); ++i)
+		{
+			item.Ticket->SignaledValues[i] = work.Signals[i]->Signal(m_Queue.GetD3D12CommandQueue());
+		}
+
+		item.Ticket->FenceValue.store(fenceValue, std::memory_order_release);
+	}
+	catch (...)
+	{
+		// Reported to whoever waits next. The ticket never becomes submitted.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Error)
+		{
+			m_Error = std::current_exception();
+		}
+	}
+
+	m_QueueLatency.Record(NowNanoseconds() - item.PostedAt);
+}
+
+void SubmitThread::WaitForSubmission(const SubmitTicket& ticket)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Submitted.wait(lock, [this, &ticket] { return ticket.IsSubmitted() || m_Error; });
+	if (m_Error)
+	{
+		std::rethrow_exception(m_Error);
+	}
+}
+
+void SubmitThread::WaitForCompletion(const SubmitTicket& ticket)
+{
+	WaitForSubmission(ticket);
+	m_Queue.WaitForFenceValue(ticket.GetFenceValue());
+}
+
+void SubmitThread::Drain()
+{
+	UINT64 posted = m_Posted.load();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Submitted.wait(lock, [this, posted] { return m_Executed.load() >= posted; });
+	if (m_Error)
+	{
+		std::rethrow_exception(m_Error);
+	}
+}
+
+void SubmitThread::ResetLatency()
+{
+	m_PostLatency.Reset();
+	m_QueueLatency.Reset();
+}
+
+SubmitThread::BenchmarkResult SubmitThread::RunBenchmark(SubmitThread& submitThread, uint32_t producerCount, uint32_t postsPerProducer)
+{
+	submitThread.Drain();
+	submitThread.ResetLatency();
+
+	BenchmarkResult result;
+	result.ProducerCount = producerCount;
+	result.Posts = UINT64(producerCount) * postsPerProducer;
+
+	// The producers start together so their posts contend on the queue.
+	std::atomic<uint32_t> ready(0);
+	std::atomic<bool> start(false);
+	std::vector<std::thread> producers;
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	for (uint32_t i = 0; i < producerCount; ++i)
+	{
+		producers.emplace_back([&]
+		{
+			try
+			{
+				++ready;
+				while (!start.load())
+				{
+					std::this_thread::yield();
+				}
+				for (uint32_t post = 0; post < postsPerProducer; ++post)
+				{
+					ComPtr<ID3D12GraphicsCommandList> commandList = submitThread.m_Queue.GetCommandList();
+					ThrowIfFailed(commandList->Close());
+					submitThread.Post(std::vector<ComPtr<ID3D12GraphicsCommandList>>{ commandList });
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error)
+				{
+					error = std::current_exception();
+				}
+			}
+		});
+	}
+
+	while (ready.load() != producerCount)
+	{
+		std::this_thread::yield();
+	}
+	auto startTime = std::chrono::high_resolution_clock::now();
+	start = true;
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+	submitThread.Drain();
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	result.Milliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	return result;
+}
@@ -0,0 +1,141 @@
+#include "../include/UploadRing.h"
+#include "../include/d3dx12.h"
+#include "../include/helpers.h"
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// Host-backed rings start at this alignment so they can hold anything an
+	// upload heap can, constant buffers included.
+	const UINT64 HostAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+UploadRing::UploadRing(Microsoft::WRL::ComPtr<ID3D12Device> device, std::shared_ptr<Fence> fence, UINT64 size)
+	: m_Fence(fence)
+	, m_CpuBase(nullptr)
+	, m_GpuBase(0)
+	, m_Size(size)
+	, m_Head(0)
+	, m_Tail(0)
+	, m_FinishedHead(0)
+{
+	CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_Resource)));
+
+	// Upload heaps can stay mapped for the lifetime of the resource.
+	CD3DX12_RANGE readRange(0, 0);
+	void* data = nullptr;
+	ThrowIfFailed(m_Resource->Map(0, &readRange, &data));
+	m_CpuBase = static_cast<UINT8*>(data);
+	m_GpuBase = m_Resource->GetGPUVirtualAddress();
+}
+
+UploadRing::UploadRing(std::shared_ptr<Fence> fence, UINT64 size)
+	: m_Fence(fence)
+	, m_HostMemory(static_cast<size_t>(size + HostAlignment))
+	, m_CpuBase(nullptr)
+	, m_GpuBase(0)
+	, m_Size(size)
+	, m_Head(0)
+	, m_Tail(0)
+	, m_FinishedHead(0)
+{
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_HostMemory.data());
+	m_CpuBase = reinterpret_cast<UINT8*>(AlignUp(base, HostAlignment));
+}
+
+UploadRing::~UploadRing()
+{
+	if (m_Resource)
+	{
+		m_Resource->Unmap(0, nullptr);
+	}
+}
+
+bool UploadRing::TryAllocate(UINT64 size, UINT64 alignment, Allocation& allocation)
+{
+	assert(alignment && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+	if (size > m_Size)
+	{
+		return false;
+	}
+
+	Retire();
+
+	UINT64 offset = m_Head % m_Size;
+	UINT64 alignedOffset = AlignUp(offset, alignment);
+	UINT64 padding = alignedOffset - offset;
+	if (alignedOffset + size > m_Size)
+	{
+		// Skip the rest of this lap rather than split the allocation.
+		alignedOffset = 0;
+		padding = m_Size - offset;
+	}
+	UINT64 end = m_Head + padding + size;
+	if (end - m_Tail > m_Size)
+	{
+		return false;
+	}
+
+	m_Head = end;
+	allocation.CpuAddress = m_CpuBase + alignedOffset;
+	allocation.GpuAddress = m_GpuBase + alignedOffset;
+	allocation.Resource = m_Resource.Get();
+	allocation.Offset = alignedOffset;
+	allocation.Size = size;
+	return true;
+}
+
+UploadRing::Allocation UploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+	if (size > m_Size)
+	{
+		throw std::length_error("UploadRing: allocation of " + std::to_string(size) +
+			" bytes is larger than the ring's " + std::to_string(m_Size));
+	}
+
+	Allocation allocation;
+	while (!TryAllocate(size, alignment, allocation))
+	{
+		// Nothing handed to Finish is left to wait for, so the space is taken
+		// by allocations that have not been finished yet.
+		if (m_Pending.empty())
+		{
+			throw std::runtime_error("UploadRing: out of space for " + std::to_string(size) +
+				" bytes, and no finished frame to wait for");
+		}
+		m_Fence->Wait(m_Pending.front().FenceValue);
+	}
+	return allocation;
+}
+
+void UploadRing::Finish(UINT64 fenceValue)
+{
+	if (m_Head != m_FinishedHead)
+	{
+		assert((m_Pending.empty() || m_Pending.back().FenceValue <= fenceValue) && "Fence values must not decrease.");
+		m_Pending.push_back({ fenceValue, m_Head });
+		m_FinishedHead = m_Head;
+	}
+}
+
+void UploadRing::Retire()
+{
+	UINT64 completed = m_Fence->GetCompletedValue();
+	while (!m_Pending.empty() && m_Pending.front().FenceValue <= completed)
+	{
+		m_Tail = m_Pending.front().End;
+		m_Pending.pop_front();
+	}
+}
@@ -35,6 +35,830 @@ using namespace Microsoft::WRL;
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "../include/helpers.h"
+#include "../include/CommandQueue.h"
+#include "../include/DrawSort.h"
+#include "../include/FrameBenchmark.h"
+#include "../include/FramePacer.h"
+#include "../include/IndirectArguments.h"
+#include "../include/JobSystem.h"
+#include "../include/NullDevice.h"
+#include "../include/ParallelCommandRecorder.h"
+#include "../include/PerfBenchmarks.h"
+#include "../include/PerfSuite.h"
+#include "../include/PipelineLibraryCache.h"
+#include "../include/PipelineStateHash.h"
+#include "../include/PipelineStream.h"
+#include "../include/Profiler.h"
+#include "../include/RootSignatureAnalyzer.h"
+#include "../include/RootSignatureGenerator.h"
+#include "../include/ShaderCache.h"
+#include "../include/ShaderCompiler.h"
+#include "../include/ShaderReflection.h"
+#include "../include/ShadowedCommandList.h"
+#include "../include/StaticDescs.h"
+#include "../include/SubmitThread.h"
 
+namespace
+{
+	enum class RunMode
+	{
+		None,
+		Benchmark,
+		Perf,
+		PipelineCache,
+		RootSignature,
+		ParallelRecord,
+		Jobs,
+		SubmitThread,
+		DrawSort,
+		Indirect,
+		Profiler,
+		ShaderCache,
+	};
+
+	struct CommandLine
+	{
+		RunMode Mode = RunMode::None;
+		UINT PipelineCount = 256;
+		UINT PermutationCount = 256;
+		std::vector<std::wstring> ShaderPaths;
+		std::wstring SignaturePath;
+		std::wstring UsagePath;
+		FrameBenchmark::Options BenchmarkOptions;
+		PerfSuite::Options PerfOptions;
+		PerfSuite::Thresholds PerfThresholds;
+		std::wstring OutputPath;
+		std::wstring TracePath;
+		std::wstring BaselinePath;
+		std::wstring SaveBaselinePath;
+	};
+
+	void PrintUsage()
+	{
+		wprintf(L"Usage: DX12 --benchmark [options]\n"
+			L"  --frames <n>            Frames measured (default 1000).\n"
+			L"  --warmup <n>            Frames run first and not measured (default 100).\n"
+			L"  --output <file>         Frame statistics JSON (default benchmark.json).\n"
+			L"  --trace <file>          Also save a Chrome trace of the run.\n"
+			L"  --draws <n>             Draws sorted and packed per frame (default 65536).\n"
+			L"  --gpu-ms <ms>           Simulated GPU time per frame (default 4).\n"
+			L"  --frames-in-flight <n>  1 to 4 (default 2).\n"
+			L"  --threads <n>           Job worker threads (default one per remaining core).\n"
+			L"\n"
+			L"       DX12 --perf [options]\n"
+			L"  --baseline <file>       Compare against this baseline; exit 1 on a regression.\n"
+			L"                          Exits 1 without one too if a benchmark is over its budget.\n"
+			L"  --save-baseline <file>  Save the results as a new baseline.\n"
+			L"  --output <file>         Also save the results JSON here.\n"
+			L"  --threshold <fraction>  Slowdown that counts as a regression (default 0.05).\n"
+			L"  --significance <z>      Standard errors a regression must exceed (default 3).\n"
+			L"  --samples <n>           Samples per benchmark (default 15).\n"
+			L"  --filter <text>         Only run benchmarks whose name contains text.\n"
+			L"\n"
+			L"       DX12 --pipeline-cache [options]\n"
+			L"  --pipelines <n>         Pipelines created per pass (default 256).\n"
+			L"  --output <file>         Pipeline library, overwritten (default pipelines.cache).\n"
+			L"\n"
+			L"       DX12 --shader-cache [options]\n"
+			L"  --permutations <n>      Pixel shader permutations compiled per pass (default 256).\n"
+			L"  --output <file>         Shader pack, overwritten (default shaders.pack). The\n"
+			L"                          benchmark's HLSL is written next to it.\n"
+			L"  --threads <n>           Job worker threads compiling misses.\n"
+			L"\n"
+			L"       DX12 --parallel-record [--frames <n>] [--draws <n>] [--threads <n>]\n"
+			L"  Records the draws of a frame into command lists on a null device with 1, 2, 4, ...\n"
+			L"  threads and prints the time per frame and the speedup over one thread.\n"
+			L"\n"
+			L"       DX12 --jobs [--threads <n>]\n"
+			L"  Runs frames of 16384 fine-grained jobs with 1, 2, 4, ... threads and prints the\n"
+			L"  time per frame, the speedup over serial code and the scheduling cost per job.\n"
+			L"\n"
+			L"       DX12 --submit-thread [--threads <n>]\n"
+			L"  Posts command lists to a SubmitThread on a null device from n producer threads\n"
+			L"  (default 4) and prints the post and post-to-queue latency histograms.\n"
+			L"\n"
+			L"       DX12 --draw-sort [--threads <n>]\n"
+			L"  Sorts 1M draw packets with 1, 2, 4, ... threads and prints the sort times and the\n"
+			L"  state changes recording them unsorted and sorted would make.\n"
+			L"\n"
+			L"       DX12 --indirect\n"
+			L"  Packs 64K indirect draw records with the SSE2 and scalar packers for each layout,\n"
+			L"  prints the time per draw and fails if the two wrote different bytes.\n"
+			L"\n"
+			L"       DX12 --profiler\n"
+			L"  Times empty ProfileScopes with recording on and off, and one read of the clock\n"
+			L"  the profiler picked.\n"
+			L"\n"
+			L"       DX12 --root-signature (--shader <file> ... | --signature <file>) [--usage <file>]\n"
+			L"  --shader <file>         Compiled shader (DXBC or DXIL), one per stage of a pipeline.\n"
+			L"                          The root signature is generated from their bindings.\n"
+			L"  --signature <file>      Serialized root signature to analyze instead.\n"
+			L"  --usage <file>          Measured changes per frame of each root parameter, one\n"
+			L"                          \"<parameter> <changes> [<constant buffer DWORDs>]\" per line.\n"
+			L"                          Without it every parameter counts as set once a frame and\n"
+			L"                          the optimizer has nothing to promote or demote.\n");
+	}
+
+	bool ParseUnsigned(const wchar_t* text, UINT& value)
+	{
+		wchar_t* end = nullptr;
+		unsigned long parsed = wcstoul(text, &end, 10);
+		if (end == text || *end != L'\0' || text[0] == L'-')
+		{
+			return false;
+		}
+		value = static_cast<UINT>(parsed);
+		return true;
+	}
+
+	bool ParseDouble(const wchar_t* text, double& value)
+	{
+		wchar_t* end = nullptr;
+		value = wcstod(text, &end);
+		return end != text && *end == L'\0';
+	}
+
+	bool ParseCommandLine(int argc, wchar_t** argv, CommandLine& commandLine)
+	{
+		FrameBenchmark::Options& options = commandLine.BenchmarkOptions;
+		static const struct
+		{
+			const wchar_t* Argument;
+			RunMode Mode;
+		} Modes[] =
+		{
+			{ L"--benchmark", RunMode::Benchmark },
+			{ L"--perf", RunMode::Perf },
+			{ L"--pipeline-cache", RunMode::PipelineCache },
+			{ L"--root-signature", RunMode::RootSignature },
+			{ L"--parallel-record", RunMode::ParallelRecord },
+			{ L"--jobs", RunMode::Jobs },
+			{ L"--submit-thread", RunMode::SubmitThread },
+			{ L"--draw-sort", RunMode::DrawSort },
+			{ L"--indirect", RunMode::Indirect },
+			{ L"--profiler", RunMode::Profiler },
+			{ L"--shader-cache", RunMode::ShaderCache },
+		};
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::wstring argument = argv[i];
+			auto mode = std::find_if(std::begin(Modes), std::end(Modes), [&argument](const auto& m) { return argument == m.Argument; });
+			if (mode != std::end(Modes))
+			{
+				// The modes run different suites, so only one may be given.
+				if (commandLine.Mode != RunMode::None && commandLine.Mode != mode->Mode)
+				{
+					return false;
+				}
+				commandLine.Mode = mode->Mode;
+				continue;
+			}
+
+			// Everything else takes a value.
+			if (i + 1 == argc)
+			{
+				return false;
+			}
+			const wchar_t* value = argv[++i];
+
+			bool parsed = true;
+			if (argument == L"--frames")
+			{
+				parsed = ParseUnsigned(value, options.FrameCount) && options.FrameCount > 0;
+			}
+			else if (argument == L"--warmup")
+			{
+				parsed = ParseUnsigned(value, options.WarmupFrames);
+			}
+			else if (argument == L"--output")
+			{
+				commandLine.OutputPath = value;
+			}
+			else if (argument == L"--trace")
+			{
+				commandLine.TracePath = value;
+			}
+			else if (argument == L"--draws")
+			{
+				parsed = ParseUnsigned(value, options.DrawCount) && options.DrawCount > 0;
+			}
+			else if (argument == L"--gpu-ms")
+			{
+				double milliseconds = 0.0;
+				parsed = ParseDouble(value, milliseconds) && milliseconds >= 0.0;
+				options.GpuFrameTime = std::chrono::microseconds(static_cast<long long>(milliseconds * 1000.0));
+			}
+			else if (argument == L"--frames-in-flight")
+			{
+				parsed = ParseUnsigned(value, options.FramesInFlight)
+					&& options.FramesInFlight >= 1 && options.FramesInFlight <= FramePacer::MaxFramesInFlight;
+			}
+			else if (argument == L"--threads")
+			{
+				parsed = ParseUnsigned(value, options.ThreadCount);
+			}
+			else if (argument == L"--baseline")
+			{
+				commandLine.BaselinePath = value;
+			}
+			else if (argument == L"--save-baseline")
+			{
+				commandLine.SaveBaselinePath = value;
+			}
+			else if (argument == L"--threshold")
+			{
+				parsed = ParseDouble(value, commandLine.PerfThresholds.Change) && commandLine.PerfThresholds.Change >= 0.0;
+			}
+			else if (argument == L"--significance")
+			{
+				parsed = ParseDouble(value, commandLine.PerfThresholds.Significance) && commandLine.PerfThresholds.Significance >= 0.0;
+			}
+			else if (argument == L"--samples")
+			{
+				parsed = ParseUnsigned(value, commandLine.PerfOptions.SampleCount) && commandLine.PerfOptions.SampleCount > 0;
+			}
+			else if (argument == L"--filter")
+			{
+				commandLine.PerfOptions.Filter.assign(value, value + wcslen(value));
+			}
+			else if (argument == L"--pipelines")
+			{
+				parsed = ParseUnsigned(value, commandLine.PipelineCount) && commandLine.PipelineCount > 0;
+			}
+			else if (argument == L"--permutations")
+			{
+				parsed = ParseUnsigned(value, commandLine.PermutationCount) && commandLine.PermutationCount > 0;
+			}
+			else if (argument == L"--shader")
+			{
+				commandLine.ShaderPaths.push_back(value);
+			}
+			else if (argument == L"--signature")
+			{
+				commandLine.SignaturePath = value;
+			}
+			else if (argument == L"--usage")
+			{
+				commandLine.UsagePath = value;
+			}
+			else
+			{
+				parsed = false;
+			}
+
+			if (!parsed)
+			{
+				return false;
+			}
+		}
+		// Only --root-signature reads a root signature, from shaders or a blob
+		// but not both.
+		bool rootSignature = commandLine.Mode == RunMode::RootSignature;
+		int sourceCount = int(!commandLine.ShaderPaths.empty()) + int(!commandLine.SignaturePath.empty());
+		return sourceCount == (rootSignature ? 1 : 0) && (rootSignature || commandLine.UsagePath.empty());
+	}
+
+	void PrintSummary(const wchar_t* name, const FrameTimeSummary& summary)
+	{
+		wprintf(L"%-6ls mean %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  max %8.3f  jitter %8.3f ms\n",
+			name, summary.Mean, summary.P50, summary.P95, summary.P99, summary.Max, summary.Jitter);
+	}
+
+	int RunBenchmark(const CommandLine& commandLine)
+	{
+		Profiler::SetEnabled(!commandLine.TracePath.empty());
+
+		std::wstring outputPath = commandLine.OutputPath.empty() ? L"benchmark.json" : commandLine.OutputPath;
+		FrameStatistics statistics = FrameBenchmark::Run(commandLine.BenchmarkOptions);
+		statistics.SaveJson(outputPath);
+		if (!commandLine.TracePath.empty())
+		{
+			Profiler::SaveChromeTrace(commandLine.TracePath);
+		}
+
+		PrintSummary(L"frame", statistics.GetFrameTimes().GetSummary());
+		PrintSummary(L"cpu", statistics.GetCpuTimes().GetSummary());
+		PrintSummary(L"gpu", statistics.GetGpuTimes().GetSummary());
+		PrintSummary(L"wait", statistics.GetCpuWaits().GetSummary());
+		PrintSummary(L"idle", statistics.GetGpuIdles().GetSummary());
+		wprintf(L"Saved %ls\n", outputPath.c_str());
+		return 0;
+	}
+
+	int RunPerf(const CommandLine& commandLine)
+	{
+		// Load the baseline first so a bad path fails before the long run.
+		std::vector<PerfResult> baseline;
+		if (!commandLine.BaselinePath.empty() && !PerfSuite::LoadJson(commandLine.BaselinePath, baseline))
+		{
+			fwprintf(stderr, L"Cannot read baseline %ls.\n", commandLine.BaselinePath.c_str());
+			return 1;
+		}
+
+		PerfSuite suite;
+		AddPerfBenchmarks(suite);
+		std::vector<PerfResult> results = suite.Run(commandLine.PerfOptions);
+
+		if (!commandLine.OutputPath.empty())
+		{
+			PerfSuite::SaveJson(commandLine.OutputPath, results);
+		}
+		if (!commandLine.SaveBaselinePath.empty())
+		{
+			PerfSuite::SaveJson(commandLine.SaveBaselinePath, results);
+			wprintf(L"Saved baseline %ls\n", commandLine.SaveBaselinePath.c_str());
+		}
+
+		if (commandLine.BaselinePath.empty())
+		{
+			for (const PerfResult& result : results)
+			{
+				wprintf(L"%-48hs %12.1f ns  +-%10.1f\n", result.Name.c_str(), result.Median, result.Deviation);
+			}
+		}
+		for (const PerfRatio& ratio : suite.GetRatios(results))
+		{
+			wprintf(L"%-48hs %12.3fx  %+10.1f ns\n", ratio.Name.c_str(), ratio.Ratio, ratio.Difference);
+		}
+
+		std::vector<PerfBudget> budgets = suite.GetBudgets(results);
+		for (const PerfBudget& budget : budgets)
+		{
+			wprintf(L"%-48hs %12.1f ns  budget %8.1f ns  %hs\n", budget.Name.c_str(), budget.Median, budget.Budget,
+				budget.Exceeded ? "over budget" : "within budget");
+		}
+		bool exceedsBudget = PerfSuite::ExceedsBudget(budgets);
+		if (exceedsBudget)
+		{
+			fwprintf(stderr, L"A benchmark is over its budget.\n");
+		}
+		if (commandLine.BaselinePath.empty())
+		{
+			return exceedsBudget ? 1 : 0;
+		}
+
+		std::vector<PerfComparison> comparisons = PerfSuite::Compare(baseline, results, commandLine.PerfThresholds);
+		for (const PerfComparison& comparison : comparisons)
+		{
+			wprintf(L"%-48hs %12.1f -> %12.1f ns  %+7.1f%%  z %6.1f  %hs\n", comparison.Name.c_str(),
+				comparison.BaselineMedian, comparison.CurrentMedian, comparison.Change * 100.0,
+				comparison.Significance, GetPerfVerdictName(comparison.Verdict));
+		}
+
+		if (PerfSuite::HasRegression(comparisons))
+		{
+			fwprintf(stderr, L"Performance regressed against %ls.\n", commandLine.BaselinePath.c_str());
+			return 1;
+		}
+		return exceedsBudget ? 1 : 0;
+	}
+
+	int RunParallelRecord(const CommandLine& commandLine)
+	{
+		const FrameBenchmark::Options& options = commandLine.BenchmarkOptions;
+		ComPtr<NullDevice> device = NullDevice::Create();
+		CommandQueue queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+		// Sorted draws, as a frame would record them.
+		std::vector<DrawPacket> packets;
+		std::vector<DrawSortItem> order;
+		std::vector<DrawSortItem> scratch;
+		DrawSubmitter::CreateBenchmarkPackets(options.DrawCount, packets, order);
+		RadixSortDrawItems(order, scratch);
+
+		const D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+		const D3D12_RECT scissorRect = { 0, 0, 1920, 1080 };
+		auto setup = [&](ID3D12GraphicsCommandList* commandList)
+		{
+			commandList->RSSetViewports(1, &viewport);
+			commandList->RSSetScissorRects(1, &scissorRect);
+			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		};
+		DrawSubmitter submitter{ DrawSubmitter::RootParameters() };
+		auto record = [&](ID3D12GraphicsCommandList* commandList, size_t begin, size_t end)
+		{
+			ShadowedCommandList shadowed(commandList);
+			submitter.Submit(shadowed, packets, order, begin, end);
+		};
+
+		// --threads counts workers; the scaling run counts the calling thread too.
+		UINT maxThreadCount = options.ThreadCount != 0 ? options.ThreadCount + 1 : 0;
+		std::vector<ParallelCommandRecorder::ScalingResult> results = ParallelCommandRecorder::RunScalingBenchmark(
+			queue, packets.size(), setup, record, maxThreadCount, options.FrameCount);
+		queue.Flush();
+
+		wprintf(L"%u draws, %u frames\n", options.DrawCount, options.FrameCount);
+		for (const ParallelCommandRecorder::ScalingResult& result : results)
+		{
+			wprintf(L"%2u threads  %8.3f ms  speedup %5.2f  efficiency %5.1f%%\n", result.ThreadCount,
+				result.RecordMilliseconds, result.Speedup, 100.0 * result.Speedup / result.ThreadCount);
+		}
+		return 0;
+	}
+
+	int RunJobs(const CommandLine& commandLine)
+	{
+		const uint32_t JobCount = 16384;
+		const uint32_t WorkPerJob = 256;
+		UINT workers = commandLine.BenchmarkOptions.ThreadCount;
+		std::vector<JobSystem::BenchmarkResult> results = JobSystem::RunBenchmark(JobCount, WorkPerJob, workers != 0 ? workers + 1 : 0);
+
+		wprintf(L"%u jobs per frame\n", JobCount);
+		for (const JobSystem::BenchmarkResult& result : results)
+		{
+			wprintf(L"%2u threads  %8.3f ms  speedup %5.2f  overhead %7.1f ns per job\n", result.ThreadCount,
+				result.FrameMilliseconds, result.Speedup, result.OverheadNanosecondsPerJob);
+		}
+		return 0;
+	}
+
+	int RunSubmitThread(const CommandLine& commandLine)
+	{
+		ComPtr<NullDevice> device = NullDevice::Create();
+		CommandQueue queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		SubmitThread submitThread(queue);
+
+		UINT producerCount = commandLine.BenchmarkOptions.ThreadCount != 0 ? commandLine.BenchmarkOptions.ThreadCount : 4;
+		SubmitThread::BenchmarkResult result = SubmitThread::RunBenchmark(submitThread, producerCount);
+
+		std::ostringstream report;
+		report << result.Posts << " posts from " << result.ProducerCount << " threads in " << result.Milliseconds << " ms\n";
+		submitThread.GetPostLatency().Write(report, "Post");
+		submitThread.GetQueueLatency().Write(report, "Post to queue");
+		wprintf(L"%hs", report.str().c_str());
+		return 0;
+	}
+
+	void PrintStateChanges(const wchar_t* name, const DrawStateChanges& changes)
+	{
+		wprintf(L"%-8ls %9llu state changes: %llu root signatures, %llu pipelines, %llu materials, %llu vertex buffers, %llu index buffers\n",
+			name, changes.GetTotal(), changes.RootSignatures, changes.PipelineStates, changes.Materials,
+			changes.VertexBuffers, changes.IndexBuffers);
+	}
+
+	int RunDrawSort(const CommandLine& commandLine)
+	{
+		UINT workers = commandLine.BenchmarkOptions.ThreadCount;
+		DrawSubmitter::Benchmark benchmark = DrawSubmitter::RunBenchmark(1 << 20, workers != 0 ? workers + 1 : 0);
+
+		wprintf(L"%zu packets\n", benchmark.PacketCount);
+		wprintf(L"std::stable_sort  %8.3f ms\n", benchmark.StdSortMilliseconds);
+		for (const DrawSubmitter::BenchmarkResult& result : benchmark.RadixSort)
+		{
+			wprintf(L"radix %2u threads  %8.3f ms  speedup %5.2f\n", result.ThreadCount, result.SortMilliseconds, result.Speedup);
+		}
+		PrintStateChanges(L"unsorted", benchmark.Unsorted);
+		PrintStateChanges(L"sorted", benchmark.Sorted);
+		if (benchmark.Unsorted.GetTotal() != 0)
+		{
+			wprintf(L"%.1f%% fewer state changes\n",
+				100.0 * (1.0 - double(benchmark.Sorted.GetTotal()) / double(benchmark.Unsorted.GetTotal())));
+		}
+		return 0;
+	}
+
+	int RunIndirect()
+	{
+		// Not a multiple of four, so the scalar tail after the SSE2 loop is
+		// checked as well.
+		std::vector<IndirectDrawPacker::BenchmarkResult> results = IndirectDrawPacker::RunBenchmark((1 << 16) + 3);
+
+		bool matches = true;
+		for (const IndirectDrawPacker::BenchmarkResult& result : results)
+		{
+			wprintf(L"%-22ls %2u bytes  scalar %6.2f ns/draw  packed %6.2f ns/draw  %6.2f GB/s  %ls\n",
+				result.Layout == IndirectDrawLayout::DrawIndexed ? L"DrawIndexed" : L"DrawIdAndDrawIndexed",
+				GetIndirectDrawStride(result.Layout), result.ScalarNanosecondsPerDraw, result.PackedNanosecondsPerDraw,
+				result.GigabytesPerSecond, result.Matches ? L"matches scalar" : L"DIFFERS FROM SCALAR");
+			matches = matches && result.Matches;
+		}
+		return matches ? 0 : 1;
+	}
+
+	int RunProfiler()
+	{
+		Profiler::Benchmark benchmark = Profiler::RunBenchmark();
+		wprintf(L"clock            %ls\n", benchmark.TimeStampCounter ? L"rdtsc" : L"steady_clock");
+		wprintf(L"timestamp        %6.1f ns\n", benchmark.TimestampNanoseconds);
+		wprintf(L"scope            %6.1f ns\n", benchmark.ScopeNanoseconds);
+		wprintf(L"scope, disabled  %6.1f ns\n", benchmark.DisabledScopeNanoseconds);
+		return 0;
+	}
+
+	// Every pixel shader differs, so every pipeline misses the library and
+	// is compiled by the driver on the cold pass.
+	const char* const CacheBenchmarkVertexShader =
+		"float4 main(uint id : SV_VertexID) : SV_Position { return float4(id & 1, id >> 1, 0, 1); }";
+	const char* const CacheBenchmarkPixelShader =
+		"float4 main() : SV_Target { return float4(VARIANT / 65536.0, 0, 0, 1); }";
+
+	ComPtr<ID3DBlob> CompileShader(const char* source, const char* profile, const D3D_SHADER_MACRO* defines)
+	{
+		ComPtr<ID3DBlob> bytecode;
+		ComPtr<ID3DBlob> errors;
+		ThrowIfFailed(D3DCompile(source, strlen(source), nullptr, defines, nullptr, "main", profile,
+			D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &bytecode, &errors));
+		return bytecode;
+	}
+
+	int RunPipelineCacheBenchmark(const CommandLine& commandLine)
+	{
+		ComPtr<ID3D12Device2> device;
+		ThrowIfFailed(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device)));
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
+		rootSignatureDesc.Init_1_1(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+		ComPtr<ID3DBlob> rootSignatureBlob;
+		ComPtr<ID3DBlob> errors;
+		ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
+			&rootSignatureBlob, &errors));
+		ComPtr<ID3D12RootSignature> rootSignature;
+		ThrowIfFailed(device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(),
+			rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+		// The cache keys pipelines by a hash that includes the root signature's.
+		SetRootSignatureHash(rootSignature.Get(), rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize());
+
+		ComPtr<ID3DBlob> vertexShader = CompileShader(CacheBenchmarkVertexShader, "vs_5_1", nullptr);
+		D3D12_RT_FORMAT_ARRAY renderTargetFormats = {};
+		renderTargetFormats.NumRenderTargets = 1;
+		renderTargetFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		using Stream = PipelineStream<
+			CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE,
+			CD3DX12_PIPELINE_STATE_STREAM_VS,
+			CD3DX12_PIPELINE_STATE_STREAM_PS,
+			CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY,
+			CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS>;
+
+		// The streams point at the shaders, and the descs at the streams.
+		std::vector<ComPtr<ID3DBlob>> pixelShaders;
+		std::vector<Stream> streams;
+		streams.reserve(commandLine.PipelineCount);
+		for (UINT i = 0; i < commandLine.PipelineCount; ++i)
+		{
+			std::string variant = std::to_string(i);
+			const D3D_SHADER_MACRO defines[] = { { "VARIANT", variant.c_str() }, { nullptr, nullptr } };
+			pixelShaders.push_back(CompileShader(CacheBenchmarkPixelShader, "ps_5_1", defines));
+			streams.push_back(MakePipelineStream(
+				CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE(rootSignature.Get()),
+				CD3DX12_PIPELINE_STATE_STREAM_VS(CD3DX12_SHADER_BYTECODE(vertexShader.Get())),
+				CD3DX12_PIPELINE_STATE_STREAM_PS(CD3DX12_SHADER_BYTECODE(pixelShaders.back().Get())),
+				CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE),
+				CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS(renderTargetFormats)));
+		}
+		std::vector<D3D12_PIPELINE_STATE_STREAM_DESC> descs;
+		for (Stream& stream : streams)
+		{
+			descs.push_back(stream.GetDesc());
+		}
+
+		std::wstring path = commandLine.OutputPath.empty() ? L"pipelines.cache" : commandLine.OutputPath;
+		PipelineLibraryCache::BenchmarkResult result = PipelineLibraryCache::RunBenchmark(device, path, descs);
+		wprintf(L"%u pipelines  cold %.1f ms  warm %.1f ms  (%llu loaded from the library)\n",
+			result.PipelineCount, result.ColdMilliseconds, result.WarmMilliseconds, result.WarmLibraryHits);
+		return 0;
+	}
+
+	// Every permutation defines a different VARIANT, so every one misses on
+	// the cold pass. The include puts a second file in each key.
+	const char* const ShaderCacheBenchmarkInclude =
+		"float4 Shade(float2 position, float variant)\n"
+		"{\n"
+		"    float4 color = float4(position * variant, variant, 1);\n"
+		"    [unroll] for (int i = 0; i < 16; ++i) { color = sin(color * 1.1 + i); }\n"
+		"    return color;\n"
+		"}\n";
+	const char* const ShaderCacheBenchmarkShader =
+		"#include \"shader_cache_benchmark.hlsli\"\n"
+		"float4 main(float4 position : SV_Position) : SV_Target { return Shade(position.xy, VARIANT / 65536.0); }\n";
+
+	bool WriteTextFile(const std::wstring& path, const char* text)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		file << text;
+		file.close();
+		return static_cast<bool>(file);
+	}
+
+	int RunShaderCacheBenchmark(const CommandLine& commandLine)
+	{
+		std::wstring path = commandLine.OutputPath.empty() ? L"shaders.pack" : commandLine.OutputPath;
+		size_t slash = path.find_last_of(L"\\/");
+		std::wstring directory = slash == std::wstring::npos ? std::wstring() : path.substr(0, slash + 1);
+
+		std::wstring sourcePath = directory + L"shader_cache_benchmark.hlsl";
+		std::wstring includePath = directory + L"shader_cache_benchmark.hlsli";
+		if (!WriteTextFile(sourcePath, ShaderCacheBenchmarkShader) || !WriteTextFile(includePath, ShaderCacheBenchmarkInclude))
+		{
+			fwprintf(stderr, L"Cannot write the benchmark shaders next to %ls.\n", path.c_str());
+			return 1;
+		}
+
+		std::vector<ShaderDesc> descs(commandLine.PermutationCount);
+		for (UINT i = 0; i < commandLine.PermutationCount; ++i)
+		{
+			descs[i].Path = sourcePath;
+			descs[i].Profile = "ps_5_1";
+			descs[i].Defines.push_back({ "VARIANT", std::to_string(i) });
+		}
+
+		JobSystem::Options jobOptions;
+		jobOptions.ThreadCount = commandLine.BenchmarkOptions.ThreadCount;
+		JobSystem jobs(jobOptions);
+
+		ShaderCache::BenchmarkResult result = ShaderCache::RunBenchmark(
+			[]() { return std::make_unique<D3DShaderCompiler>(); }, path, descs, jobs);
+		const ShaderCache::Stats& warm = result.Warm;
+		wprintf(L"%u shaders  cold %.1f ms  warm %.1f ms\n", result.ShaderCount, result.ColdMilliseconds, result.WarmMilliseconds);
+		wprintf(L"warm: %llu hits  %llu misses  %llu failures  hit rate %.1f%%  %.1f ms of compiling saved\n",
+			warm.Hits, warm.Misses, warm.Failures, warm.GetHitRate() * 100.0, warm.SavedMilliseconds);
+		return warm.Failures == 0 ? 0 : 1;
+	}
+
+	bool ReadBinaryFile(const std::wstring& path, std::vector<char>& data)
+	{
+		std::ifstream file(path, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return file.is_open() && !file.bad();
+	}
+
+	// Fills generated and returns its description.
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC* GenerateRootSignature(const std::vector<std::wstring>& paths, GeneratedRootSignature& generated)
+	{
+		std::vector<ShaderReflection> reflections(paths.size());
+		std::vector<const ShaderReflection*> shaders;
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			std::vector<char> bytecode;
+			if (!ReadBinaryFile(paths[i], bytecode))
+			{
+				fwprintf(stderr, L"Cannot read %ls.\n", paths[i].c_str());
+				return nullptr;
+			}
+
+			std::string error;
+			if (!ReflectShader(bytecode.data(), bytecode.size(), reflections[i], error))
+			{
+				fwprintf(stderr, L"Cannot reflect %ls: %hs\n", paths[i].c_str(), error.c_str());
+				return nullptr;
+			}
+			shaders.push_back(&reflections[i]);
+		}
+
+		std::string error;
+		if (!RootSignatureGenerator::Generate(shaders, generated, error))
+		{
+			fwprintf(stderr, L"Cannot generate a root signature: %hs\n", error.c_str());
+			return nullptr;
+		}
+		return &generated.Layout.GetDesc();
+	}
+
+	int RunRootSignature(const CommandLine& commandLine)
+	{
+		GeneratedRootSignature generated;
+		ComPtr<ID3D12VersionedRootSignatureDeserializer> deserializer;
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC* desc = nullptr;
+		std::vector<RootParameterUsage> usage;
+		if (commandLine.SignaturePath.empty())
+		{
+			desc = GenerateRootSignature(commandLine.ShaderPaths, generated);
+			if (!desc)
+			{
+				return 1;
+			}
+			// The stages that read each parameter are known from the shaders.
+			usage = RootSignatureGenerator::GetUsage(generated);
+		}
+		else
+		{
+			std::vector<char> blob;
+			if (!ReadBinaryFile(commandLine.SignaturePath, blob)
+				|| FAILED(D3D12CreateVersionedRootSignatureDeserializer(blob.data(), blob.size(), IID_PPV_ARGS(&deserializer)))
+				|| FAILED(deserializer->GetRootSignatureDescAtVersion(D3D_ROOT_SIGNATURE_VERSION_1_1, &desc)))
+			{
+				fwprintf(stderr, L"Cannot read a root signature from %ls.\n", commandLine.SignaturePath.c_str());
+				return 1;
+			}
+		}
+
+		if (!commandLine.UsagePath.empty())
+		{
+			std::ifstream file(commandLine.UsagePath);
+			std::string error;
+			if (!file)
+			{
+				fwprintf(stderr, L"Cannot read %ls.\n", commandLine.UsagePath.c_str());
+				return 1;
+			}
+			if (!RootSignatureAnalyzer::ReadUsage(file, usage, error))
+			{
+				fwprintf(stderr, L"%ls: %hs\n", commandLine.UsagePath.c_str(), error.c_str());
+				return 1;
+			}
+			if (usage.size() > desc->Desc_1_1.NumParameters)
+			{
+				fwprintf(stderr, L"%ls: the root signature has only %u parameters.\n", commandLine.UsagePath.c_str(), desc->Desc_1_1.NumParameters);
+				return 1;
+			}
+		}
+
+		RootSignatureLayout optimized = RootSignatureAnalyzer::Optimize(*desc, usage);
+
+		std::ostringstream report;
+		RootSignatureAnalyzer::WriteComparison(report, *desc, usage, optimized);
+		if (!generated.Bindings.empty())
+		{
+			report << "\n";
+			RootSignatureGenerator::WriteBindings(report, generated);
+		}
+
+		UINT promoted = 0;
+		UINT demoted = 0;
+		for (const RootParameterBinding& binding : optimized.GetBindings())
+		{
+			promoted += binding.Action == RootParameterAction::Promoted;
+			demoted += binding.Action == RootParameterAction::Demoted;
+		}
+		report << "\n" << promoted << " promoted, " << demoted << " demoted, "
+			<< RootSignatureAnalyzer::Analyze(*desc, usage).TotalDwords << " -> "
+			<< RootSignatureAnalyzer::Analyze(optimized.GetDesc()).TotalDwords << " DWORDs\n";
+		wprintf(L"%hs", report.str().c_str());
+
+		if (!optimized.IsWithinBudget())
+		{
+			fwprintf(stderr, L"The optimized root signature is still over the %u DWORD budget. Move root constants into constant buffers or merge descriptor tables.\n",
+				RootSignatureAnalyzer::Options().DwordBudget);
+			return 1;
+		}
+		return 0;
+	}
+}
+
+int main()
+{
+	assert(StaticDescHashesMatchRuntime() && "HashStaticDesc must match HashValue of the d3dx12-built descs.");
+
+	int argc = 0;
+	wchar_t** argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+	if (!argv)
+	{
+		return 1;
+	}
+
+	CommandLine commandLine;
+	bool parsed = ParseCommandLine(argc, argv, commandLine);
+	::LocalFree(argv);
+
+	if (!parsed || commandLine.Mode == RunMode::None)
+	{
+		PrintUsage();
+		return parsed ? 0 : 1;
+	}
+
+	try
+	{
+		switch (commandLine.Mode)
+		{
+		case RunMode::Perf:
+			return RunPerf(commandLine);
+		case RunMode::PipelineCache:
+			return RunPipelineCacheBenchmark(commandLine);
+		case RunMode::RootSignature:
+			return RunRootSignature(commandLine);
+		case RunMode::ParallelRecord:
+			return RunParallelRecord(commandLine);
+		case RunMode::Jobs:
+			return RunJobs(commandLine);
+		case RunMode::SubmitThread:
+			return RunSubmitThread(commandLine);
+		case RunMode::DrawSort:
+			return RunDrawSort(commandLine);
+		case RunMode::Indirect:
+			return RunIndirect();
+		case RunMode::Profiler:
+			return RunProfiler();
+		case RunMode::ShaderCache:
+			return RunShaderCacheBenchmark(commandLine);
+		default:
+			return RunBenchmark(commandLine);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		fwprintf(stderr, L"Benchmark failed: %hs\n", e.what());
+		return 1;
+	}
+}